@@ -0,0 +1,568 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "abrladder.h"
+#include "encoder.h"
+
+#include <ctype.h>
+
+using namespace X265_NS;
+
+template<typename T>
+static void downscalePlane(const void* srcPlane, int srcStride, void* dstPlane, int dstStride, int width, int height)
+{
+    const T* src = (const T*)srcPlane;
+    T* dst = (T*)dstPlane;
+    srcStride /= sizeof(T);
+    dstStride /= sizeof(T);
+
+    for (int y = 0; y < height; y++, src += 2 * srcStride, dst += dstStride)
+    {
+        for (int x = 0; x < width; x++)
+            dst[x] = (T)((src[2 * x] + src[2 * x + 1] + src[srcStride + 2 * x] + src[srcStride + 2 * x + 1] + 2) >> 2);
+    }
+}
+
+/* a token following an option is its value unless it is another option,
+ * negative numbers are values */
+static bool isValue(const char* token)
+{
+    return token[0] != '-' || isdigit((unsigned char)token[1]) || token[1] == '.';
+}
+
+AbrLadder::AbrLadder()
+{
+    m_api = NULL;
+    m_threadPool = NULL;
+    memset(&m_info, 0, sizeof(m_info));
+    memset(m_rungs, 0, sizeof(m_rungs));
+    m_numRungs = 0;
+    m_maxShift = 0;
+    m_srcDepth = 8;
+    m_csp = X265_CSP_I420;
+}
+
+bool AbrLadder::parse(const char* fileName, const x265_api* api, const x265_param* base, const InputFileInfo& info)
+{
+    m_api = api;
+    m_info = info;
+    m_csp = info.csp;
+    m_srcDepth = info.depth;
+
+    if (info.csp >= X265_CSP_NV12)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "abr-ladder requires planar input\n");
+        return true;
+    }
+
+    FILE* file = x265_fopen(fileName, "r");
+    if (!file)
+    {
+        x265_log_file(NULL, X265_LOG_ERROR, "unable to open abr-ladder file <%s>\n", fileName);
+        return true;
+    }
+
+    char line[2048];
+    int lineNum = 0;
+    bool bError = false;
+    while (!bError && fgets(line, sizeof(line), file))
+    {
+        lineNum++;
+        char* start = line + strspn(line, " \t\r\n");
+        if (!*start || *start == '#')
+            continue;
+        if (m_numRungs == X265_LADDER_MAX_RUNGS)
+        {
+            x265_log(NULL, X265_LOG_ERROR, "abr-ladder supports at most %d rungs\n", X265_LADDER_MAX_RUNGS);
+            bError = true;
+        }
+        else
+            bError = parseRung(start, lineNum, base);
+    }
+    fclose(file);
+    if (bError)
+        return true;
+    if (!m_numRungs)
+    {
+        x265_log_file(NULL, X265_LOG_ERROR, "abr-ladder file <%s> describes no rung\n", fileName);
+        return true;
+    }
+
+    /* A rung loads the analysis of its parent either at the same resolution
+     * or at half its resolution (scale-factor 2). scaleFactor is shared by
+     * the save and the load sides of an encoder, so the children of a rung
+     * must all be scaled as the rung itself is; the root takes the scaling
+     * of its children */
+    bool bRootScaled = false;
+    for (int i = 1; i < m_numRungs; i++)
+    {
+        LadderRung& rung = m_rungs[i];
+        LadderRung& parent = m_rungs[rung.parent];
+        int levels = parent.shift - rung.shift;
+        if (levels < 0 || levels > 1)
+        {
+            x265_log(NULL, X265_LOG_ERROR, "abr-ladder rung %s: must have the resolution of rung %s or twice its resolution\n",
+                     rung.name, parent.name);
+            return true;
+        }
+        rung.param->scaleFactor = levels ? 2 : 0;
+        if (!rung.parent && !bRootScaled)
+        {
+            parent.param->scaleFactor = rung.param->scaleFactor;
+            bRootScaled = true;
+        }
+        else if (parent.param->scaleFactor != rung.param->scaleFactor)
+        {
+            if (rung.parent)
+                x265_log(NULL, X265_LOG_ERROR, "abr-ladder rung %s: must be scaled from rung %s as %s is scaled from its own parent\n",
+                         rung.name, parent.name, parent.name);
+            else
+                x265_log(NULL, X265_LOG_ERROR, "abr-ladder rung %s: rungs loading from rung %s must all have the same resolution\n",
+                         rung.name, parent.name);
+            return true;
+        }
+        if (rung.param->rc.vbvBufferSize && rung.param->rc.vbvMaxBitrate &&
+            !(parent.param->rc.vbvBufferSize && parent.param->rc.vbvMaxBitrate))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "abr-ladder rung %s: VBV requires VBV on rung %s, whose lookahead it reuses\n",
+                     rung.name, parent.name);
+            return true;
+        }
+    }
+
+    for (int i = 0; i < m_numRungs; i++)
+    {
+        LadderRung& rung = m_rungs[i];
+        bool bParent = false;
+        for (int j = i + 1; j < m_numRungs && !bParent; j++)
+            bParent = m_rungs[j].parent == i;
+
+        /* the analysis is handed over in memory, through the x265_picture
+         * analysisData, and the file names are only used to enable save and
+         * load. Only the root rung runs a lookahead, its decisions are part
+         * of the analysis data */
+        rung.param->bUseAnalysisFile = 0;
+        rung.param->analysisSave = bParent ? strdup(rung.name) : NULL;
+        rung.param->analysisLoad = i ? strdup(m_rungs[rung.parent].name) : NULL;
+        rung.param->bDisableLookahead = m_numRungs > 1;
+        rung.param->sourceWidth = m_info.width >> rung.shift;
+        rung.param->sourceHeight = m_info.height >> rung.shift;
+
+        InputFileInfo outInfo = m_info;
+        outInfo.width = rung.param->sourceWidth;
+        outInfo.height = rung.param->sourceHeight;
+        rung.output = OutputFile::open(rung.outputName, outInfo);
+        if (rung.output->isFail())
+        {
+            x265_log_file(NULL, X265_LOG_ERROR, "failed to open output file <%s> for writing\n", rung.outputName);
+            return true;
+        }
+        rung.output->setParam(rung.param);
+        general_log_file(rung.param, rung.output->getName(), X265_LOG_INFO, "rung %s %dx%d%s%s, output file: %s\n",
+                         rung.name, rung.param->sourceWidth, rung.param->sourceHeight, i ? " loads " : "",
+                         i ? m_rungs[rung.parent].name : "", rung.outputName);
+    }
+    return false;
+}
+
+bool AbrLadder::parseRung(char* line, int lineNum, const x265_param* base)
+{
+    LadderRung& rung = m_rungs[m_numRungs];
+    char parentName[64];
+    int length = 0;
+
+    if (sscanf(line, " [%63[^]:]:%63[^]]]%n", rung.name, parentName, &length) != 2 || !length)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "abr-ladder line %d: expected [name:parent] followed by options\n", lineNum);
+        return true;
+    }
+
+    rung.parent = -1;
+    for (int i = 0; i < m_numRungs; i++)
+    {
+        if (!strcmp(m_rungs[i].name, rung.name))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "abr-ladder line %d: rung %s is already defined\n", lineNum, rung.name);
+            return true;
+        }
+        if (!strcmp(m_rungs[i].name, parentName))
+            rung.parent = i;
+    }
+    if (!m_numRungs != !strcmp(parentName, "nil") || (m_numRungs && rung.parent < 0))
+    {
+        x265_log(NULL, X265_LOG_ERROR, "abr-ladder line %d: the first rung must be the only one with a nil parent, "
+                 "other rungs load from a rung defined before them\n", lineNum);
+        return true;
+    }
+
+    rung.param = m_api->param_alloc();
+    if (!rung.param)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "param alloc failed\n");
+        return true;
+    }
+    memcpy(rung.param, base, sizeof(x265_param));
+
+    /* the encoder releases the string arguments of its param. Those of the
+     * command line are handed to the root rung, the other rungs own copies */
+    rung.param->analysisSave = rung.param->analysisLoad = NULL;
+    const char** strings[Encoder::MAX_PARAM_STRINGS];
+    int numStrings = Encoder::getParamStrings(rung.param, strings);
+    for (int i = 0; i < numStrings; i++)
+    {
+        if (*strings[i] && m_numRungs)
+            *strings[i] = strdup(*strings[i]);
+    }
+    rung.param->analysisReuseLevel = 10;
+    m_numRungs++;
+
+    std::vector<char*> tokens;
+    for (char* token = strtok(line + length, " \t\r\n"); token; token = strtok(NULL, " \t\r\n"))
+        tokens.push_back(token);
+
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+        const char* name = tokens[i];
+        const char* value = i + 1 < tokens.size() && isValue(tokens[i + 1]) ? tokens[++i] : NULL;
+
+        if (!strcmp(name, "-o") || !strcmp(name, "--output"))
+        {
+            if (value)
+                rung.outputName = strdup(value);
+        }
+        else if (strncmp(name, "--", 2))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "abr-ladder line %d: %s is not a long option\n", lineNum, name);
+            return true;
+        }
+        else if (m_api->param_parse(rung.param, name + 2, value))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "abr-ladder line %d: invalid argument: %s = %s\n", lineNum, name + 2, value ? value : "");
+            return true;
+        }
+    }
+    if (!rung.outputName)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "abr-ladder line %d: rung %s has no output file\n", lineNum, rung.name);
+        return true;
+    }
+
+    /* the rung resolution must be the source resolution divided by a power
+     * of two, with whole chroma samples, and within the input file limits */
+    const x265_cli_csp& csp = x265_cli_csps[m_csp];
+    for (rung.shift = 0; rung.shift <= X265_LADDER_MAX_SHIFT; rung.shift++)
+    {
+        int widthMask = (1 << (rung.shift + csp.width[1])) - 1;
+        int heightMask = (1 << (rung.shift + csp.height[1])) - 1;
+        if (rung.param->sourceWidth == m_info.width >> rung.shift && rung.param->sourceHeight == m_info.height >> rung.shift &&
+            !(m_info.width & widthMask) && !(m_info.height & heightMask))
+            break;
+    }
+    if (rung.shift > X265_LADDER_MAX_SHIFT || rung.param->sourceWidth < MIN_FRAME_WIDTH || rung.param->sourceHeight < MIN_FRAME_HEIGHT)
+    {
+        x265_log(NULL, X265_LOG_ERROR, "abr-ladder line %d: rung %s resolution %dx%d is not the source resolution %dx%d divided by 1, 2, 4 or 8, "
+                 "or is below %dx%d\n", lineNum, rung.name, rung.param->sourceWidth, rung.param->sourceHeight, m_info.width, m_info.height,
+                 MIN_FRAME_WIDTH, MIN_FRAME_HEIGHT);
+        return true;
+    }
+    m_maxShift = X265_MAX(m_maxShift, rung.shift);
+    return false;
+}
+
+int AbrLadder::open()
+{
+    /* NULL with --pools none on the root rung, each rung then has its own
+     * pools, if any */
+    m_threadPool = m_api->threadpool_create(m_rungs[0].param);
+
+    for (int i = 0; i < m_numRungs; i++)
+    {
+        LadderRung& rung = m_rungs[i];
+        rung.param->threadPool = m_threadPool;
+        rung.encoder = m_api->encoder_open(rung.param);
+        if (!rung.encoder)
+        {
+            x265_log(NULL, X265_LOG_ERROR, "failed to open encoder of rung %s\n", rung.name);
+            return 2;
+        }
+
+        /* get the encoder parameters post-initialization */
+        m_api->encoder_parameters(rung.encoder, rung.param);
+        m_api->picture_init(rung.param, &rung.picOut);
+        if (rung.output->needPTS())
+            rung.ptsQueue = new std::priority_queue<int64_t>();
+
+        if (!rung.param->bRepeatHeaders)
+        {
+            x265_nal* nal;
+            uint32_t numNal;
+            if (m_api->encoder_headers(rung.encoder, &nal, &numNal) < 0)
+            {
+                x265_log(NULL, X265_LOG_ERROR, "Failure generating stream headers of rung %s\n", rung.name);
+                return 3;
+            }
+            rung.totalBytes += rung.output->writeHeaders(nal, numNal);
+        }
+    }
+    return 0;
+}
+
+bool AbrLadder::encode(const x265_picture* pic_in)
+{
+    if (pic_in)
+    {
+        LadderFrame* frame = addFrame(*pic_in);
+        return frame && feed(0, frame, NULL) >= 0;
+    }
+
+    /* flush in ladder order, a rung only gets new input while its parent
+     * is being encoded or flushed */
+    for (int i = 0; i < m_numRungs; i++)
+    {
+        int numEncoded;
+        do
+            numEncoded = feed(i, NULL, NULL);
+        while (numEncoded > 0);
+        if (numEncoded < 0)
+            return false;
+    }
+    return true;
+}
+
+int AbrLadder::feed(int index, LadderFrame* frame, const x265_analysis_data* analysis)
+{
+    LadderRung& rung = m_rungs[index];
+    x265_picture pic;
+    x265_picture* pic_in = NULL;
+
+    if (frame)
+    {
+        m_api->picture_init(rung.param, &pic);
+        pic.poc = frame->poc;
+        pic.pts = frame->pts;
+        pic.bitDepth = m_srcDepth;
+        pic.colorSpace = m_csp;
+        for (int i = 0; i < x265_cli_csps[m_csp].planes; i++)
+        {
+            pic.planes[i] = frame->planes[rung.shift][i];
+            pic.stride[i] = frame->stride[rung.shift][i];
+        }
+        if (analysis)
+            pic.analysisData = *analysis;
+        pic_in = &pic;
+    }
+
+    x265_nal* nal;
+    uint32_t numNal;
+    int numEncoded = m_api->encoder_encode(rung.encoder, &nal, &numNal, pic_in, &rung.picOut);
+
+    /* the encoder has copied the picture and its analysis */
+    if (frame && !--frame->pending)
+        releaseFrame(frame);
+    if (numEncoded < 0)
+        return -1;
+
+    if (numNal)
+    {
+        rung.totalBytes += rung.output->writeFrame(nal, numNal, rung.picOut);
+        if (rung.ptsQueue)
+        {
+            rung.ptsQueue->push(-rung.picOut.pts);
+            if (rung.ptsQueue->size() > 2)
+                rung.ptsQueue->pop();
+        }
+    }
+    if (!numEncoded)
+        return 0;
+
+    /* hand the picture and its analysis over to the children while the
+     * analysis buffers are valid, they are released by the next call to
+     * x265_encoder_encode() of this rung */
+    rung.outFrameCount++;
+    LadderFrame* out = NULL;
+    for (int i = index + 1; i < m_numRungs; i++)
+    {
+        if (m_rungs[i].parent != index)
+            continue;
+        if (!out && !(out = findFrame(rung.picOut.poc)))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "abr-ladder rung %s: output picture %d has no source\n", rung.name, rung.picOut.poc);
+            return -1;
+        }
+        x265_analysis_data outAnalysis = rung.picOut.analysisData;
+        if (feed(i, out, &outAnalysis) < 0)
+            return -1;
+    }
+    return numEncoded;
+}
+
+LadderFrame* AbrLadder::addFrame(const x265_picture& pic)
+{
+    const x265_cli_csp& csp = x265_cli_csps[m_csp];
+    int bytes = pic.bitDepth > 8 ? 2 : 1;
+    m_srcDepth = pic.bitDepth;
+
+    LadderFrame* frame = NULL;
+    if (m_freeFrames.size())
+    {
+        frame = m_freeFrames.back();
+        m_freeFrames.pop_back();
+    }
+    else
+    {
+        frame = new LadderFrame;
+        memset(frame, 0, sizeof(LadderFrame));
+        for (int s = 0; s <= m_maxShift; s++)
+        {
+            for (int i = 0; i < csp.planes; i++)
+            {
+                int width = (m_info.width >> s) >> csp.width[i];
+                int height = (m_info.height >> s) >> csp.height[i];
+                frame->stride[s][i] = width * bytes;
+                frame->planes[s][i] = x265_malloc(width * height * bytes);
+                if (!frame->planes[s][i])
+                {
+                    x265_log(NULL, X265_LOG_ERROR, "abr-ladder: picture allocation failure\n");
+                    m_freeFrames.push_back(frame);
+                    return NULL;
+                }
+            }
+        }
+    }
+
+    frame->poc = pic.poc;
+    frame->pts = pic.pts;
+    frame->pending = m_numRungs;
+    for (int i = 0; i < csp.planes; i++)
+    {
+        int width = m_info.width >> csp.width[i];
+        int height = m_info.height >> csp.height[i];
+        const uint8_t* src = (const uint8_t*)pic.planes[i];
+        uint8_t* dst = (uint8_t*)frame->planes[0][i];
+        for (int y = 0; y < height; y++, src += pic.stride[i], dst += frame->stride[0][i])
+            memcpy(dst, src, width * bytes);
+
+        for (int s = 1; s <= m_maxShift; s++)
+        {
+            width = (m_info.width >> s) >> csp.width[i];
+            height = (m_info.height >> s) >> csp.height[i];
+            if (bytes == 2)
+                downscalePlane<uint16_t>(frame->planes[s - 1][i], frame->stride[s - 1][i], frame->planes[s][i], frame->stride[s][i], width, height);
+            else
+                downscalePlane<uint8_t>(frame->planes[s - 1][i], frame->stride[s - 1][i], frame->planes[s][i], frame->stride[s][i], width, height);
+        }
+    }
+    m_frames.push_back(frame);
+    return frame;
+}
+
+LadderFrame* AbrLadder::findFrame(int poc)
+{
+    for (size_t i = 0; i < m_frames.size(); i++)
+    {
+        if (m_frames[i]->poc == poc)
+            return m_frames[i];
+    }
+    return NULL;
+}
+
+void AbrLadder::releaseFrame(LadderFrame* frame)
+{
+    for (size_t i = 0; i < m_frames.size(); i++)
+    {
+        if (m_frames[i] == frame)
+        {
+            m_frames.erase(m_frames.begin() + i);
+            break;
+        }
+    }
+    m_freeFrames.push_back(frame);
+}
+
+uint64_t AbrLadder::totalBytes() const
+{
+    uint64_t bytes = 0;
+    for (int i = 0; i < m_numRungs; i++)
+        bytes += m_rungs[i].totalBytes;
+    return bytes;
+}
+
+void AbrLadder::close(int argc, char** argv, bool bAborted)
+{
+    for (int i = 0; i < m_numRungs; i++)
+    {
+        LadderRung& rung = m_rungs[i];
+        if (!rung.encoder)
+            continue;
+
+        general_log(rung.param, NULL, X265_LOG_INFO, "rung %s: %u frames, %.2f kb/s\n", rung.name, rung.outFrameCount,
+                    rung.outFrameCount ? 0.008 * rung.totalBytes * rung.param->fpsNum / (rung.param->fpsDenom * (double)rung.outFrameCount) : 0);
+        if (rung.param->csvfn && !bAborted)
+            m_api->encoder_log(rung.encoder, argc, argv);
+        m_api->encoder_close(rung.encoder);
+        rung.encoder = NULL;
+
+        int64_t second_largest_pts = 0;
+        int64_t largest_pts = 0;
+        if (rung.ptsQueue && rung.ptsQueue->size() >= 2)
+        {
+            second_largest_pts = -rung.ptsQueue->top();
+            rung.ptsQueue->pop();
+            largest_pts = -rung.ptsQueue->top();
+            rung.ptsQueue->pop();
+        }
+        rung.output->closeFile(largest_pts, second_largest_pts);
+    }
+}
+
+void AbrLadder::destroy()
+{
+    for (int i = 0; i < m_numRungs; i++)
+    {
+        LadderRung& rung = m_rungs[i];
+        if (rung.encoder)
+            m_api->encoder_close(rung.encoder);
+        if (rung.output)
+            rung.output->release();
+        delete rung.ptsQueue;
+        free((char*)rung.outputName);
+        /* the analysis file names belong to the encoder, which frees them */
+        m_api->param_free(rung.param);
+    }
+    m_numRungs = 0;
+
+    if (m_threadPool)
+    {
+        m_api->threadpool_free(m_threadPool);
+        m_threadPool = NULL;
+    }
+
+    m_freeFrames.insert(m_freeFrames.end(), m_frames.begin(), m_frames.end());
+    m_frames.clear();
+    for (size_t f = 0; f < m_freeFrames.size(); f++)
+    {
+        for (int s = 0; s <= X265_LADDER_MAX_SHIFT; s++)
+            for (int i = 0; i < 3; i++)
+                x265_free(m_freeFrames[f]->planes[s][i]);
+        delete m_freeFrames[f];
+    }
+    m_freeFrames.clear();
+}
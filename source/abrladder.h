@@ -0,0 +1,130 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_ABRLADDER_H
+#define X265_ABRLADDER_H
+
+#include "x265.h"
+#include "input/input.h"
+#include "output/output.h"
+
+#include <vector>
+#include <queue>
+
+namespace X265_NS {
+// private x265 namespace
+
+/* In-process ABR ladder, see --abr-ladder.
+ *
+ * The ladder file describes one rung per line:
+ *
+ *   [name:parent] --bitrate 800 --input-res 960x540 -o out540.hevc
+ *
+ * The parent is the name of a rung on a previous line, or nil for the root
+ * rung. The source is read once, at its own resolution, and every rung
+ * encodes it at the source resolution divided by a power of two.
+ *
+ * Only the root rung runs a lookahead. Each rung hands its analysis over to
+ * its children in memory, as pic_out->analysisData of the parent becomes
+ * pic_in->analysisData of the children (analysis-reuse-level 10, refined by
+ * the children with the scale-factor/refine-* machinery). Children are fed
+ * in the encode order of their parent, so source pictures are held until
+ * every rung has consumed them. All the rungs share one set of thread pools,
+ * sized by the options of the root rung */
+
+#define X265_LADDER_MAX_RUNGS 16
+#define X265_LADDER_MAX_SHIFT 3
+
+struct LadderRung
+{
+    char          name[64];
+    int           parent;       // index of the parent rung, -1 for the root
+    int           shift;        // log2 of the source to rung downscale
+    x265_param*   param;
+    x265_encoder* encoder;
+    OutputFile*   output;
+    const char*   outputName;
+    x265_picture  picOut;
+    uint64_t      totalBytes;
+    uint32_t      outFrameCount;
+    std::priority_queue<int64_t>* ptsQueue;
+};
+
+struct LadderFrame
+{
+    int      poc;
+    int64_t  pts;
+    int      pending;           // rungs not yet fed with this picture
+    void*    planes[X265_LADDER_MAX_SHIFT + 1][3];
+    int      stride[X265_LADDER_MAX_SHIFT + 1][3];
+};
+
+class AbrLadder
+{
+public:
+
+    AbrLadder();
+    ~AbrLadder() { destroy(); }
+
+    /* reads the ladder file, every rung starts from a copy of the command
+     * line param. Returns true on error, like CLIOptions::parse() */
+    bool parse(const char* fileName, const x265_api* api, const x265_param* base, const InputFileInfo& info);
+
+    /* opens the encoders and the output files, writes the stream headers.
+     * Returns 0 or a CLI return code */
+    int  open();
+
+    /* feeds a source picture to the root rung, NULL flushes all the rungs.
+     * Returns false if an encoder aborted */
+    bool encode(const x265_picture* pic_in);
+
+    void close(int argc, char** argv, bool bAborted);
+    void destroy();
+
+    uint32_t rootFrameCount() const { return m_numRungs ? m_rungs[0].outFrameCount : 0; }
+    uint64_t totalBytes() const;
+
+protected:
+
+    const x265_api* m_api;
+    x265_threadpool* m_threadPool;
+    InputFileInfo   m_info;
+    LadderRung      m_rungs[X265_LADDER_MAX_RUNGS];
+    int             m_numRungs;
+    int             m_maxShift;
+    int             m_srcDepth;
+    int             m_csp;
+    std::vector<LadderFrame*> m_frames;      // source pictures not yet fed to every rung
+    std::vector<LadderFrame*> m_freeFrames;
+
+    bool parseRung(char* line, int lineNum, const x265_param* base);
+
+    /* encodes a picture, or flushes if frame is NULL, and feeds the output
+     * to the children of the rung. Returns the number of output pictures or
+     * -1 on abort */
+    int  feed(int rung, LadderFrame* frame, const x265_analysis_data* analysis);
+    LadderFrame* addFrame(const x265_picture& pic);
+    LadderFrame* findFrame(int poc);
+    void releaseFrame(LadderFrame* frame);
+};
+}
+
+#endif // ifndef X265_ABRLADDER_H
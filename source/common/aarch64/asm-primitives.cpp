@@ -0,0 +1,48 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "x265.h"
+#include "cpu.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* The AArch64 primitives are NEON and SVE intrinsics rather than assembly,
+ * but they are selected here so the encoder and the test bench treat them
+ * like any other architecture's assembly */
+void setupAssemblyPrimitives(EncoderPrimitives &p, int cpuMask)
+{
+    if (cpuMask & X265_CPU_NEON)
+    {
+        setupPixelPrimitives_neon(p);      // pixel-neon.cpp
+        setupFilterPrimitives_neon(p);     // ipfilter-neon.cpp
+        setupDCTPrimitives_neon(p);        // dct-neon.cpp
+        setupIntraPrimitives_neon(p);      // intrapred-neon.cpp
+        setupLoopFilterPrimitives_neon(p); // loopfilter-neon.cpp
+    }
+#if HAVE_SVE
+    if (cpuMask & X265_CPU_SVE)
+        setupPixelPrimitives_sve(p);       // pixel-util-sve.cpp
+#endif
+}
+} // namespace X265_NS
@@ -0,0 +1,295 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "neon-util.h"
+
+/* Transforms and quantization. The partial butterflies of dct.cpp only
+ * regroup the integer sums of the matrix products, so the passes below use
+ * the even/odd symmetries of the transform matrices instead, vectorized
+ * across four columns, and produce the same results */
+
+using namespace X265_NS;
+
+template<int N>
+static inline const int16_t* transformMatrix()
+{
+    return N == 4 ? &g_t4[0][0] : N == 8 ? &g_t8[0][0] : N == 16 ? &g_t16[0][0] : &g_t32[0][0];
+}
+
+template<int N>
+static void transposeBlock(const int16_t* src, intptr_t srcStride, int16_t* dst)
+{
+    for (int i = 0; i < N; i += 4)
+    {
+        for (int j = 0; j < N; j += 4)
+        {
+            const int16_t* s = src + i * srcStride + j;
+            int16x4_t r0 = vld1_s16(s);
+            int16x4_t r1 = vld1_s16(s + srcStride);
+            int16x4_t r2 = vld1_s16(s + 2 * srcStride);
+            int16x4_t r3 = vld1_s16(s + 3 * srcStride);
+            transpose4x4_s16(r0, r1, r2, r3);
+
+            int16_t* d = dst + j * N + i;
+            vst1_s16(d, r0);
+            vst1_s16(d + N, r1);
+            vst1_s16(d + 2 * N, r2);
+            vst1_s16(d + 3 * N, r3);
+        }
+    }
+}
+
+/* one forward pass, dst[k * N + j] = (row k of the matrix . row j of src)
+ * rounded and shifted, as partialButterflyN(src, dst, shift, N) */
+template<int N>
+static void dctPass(const int16_t* src, intptr_t srcStride, int16_t* dst, int shift)
+{
+    const int16_t* t = transformMatrix<N>();
+    const int32x4_t vshift = vdupq_n_s32(-shift);
+    ALIGN_VAR_32(int16_t, tr[N * N]);
+
+    transposeBlock<N>(src, srcStride, tr);
+
+    for (int j = 0; j < N; j += 4)
+    {
+        /* odd rows of the matrix are antisymmetric, even rows symmetric, and
+         * the even rows split the same way again over the first half */
+        int32x4_t e[N / 2], o[N / 2], ee[N / 4], eo[N / 4];
+        for (int n = 0; n < N / 2; n++)
+        {
+            int32x4_t a = vmovl_s16(vld1_s16(tr + n * N + j));
+            int32x4_t b = vmovl_s16(vld1_s16(tr + (N - 1 - n) * N + j));
+            e[n] = vaddq_s32(a, b);
+            o[n] = vsubq_s32(a, b);
+        }
+        for (int n = 0; n < N / 4; n++)
+        {
+            ee[n] = vaddq_s32(e[n], e[N / 2 - 1 - n]);
+            eo[n] = vsubq_s32(e[n], e[N / 2 - 1 - n]);
+        }
+
+        for (int k = 0; k < N; k++)
+        {
+            const int16_t* tk = t + k * N;
+            int32x4_t sum;
+            if (k & 1)
+            {
+                sum = vmulq_n_s32(o[0], tk[0]);
+                for (int n = 1; n < N / 2; n++)
+                    sum = vmlaq_n_s32(sum, o[n], tk[n]);
+            }
+            else
+            {
+                const int32x4_t* v = (k & 2) ? eo : ee;
+                sum = vmulq_n_s32(v[0], tk[0]);
+                for (int n = 1; n < N / 4; n++)
+                    sum = vmlaq_n_s32(sum, v[n], tk[n]);
+            }
+            vst1_s16(dst + k * N + j, vmovn_s32(vrshlq_s32(sum, vshift)));
+        }
+    }
+}
+
+/* one inverse pass, row j of dst = (column j of src) x matrix, rounded,
+ * shifted and saturated, as partialButterflyInverseN(src, dst, shift, N) */
+template<int N>
+static void idctPass(const int16_t* src, int16_t* dst, intptr_t dstStride, int shift)
+{
+    const int16_t* t = transformMatrix<N>();
+    const int32x4_t vshift = vdupq_n_s32(-shift);
+
+    for (int j = 0; j < N; j++, dst += dstStride)
+    {
+        if (N == 4)
+        {
+            int32x4_t sum = vmull_n_s16(vld1_s16(t), src[j]);
+            for (int n = 1; n < 4; n++)
+                sum = vmlal_n_s16(sum, vld1_s16(t + n * 4), src[n * 4 + j]);
+            vst1_s16(dst, vqmovn_s32(vrshlq_s32(sum, vshift)));
+            continue;
+        }
+
+        /* column N-1-k of the matrix is column k with the odd rows negated */
+        const int H = N == 4 ? 1 : N / 8;
+        int32x4_t e[H], o[H];
+        for (int k = 0; k < H; k++)
+        {
+            e[k] = vdupq_n_s32(0);
+            o[k] = vdupq_n_s32(0);
+        }
+        for (int n = 0; n < N; n += 2)
+        {
+            int16_t se = src[n * N + j];
+            int16_t so = src[(n + 1) * N + j];
+            for (int k = 0; k < H; k++)
+            {
+                e[k] = vmlal_n_s16(e[k], vld1_s16(t + n * N + 4 * k), se);
+                o[k] = vmlal_n_s16(o[k], vld1_s16(t + (n + 1) * N + 4 * k), so);
+            }
+        }
+        for (int k = 0; k < H; k++)
+        {
+            vst1_s16(dst + 4 * k, vqmovn_s32(vrshlq_s32(vaddq_s32(e[k], o[k]), vshift)));
+            int16x4_t mirror = vqmovn_s32(vrshlq_s32(vsubq_s32(e[k], o[k]), vshift));
+            vst1_s16(dst + N - 4 - 4 * k, vrev64_s16(mirror));
+        }
+    }
+}
+
+template<int N, int log2N>
+static void dct_neon(const int16_t* src, int16_t* dst, intptr_t srcStride)
+{
+    const int shift_1st = log2N - 1 + X265_DEPTH - 8;
+    const int shift_2nd = log2N + 6;
+
+    ALIGN_VAR_32(int16_t, coef[N * N]);
+
+    dctPass<N>(src, srcStride, coef, shift_1st);
+    dctPass<N>(coef, N, dst, shift_2nd);
+}
+
+template<int N>
+static void idct_neon(const int16_t* src, int16_t* dst, intptr_t dstStride)
+{
+    const int shift_1st = 7;
+    const int shift_2nd = 12 - (X265_DEPTH - 8);
+
+    ALIGN_VAR_32(int16_t, coef[N * N]);
+
+    idctPass<N>(src, coef, N, shift_1st);
+    idctPass<N>(coef, dst, dstStride, shift_2nd);
+}
+
+static uint32_t quant_neon(const int16_t* coef, const int32_t* quantCoeff, int32_t* deltaU, int16_t* qCoef, int qBits, int add, int numCoeff)
+{
+    X265_CHECK(qBits >= 8, "qBits less than 8\n");
+    X265_CHECK((numCoeff % 16) == 0, "numCoeff must be multiple of 16\n");
+
+    const int32x4_t vadd = vdupq_n_s32(add);
+    const int32x4_t vshl = vdupq_n_s32(qBits);
+    const int32x4_t vshr = vdupq_n_s32(-qBits);
+    const int32x4_t vshr8 = vdupq_n_s32(8 - qBits);
+    uint32x4_t numSig = vdupq_n_u32(0);
+
+    for (int i = 0; i < numCoeff; i += 4)
+    {
+        int32x4_t level = vmovl_s16(vld1_s16(coef + i));
+        int32x4_t tmplevel = vmulq_s32(vabsq_s32(level), vld1q_s32(quantCoeff + i));
+        int32x4_t q = vshlq_s32(vaddq_s32(tmplevel, vadd), vshr);
+
+        vst1q_s32(deltaU + i, vshlq_s32(vsubq_s32(tmplevel, vshlq_s32(q, vshl)), vshr8));
+        numSig = vsubq_u32(numSig, vtstq_s32(q, q));
+        q = vbslq_s32(vcltzq_s32(level), vnegq_s32(q), q);
+        vst1_s16(qCoef + i, vqmovn_s32(q));
+    }
+
+    return vaddvq_u32(numSig);
+}
+
+static uint32_t nquant_neon(const int16_t* coef, const int32_t* quantCoeff, int16_t* qCoef, int qBits, int add, int numCoeff)
+{
+    X265_CHECK((numCoeff % 16) == 0, "number of quant coeff is not multiple of 4x4\n");
+    X265_CHECK((uint32_t)add < ((uint32_t)1 << qBits), "2 ^ qBits less than add\n");
+
+    const int32x4_t vadd = vdupq_n_s32(add);
+    const int32x4_t vshr = vdupq_n_s32(-qBits);
+    uint32x4_t numSig = vdupq_n_u32(0);
+
+    for (int i = 0; i < numCoeff; i += 4)
+    {
+        int32x4_t level = vmovl_s16(vld1_s16(coef + i));
+        int32x4_t q = vshlq_s32(vaddq_s32(vmulq_s32(vabsq_s32(level), vld1q_s32(quantCoeff + i)), vadd), vshr);
+
+        numSig = vsubq_u32(numSig, vtstq_s32(q, q));
+        /* saturate the signed level, then wrap its absolute value as the C
+         * reference does */
+        q = vbslq_s32(vcltzq_s32(level), vnegq_s32(q), q);
+        vst1_s16(qCoef + i, vabs_s16(vqmovn_s32(q)));
+    }
+
+    return vaddvq_u32(numSig);
+}
+
+static void dequant_normal_neon(const int16_t* quantCoef, int16_t* coef, int num, int scale, int shift)
+{
+    X265_CHECK(num <= 32 * 32, "dequant num %d too large\n", num);
+    X265_CHECK((num % 8) == 0, "dequant num %d not multiple of 8\n", num);
+    X265_CHECK(shift <= 10, "shift too large %d\n", shift);
+
+    const int32x4_t vshr = vdupq_n_s32(-shift);
+
+    for (int n = 0; n < num; n += 8)
+    {
+        int16x8_t q = vld1q_s16(quantCoef + n);
+        int32x4_t lo = vrshlq_s32(vmulq_n_s32(vmovl_s16(vget_low_s16(q)), scale), vshr);
+        int32x4_t hi = vrshlq_s32(vmulq_n_s32(vmovl_high_s16(q), scale), vshr);
+        vst1q_s16(coef + n, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+}
+
+static void dequant_scaling_neon(const int16_t* quantCoef, const int32_t* deQuantCoef, int16_t* coef, int num, int per, int shift)
+{
+    X265_CHECK(num <= 32 * 32, "dequant num %d too large\n", num);
+
+    shift += 4;
+
+    if (shift > per)
+    {
+        const int32x4_t vshr = vdupq_n_s32(per - shift);
+        for (int n = 0; n < num; n += 4)
+        {
+            int32x4_t c = vmulq_s32(vmovl_s16(vld1_s16(quantCoef + n)), vld1q_s32(deQuantCoef + n));
+            vst1_s16(coef + n, vqmovn_s32(vrshlq_s32(c, vshr)));
+        }
+    }
+    else
+    {
+        const int32x4_t vshl = vdupq_n_s32(per - shift);
+        for (int n = 0; n < num; n += 4)
+        {
+            int32x4_t c = vmulq_s32(vmovl_s16(vld1_s16(quantCoef + n)), vld1q_s32(deQuantCoef + n));
+            c = vshlq_s32(vmovl_s16(vqmovn_s32(c)), vshl);
+            vst1_s16(coef + n, vqmovn_s32(c));
+        }
+    }
+}
+
+namespace X265_NS {
+void setupDCTPrimitives_neon(EncoderPrimitives &p)
+{
+    p.cu[BLOCK_4x4].dct   = dct_neon<4, 2>;
+    p.cu[BLOCK_8x8].dct   = dct_neon<8, 3>;
+    p.cu[BLOCK_16x16].dct = dct_neon<16, 4>;
+    p.cu[BLOCK_32x32].dct = dct_neon<32, 5>;
+
+    p.cu[BLOCK_4x4].idct   = idct_neon<4>;
+    p.cu[BLOCK_8x8].idct   = idct_neon<8>;
+    p.cu[BLOCK_16x16].idct = idct_neon<16>;
+    p.cu[BLOCK_32x32].idct = idct_neon<32>;
+
+    p.quant = quant_neon;
+    p.nquant = nquant_neon;
+    p.dequant_normal = dequant_normal_neon;
+    p.dequant_scaling = dequant_scaling_neon;
+}
+}
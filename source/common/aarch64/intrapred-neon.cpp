@@ -0,0 +1,281 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "neon-util.h"
+
+/* Planar, DC and angular intra prediction of 8bit pixels. The reference
+ * arrays are built as in intrapred.cpp and only the per row work is
+ * vectorized; horizontal modes are predicted into a buffer and transposed */
+
+using namespace X265_NS;
+
+#if !HIGH_BIT_DEPTH
+
+template<int width>
+static inline uint32_t sumPixels(const pixel* src)
+{
+    if (width == 4)
+        return vaddlv_u8(load4_u8(src));
+    if (width == 8)
+        return vaddlv_u8(vld1_u8(src));
+
+    uint32_t sum = 0;
+    for (int x = 0; x < width; x += 16)
+        sum += vaddlvq_u8(vld1q_u8(src + x));
+    return sum;
+}
+
+template<int width>
+static inline void fillRow(pixel* dst, uint8x16_t v)
+{
+    if (width == 4)
+        store4_u8(dst, vget_low_u8(v));
+    else if (width == 8)
+        vst1_u8(dst, vget_low_u8(v));
+    else
+        for (int x = 0; x < width; x += 16)
+            vst1q_u8(dst + x, v);
+}
+
+static void dcPredFilter(const pixel* above, const pixel* left, pixel* dst, intptr_t dststride, int size)
+{
+    dst[0] = (pixel)((above[0] + left[0] + 2 * dst[0] + 2) >> 2);
+
+    for (int x = 1; x < size; x++)
+        dst[x] = (pixel)((above[x] +  3 * dst[x] + 2) >> 2);
+
+    dst += dststride;
+    for (int y = 1; y < size; y++)
+    {
+        *dst = (pixel)((left[y] + 3 * *dst + 2) >> 2);
+        dst += dststride;
+    }
+}
+
+template<int width>
+static void intra_pred_dc_neon(pixel* dst, intptr_t dstStride, const pixel* srcPix, int /*dirMode*/, int bFilter)
+{
+    uint32_t dcVal = width + sumPixels<width>(srcPix + 1) + sumPixels<width>(srcPix + 2 * width + 1);
+    dcVal /= width + width;
+
+    const uint8x16_t v = vdupq_n_u8((uint8_t)dcVal);
+    for (int y = 0; y < width; y++)
+        fillRow<width>(dst + y * dstStride, v);
+
+    if (bFilter)
+        dcPredFilter(srcPix + 1, srcPix + (2 * width + 1), dst, dstStride, width);
+}
+
+template<int log2Size>
+static void planar_pred_neon(pixel* dst, intptr_t dstStride, const pixel* srcPix, int /*dirMode*/, int /*bFilter*/)
+{
+    const int blkSize = 1 << log2Size;
+    const int chunks = (blkSize + 7) / 8;
+
+    const pixel* above = srcPix + 1;
+    const pixel* left  = srcPix + (2 * blkSize + 1);
+    const int topRight = above[blkSize];
+    const int bottomLeft = left[blkSize];
+
+    /* per column terms; the lanes past a 4 wide block are never stored */
+    static const uint8_t colIdx[8] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+    uint8x8_t top[chunks], colWeight[chunks];
+    uint16x8_t colTerm[chunks];
+    for (int c = 0; c < chunks; c++)
+    {
+        uint8x8_t x = vadd_u8(vld1_u8(colIdx), vdup_n_u8((uint8_t)(8 * c)));
+        top[c] = blkSize == 4 ? load4_u8(above) : vld1_u8(above + 8 * c);
+        colWeight[c] = vsub_u8(vdup_n_u8(blkSize - 1), x);
+        colTerm[c] = vmull_u8(vadd_u8(x, vdup_n_u8(1)), vdup_n_u8((uint8_t)topRight));
+    }
+
+    const int16x8_t vshift = vdupq_n_s16(-(log2Size + 1));
+    for (int y = 0; y < blkSize; y++, dst += dstStride)
+    {
+        const uint8x8_t rowWeight = vdup_n_u8((uint8_t)(blkSize - 1 - y));
+        const uint8x8_t l = vdup_n_u8(left[y]);
+        const uint16x8_t rowTerm = vdupq_n_u16((uint16_t)((y + 1) * bottomLeft + blkSize));
+
+        for (int c = 0; c < chunks; c++)
+        {
+            uint16x8_t sum = vmull_u8(top[c], rowWeight);
+            sum = vmlal_u8(sum, colWeight[c], l);
+            sum = vaddq_u16(vaddq_u16(sum, colTerm[c]), rowTerm);
+            uint8x8_t res = vmovn_u16(vshlq_u16(sum, vshift));
+            if (blkSize == 4)
+                store4_u8(dst, res);
+            else
+                vst1_u8(dst + 8 * c, res);
+        }
+    }
+}
+
+/* (32 - fraction) * ref[x] + fraction * ref[x + 1], rounded; a zero fraction
+ * yields a plain copy */
+template<int width>
+static inline void interpRow(pixel* dst, const pixel* ref, int fraction)
+{
+    const uint8x8_t f0 = vdup_n_u8((uint8_t)(32 - fraction));
+    const uint8x8_t f1 = vdup_n_u8((uint8_t)fraction);
+
+    if (width == 4)
+    {
+        uint16x8_t sum = vmlal_u8(vmull_u8(load4_u8(ref), f0), load4_u8(ref + 1), f1);
+        store4_u8(dst, vrshrn_n_u16(sum, 5));
+        return;
+    }
+
+    for (int x = 0; x < width; x += 8)
+    {
+        uint16x8_t sum = vmlal_u8(vmull_u8(vld1_u8(ref + x), f0), vld1_u8(ref + x + 1), f1);
+        vst1_u8(dst + x, vrshrn_n_u16(sum, 5));
+    }
+}
+
+template<int width>
+static inline void transposeBlock(pixel* dst, intptr_t dstStride, const pixel* src)
+{
+    if (width == 4)
+    {
+        for (int y = 0; y < 4; y++)
+            for (int x = 0; x < 4; x++)
+                dst[y * dstStride + x] = src[x * 4 + y];
+        return;
+    }
+
+    for (int i = 0; i < width; i += 8)
+    {
+        for (int j = 0; j < width; j += 8)
+        {
+            uint8x8_t r[8];
+            for (int k = 0; k < 8; k++)
+                r[k] = vld1_u8(src + (i + k) * width + j);
+            transpose8x8_u8(r);
+            for (int k = 0; k < 8; k++)
+                vst1_u8(dst + (j + k) * dstStride + i, r[k]);
+        }
+    }
+}
+
+template<int width>
+static void intra_pred_ang_neon(pixel* dst, intptr_t dstStride, const pixel* srcPix0, int dirMode, int bFilter)
+{
+    const int width2 = width << 1;
+    const int horMode = dirMode < 18;
+    pixel neighbourBuf[129];
+    const pixel* srcPix = srcPix0;
+
+    if (horMode)
+    {
+        neighbourBuf[0] = srcPix[0];
+        memcpy(neighbourBuf + 1, srcPix + width2 + 1, width2 * sizeof(pixel));
+        memcpy(neighbourBuf + width2 + 1, srcPix + 1, width2 * sizeof(pixel));
+        srcPix = neighbourBuf;
+    }
+
+    static const int8_t angleTable[17] = { -32, -26, -21, -17, -13, -9, -5, -2, 0, 2, 5, 9, 13, 17, 21, 26, 32 };
+    static const int16_t invAngleTable[8] = { 4096, 1638, 910, 630, 482, 390, 315, 256 };
+
+    const int angleOffset = horMode ? 10 - dirMode : dirMode - 26;
+    const int angle = angleTable[8 + angleOffset];
+
+    ALIGN_VAR_32(pixel, pred[width * width]);
+    pixel* out = horMode ? pred : dst;
+    const intptr_t outStride = horMode ? width : dstStride;
+
+    if (!angle)
+    {
+        for (int y = 0; y < width; y++)
+            memcpy(out + y * outStride, srcPix + 1, width * sizeof(pixel));
+
+        if (bFilter)
+        {
+            int topLeft = srcPix[0], top = srcPix[1];
+            for (int y = 0; y < width; y++)
+                out[y * outStride] = x265_clip((int16_t)(top + ((srcPix[width2 + 1 + y] - topLeft) >> 1)));
+        }
+    }
+    else
+    {
+        pixel refBuf[64];
+        const pixel* ref;
+
+        if (angle < 0)
+        {
+            int nbProjected = -((width * angle) >> 5) - 1;
+            pixel* ref_pix = refBuf + nbProjected + 1;
+
+            int invAngle = invAngleTable[-angleOffset - 1];
+            int invAngleSum = 128;
+            for (int i = 0; i < nbProjected; i++)
+            {
+                invAngleSum += invAngle;
+                ref_pix[-2 - i] = srcPix[width2 + (invAngleSum >> 8)];
+            }
+
+            memcpy(ref_pix - 1, srcPix, (width + 1) * sizeof(pixel));
+            ref = ref_pix;
+        }
+        else
+            ref = srcPix + 1;
+
+        int angleSum = 0;
+        for (int y = 0; y < width; y++)
+        {
+            angleSum += angle;
+            interpRow<width>(out + y * outStride, ref + (angleSum >> 5), angleSum & 31);
+        }
+    }
+
+    if (horMode)
+        transposeBlock<width>(dst, dstStride, pred);
+}
+
+#endif // if !HIGH_BIT_DEPTH
+
+namespace X265_NS {
+void setupIntraPrimitives_neon(EncoderPrimitives &p)
+{
+#if HIGH_BIT_DEPTH
+    (void)p;
+#else
+    p.cu[BLOCK_4x4].intra_pred[PLANAR_IDX] = planar_pred_neon<2>;
+    p.cu[BLOCK_8x8].intra_pred[PLANAR_IDX] = planar_pred_neon<3>;
+    p.cu[BLOCK_16x16].intra_pred[PLANAR_IDX] = planar_pred_neon<4>;
+    p.cu[BLOCK_32x32].intra_pred[PLANAR_IDX] = planar_pred_neon<5>;
+
+    p.cu[BLOCK_4x4].intra_pred[DC_IDX] = intra_pred_dc_neon<4>;
+    p.cu[BLOCK_8x8].intra_pred[DC_IDX] = intra_pred_dc_neon<8>;
+    p.cu[BLOCK_16x16].intra_pred[DC_IDX] = intra_pred_dc_neon<16>;
+    p.cu[BLOCK_32x32].intra_pred[DC_IDX] = intra_pred_dc_neon<32>;
+
+    for (int i = 2; i < NUM_INTRA_MODE; i++)
+    {
+        p.cu[BLOCK_4x4].intra_pred[i] = intra_pred_ang_neon<4>;
+        p.cu[BLOCK_8x8].intra_pred[i] = intra_pred_ang_neon<8>;
+        p.cu[BLOCK_16x16].intra_pred[i] = intra_pred_ang_neon<16>;
+        p.cu[BLOCK_32x32].intra_pred[i] = intra_pred_ang_neon<32>;
+    }
+#endif
+}
+}
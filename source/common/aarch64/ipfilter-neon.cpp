@@ -0,0 +1,353 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "neon-util.h"
+
+/* Interpolation filters for block widths that are a multiple of 4. With 8bit
+ * pixels the filter sums fit in 16bit lanes; the filters of intermediate
+ * 16bit samples accumulate in 32bit lanes and do not depend on the bit depth */
+
+using namespace X265_NS;
+
+template<int N, int W>
+static inline int32x4_t filterShorts(const int16_t* src, intptr_t step, const int16_t* coeff, int32x4_t& hi)
+{
+    int32x4_t lo = vdupq_n_s32(0);
+    hi = lo;
+    for (int k = 0; k < N; k++, src += step)
+    {
+        if (W == 8)
+        {
+            int16x8_t s = vld1q_s16(src);
+            lo = vmlal_n_s16(lo, vget_low_s16(s), coeff[k]);
+            hi = vmlal_high_n_s16(hi, s, coeff[k]);
+        }
+        else
+            lo = vmlal_n_s16(lo, vld1_s16(src), coeff[k]);
+    }
+    return lo;
+}
+
+template<int N, int width, int height>
+static void interp_vert_ss_neon(const int16_t* src, intptr_t srcStride, int16_t* dst, intptr_t dstStride, int coeffIdx)
+{
+    const int16_t* c = (N == 8 ? g_lumaFilter[coeffIdx] : g_chromaFilter[coeffIdx]);
+
+    src -= (N / 2 - 1) * srcStride;
+    for (int row = 0; row < height; row++)
+    {
+        int col = 0;
+        int32x4_t hi;
+        for (; col + 8 <= width; col += 8)
+        {
+            int32x4_t lo = filterShorts<N, 8>(src + col, srcStride, c, hi);
+            vst1q_s16(dst + col, vcombine_s16(vshrn_n_s32(lo, IF_FILTER_PREC), vshrn_n_s32(hi, IF_FILTER_PREC)));
+        }
+        if (width & 4)
+            vst1_s16(dst + col, vshrn_n_s32(filterShorts<N, 4>(src + col, srcStride, c, hi), IF_FILTER_PREC));
+
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+#if !HIGH_BIT_DEPTH
+
+/* sum of the N taps for W (8 or 4) adjacent outputs, src points to the first
+ * tap of the first output and step separates the taps */
+template<int N, int W>
+static inline int16x8_t filterPixels(const pixel* src, intptr_t step, const int16_t* coeff)
+{
+    int16x8_t sum = vdupq_n_s16(0);
+    for (int k = 0; k < N; k++, src += step)
+    {
+        uint8x8_t s = W == 8 ? vld1_u8(src) : load4_u8(src);
+        sum = vmlaq_n_s16(sum, vreinterpretq_s16_u16(vmovl_u8(s)), coeff[k]);
+    }
+    return sum;
+}
+
+/* With 8bit pixels the ps filters have no shift, only the offset */
+template<int N>
+static inline void filterRow_pp(const pixel* src, intptr_t step, pixel* dst, int width, const int16_t* coeff)
+{
+    int col = 0;
+    for (; col + 8 <= width; col += 8)
+        vst1_u8(dst + col, vqrshrun_n_s16(filterPixels<N, 8>(src + col, step, coeff), IF_FILTER_PREC));
+    if (width & 4)
+        store4_u8(dst + col, vqrshrun_n_s16(filterPixels<N, 4>(src + col, step, coeff), IF_FILTER_PREC));
+}
+
+template<int N>
+static inline void filterRow_ps(const pixel* src, intptr_t step, int16_t* dst, int width, const int16_t* coeff)
+{
+    const int16x8_t offset = vdupq_n_s16(IF_INTERNAL_OFFS);
+    int col = 0;
+    for (; col + 8 <= width; col += 8)
+        vst1q_s16(dst + col, vsubq_s16(filterPixels<N, 8>(src + col, step, coeff), offset));
+    if (width & 4)
+        vst1_s16(dst + col, vget_low_s16(vsubq_s16(filterPixels<N, 4>(src + col, step, coeff), offset)));
+}
+
+template<int N, int width, int height>
+static void interp_horiz_pp_neon(const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int coeffIdx)
+{
+    const int16_t* coeff = (N == 4) ? g_chromaFilter[coeffIdx] : g_lumaFilter[coeffIdx];
+
+    src -= N / 2 - 1;
+    for (int row = 0; row < height; row++)
+    {
+        filterRow_pp<N>(src, 1, dst, width, coeff);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+template<int N, int width, int height>
+static void interp_horiz_ps_neon(const pixel* src, intptr_t srcStride, int16_t* dst, intptr_t dstStride, int coeffIdx, int isRowExt)
+{
+    const int16_t* coeff = (N == 4) ? g_chromaFilter[coeffIdx] : g_lumaFilter[coeffIdx];
+    int blkheight = height;
+
+    src -= N / 2 - 1;
+    if (isRowExt)
+    {
+        src -= (N / 2 - 1) * srcStride;
+        blkheight += N - 1;
+    }
+
+    for (int row = 0; row < blkheight; row++)
+    {
+        filterRow_ps<N>(src, 1, dst, width, coeff);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+template<int N, int width, int height>
+static void interp_vert_pp_neon(const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int coeffIdx)
+{
+    const int16_t* c = (N == 4) ? g_chromaFilter[coeffIdx] : g_lumaFilter[coeffIdx];
+
+    src -= (N / 2 - 1) * srcStride;
+    for (int row = 0; row < height; row++)
+    {
+        filterRow_pp<N>(src, srcStride, dst, width, c);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+template<int N, int width, int height>
+static void interp_vert_ps_neon(const pixel* src, intptr_t srcStride, int16_t* dst, intptr_t dstStride, int coeffIdx)
+{
+    const int16_t* c = (N == 4) ? g_chromaFilter[coeffIdx] : g_lumaFilter[coeffIdx];
+
+    src -= (N / 2 - 1) * srcStride;
+    for (int row = 0; row < height; row++)
+    {
+        filterRow_ps<N>(src, srcStride, dst, width, c);
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+template<int N, int width, int height>
+static void interp_vert_sp_neon(const int16_t* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int coeffIdx)
+{
+    const int shift = IF_FILTER_PREC + IF_INTERNAL_PREC - X265_DEPTH;
+    const int32x4_t offset = vdupq_n_s32((1 << (shift - 1)) + (IF_INTERNAL_OFFS << IF_FILTER_PREC));
+    const int16_t* coeff = (N == 8 ? g_lumaFilter[coeffIdx] : g_chromaFilter[coeffIdx]);
+
+    src -= (N / 2 - 1) * srcStride;
+    for (int row = 0; row < height; row++)
+    {
+        int col = 0;
+        int32x4_t hi;
+        for (; col + 8 <= width; col += 8)
+        {
+            int32x4_t lo = filterShorts<N, 8>(src + col, srcStride, coeff, hi);
+            uint16x8_t val = vcombine_u16(vqshrun_n_s32(vaddq_s32(lo, offset), shift), vqshrun_n_s32(vaddq_s32(hi, offset), shift));
+            vst1_u8(dst + col, vqmovn_u16(val));
+        }
+        if (width & 4)
+        {
+            int32x4_t lo = filterShorts<N, 4>(src + col, srcStride, coeff, hi);
+            uint16x4_t val = vqshrun_n_s32(vaddq_s32(lo, offset), shift);
+            store4_u8(dst + col, vqmovn_u16(vcombine_u16(val, val)));
+        }
+
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+template<int N, int width, int height>
+static void interp_hv_pp_neon(const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int idxX, int idxY)
+{
+    ALIGN_VAR_32(int16_t, immed[width * (height + N - 1)]);
+
+    interp_horiz_ps_neon<N, width, height>(src, srcStride, immed, width, idxX, 1);
+    interp_vert_sp_neon<N, width, height>(immed + (N / 2 - 1) * width, width, dst, dstStride, idxY);
+}
+
+template<int width, int height>
+static void filterPixelToShort_neon(const pixel* src, intptr_t srcStride, int16_t* dst, intptr_t dstStride)
+{
+    const int shift = IF_INTERNAL_PREC - X265_DEPTH;
+    const int16x8_t offset = vdupq_n_s16(IF_INTERNAL_OFFS);
+
+    for (int row = 0; row < height; row++)
+    {
+        int col = 0;
+        for (; col + 8 <= width; col += 8)
+        {
+            int16x8_t val = vreinterpretq_s16_u16(vshll_n_u8(vld1_u8(src + col), shift));
+            vst1q_s16(dst + col, vsubq_s16(val, offset));
+        }
+        if (width & 4)
+        {
+            int16x8_t val = vreinterpretq_s16_u16(vshll_n_u8(load4_u8(src + col), shift));
+            vst1_s16(dst + col, vget_low_s16(vsubq_s16(val, offset)));
+        }
+
+        src += srcStride;
+        dst += dstStride;
+    }
+}
+
+#endif // if !HIGH_BIT_DEPTH
+
+namespace X265_NS {
+void setupFilterPrimitives_neon(EncoderPrimitives &p)
+{
+#if HIGH_BIT_DEPTH
+#define CHROMA(CSP, PU, W, H) \
+    p.chroma[CSP].pu[PU].filter_vss = interp_vert_ss_neon<4, W, H>;
+#define LUMA(W, H) \
+    p.pu[LUMA_ ## W ## x ## H].luma_vss = interp_vert_ss_neon<8, W, H>;
+#else
+#define CHROMA(CSP, PU, W, H) \
+    p.chroma[CSP].pu[PU].filter_hpp = interp_horiz_pp_neon<4, W, H>; \
+    p.chroma[CSP].pu[PU].filter_hps = interp_horiz_ps_neon<4, W, H>; \
+    p.chroma[CSP].pu[PU].filter_vpp = interp_vert_pp_neon<4, W, H>; \
+    p.chroma[CSP].pu[PU].filter_vps = interp_vert_ps_neon<4, W, H>; \
+    p.chroma[CSP].pu[PU].filter_vsp = interp_vert_sp_neon<4, W, H>; \
+    p.chroma[CSP].pu[PU].filter_vss = interp_vert_ss_neon<4, W, H>; \
+    p.chroma[CSP].pu[PU].p2s[NONALIGNED] = filterPixelToShort_neon<W, H>; \
+    p.chroma[CSP].pu[PU].p2s[ALIGNED] = filterPixelToShort_neon<W, H>;
+#define LUMA(W, H) \
+    p.pu[LUMA_ ## W ## x ## H].luma_hpp  = interp_horiz_pp_neon<8, W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].luma_hps  = interp_horiz_ps_neon<8, W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].luma_vpp  = interp_vert_pp_neon<8, W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].luma_vps  = interp_vert_ps_neon<8, W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].luma_vsp  = interp_vert_sp_neon<8, W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].luma_vss  = interp_vert_ss_neon<8, W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].luma_hvpp = interp_hv_pp_neon<8, W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].convert_p2s[NONALIGNED] = filterPixelToShort_neon<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].convert_p2s[ALIGNED] = filterPixelToShort_neon<W, H>;
+#endif
+#define CHROMA_420(W, H) CHROMA(X265_CSP_I420, CHROMA_420_ ## W ## x ## H, W, H)
+#define CHROMA_422(W, H) CHROMA(X265_CSP_I422, CHROMA_422_ ## W ## x ## H, W, H)
+#define CHROMA_444(W, H) CHROMA(X265_CSP_I444, LUMA_ ## W ## x ## H, W, H)
+#define LUMA_444(W, H) LUMA(W, H) CHROMA_444(W, H)
+
+    LUMA_444(4, 4);
+    LUMA_444(8, 8);
+    LUMA_444(16, 16);
+    LUMA_444(32, 32);
+    LUMA_444(64, 64);
+    LUMA_444(4, 8);
+    LUMA_444(8, 4);
+    LUMA_444(16,  8);
+    LUMA_444(8, 16);
+    LUMA_444(16, 12);
+    LUMA_444(12, 16);
+    LUMA_444(16,  4);
+    LUMA_444(4, 16);
+    LUMA_444(32, 16);
+    LUMA_444(16, 32);
+    LUMA_444(32, 24);
+    LUMA_444(24, 32);
+    LUMA_444(32,  8);
+    LUMA_444(8, 32);
+    LUMA_444(64, 32);
+    LUMA_444(32, 64);
+    LUMA_444(64, 48);
+    LUMA_444(48, 64);
+    LUMA_444(64, 16);
+    LUMA_444(16, 64);
+
+    /* the 2 and 6 wide chroma blocks keep their C versions */
+    CHROMA_420(4,  4);
+    CHROMA_420(4,  2);
+    CHROMA_420(8,  8);
+    CHROMA_420(8,  4);
+    CHROMA_420(4,  8);
+    CHROMA_420(8,  6);
+    CHROMA_420(8,  2);
+    CHROMA_420(16, 16);
+    CHROMA_420(16, 8);
+    CHROMA_420(8,  16);
+    CHROMA_420(16, 12);
+    CHROMA_420(12, 16);
+    CHROMA_420(16, 4);
+    CHROMA_420(4,  16);
+    CHROMA_420(32, 32);
+    CHROMA_420(32, 16);
+    CHROMA_420(16, 32);
+    CHROMA_420(32, 24);
+    CHROMA_420(24, 32);
+    CHROMA_420(32, 8);
+    CHROMA_420(8,  32);
+
+    CHROMA_422(4,  8);
+    CHROMA_422(4,  4);
+    CHROMA_422(8,  16);
+    CHROMA_422(8,  8);
+    CHROMA_422(4,  16);
+    CHROMA_422(8,  12);
+    CHROMA_422(8,  4);
+    CHROMA_422(16, 32);
+    CHROMA_422(16, 16);
+    CHROMA_422(8,  32);
+    CHROMA_422(16, 24);
+    CHROMA_422(12, 32);
+    CHROMA_422(16, 8);
+    CHROMA_422(4,  32);
+    CHROMA_422(32, 64);
+    CHROMA_422(32, 32);
+    CHROMA_422(16, 64);
+    CHROMA_422(32, 48);
+    CHROMA_422(24, 64);
+    CHROMA_422(32, 16);
+    CHROMA_422(8,  64);
+
+#undef LUMA_444
+#undef CHROMA_444
+#undef CHROMA_422
+#undef CHROMA_420
+#undef LUMA
+#undef CHROMA
+}
+}
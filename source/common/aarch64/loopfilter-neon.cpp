@@ -0,0 +1,212 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "neon-util.h"
+
+/* SAO of 8bit pixels, sixteen pixels at a time. Every edge class compares
+ * only reconstructed pixels that are not yet written, so the rows vectorize
+ * directly; columns past the last whole vector use the loopfilter.cpp
+ * formulas. The edge offsets are looked up with a table lookup and added
+ * with unsigned saturation, which is the clip of the C reference */
+
+using namespace X265_NS;
+
+#if !HIGH_BIT_DEPTH
+
+static inline int8_t signOf(int x)
+{
+    return (x >> 31) | ((int)((((uint32_t)-x)) >> 31));
+}
+
+static inline int8x16_t signOf(uint8x16_t a, uint8x16_t b)
+{
+    return vsubq_s8(vreinterpretq_s8_u8(vcltq_u8(a, b)), vreinterpretq_s8_u8(vcgtq_u8(a, b)));
+}
+
+/* the five edge offsets, padded to a lookup table */
+static inline int8x16_t edgeTable(const int8_t* offsetEo)
+{
+    int8_t table[16] = { 0 };
+    memcpy(table, offsetEo, 5);
+    return vld1q_s8(table);
+}
+
+static inline uint8x16_t applyEdge(uint8x16_t rec, int8x16_t table, int8x16_t edgeType)
+{
+    return vsqaddq_u8(rec, vqtbl1q_s8(table, vreinterpretq_u8_s8(edgeType)));
+}
+
+static void calSign_neon(int8_t *dst, const pixel *src1, const pixel *src2, const int endX)
+{
+    int x = 0;
+    for (; x + 16 <= endX; x += 16)
+        vst1q_s8(dst + x, signOf(vld1q_u8(src1 + x), vld1q_u8(src2 + x)));
+    for (; x < endX; x++)
+        dst[x] = signOf(src1[x] - src2[x]);
+}
+
+static void processSaoCUE0_neon(pixel * rec, int8_t * offsetEo, int width, int8_t* signLeft, intptr_t stride)
+{
+    const int8x16_t table = edgeTable(offsetEo);
+    const int8x16_t two = vdupq_n_s8(2);
+
+    for (int y = 0; y < 2; y++, rec += stride)
+    {
+        /* lane 15 carries the left sign into the next vector */
+        int8x16_t carry = vdupq_n_s8(signLeft[y]);
+        int x = 0;
+        for (; x + 16 <= width; x += 16)
+        {
+            uint8x16_t r = vld1q_u8(rec + x);
+            int8x16_t signRight = signOf(r, vld1q_u8(rec + x + 1));
+            int8x16_t negRight = vnegq_s8(signRight);
+            int8x16_t signLeft0 = vextq_s8(carry, negRight, 15);
+            carry = negRight;
+            vst1q_u8(rec + x, applyEdge(r, table, vaddq_s8(vaddq_s8(signRight, signLeft0), two)));
+        }
+
+        int8_t signLeft0 = vgetq_lane_s8(carry, 15);
+        for (; x < width; x++)
+        {
+            int8_t signRight = signOf(rec[x] - rec[x + 1]);
+            int edgeType = signRight + signLeft0 + 2;
+            signLeft0 = -signRight;
+            rec[x] = x265_clip(rec[x] + offsetEo[edgeType]);
+        }
+    }
+}
+
+static void processSaoCUE1_neon(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int width)
+{
+    const int8x16_t table = edgeTable(offsetEo);
+    const int8x16_t two = vdupq_n_s8(2);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t r = vld1q_u8(rec + x);
+        int8x16_t signDown = signOf(r, vld1q_u8(rec + x + stride));
+        int8x16_t edgeType = vaddq_s8(vaddq_s8(signDown, vld1q_s8(upBuff1 + x)), two);
+        vst1q_s8(upBuff1 + x, vnegq_s8(signDown));
+        vst1q_u8(rec + x, applyEdge(r, table, edgeType));
+    }
+    for (; x < width; x++)
+    {
+        int8_t signDown = signOf(rec[x] - rec[x + stride]);
+        int edgeType = signDown + upBuff1[x] + 2;
+        upBuff1[x] = -signDown;
+        rec[x] = x265_clip(rec[x] + offsetEo[edgeType]);
+    }
+}
+
+static void processSaoCUE1_2Rows_neon(pixel* rec, int8_t* upBuff1, int8_t* offsetEo, intptr_t stride, int width)
+{
+    processSaoCUE1_neon(rec, upBuff1, offsetEo, stride, width);
+    processSaoCUE1_neon(rec + stride, upBuff1, offsetEo, stride, width);
+}
+
+static void processSaoCUE2_neon(pixel * rec, int8_t * bufft, int8_t * buff1, int8_t * offsetEo, int width, intptr_t stride)
+{
+    const int8x16_t table = edgeTable(offsetEo);
+    const int8x16_t two = vdupq_n_s8(2);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t r = vld1q_u8(rec + x);
+        int8x16_t signDown = signOf(r, vld1q_u8(rec + x + stride + 1));
+        int8x16_t edgeType = vaddq_s8(vaddq_s8(signDown, vld1q_s8(buff1 + x)), two);
+        vst1q_s8(bufft + x + 1, vnegq_s8(signDown));
+        vst1q_u8(rec + x, applyEdge(r, table, edgeType));
+    }
+    for (; x < width; x++)
+    {
+        int8_t signDown = signOf(rec[x] - rec[x + stride + 1]);
+        int edgeType = signDown + buff1[x] + 2;
+        bufft[x + 1] = -signDown;
+        rec[x] = x265_clip(rec[x] + offsetEo[edgeType]);
+    }
+}
+
+static void processSaoCUE3_neon(pixel *rec, int8_t *upBuff1, int8_t *offsetEo, intptr_t stride, int startX, int endX)
+{
+    const int8x16_t table = edgeTable(offsetEo);
+    const int8x16_t two = vdupq_n_s8(2);
+
+    /* the sign stored one column to the left is never read again */
+    int x = startX + 1;
+    for (; x + 16 <= endX; x += 16)
+    {
+        uint8x16_t r = vld1q_u8(rec + x);
+        int8x16_t signDown = signOf(r, vld1q_u8(rec + x + stride));
+        int8x16_t edgeType = vaddq_s8(vaddq_s8(signDown, vld1q_s8(upBuff1 + x)), two);
+        vst1q_s8(upBuff1 + x - 1, vnegq_s8(signDown));
+        vst1q_u8(rec + x, applyEdge(r, table, edgeType));
+    }
+    for (; x < endX; x++)
+    {
+        int8_t signDown = signOf(rec[x] - rec[x + stride]);
+        int edgeType = signDown + upBuff1[x] + 2;
+        upBuff1[x - 1] = -signDown;
+        rec[x] = x265_clip(rec[x] + offsetEo[edgeType]);
+    }
+}
+
+static void processSaoCUB0_neon(pixel* rec, const int8_t* offset, int ctuWidth, int ctuHeight, intptr_t stride)
+{
+    const int boShift = X265_DEPTH - 5;
+    const int8x16x2_t table = { { vld1q_s8(offset), vld1q_s8(offset + 16) } };
+
+    for (int y = 0; y < ctuHeight; y++, rec += stride)
+    {
+        int x = 0;
+        for (; x + 16 <= ctuWidth; x += 16)
+        {
+            uint8x16_t r = vld1q_u8(rec + x);
+            vst1q_u8(rec + x, vsqaddq_u8(r, vqtbl2q_s8(table, vshrq_n_u8(r, 3))));
+        }
+        for (; x < ctuWidth; x++)
+            rec[x] = x265_clip(rec[x] + offset[rec[x] >> boShift]);
+    }
+}
+
+#endif // if !HIGH_BIT_DEPTH
+
+namespace X265_NS {
+void setupLoopFilterPrimitives_neon(EncoderPrimitives &p)
+{
+#if HIGH_BIT_DEPTH
+    (void)p;
+#else
+    p.saoCuOrgE0 = processSaoCUE0_neon;
+    p.saoCuOrgE1 = processSaoCUE1_neon;
+    p.saoCuOrgE1_2Rows = processSaoCUE1_2Rows_neon;
+    p.saoCuOrgE2[0] = processSaoCUE2_neon;
+    p.saoCuOrgE2[1] = processSaoCUE2_neon;
+    p.saoCuOrgE3[0] = processSaoCUE3_neon;
+    p.saoCuOrgE3[1] = processSaoCUE3_neon;
+    p.saoCuOrgB0 = processSaoCUB0_neon;
+    p.sign = calSign_neon;
+#endif
+}
+}
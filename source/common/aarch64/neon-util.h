@@ -0,0 +1,122 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_NEON_UTIL_H
+#define X265_NEON_UTIL_H
+
+#include <arm_neon.h>
+#include <string.h>
+
+/* helpers shared by the AArch64 NEON intrinsic primitives */
+
+/* four bytes in the low half, zeros in the high half */
+static inline uint8x8_t load4_u8(const uint8_t* src)
+{
+    uint32_t v;
+    memcpy(&v, src, sizeof(v));
+    return vreinterpret_u8_u32(vset_lane_u32(v, vdup_n_u32(0), 0));
+}
+
+static inline void store4_u8(uint8_t* dst, uint8x8_t v)
+{
+    uint32_t w = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+    memcpy(dst, &w, sizeof(w));
+}
+
+/* transposes the 4x4 blocks held in the low and in the high halves of the
+ * four rows */
+static inline void transpose4x4x2_s16(int16x8_t& r0, int16x8_t& r1, int16x8_t& r2, int16x8_t& r3)
+{
+    int32x4_t t0 = vreinterpretq_s32_s16(vtrn1q_s16(r0, r1));
+    int32x4_t t1 = vreinterpretq_s32_s16(vtrn2q_s16(r0, r1));
+    int32x4_t t2 = vreinterpretq_s32_s16(vtrn1q_s16(r2, r3));
+    int32x4_t t3 = vreinterpretq_s32_s16(vtrn2q_s16(r2, r3));
+
+    r0 = vreinterpretq_s16_s32(vtrn1q_s32(t0, t2));
+    r2 = vreinterpretq_s16_s32(vtrn2q_s32(t0, t2));
+    r1 = vreinterpretq_s16_s32(vtrn1q_s32(t1, t3));
+    r3 = vreinterpretq_s16_s32(vtrn2q_s32(t1, t3));
+}
+
+static inline void transpose4x4_s16(int16x4_t& r0, int16x4_t& r1, int16x4_t& r2, int16x4_t& r3)
+{
+    int32x2_t t0 = vreinterpret_s32_s16(vtrn1_s16(r0, r1));
+    int32x2_t t1 = vreinterpret_s32_s16(vtrn2_s16(r0, r1));
+    int32x2_t t2 = vreinterpret_s32_s16(vtrn1_s16(r2, r3));
+    int32x2_t t3 = vreinterpret_s32_s16(vtrn2_s16(r2, r3));
+
+    r0 = vreinterpret_s16_s32(vtrn1_s32(t0, t2));
+    r2 = vreinterpret_s16_s32(vtrn2_s32(t0, t2));
+    r1 = vreinterpret_s16_s32(vtrn1_s32(t1, t3));
+    r3 = vreinterpret_s16_s32(vtrn2_s32(t1, t3));
+}
+
+static inline void transpose8x8_s16(int16x8_t* r)
+{
+    int32x4_t b[8];
+    for (int i = 0; i < 8; i += 2)
+    {
+        b[i] = vreinterpretq_s32_s16(vtrn1q_s16(r[i], r[i + 1]));
+        b[i + 1] = vreinterpretq_s32_s16(vtrn2q_s16(r[i], r[i + 1]));
+    }
+
+    int64x2_t c[8];
+    for (int i = 0; i < 8; i += 4)
+    {
+        c[i] = vreinterpretq_s64_s32(vtrn1q_s32(b[i], b[i + 2]));
+        c[i + 2] = vreinterpretq_s64_s32(vtrn2q_s32(b[i], b[i + 2]));
+        c[i + 1] = vreinterpretq_s64_s32(vtrn1q_s32(b[i + 1], b[i + 3]));
+        c[i + 3] = vreinterpretq_s64_s32(vtrn2q_s32(b[i + 1], b[i + 3]));
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        r[i] = vreinterpretq_s16_s64(vtrn1q_s64(c[i], c[i + 4]));
+        r[i + 4] = vreinterpretq_s16_s64(vtrn2q_s64(c[i], c[i + 4]));
+    }
+}
+
+static inline void transpose8x8_u8(uint8x8_t* r)
+{
+    uint16x4_t b[8];
+    for (int i = 0; i < 8; i += 2)
+    {
+        b[i] = vreinterpret_u16_u8(vtrn1_u8(r[i], r[i + 1]));
+        b[i + 1] = vreinterpret_u16_u8(vtrn2_u8(r[i], r[i + 1]));
+    }
+
+    uint32x2_t c[8];
+    for (int i = 0; i < 8; i += 4)
+    {
+        c[i] = vreinterpret_u32_u16(vtrn1_u16(b[i], b[i + 2]));
+        c[i + 2] = vreinterpret_u32_u16(vtrn2_u16(b[i], b[i + 2]));
+        c[i + 1] = vreinterpret_u32_u16(vtrn1_u16(b[i + 1], b[i + 3]));
+        c[i + 3] = vreinterpret_u32_u16(vtrn2_u16(b[i + 1], b[i + 3]));
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+        r[i] = vreinterpret_u8_u32(vtrn1_u32(c[i], c[i + 4]));
+        r[i + 4] = vreinterpret_u8_u32(vtrn2_u32(c[i], c[i + 4]));
+    }
+}
+
+#endif // ifndef X265_NEON_UTIL_H
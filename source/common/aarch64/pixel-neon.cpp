@@ -0,0 +1,398 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "slicetype.h"      // LOWRES_COST_MASK
+#include "primitives.h"
+#include "neon-util.h"
+
+/* Block comparison and cu-tree primitives. The comparisons operate on 8bit
+ * pixels, their differences and transforms fit in 16bit lanes */
+
+using namespace X265_NS;
+
+#if !HIGH_BIT_DEPTH
+
+static inline void absDiffRow(uint16x8_t& acc, const pixel* a, const pixel* b, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16)
+    {
+        uint8x16_t p = vld1q_u8(a + x);
+        uint8x16_t q = vld1q_u8(b + x);
+        acc = vabal_u8(acc, vget_low_u8(p), vget_low_u8(q));
+        acc = vabal_high_u8(acc, p, q);
+    }
+    if (width & 8)
+    {
+        acc = vabal_u8(acc, vld1_u8(a + x), vld1_u8(b + x));
+        x += 8;
+    }
+    if (width & 4)
+        acc = vabal_u8(acc, load4_u8(a + x), load4_u8(b + x));
+}
+
+template<int lx, int ly>
+static int sad_neon(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    uint32x4_t sum = vdupq_n_u32(0);
+
+    for (int y = 0; y < ly; y++)
+    {
+        uint16x8_t row = vdupq_n_u16(0);
+        absDiffRow(row, pix1, pix2, lx);
+        sum = vpadalq_u16(sum, row);
+
+        pix1 += stride_pix1;
+        pix2 += stride_pix2;
+    }
+
+    return (int)vaddvq_u32(sum);
+}
+
+template<int lx, int ly>
+static void sad_x3_neon(const pixel* pix1, const pixel* pix2, const pixel* pix3, const pixel* pix4, intptr_t frefstride, int32_t* res)
+{
+    uint32x4_t sum0 = vdupq_n_u32(0), sum1 = sum0, sum2 = sum0;
+
+    for (int y = 0; y < ly; y++)
+    {
+        uint16x8_t row0 = vdupq_n_u16(0), row1 = row0, row2 = row0;
+        absDiffRow(row0, pix1, pix2, lx);
+        absDiffRow(row1, pix1, pix3, lx);
+        absDiffRow(row2, pix1, pix4, lx);
+        sum0 = vpadalq_u16(sum0, row0);
+        sum1 = vpadalq_u16(sum1, row1);
+        sum2 = vpadalq_u16(sum2, row2);
+
+        pix1 += FENC_STRIDE;
+        pix2 += frefstride;
+        pix3 += frefstride;
+        pix4 += frefstride;
+    }
+
+    res[0] = (int32_t)vaddvq_u32(sum0);
+    res[1] = (int32_t)vaddvq_u32(sum1);
+    res[2] = (int32_t)vaddvq_u32(sum2);
+}
+
+template<int lx, int ly>
+static void sad_x4_neon(const pixel* pix1, const pixel* pix2, const pixel* pix3, const pixel* pix4, const pixel* pix5, intptr_t frefstride, int32_t* res)
+{
+    uint32x4_t sum0 = vdupq_n_u32(0), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+
+    for (int y = 0; y < ly; y++)
+    {
+        uint16x8_t row0 = vdupq_n_u16(0), row1 = row0, row2 = row0, row3 = row0;
+        absDiffRow(row0, pix1, pix2, lx);
+        absDiffRow(row1, pix1, pix3, lx);
+        absDiffRow(row2, pix1, pix4, lx);
+        absDiffRow(row3, pix1, pix5, lx);
+        sum0 = vpadalq_u16(sum0, row0);
+        sum1 = vpadalq_u16(sum1, row1);
+        sum2 = vpadalq_u16(sum2, row2);
+        sum3 = vpadalq_u16(sum3, row3);
+
+        pix1 += FENC_STRIDE;
+        pix2 += frefstride;
+        pix3 += frefstride;
+        pix4 += frefstride;
+        pix5 += frefstride;
+    }
+
+    res[0] = (int32_t)vaddvq_u32(sum0);
+    res[1] = (int32_t)vaddvq_u32(sum1);
+    res[2] = (int32_t)vaddvq_u32(sum2);
+    res[3] = (int32_t)vaddvq_u32(sum3);
+}
+
+template<int lx, int ly>
+static sse_t sse_pp_neon(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    uint32x4_t sum = vdupq_n_u32(0);
+
+    for (int y = 0; y < ly; y++)
+    {
+        int x = 0;
+        for (; x + 16 <= lx; x += 16)
+        {
+            uint8x16_t d = vabdq_u8(vld1q_u8(pix1 + x), vld1q_u8(pix2 + x));
+            sum = vpadalq_u16(sum, vmull_u8(vget_low_u8(d), vget_low_u8(d)));
+            sum = vpadalq_u16(sum, vmull_high_u8(d, d));
+        }
+        if (lx & 8)
+        {
+            uint8x8_t d = vabd_u8(vld1_u8(pix1 + x), vld1_u8(pix2 + x));
+            sum = vpadalq_u16(sum, vmull_u8(d, d));
+            x += 8;
+        }
+        if (lx & 4)
+        {
+            uint8x8_t d = vabd_u8(load4_u8(pix1 + x), load4_u8(pix2 + x));
+            sum = vpadalq_u16(sum, vmull_u8(d, d));
+        }
+
+        pix1 += stride_pix1;
+        pix2 += stride_pix2;
+    }
+
+    return vaddvq_u32(sum);
+}
+
+static inline void hadamard4(int16x8_t& a0, int16x8_t& a1, int16x8_t& a2, int16x8_t& a3)
+{
+    int16x8_t t0 = vaddq_s16(a0, a1);
+    int16x8_t t1 = vsubq_s16(a0, a1);
+    int16x8_t t2 = vaddq_s16(a2, a3);
+    int16x8_t t3 = vsubq_s16(a2, a3);
+
+    a0 = vaddq_s16(t0, t2);
+    a2 = vsubq_s16(t0, t2);
+    a1 = vaddq_s16(t1, t3);
+    a3 = vsubq_s16(t1, t3);
+}
+
+static inline void hadamard8(int16x8_t* a)
+{
+    hadamard4(a[0], a[1], a[2], a[3]);
+    hadamard4(a[4], a[5], a[6], a[7]);
+    for (int i = 0; i < 4; i++)
+    {
+        int16x8_t t = a[i];
+        a[i] = vaddq_s16(t, a[i + 4]);
+        a[i + 4] = vsubq_s16(t, a[i + 4]);
+    }
+}
+
+/* the sum of absolute values of both 4x4 Hadamard transforms of an 8x4 block
+ * (or of the 4x4 block in the low half when width is 4). The sum of the
+ * coefficients of a 4x4 transform is even so the caller may halve the total */
+static inline uint16x8_t satd4Rows(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2, int width)
+{
+    int16x8_t r[4];
+
+    for (int i = 0; i < 4; i++, pix1 += stride_pix1, pix2 += stride_pix2)
+    {
+        uint8x8_t p = width == 4 ? load4_u8(pix1) : vld1_u8(pix1);
+        uint8x8_t q = width == 4 ? load4_u8(pix2) : vld1_u8(pix2);
+        r[i] = vreinterpretq_s16_u16(vsubl_u8(p, q));
+    }
+
+    hadamard4(r[0], r[1], r[2], r[3]);
+    transpose4x4x2_s16(r[0], r[1], r[2], r[3]);
+    hadamard4(r[0], r[1], r[2], r[3]);
+
+    uint16x8_t sum = vaddq_u16(vreinterpretq_u16_s16(vabsq_s16(r[0])), vreinterpretq_u16_s16(vabsq_s16(r[1])));
+    sum = vaddq_u16(sum, vreinterpretq_u16_s16(vabsq_s16(r[2])));
+    return vaddq_u16(sum, vreinterpretq_u16_s16(vabsq_s16(r[3])));
+}
+
+template<int w, int h>
+static int satd_neon(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    uint32x4_t sum = vdupq_n_u32(0);
+
+    for (int row = 0; row < h; row += 4)
+    {
+        int col = 0;
+        for (; col + 8 <= w; col += 8)
+            sum = vpadalq_u16(sum, satd4Rows(pix1 + row * stride_pix1 + col, stride_pix1,
+                                             pix2 + row * stride_pix2 + col, stride_pix2, 8));
+        if (w & 4)
+            sum = vpadalq_u16(sum, satd4Rows(pix1 + row * stride_pix1 + col, stride_pix1,
+                                             pix2 + row * stride_pix2 + col, stride_pix2, 4));
+    }
+
+    return (int)(vaddvq_u32(sum) >> 1);
+}
+
+/* unrounded sa8d of an 8x8 block, as _sa8d_8x8() */
+static inline int sa8dRaw(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    int16x8_t r[8];
+
+    for (int i = 0; i < 8; i++, pix1 += i_pix1, pix2 += i_pix2)
+        r[i] = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(pix1), vld1_u8(pix2)));
+
+    hadamard8(r);
+    transpose8x8_s16(r);
+    hadamard8(r);
+
+    uint32x4_t sum = vdupq_n_u32(0);
+    for (int i = 0; i < 8; i += 2)
+        sum = vpadalq_u16(sum, vaddq_u16(vreinterpretq_u16_s16(vabsq_s16(r[i])), vreinterpretq_u16_s16(vabsq_s16(r[i + 1]))));
+
+    return (int)vaddvq_u32(sum);
+}
+
+static int sa8d_8x8_neon(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    return (sa8dRaw(pix1, i_pix1, pix2, i_pix2) + 2) >> 2;
+}
+
+template<int w, int h>
+static int sa8d8_neon(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    int cost = 0;
+
+    for (int y = 0; y < h; y += 8)
+        for (int x = 0; x < w; x += 8)
+            cost += sa8d_8x8_neon(pix1 + i_pix1 * y + x, i_pix1, pix2 + i_pix2 * y + x, i_pix2);
+
+    return cost;
+}
+
+template<int w, int h>
+static int sa8d16_neon(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    int cost = 0;
+
+    for (int y = 0; y < h; y += 16)
+    {
+        for (int x = 0; x < w; x += 16)
+        {
+            const pixel* p1 = pix1 + i_pix1 * y + x;
+            const pixel* p2 = pix2 + i_pix2 * y + x;
+            int sum = sa8dRaw(p1, i_pix1, p2, i_pix2) +
+                      sa8dRaw(p1 + 8, i_pix1, p2 + 8, i_pix2) +
+                      sa8dRaw(p1 + 8 * i_pix1, i_pix1, p2 + 8 * i_pix2, i_pix2) +
+                      sa8dRaw(p1 + 8 + 8 * i_pix1, i_pix1, p2 + 8 + 8 * i_pix2, i_pix2);
+            cost += (sum + 2) >> 2;
+        }
+    }
+
+    return cost;
+}
+
+#endif // if !HIGH_BIT_DEPTH
+
+static void propagateCost_neon(int* dst, const uint16_t* propagateIn, const int32_t* intraCosts, const uint16_t* interCosts,
+                               const int32_t* invQscales, const double* fpsFactor, int len)
+{
+    const float64x2_t fps = vdupq_n_f64(*fpsFactor / 256);
+    const float64x2_t half = vdupq_n_f64(0.5);
+    const uint32x4_t costMask = vdupq_n_u32(LOWRES_COST_MASK);
+    int i = 0;
+
+    for (; i + 4 <= len; i += 4)
+    {
+        int32x4_t intra = vld1q_s32(intraCosts + i);
+        int32x4_t inter = vreinterpretq_s32_u32(vandq_u32(vmovl_u16(vld1_u16(interCosts + i)), costMask));
+        inter = vminq_s32(intra, inter);
+
+        /* the C reference multiplies in int before converting */
+        int32x4_t intraQ = vmulq_s32(intra, vld1q_s32(invQscales + i));
+        uint32x4_t in = vmovl_u16(vld1_u16(propagateIn + i));
+        int32x4_t num = vsubq_s32(intra, inter);
+
+        float64x2_t res[2];
+        for (int h = 0; h < 2; h++)
+        {
+            int32x2_t q = h ? vget_high_s32(intraQ) : vget_low_s32(intraQ);
+            int32x2_t n = h ? vget_high_s32(num) : vget_low_s32(num);
+            int32x2_t c = h ? vget_high_s32(intra) : vget_low_s32(intra);
+            uint32x2_t p = h ? vget_high_u32(in) : vget_low_u32(in);
+
+            float64x2_t amount = vaddq_f64(vcvtq_f64_u64(vmovl_u32(p)), vmulq_f64(vcvtq_f64_s64(vmovl_s32(q)), fps));
+            float64x2_t cost = vdivq_f64(vmulq_f64(amount, vcvtq_f64_s64(vmovl_s32(n))), vcvtq_f64_s64(vmovl_s32(c)));
+            res[h] = vaddq_f64(cost, half);
+        }
+
+        vst1q_s32(dst + i, vcombine_s32(vmovn_s64(vcvtq_s64_f64(res[0])), vmovn_s64(vcvtq_s64_f64(res[1]))));
+    }
+
+    double fpsScalar = *fpsFactor / 256;
+    for (; i < len; i++)
+    {
+        int intraCost = intraCosts[i];
+        int interCost = X265_MIN(intraCosts[i], interCosts[i] & LOWRES_COST_MASK);
+        double propagateIntra = intraCost * invQscales[i];
+        double propagateAmount = (double)propagateIn[i] + propagateIntra * fpsScalar;
+        double propagateNum = (double)(intraCost - interCost);
+        dst[i] = (int)(propagateAmount * propagateNum / (double)intraCost + 0.5);
+    }
+}
+
+namespace X265_NS {
+void setupPixelPrimitives_neon(EncoderPrimitives &p)
+{
+#if !HIGH_BIT_DEPTH
+#define LUMA_PU(W, H) \
+    p.pu[LUMA_ ## W ## x ## H].sad    = sad_neon<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].sad_x3 = sad_x3_neon<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].sad_x4 = sad_x4_neon<W, H>; \
+    p.pu[LUMA_ ## W ## x ## H].satd   = satd_neon<W, H>;
+
+    LUMA_PU(4, 4);
+    LUMA_PU(8, 8);
+    LUMA_PU(16, 16);
+    LUMA_PU(32, 32);
+    LUMA_PU(64, 64);
+    LUMA_PU(4, 8);
+    LUMA_PU(8, 4);
+    LUMA_PU(16,  8);
+    LUMA_PU(8, 16);
+    LUMA_PU(16, 12);
+    LUMA_PU(12, 16);
+    LUMA_PU(16,  4);
+    LUMA_PU(4, 16);
+    LUMA_PU(32, 16);
+    LUMA_PU(16, 32);
+    LUMA_PU(32, 24);
+    LUMA_PU(24, 32);
+    LUMA_PU(32,  8);
+    LUMA_PU(8, 32);
+    LUMA_PU(64, 32);
+    LUMA_PU(32, 64);
+    LUMA_PU(64, 48);
+    LUMA_PU(48, 64);
+    LUMA_PU(64, 16);
+    LUMA_PU(16, 64);
+#undef LUMA_PU
+
+    p.cu[BLOCK_4x4].sse_pp   = sse_pp_neon<4, 4>;
+    p.cu[BLOCK_8x8].sse_pp   = sse_pp_neon<8, 8>;
+    p.cu[BLOCK_16x16].sse_pp = sse_pp_neon<16, 16>;
+    p.cu[BLOCK_32x32].sse_pp = sse_pp_neon<32, 32>;
+    p.cu[BLOCK_64x64].sse_pp = sse_pp_neon<64, 64>;
+
+    p.cu[BLOCK_8x8].sa8d   = sa8d_8x8_neon;
+    p.cu[BLOCK_16x16].sa8d = sa8d16_neon<16, 16>;
+    p.cu[BLOCK_32x32].sa8d = sa8d16_neon<32, 32>;
+    p.cu[BLOCK_64x64].sa8d = sa8d16_neon<64, 64>;
+
+    /* chroma sizes which setupAliasPrimitives() does not take from luma */
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_8x12].satd  = satd_neon<8, 12>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_16x24].satd = satd_neon<16, 24>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_12x32].satd = satd_neon<12, 32>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_4x32].satd  = satd_neon<4, 32>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_32x48].satd = satd_neon<32, 48>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_24x64].satd = satd_neon<24, 64>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_8x64].satd  = satd_neon<8, 64>;
+
+    p.chroma[X265_CSP_I422].cu[BLOCK_422_8x16].sa8d  = sa8d8_neon<8, 16>;
+    p.chroma[X265_CSP_I422].cu[BLOCK_422_16x32].sa8d = sa8d16_neon<16, 32>;
+    p.chroma[X265_CSP_I422].cu[BLOCK_422_32x64].sa8d = sa8d16_neon<32, 64>;
+#endif
+
+    p.propagateCost = propagateCost_neon;
+}
+}
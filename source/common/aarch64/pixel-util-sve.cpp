@@ -0,0 +1,136 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "slicetype.h"      // LOWRES_COST_MASK
+#include "primitives.h"
+#include <arm_sve.h>
+
+/* Vector length agnostic SVE versions of the long one dimensional loops.
+ * The loops are predicated with whilelt, so they need no scalar tail and
+ * run unchanged on any SVE vector length. This file is the only one built
+ * with SVE code generation enabled; setupPixelPrimitives_sve() is called
+ * only when cpu detection reports SVE */
+
+using namespace X265_NS;
+
+static void propagateCost_sve(int* dst, const uint16_t* propagateIn, const int32_t* intraCosts, const uint16_t* interCosts,
+                              const int32_t* invQscales, const double* fpsFactor, int len)
+{
+    const double fps = *fpsFactor / 256;
+
+    for (int i = 0; i < len; i += (int)svcntd())
+    {
+        svbool_t pg = svwhilelt_b64(i, len);
+        svint64_t intra = svld1sw_s64(pg, intraCosts + i);
+        svint64_t inter = svand_n_s64_x(pg, svld1uh_s64(pg, interCosts + i), LOWRES_COST_MASK);
+        inter = svmin_s64_x(pg, intra, inter);
+
+        /* the C reference multiplies in int before converting */
+        svint64_t intraQ = svextw_s64_x(pg, svmul_s64_x(pg, intra, svld1sw_s64(pg, invQscales + i)));
+
+        svfloat64_t amount = svcvt_f64_s64_x(pg, svld1uh_s64(pg, propagateIn + i));
+        amount = svadd_f64_x(pg, amount, svmul_n_f64_x(pg, svcvt_f64_s64_x(pg, intraQ), fps));
+        svfloat64_t cost = svmul_f64_x(pg, amount, svcvt_f64_s64_x(pg, svsub_s64_x(pg, intra, inter)));
+        cost = svadd_n_f64_x(pg, svdiv_f64_x(pg, cost, svcvt_f64_s64_x(pg, intra)), 0.5);
+
+        svst1w_s64(pg, dst + i, svcvt_s64_f64_x(pg, cost));
+    }
+}
+
+static uint32_t quant_sve(const int16_t* coef, const int32_t* quantCoeff, int32_t* deltaU, int16_t* qCoef, int qBits, int add, int numCoeff)
+{
+    X265_CHECK(qBits >= 8, "qBits less than 8\n");
+    X265_CHECK((numCoeff % 16) == 0, "numCoeff must be multiple of 16\n");
+
+    uint64_t numSig = 0;
+
+    for (int i = 0; i < numCoeff; i += (int)svcntw())
+    {
+        svbool_t pg = svwhilelt_b32(i, numCoeff);
+        svint32_t level = svld1sh_s32(pg, coef + i);
+        svint32_t tmplevel = svmul_s32_x(pg, svabs_s32_x(pg, level), svld1_s32(pg, quantCoeff + i));
+        svint32_t q = svasr_n_s32_x(pg, svadd_n_s32_x(pg, tmplevel, add), qBits);
+
+        svint32_t delta = svsub_s32_x(pg, tmplevel, svlsl_n_s32_x(pg, q, qBits));
+        svst1_s32(pg, deltaU + i, svasr_n_s32_x(pg, delta, qBits - 8));
+        numSig += svcntp_b32(pg, svcmpne_n_s32(pg, q, 0));
+
+        q = svneg_s32_m(q, svcmplt_n_s32(pg, level, 0), q);
+        q = svmax_n_s32_x(pg, svmin_n_s32_x(pg, q, 32767), -32768);
+        svst1h_s32(pg, qCoef + i, q);
+    }
+
+    return (uint32_t)numSig;
+}
+
+static uint32_t nquant_sve(const int16_t* coef, const int32_t* quantCoeff, int16_t* qCoef, int qBits, int add, int numCoeff)
+{
+    X265_CHECK((numCoeff % 16) == 0, "number of quant coeff is not multiple of 4x4\n");
+    X265_CHECK((uint32_t)add < ((uint32_t)1 << qBits), "2 ^ qBits less than add\n");
+
+    uint64_t numSig = 0;
+
+    for (int i = 0; i < numCoeff; i += (int)svcntw())
+    {
+        svbool_t pg = svwhilelt_b32(i, numCoeff);
+        svint32_t level = svld1sh_s32(pg, coef + i);
+        svint32_t q = svmul_s32_x(pg, svabs_s32_x(pg, level), svld1_s32(pg, quantCoeff + i));
+        q = svasr_n_s32_x(pg, svadd_n_s32_x(pg, q, add), qBits);
+        numSig += svcntp_b32(pg, svcmpne_n_s32(pg, q, 0));
+
+        /* clip the signed level; -32768 stays negative when truncated to
+         * int16 as in the C reference */
+        q = svneg_s32_m(q, svcmplt_n_s32(pg, level, 0), q);
+        q = svmax_n_s32_x(pg, svmin_n_s32_x(pg, q, 32767), -32768);
+        svst1h_s32(pg, qCoef + i, svabs_s32_x(pg, q));
+    }
+
+    return (uint32_t)numSig;
+}
+
+static void dequant_normal_sve(const int16_t* quantCoef, int16_t* coef, int num, int scale, int shift)
+{
+    X265_CHECK(num <= 32 * 32, "dequant num %d too large\n", num);
+    X265_CHECK((num % 8) == 0, "dequant num %d not multiple of 8\n", num);
+    X265_CHECK(shift <= 10, "shift too large %d\n", shift);
+
+    const int add = shift ? 1 << (shift - 1) : 0;
+
+    for (int n = 0; n < num; n += (int)svcntw())
+    {
+        svbool_t pg = svwhilelt_b32(n, num);
+        svint32_t c = svmul_n_s32_x(pg, svld1sh_s32(pg, quantCoef + n), scale);
+        c = svasr_n_s32_x(pg, svadd_n_s32_x(pg, c, add), shift);
+        c = svmax_n_s32_x(pg, svmin_n_s32_x(pg, c, 32767), -32768);
+        svst1h_s32(pg, coef + n, c);
+    }
+}
+
+namespace X265_NS {
+void setupPixelPrimitives_sve(EncoderPrimitives &p)
+{
+    p.propagateCost = propagateCost_sve;
+    p.quant = quant_sve;
+    p.nquant = nquant_sve;
+    p.dequant_normal = dequant_normal_sve;
+}
+}
@@ -33,6 +33,10 @@
 #include <fcntl.h>
 #else
 #include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 namespace X265_NS {
@@ -306,4 +310,61 @@ error:
     return NULL;
 }
 
+void* x265_map_file(const char *filename, uint64_t* size)
+{
+    void* data = NULL;
+    *size = 0;
+#if _WIN32
+    wchar_t buf_utf16[MAX_PATH * 2];
+    if (!MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, filename, -1, buf_utf16, sizeof(buf_utf16) / sizeof(wchar_t)))
+        return NULL;
+    HANDLE file = CreateFileW(buf_utf16, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0)
+        mapping = CreateFileMappingW(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    if (mapping)
+    {
+        /* the view keeps the mapping object and the file open */
+        data = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+        if (data)
+            *size = fileSize.QuadPart;
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 0)
+    {
+        /* private writable mapping, the users are not meant to write the data
+         * but a stray write must not reach the file */
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
+            data = NULL;
+        else
+            *size = st.st_size;
+    }
+    close(fd);
+#endif
+    return data;
+}
+
+void x265_unmap_file(void* data, uint64_t size)
+{
+    if (!data)
+        return;
+#if _WIN32
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap(data, (size_t)size);
+#endif
+}
+
+
 }
@@ -213,6 +213,9 @@ typedef int16_t  coeff_t;      // transform coefficient
 #define X265_LOWRES_CU_SIZE   8
 #define X265_LOWRES_CU_BITS   3
 
+// coarser levels of the lowres pyramid for hierarchical lookahead motion search
+#define X265_HME_MAX_LEVELS   2
+
 #define X265_MALLOC(type, count)    (type*)x265_malloc(sizeof(type) * (count))
 #define X265_FREE(ptr)              x265_free(ptr)
 #define X265_FREE_ZERO(ptr)         x265_free(ptr); (ptr) = NULL
@@ -436,6 +439,11 @@ void*    x265_malloc(size_t size);
 void     x265_free(void *ptr);
 char*    x265_slurp_file(const char *filename);
 
+/* maps the whole file copy-on-write, returns NULL if it cannot be mapped or
+ * is empty */
+void*    x265_map_file(const char *filename, uint64_t* size);
+void     x265_unmap_file(void* data, uint64_t size);
+
 /* located in primitives.cpp */
 void     x265_setup_primitives(x265_param* param);
 void     x265_report_simd(x265_param* param);
@@ -36,6 +36,9 @@
 #include <sys/sysctl.h>
 #include <machine/cpu.h>
 #endif
+#if X265_ARCH_ARM64 && defined(__linux__)
+#include <sys/auxv.h>
+#endif
 
 #if X265_ARCH_ARM && !defined(HAVE_NEON)
 #include <signal.h>
@@ -94,6 +97,7 @@ const cpu_name_t cpu_names[] =
     { "SlowAtom",        X265_CPU_SLOW_ATOM },
     { "SlowPshufb",      X265_CPU_SLOW_PSHUFB },
     { "SlowPalignr",     X265_CPU_SLOW_PALIGNR },
+    { "SlowAVX512",      X265_CPU_SLOW_AVX512 },
     { "SlowShuffle",     X265_CPU_SLOW_SHUFFLE },
     { "UnalignedStack",  X265_CPU_STACK_MOD4 },
 
@@ -102,6 +106,11 @@ const cpu_name_t cpu_names[] =
     { "NEON",            X265_CPU_NEON },
     { "FastNeonMRC",     X265_CPU_FAST_NEON_MRC },
 
+#elif X265_ARCH_ARM64
+    { "NEON",            X265_CPU_NEON },
+    { "SVE",             X265_CPU_SVE },
+    { "SVE2",            X265_CPU_SVE2 },
+
 #elif X265_ARCH_POWER8
     { "Altivec",         X265_CPU_ALTIVEC },
 
@@ -189,7 +198,13 @@ uint32_t cpu_detect(bool benableavx512 )
                 if ((xcr0 & 0xE0) == 0xE0) /* OPMASK/ZMM state */
                 {
                     if ((ebx & 0xD0030000) == 0xD0030000)
+                    {
                         cpu |= X265_CPU_AVX512;
+                        /* cores before AVX512_VBMI2 (Ice Lake, Zen 4) take a
+                         * frequency licence penalty for heavy 512bit code */
+                        if (!(ecx & 0x00000040))
+                            cpu |= X265_CPU_SLOW_AVX512;
+                    }
                 }
             }
         }
@@ -370,6 +385,33 @@ uint32_t cpu_detect(bool benableavx512)
     return flags;
 }
 
+#elif X265_ARCH_ARM64
+
+uint32_t cpu_detect(bool /* benableavx512 */)
+{
+    // NEON (AdvSIMD) is mandatory in ARMv8-A
+    uint32_t flags = X265_CPU_NEON;
+
+    // SVE support is reported by the kernel; the bits are those of the
+    // uapi hwcap.h, for older C libraries that do not define them yet
+#if defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+#ifdef AT_HWCAP2
+    unsigned long hwcap2 = getauxval(AT_HWCAP2);
+#else
+    unsigned long hwcap2 = 0;
+#endif
+    if (hwcap & (1UL << 22))    // HWCAP_SVE
+    {
+        flags |= X265_CPU_SVE;
+        if (hwcap2 & (1UL << 1)) // HWCAP2_SVE2
+            flags |= X265_CPU_SVE2;
+    }
+#endif
+
+    return flags;
+}
+
 #elif X265_ARCH_POWER8
 
 uint32_t cpu_detect(bool benableavx512)
@@ -389,4 +431,48 @@ uint32_t cpu_detect(bool benableavx512)
 }
 
 #endif // if X265_ARCH_X86
+
+void cpu_host_type(cpu_host_t& host)
+{
+    strcpy(host.vendor, "unknown");
+    host.family = host.model = host.stepping = 0;
+
+#if X265_ARCH_X86
+#if !X86_64
+    if (!PFX(cpu_cpuid_test)())
+        return;
+#endif
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t vendor[4] = { 0 };
+    PFX(cpu_cpuid)(0, &eax, vendor + 0, vendor + 2, vendor + 1);
+    if (eax == 0)
+        return;
+
+    /* some vendor strings are padded with spaces */
+    int len = 0;
+    for (const char* c = (const char*)vendor; *c; c++)
+        if (*c != ' ')
+            host.vendor[len++] = *c;
+    host.vendor[len] = 0;
+
+    PFX(cpu_cpuid)(1, &eax, &ebx, &ecx, &edx);
+    host.family = ((eax >> 8) & 0xf) + ((eax >> 20) & 0xff);
+    host.model = ((eax >> 4) & 0xf) + ((eax >> 12) & 0xf0);
+    host.stepping = eax & 0xf;
+#elif X265_ARCH_ARM64 && defined(__linux__)
+    /* MIDR_EL1: implementer, variant, architecture, part number, revision */
+    FILE* fp = fopen("/sys/devices/system/cpu/cpu0/regs/identification/midr_el1", "r");
+    if (!fp)
+        return;
+    unsigned long long midr = 0;
+    if (fscanf(fp, "%llx", &midr) == 1 && midr)
+    {
+        sprintf(host.vendor, "arm-%02x", (unsigned)(midr >> 24) & 0xff);
+        host.family = (int)(midr >> 20) & 0xf;
+        host.model = (int)(midr >> 4) & 0xfff;
+        host.stepping = (int)midr & 0xf;
+    }
+    fclose(fp);
+#endif
+}
 }
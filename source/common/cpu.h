@@ -52,6 +52,18 @@ extern "C" void PFX(safe_intel_cpu_indicator_init)(void);
 namespace X265_NS {
 uint32_t cpu_detect(bool);
 
+/* identifies the type of the host CPU beyond its capability flags, for data
+ * measured on one host type. Unknown parts are reported as "unknown" and 0 */
+struct cpu_host_t
+{
+    char vendor[16];
+    int  family;
+    int  model;
+    int  stepping;
+};
+
+void cpu_host_type(cpu_host_t& host);
+
 struct cpu_name_t
 {
     char name[16];
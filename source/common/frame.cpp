@@ -33,6 +33,9 @@ Frame::Frame()
 {
     m_bChromaExtended = false;
     m_lowresInit = false;
+    m_preQueued = false;
+    m_preNextBand = 0;
+    m_preBandsDone = 0;
     m_reconRowFlag = NULL;
     m_reconColCount = NULL;
     m_countRefEncoders = 0;
@@ -47,7 +50,11 @@ Frame::Frame()
     memset(&m_lowres, 0, sizeof(m_lowres));
     m_rcData = NULL;
     m_encodeStartTime = 0;
+    m_lookaheadInputDepth = 0;
+    m_lookaheadOutputDepth = 0;
     m_reconfigureRc = false;
+    m_planesRelease = NULL;
+    m_planesOpaque = NULL;
     m_ctuInfo = NULL;
     m_prevCtuInfoChange = NULL;
     m_addOnDepth = NULL;
@@ -156,6 +163,18 @@ void Frame::reinit(const SPS& sps)
     m_encData->reinit(sps);
 }
 
+/* hand the planes of a zero-copy input picture back to the user, once the
+ * frame is neither encoded nor referenced anymore */
+void Frame::releasePlanes()
+{
+    if (m_planesRelease)
+    {
+        void* planes[3] = { m_fencPic->m_picOrg[0], m_fencPic->m_picOrg[1], m_fencPic->m_picOrg[2] };
+        m_planesRelease(m_planesOpaque, planes);
+        m_planesRelease = NULL;
+    }
+}
+
 void Frame::destroy()
 {
     if (m_encData)
@@ -167,6 +186,7 @@ void Frame::destroy()
 
     if (m_fencPic)
     {
+        releasePlanes();
         if (m_param->bCopyPicToFrame)
             m_fencPic->destroy();
         delete m_fencPic;
@@ -90,9 +90,14 @@ public:
     int64_t                m_dts;
     int32_t                m_forceqp;            // Force to use the qp specified in qp file
     void*                  m_userData;           // user provided pointer passed in with this picture
+    void                 (*m_planesRelease)(void*, void*[3]); // zero-copy input, returns the planes to the user
+    void*                  m_planesOpaque;
 
     Lowres                 m_lowres;
     bool                   m_lowresInit;         // lowres init complete (pre-analysis)
+    bool                   m_preQueued;          // pre-analysis given to the pre-lookahead pipeline
+    int                    m_preNextBand;        // next pre-lookahead row band to be processed
+    int                    m_preBandsDone;       // count of pre-lookahead row bands completed
     bool                   m_bChromaExtended;    // orig chroma planes motion extended for weight analysis
     bool                   m_reconfigureRc;
 
@@ -101,7 +106,7 @@ public:
 
     /* Frame Parallelism - notification between FrameEncoders of available motion reference rows */
     ThreadSafeInteger*     m_reconRowFlag;       // flag of CTU rows completely reconstructed and extended for motion reference
-    ThreadSafeInteger*     m_reconColCount;      // count of CTU cols completely reconstructed and extended for motion reference
+    ThreadSafeInteger*     m_reconColCount;      // count of CTU cols completely reconstructed and extended for motion reference (--column-sync)
     int32_t                m_numRows;
     volatile uint32_t      m_countRefEncoders;   // count of FrameEncoder threads monitoring m_reconRowCount
 
@@ -118,6 +123,8 @@ public:
     Event                  m_copied;
     int*                   m_prevCtuInfoChange;
     int64_t                m_encodeStartTime;
+    int                    m_lookaheadInputDepth;  // lookahead queue depths when the frame was decided
+    int                    m_lookaheadOutputDepth;
 
     uint8_t**              m_addOnDepth;
     uint8_t**              m_addOnCtuInfo;
@@ -135,6 +142,7 @@ public:
     bool create(x265_param *param, float* quantOffsets);
     bool allocEncodeData(x265_param *param, const SPS& sps);
     void reinit(const SPS& sps);
+    void releasePlanes();
     void destroy();
 };
 }
@@ -65,6 +65,8 @@ bool Lowres::create(PicYuv *origPic, int _bframes, bool bAQEnabled, uint32_t qgS
                CHECKED_MALLOC_ZERO(qpAqMotionOffset, double, cuCountFullRes);
     if (origPic->m_param->bDynamicRefine)
         CHECKED_MALLOC_ZERO(blockVariance, uint32_t, cuCountFullRes);
+    if (bAQEnabled || origPic->m_param->bEnableWeightedPred || origPic->m_param->bEnableWeightedBiPred)
+        CHECKED_MALLOC_ZERO(blockEnergy, uint32_t, cuCountFullRes);
     CHECKED_MALLOC(propagateCost, uint16_t, cuCount);
 
     /* allocate lowres buffers */
@@ -99,6 +101,33 @@ bool Lowres::create(PicYuv *origPic, int _bframes, bool bAQEnabled, uint32_t qgS
         CHECKED_MALLOC(lowresMvCosts[1][i], int32_t, cuCount);
     }
 
+    hmeLevels = origPic->m_param->hmeLevels;
+    for (int l = 0; l < hmeLevels; l++)
+    {
+        hmeBlocksInRow[l] = ((l ? hmeBlocksInRow[l - 1] : maxBlocksInRow) + 1) >> 1;
+        hmeBlocksInCol[l] = ((l ? hmeBlocksInCol[l - 1] : maxBlocksInCol) + 1) >> 1;
+
+        ReferencePlanes& planes = hmePlanes[l];
+        planes.isLowres = true;
+        planes.lumaStride = hmeBlocksInRow[l] * X265_LOWRES_CU_SIZE + 2 * origPic->m_lumaMarginX;
+        if (planes.lumaStride & 31)
+            planes.lumaStride += 32 - (planes.lumaStride & 31);
+
+        size_t levelsize = planes.lumaStride * (hmeBlocksInCol[l] * X265_LOWRES_CU_SIZE + 2 * origPic->m_lumaMarginY);
+        size_t leveloffset = planes.lumaStride * origPic->m_lumaMarginY + origPic->m_lumaMarginX;
+        CHECKED_MALLOC_ZERO(hmeBuffer[l], pixel, 4 * levelsize);
+        for (int i = 0; i < 4; i++)
+            planes.lowresPlane[i] = hmeBuffer[l] + i * levelsize + leveloffset;
+        planes.fpelPlane[0] = planes.lowresPlane[0];
+
+        int levelCount = hmeBlocksInRow[l] * hmeBlocksInCol[l];
+        for (int i = 0; i < bframes + 2; i++)
+        {
+            CHECKED_MALLOC(hmeMvs[l][0][i], MV, levelCount);
+            CHECKED_MALLOC(hmeMvs[l][1][i], MV, levelCount);
+        }
+    }
+
     return true;
 
 fail:
@@ -127,6 +156,16 @@ void Lowres::destroy()
         X265_FREE(lowresMvCosts[0][i]);
         X265_FREE(lowresMvCosts[1][i]);
     }
+
+    for (int l = 0; l < hmeLevels; l++)
+    {
+        X265_FREE(hmeBuffer[l]);
+        for (int i = 0; i < bframes + 2; i++)
+        {
+            X265_FREE(hmeMvs[l][0][i]);
+            X265_FREE(hmeMvs[l][1][i]);
+        }
+    }
     X265_FREE(qpAqOffset);
     X265_FREE(invQscaleFactor);
     X265_FREE(qpCuTreeOffset);
@@ -134,9 +173,17 @@ void Lowres::destroy()
        X265_FREE(invQscaleFactor8x8);
        X265_FREE(qpAqMotionOffset);
     X265_FREE(blockVariance);
+    X265_FREE(blockEnergy);
 }
 // (re) initialize lowres state
 void Lowres::init(PicYuv *origPic, int poc)
+{
+    initState(origPic, poc);
+    downscale(origPic, 0, lines);
+    extendBorders(origPic);
+}
+
+void Lowres::initState(PicYuv *origPic, int poc)
 {
     bLastMiniGopBFrame = false;
     bKeyframe = false; // Not a keyframe unless identified by lookahead
@@ -144,6 +191,7 @@ void Lowres::init(PicYuv *origPic, int poc)
     leadingBframes = 0;
     indB = 0;
     memset(costEst, -1, sizeof(costEst));
+    memset(miniGopCost, -1, sizeof(miniGopCost));
     memset(weightedCostDelta, 0, sizeof(weightedCostDelta));
 
     if (qpAqOffset && invQscaleFactor)
@@ -164,16 +212,43 @@ void Lowres::init(PicYuv *origPic, int poc)
     if (origPic->m_param->rc.vbvBufferSize)
         for (int i = 0; i < X265_LOOKAHEAD_MAX + 1; i++)
             plannedType[i] = X265_TYPE_AUTO;
+}
+
+/* downscale and generate 4 hpel planes for lookahead, lowres lines
+ * [startLine, endLine) */
+void Lowres::downscale(PicYuv *origPic, int startLine, int endLine)
+{
+    intptr_t srcOffset = 2 * startLine * origPic->m_stride;
+    intptr_t dstOffset = startLine * lumaStride;
 
-    /* downscale and generate 4 hpel planes for lookahead */
-    primitives.frameInitLowres(origPic->m_picOrg[0],
-                               lowresPlane[0], lowresPlane[1], lowresPlane[2], lowresPlane[3],
-                               origPic->m_stride, lumaStride, width, lines);
+    primitives.frameInitLowres(origPic->m_picOrg[0] + srcOffset,
+                               lowresPlane[0] + dstOffset, lowresPlane[1] + dstOffset,
+                               lowresPlane[2] + dstOffset, lowresPlane[3] + dstOffset,
+                               origPic->m_stride, lumaStride, width, endLine - startLine);
+}
 
+void Lowres::extendBorders(PicYuv *origPic)
+{
     /* extend hpel planes for motion search */
     extendPicBorder(lowresPlane[0], lumaStride, width, lines, origPic->m_lumaMarginX, origPic->m_lumaMarginY);
     extendPicBorder(lowresPlane[1], lumaStride, width, lines, origPic->m_lumaMarginX, origPic->m_lumaMarginY);
     extendPicBorder(lowresPlane[2], lumaStride, width, lines, origPic->m_lumaMarginX, origPic->m_lumaMarginY);
     extendPicBorder(lowresPlane[3], lumaStride, width, lines, origPic->m_lumaMarginX, origPic->m_lumaMarginY);
     fpelPlane[0] = lowresPlane[0];
+
+    /* downscale each coarser level of the pyramid from the (extended) full
+     * pel plane of the previous level */
+    for (int l = 0; l < hmeLevels; l++)
+    {
+        ReferencePlanes& src = l ? hmePlanes[l - 1] : *this;
+        ReferencePlanes& dst = hmePlanes[l];
+        int levelWidth = hmeBlocksInRow[l] * X265_LOWRES_CU_SIZE;
+        int levelLines = hmeBlocksInCol[l] * X265_LOWRES_CU_SIZE;
+
+        primitives.frameInitLowres(src.lowresPlane[0],
+                                   dst.lowresPlane[0], dst.lowresPlane[1], dst.lowresPlane[2], dst.lowresPlane[3],
+                                   src.lumaStride, dst.lumaStride, levelWidth, levelLines);
+        for (int i = 0; i < 4; i++)
+            extendPicBorder(dst.lowresPlane[i], dst.lumaStride, levelWidth, levelLines, origPic->m_lumaMarginX, origPic->m_lumaMarginY);
+    }
 }
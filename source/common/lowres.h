@@ -123,6 +123,7 @@ struct Lowres : public ReferencePlanes
     /* lookahead output data */
     int64_t   costEst[X265_BFRAME_MAX + 2][X265_BFRAME_MAX + 2];
     int64_t   costEstAq[X265_BFRAME_MAX + 2][X265_BFRAME_MAX + 2];
+    int64_t   miniGopCost[X265_BFRAME_MAX + 2]; // path cost of the mini-GOP ending at this P, by its length
     int32_t*  rowSatds[X265_BFRAME_MAX + 2][X265_BFRAME_MAX + 2];
     int       intraMbs[X265_BFRAME_MAX + 2];
     int32_t*  intraCost;
@@ -137,6 +138,15 @@ struct Lowres : public ReferencePlanes
     uint32_t  maxBlocksInRowFullRes;
     uint32_t  maxBlocksInColFullRes;
 
+    /* coarser levels of the lowres pyramid for hierarchical motion search,
+     * level 0 is quarter resolution and each next level halves it again */
+    int       hmeLevels;
+    ReferencePlanes hmePlanes[X265_HME_MAX_LEVELS];
+    pixel*    hmeBuffer[X265_HME_MAX_LEVELS];
+    MV*       hmeMvs[X265_HME_MAX_LEVELS][2][X265_BFRAME_MAX + 2];
+    uint32_t  hmeBlocksInRow[X265_HME_MAX_LEVELS];
+    uint32_t  hmeBlocksInCol[X265_HME_MAX_LEVELS];
+
     /* used for vbvLookahead */
     int       plannedType[X265_LOOKAHEAD_MAX + 1];
     int64_t   plannedSatd[X265_LOOKAHEAD_MAX + 1];
@@ -150,6 +160,9 @@ struct Lowres : public ReferencePlanes
     int*      invQscaleFactor; // qScale values for qp Aq Offsets
     int*      invQscaleFactor8x8; // temporary buffer for qg-size 8
     uint32_t* blockVariance;
+    uint32_t* blockEnergy;     // AC energy of each AQ block, shared by the AQ passes
+    uint64_t  energySsd[3];    // wp_ssd and wp_sum contributions of one blockEnergy pass
+    uint64_t  energySum[3];
     uint64_t  wp_ssd[3];       // This is different than SSDY, this is sum(pixel^2) - sum(pixel)^2 for entire frame
     uint64_t  wp_sum[3];
     uint64_t  frameVariance;
@@ -162,6 +175,11 @@ struct Lowres : public ReferencePlanes
     bool create(PicYuv *origPic, int _bframes, bool bAqEnabled, uint32_t qgSize);
     void destroy();
     void init(PicYuv *origPic, int poc);
+
+    /* the steps of init(), for callers which generate the lowres planes in row bands */
+    void initState(PicYuv *origPic, int poc);
+    void downscale(PicYuv *origPic, int startLine, int endLine);
+    void extendBorders(PicYuv *origPic);
 };
 }
 
@@ -108,6 +108,13 @@ void x265_param_default(x265_param* param)
     param->cpuid = X265_NS::cpu_detect(false);
     param->bEnableWavefront = 1;
     param->frameNumThreads = 0;
+    param->poolStealThreshold = 0;
+    param->threadPool = NULL;
+    param->poolWeight = 1;
+    param->bStatsBinary = 0;
+    param->bPrimitiveTune = 0;
+    param->primitiveTuneFile = NULL;
+    param->bEnableColumnSync = 0;
 
     param->logLevel = X265_LOG_INFO;
     param->csvLogLevel = 0;
@@ -154,6 +161,10 @@ void x265_param_default(x265_param* param)
     param->scenecutThreshold = 40; /* Magic number pulled in from x264 */
     param->lookaheadSlices = 8;
     param->lookaheadThreads = 0;
+    param->preLookaheadDepth = 0;
+    param->bLookaheadSteal = 1;
+    param->hmeLevels = 0;
+    param->lowresMvSeed = 0;
     param->scenecutBias = 5.0;
     param->radl = 0;
     /* Intra Coding Tools */
@@ -206,6 +217,8 @@ void x265_param_default(x265_param* param)
     param->analysisReuseFileName = NULL;
     param->analysisSave = NULL;
     param->analysisLoad = NULL;
+    param->bAnalysisMmap = 0;
+    param->bAnalysisCompress = 0;
     param->bIntraInBFrames = 0;
     param->bLossless = 0;
     param->bCULossless = 0;
@@ -633,9 +646,11 @@ int x265_param_parse(x265_param* p, const char* name, const char* value)
         if (bValueWasNull)
             p->cpuid = atobool(value);
         else
-            p->cpuid = parseCpuName(value, bError);
+            p->cpuid = parseCpuName(value, bError, false);
 #endif
     }
+    OPT("primitive-tune") p->bPrimitiveTune = atobool(value);
+    OPT("primitive-tune-file") p->primitiveTuneFile = strdup(value);
     OPT("fps")
     {
         if (sscanf(value, "%u/%u", &p->fpsNum, &p->fpsDenom) == 2)
@@ -686,6 +701,7 @@ int x265_param_parse(x265_param* p, const char* name, const char* value)
     OPT("annexb") p->bAnnexB = atobool(value);
     OPT("repeat-headers") p->bRepeatHeaders = atobool(value);
     OPT("wpp") p->bEnableWavefront = atobool(value);
+    OPT("column-sync") p->bEnableColumnSync = atobool(value);
     OPT("ctu") p->maxCUSize = (uint32_t)atoi(value);
     OPT("min-cu-size") p->minCUSize = (uint32_t)atoi(value);
     OPT("tu-intra-depth") p->tuQTMaxIntraDepth = (uint32_t)atoi(value);
@@ -954,8 +970,11 @@ int x265_param_parse(x265_param* p, const char* name, const char* value)
         p->rc.bStatRead = pass & 2;
     }
     OPT("stats") p->rc.statFileName = strdup(value);
+    OPT("stats-binary") p->bStatsBinary = atobool(value);
     OPT("scaling-list") p->scalingLists = strdup(value);
     OPT2("pools", "numa-pools") p->numaPools = strdup(value);
+    OPT("pool-steal") p->poolStealThreshold = atoi(value);
+    OPT("pool-weight") p->poolWeight = atoi(value);
     OPT("lambda-file") p->rc.lambdaFileName = strdup(value);
     OPT("analysis-reuse-file") p->analysisReuseFileName = strdup(value);
     OPT("qg-size") p->rc.qgSize = atoi(value);
@@ -985,6 +1004,10 @@ int x265_param_parse(x265_param* p, const char* name, const char* value)
         OPT("multi-pass-opt-rps") p->bMultiPassOptRPS = atobool(value);
         OPT("scenecut-bias") p->scenecutBias = atof(value);
         OPT("lookahead-threads") p->lookaheadThreads = atoi(value);
+        OPT("pre-lookahead-depth") p->preLookaheadDepth = atoi(value);
+        OPT("lookahead-steal") p->bLookaheadSteal = atobool(value);
+        OPT("hme-levels") p->hmeLevels = atoi(value);
+        OPT("lowres-mv-seed") p->lowresMvSeed = atoi(value);
         OPT("opt-cu-delta-qp") p->bOptCUDeltaQP = atobool(value);
         OPT("multi-pass-opt-analysis") p->analysisMultiPassRefine = atobool(value);
         OPT("multi-pass-opt-distortion") p->analysisMultiPassDistortion = atobool(value);
@@ -1037,6 +1060,8 @@ int x265_param_parse(x265_param* p, const char* name, const char* value)
         OPT("gop-lookahead") p->gopLookahead = atoi(value);
         OPT("analysis-save") p->analysisSave = strdup(value);
         OPT("analysis-load") p->analysisLoad = strdup(value);
+        OPT("analysis-mmap") p->bAnalysisMmap = atobool(value);
+        OPT("analysis-compress") p->bAnalysisCompress = atobool(value);
         OPT("radl") p->radl = atoi(value);
         OPT("max-ausize-factor") p->maxAUSizeFactor = atof(value);
         OPT("dynamic-refine") p->bDynamicRefine = atobool(value);
@@ -1231,6 +1256,10 @@ int x265_check_params(x265_param* param)
           "limitRectAmp must be 0, 1");
     CHECK(param->frameNumThreads < 0 || param->frameNumThreads > X265_MAX_FRAME_THREADS,
           "frameNumThreads (--frame-threads) must be [0 .. X265_MAX_FRAME_THREADS)");
+    CHECK(param->poolStealThreshold < 0,
+          "pool-steal idle threshold must be a positive number of milliseconds, or 0 to disable");
+    CHECK(param->poolWeight < 1 || param->poolWeight > 100,
+          "pool-weight must be between 1 and 100");
     CHECK(param->cbQpOffset < -12, "Min. Chroma Cb QP Offset is -12");
     CHECK(param->cbQpOffset >  12, "Max. Chroma Cb QP Offset is  12");
     CHECK(param->crQpOffset < -12, "Min. Chroma Cr QP Offset is -12");
@@ -1283,6 +1312,12 @@ int x265_check_params(x265_param* param)
           "Lookahead depth must be less than 256");
     CHECK(param->lookaheadSlices > 16 || param->lookaheadSlices < 0,
           "Lookahead slices must between 0 and 16");
+    CHECK(param->preLookaheadDepth > X265_LOOKAHEAD_MAX || param->preLookaheadDepth < 0,
+          "Pre-lookahead depth must be between 0 and 250");
+    CHECK(param->hmeLevels > X265_HME_MAX_LEVELS || param->hmeLevels < 0,
+          "HME levels must be between 0 and 2");
+    CHECK(param->lowresMvSeed > 2 || param->lowresMvSeed < 0,
+          "Lowres MV seed must be between 0 and 2");
     CHECK(param->rc.aqMode < X265_AQ_NONE || X265_AQ_AUTO_VARIANCE_BIASED < param->rc.aqMode,
           "Aq-Mode is out of range");
     CHECK(param->rc.aqStrength < 0 || param->rc.aqStrength > 3,
@@ -1386,6 +1421,10 @@ int x265_check_params(x265_param* param)
     CHECK((param->analysisSave || param->analysisLoad) && (param->analysisReuseLevel < 1 || param->analysisReuseLevel > 10),
         "Invalid analysis refine level. Value must be between 1 and 10 (inclusive)");
     CHECK(param->scaleFactor > 2, "Invalid scale-factor. Supports factor <= 2");
+    CHECK(param->bAnalysisMmap && (param->analysisSave || param->analysisLoad) && (param->scaleFactor || param->bDisableLookahead),
+        "analysis-mmap is not supported with scale-factor or bDisableLookahead");
+    CHECK(param->bAnalysisMmap && param->bAnalysisCompress && param->analysisSave,
+        "analysis-compress is not supported with analysis-mmap");
     CHECK(param->rc.qpMax < QP_MIN || param->rc.qpMax > QP_MAX_MAX,
         "qpmax exceeds supported range (0 to 69)");
     CHECK(param->rc.qpMin < QP_MIN || param->rc.qpMin > QP_MAX_MAX,
@@ -1542,6 +1581,8 @@ void x265_print_params(x265_param* param)
     TOOLOPT(param->bEnableStrongIntraSmoothing, "strong-intra-smoothing");
     TOOLVAL(param->lookaheadSlices, "lslices=%d");
     TOOLVAL(param->lookaheadThreads, "lthreads=%d")
+    TOOLVAL(param->hmeLevels, "hme=%d");
+    TOOLVAL(param->lowresMvSeed, "lowres-mv-seed=%d");
     TOOLVAL(param->bCTUInfo, "ctu-info=%d");
     if (param->bMVType == AVC_INFO)
         TOOLOPT(param->bMVType, "refine-mv-type=avc");
@@ -1589,7 +1630,12 @@ char *x265_param2string(x265_param* p, int padx, int pady)
     s += sprintf(s, " frame-threads=%d", p->frameNumThreads);
     if (p->numaPools)
         s += sprintf(s, " numa-pools=%s", p->numaPools);
+    if (p->poolStealThreshold)
+        s += sprintf(s, " pool-steal=%d", p->poolStealThreshold);
+    if (p->threadPool)
+        s += sprintf(s, " pool-weight=%d", p->poolWeight);
     BOOL(p->bEnableWavefront, "wpp");
+    BOOL(p->bEnableColumnSync, "column-sync");
     BOOL(p->bDistributeModeAnalysis, "pmode");
     BOOL(p->bDistributeMotionEstimation, "pme");
     BOOL(p->bEnablePsnr, "psnr");
@@ -1625,6 +1671,8 @@ char *x265_param2string(x265_param* p, int padx, int pady)
     s += sprintf(s, " bframe-bias=%d", p->bFrameBias);
     s += sprintf(s, " rc-lookahead=%d", p->lookaheadDepth);
     s += sprintf(s, " lookahead-slices=%d", p->lookaheadSlices);
+    BOOL(p->bLookaheadSteal, "lookahead-steal");
+    s += sprintf(s, " hme-levels=%d", p->hmeLevels);
     s += sprintf(s, " scenecut=%d", p->scenecutThreshold);
     s += sprintf(s, " radl=%d", p->radl);
     BOOL(p->bIntraRefresh, "intra-refresh");
@@ -1651,6 +1699,7 @@ char *x265_param2string(x265_param* p, int padx, int pady)
     s += sprintf(s, " me=%d", p->searchMethod);
     s += sprintf(s, " subme=%d", p->subpelRefine);
     s += sprintf(s, " merange=%d", p->searchRange);
+    s += sprintf(s, " lowres-mv-seed=%d", p->lowresMvSeed);
     BOOL(p->bEnableTemporalMvp, "temporal-mvp");
     BOOL(p->bEnableWeightedPred, "weightp");
     BOOL(p->bEnableWeightedBiPred, "weightb");
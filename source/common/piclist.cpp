@@ -158,3 +158,123 @@ void PicList::remove(Frame& curFrame)
 
     curFrame.m_next = curFrame.m_prev = NULL;
 }
+
+PicQueue::PicQueue()
+{
+    for (int i = 0; i < QUEUE_SIZE; i++)
+    {
+        m_slots[i].seq = i;
+        m_slots[i].pic = NULL;
+    }
+    m_head = m_tail = 0;
+    m_count = 0;
+    m_pushWaiters = 0;
+    m_maxDepth = 0;
+    m_numFullWaits = 0;
+    m_fullWaitTime = 0;
+}
+
+/* A slot whose sequence number equals the tail position is free for the
+ * producer which claims that position. Once the picture is written the
+ * sequence becomes position + 1, which makes it available to the consumer
+ * claiming that head position, who then releases it for the producer one
+ * lap later (position + QUEUE_SIZE). Sequence updates use atomic adds, which
+ * are full barriers, to publish the picture pointer */
+bool PicQueue::tryPushBack(Frame& pic)
+{
+    int32_t pos = m_tail;
+    for (;;)
+    {
+        Slot& slot = m_slots[pos & (QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)((uint32_t)slot.seq - (uint32_t)pos);
+        if (!diff)
+        {
+            int32_t prev = ATOMIC_CAS32(&m_tail, pos, (int32_t)((uint32_t)pos + 1));
+            if (prev == pos)
+            {
+                slot.pic = &pic;
+                ATOMIC_ADD(&slot.seq, 1);
+                break;
+            }
+            pos = prev;
+        }
+        else if (diff < 0)
+            return false; /* full */
+        else
+            pos = m_tail;
+    }
+
+    int count = ATOMIC_INC(&m_count);
+    if (count > m_maxDepth)
+        m_maxDepth = count; /* not thread safe, but good enough */
+    return true;
+}
+
+void PicQueue::pushBack(Frame& pic)
+{
+    if (tryPushBack(pic))
+        return;
+
+    int64_t startTime = x265_mdate();
+    ATOMIC_INC(&m_pushWaiters);
+    while (!tryPushBack(pic))
+        m_notFull.timedWait(1);
+    ATOMIC_DEC(&m_pushWaiters);
+
+    ATOMIC_INC(&m_numFullWaits);
+    m_fullWaitTime += x265_mdate() - startTime;
+}
+
+Frame* PicQueue::popFront()
+{
+    int32_t pos = m_head;
+    Frame* pic;
+    for (;;)
+    {
+        Slot& slot = m_slots[pos & (QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)((uint32_t)slot.seq - ((uint32_t)pos + 1));
+        if (!diff)
+        {
+            int32_t prev = ATOMIC_CAS32(&m_head, pos, (int32_t)((uint32_t)pos + 1));
+            if (prev == pos)
+            {
+                pic = slot.pic;
+                slot.pic = NULL;
+                ATOMIC_ADD(&slot.seq, QUEUE_SIZE - 1);
+                break;
+            }
+            pos = prev;
+        }
+        else if (diff < 0)
+            return NULL; /* empty */
+        else
+            pos = m_head;
+    }
+
+    ATOMIC_DEC(&m_count);
+    if (m_pushWaiters)
+        m_notFull.trigger();
+    return pic;
+}
+
+Frame* PicQueue::at(int idx)
+{
+    if (idx < 0 || idx >= m_count)
+        return NULL;
+
+    uint32_t pos = (uint32_t)m_head + idx;
+    Slot& slot = m_slots[pos & (QUEUE_SIZE - 1)];
+    return (uint32_t)slot.seq == pos + 1 ? slot.pic : NULL;
+}
+
+Frame* PicQueue::getPOC(int poc)
+{
+    int count = m_count;
+    for (int i = 0; i < count; i++)
+    {
+        Frame* curFrame = at(i);
+        if (curFrame && curFrame->m_poc == poc)
+            return curFrame;
+    }
+    return NULL;
+}
@@ -25,6 +25,7 @@
 #define X265_PICLIST_H
 
 #include "common.h"
+#include "threading.h"
 
 namespace X265_NS {
 
@@ -78,6 +79,60 @@ public:
 
     operator bool() const { return !!m_count; }
 };
+
+/* Bounded lock-free multi-producer, multi-consumer FIFO of pictures, a ring
+ * of sequence numbered slots. Unlike PicList it does not link the pictures
+ * together. Producers only block (as a last resort) when the ring is full */
+class PicQueue
+{
+public:
+
+    enum { QUEUE_SIZE = 512 }; // must be a power of two
+
+    PicQueue();
+
+    /** Push picture to end of the queue, false if the queue is full */
+    bool tryPushBack(Frame& pic);
+
+    /** Push picture to end of the queue, blocking while the queue is full */
+    void pushBack(Frame& pic);
+
+    /** Pop picture from beginning of the queue, NULL if the queue is empty */
+    Frame* popFront();
+
+    /** Get the idx'th picture from the beginning of the queue, or NULL. Only
+     * the consuming thread has a stable view of the queue contents */
+    Frame* at(int idx);
+
+    /** Find frame with specified POC */
+    Frame* getPOC(int poc);
+
+    Frame* first()        { return at(0); }
+
+    int size() const      { return m_count; }
+
+    bool empty() const    { return !m_count; }
+
+    /* statistics */
+    int      m_maxDepth;       // peak count of pictures in the queue
+    int      m_numFullWaits;   // count of pushBack() calls which blocked
+    int64_t  m_fullWaitTime;   // total time spent blocked in pushBack()
+
+protected:
+
+    struct Slot
+    {
+        volatile int32_t seq;
+        Frame* volatile  pic;
+    };
+
+    Slot             m_slots[QUEUE_SIZE];
+    volatile int32_t m_head;
+    volatile int32_t m_tail;
+    volatile int     m_count;
+    volatile int     m_pushWaiters;
+    Event            m_notFull;
+};
 }
 
 #endif // ifndef X265_PICLIST_H
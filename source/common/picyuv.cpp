@@ -26,6 +26,7 @@
 #include "picyuv.h"
 #include "slice.h"
 #include "primitives.h"
+#include "threadpool.h"
 
 using namespace X265_NS;
 
@@ -146,6 +147,27 @@ int PicYuv::getLumaBufLen(uint32_t picWidth, uint32_t picHeight, uint32_t picCsp
     return bufLen;
 }
 
+void PicYuv::getBufferLayout(int stride[3], int offset[3], int size[3]) const
+{
+    uint32_t numCuInHeight = (m_picHeight + m_param->maxCUSize - 1) / m_param->maxCUSize;
+    int maxHeight = numCuInHeight * m_param->maxCUSize;
+
+    stride[0] = (int)(m_stride * sizeof(pixel));
+    offset[0] = (int)((m_lumaMarginY * m_stride + m_lumaMarginX) * sizeof(pixel));
+    size[0] = (int)(m_stride * (maxHeight + (m_lumaMarginY * 2)) * sizeof(pixel));
+    for (int i = 1; i < 3; i++)
+    {
+        if (m_picCsp != X265_CSP_I400)
+        {
+            stride[i] = (int)(m_strideC * sizeof(pixel));
+            offset[i] = (int)((m_chromaMarginY * m_strideC + m_chromaMarginX) * sizeof(pixel));
+            size[i] = (int)(m_strideC * ((maxHeight >> m_vChromaShift) + (m_chromaMarginY * 2)) * sizeof(pixel));
+        }
+        else
+            stride[i] = offset[i] = size[i] = 0;
+    }
+}
+
 /* the first picture allocated by the encoder will be asked to generate these
  * offset arrays. Once generated, they will be provided to all future PicYuv
  * allocated by the same encoder. */
@@ -204,9 +226,192 @@ void PicYuv::destroy()
     X265_FREE(m_picBuf[2]);
 }
 
+bool PicYuv::isValidInput(int csp, int bitDepth, int internalCsp)
+{
+    bool b422to420 = internalCsp == X265_CSP_I420 || internalCsp == X265_CSP_I422;
+
+    switch (csp)
+    {
+    case X265_CSP_I400:
+        return true;
+    case X265_CSP_I422:
+        return b422to420;
+    case X265_CSP_NV12:
+        return internalCsp == X265_CSP_I420 && (bitDepth == 8 || bitDepth >= X265_DEPTH);
+    case X265_CSP_NV16:
+        return b422to420 && (bitDepth == 8 || bitDepth >= X265_DEPTH);
+    case X265_CSP_YUYV:
+    case X265_CSP_UYVY:
+        return b422to420 && bitDepth == 8;
+    case X265_CSP_V210:
+        return b422to420 && bitDepth == 10;
+    default:
+        return csp == internalCsp;
+    }
+}
+
+/* Copy rows of one plane of a planar picture, starting at column col. Shift
+ * pixels as necessary, mask off bits above X265_DEPTH for safety */
+static void copyPlane(const x265_picture& pic, int plane, int row, int col, pixel* dst, intptr_t dstStride, int width, int height)
+{
+    const uint8_t* src = (uint8_t*)pic.planes[plane] + row * pic.stride[plane];
+
+    if (pic.bitDepth == 8)
+    {
+#if (X265_DEPTH > 8)
+        primitives.planecopy_cp(src + col, pic.stride[plane], dst, dstStride, width, height, X265_DEPTH - 8);
+#else
+        for (int r = 0; r < height; r++)
+        {
+            memcpy(dst, src + col, width * sizeof(pixel));
+
+            dst += dstStride;
+            src += pic.stride[plane];
+        }
+#endif
+    }
+    else
+    {
+        uint16_t mask = (1 << X265_DEPTH) - 1;
+        const uint16_t* srcShort = (const uint16_t*)src + col;
+
+        if (pic.bitDepth > X265_DEPTH)
+            primitives.planecopy_sp(srcShort, pic.stride[plane] / sizeof(uint16_t), dst, dstStride, width, height, pic.bitDepth - X265_DEPTH, mask);
+        else
+            primitives.planecopy_sp_shl(srcShort, pic.stride[plane] / sizeof(uint16_t), dst, dstStride, width, height, X265_DEPTH - pic.bitDepth, mask);
+    }
+}
+
+/* Copy the chroma of input chroma rows [row, row + height) from chroma column
+ * col, at the vertical resolution of the input. Packed pictures also give the
+ * luma of these rows */
+static void copyChroma(const x265_picture& pic, int row, int col, int widthC, int height,
+                       pixel* dstY, intptr_t dstStride, pixel* dstU, pixel* dstV, intptr_t dstStrideC)
+{
+    const uint8_t* src = (uint8_t*)pic.planes[0] + row * pic.stride[0];
+
+    switch (pic.colorSpace)
+    {
+    case X265_CSP_NV12:
+    case X265_CSP_NV16:
+        src = (uint8_t*)pic.planes[1] + row * pic.stride[1];
+        if (pic.bitDepth == 8)
+            primitives.planecopy_nv_cp(src + 2 * col, pic.stride[1], dstU, dstV, dstStrideC, widthC, height, X265_DEPTH - 8);
+        else
+            primitives.planecopy_nv_sp((const uint16_t*)src + 2 * col, pic.stride[1] / sizeof(uint16_t), dstU, dstV, dstStrideC, widthC, height,
+                                       pic.bitDepth - X265_DEPTH, (uint16_t)((1 << X265_DEPTH) - 1));
+        break;
+    case X265_CSP_YUYV:
+        primitives.planecopy_yuyv(src + 4 * col, pic.stride[0], dstY, dstStride, dstU, dstV, dstStrideC, 2 * widthC, height);
+        break;
+    case X265_CSP_UYVY:
+        primitives.planecopy_uyvy(src + 4 * col, pic.stride[0], dstY, dstStride, dstU, dstV, dstStrideC, 2 * widthC, height);
+        break;
+    case X265_CSP_V210:
+        X265_CHECK(!(col % 3), "v210 column not on a block boundary\n");
+        primitives.planecopy_v210(src + (col / 3) * 16, pic.stride[0], dstY, dstStride, dstU, dstV, dstStrideC, 2 * widthC, height);
+        break;
+    default:
+        copyPlane(pic, 1, row, col, dstU, dstStrideC, widthC, height);
+        copyPlane(pic, 2, row, col, dstV, dstStrideC, widthC, height);
+        break;
+    }
+}
+
+void PicYuv::copyRows(const x265_picture& pic, int internalCsp, int width, int rowBegin, int rowEnd)
+{
+    int csp = pic.colorSpace;
+    pixel* yPixel = m_picOrg[0] + rowBegin * m_stride;
+    bool bPacked = csp >= X265_CSP_YUYV;
+
+    if (!bPacked)
+        copyPlane(pic, 0, rowBegin, 0, yPixel, m_stride, width, rowEnd - rowBegin);
+
+    if (internalCsp == X265_CSP_I400)
+        return;
+
+    int widthC = width >> m_hChromaShift;
+    int rowC = rowBegin >> m_vChromaShift;
+    int heightC = (rowEnd >> m_vChromaShift) - rowC;
+    pixel* uPixel = m_picOrg[1] + rowC * m_strideC;
+    pixel* vPixel = m_picOrg[2] + rowC * m_strideC;
+
+    /* 4:2:2 input encoded as 4:2:0 */
+    bool bDownsample = m_vChromaShift && (bPacked || csp == X265_CSP_NV16 || csp == X265_CSP_I422);
+    if (!bDownsample)
+    {
+        copyChroma(pic, rowC, 0, widthC, heightC, yPixel, m_stride, uPixel, vPixel, m_strideC);
+        return;
+    }
+
+    /* convert pairs of input rows in segments small enough to stay in the
+     * cache, then average them. The segment width is a multiple of three so
+     * that v210 segments start on a block */
+    enum { SEGMENT_WIDTH = 192 };
+    ALIGN_VAR_32(pixel, rowsU[2 * SEGMENT_WIDTH]);
+    ALIGN_VAR_32(pixel, rowsV[2 * SEGMENT_WIDTH]);
+
+    for (int r = 0; r < heightC; r++)
+    {
+        for (int c = 0; c < widthC; c += SEGMENT_WIDTH)
+        {
+            int segment = X265_MIN((int)SEGMENT_WIDTH, widthC - c);
+            copyChroma(pic, 2 * (rowC + r), c, segment, 2, yPixel + 2 * c, m_stride, rowsU, rowsV, SEGMENT_WIDTH);
+            primitives.chroma_downsample(rowsU, SEGMENT_WIDTH, uPixel + c, m_strideC, segment, 1);
+            primitives.chroma_downsample(rowsV, SEGMENT_WIDTH, vPixel + c, m_strideC, segment, 1);
+        }
+
+        yPixel += 2 * m_stride;
+        uPixel += m_strideC;
+        vPixel += m_strideC;
+    }
+}
+
+namespace {
+/* Row bands of an input picture, converted by the calling thread and by any
+ * idle worker it could bond */
+class CopyRowsGroup : public BondedTaskGroup
+{
+public:
+
+    enum { BAND_HEIGHT = 64 };
+
+    PicYuv&             m_dst;
+    const x265_picture& m_pic;
+    int                 m_internalCsp;
+    int                 m_width;
+    int                 m_height;
+
+    CopyRowsGroup(PicYuv& dst, const x265_picture& pic, int internalCsp, int width, int height)
+        : m_dst(dst), m_pic(pic), m_internalCsp(internalCsp), m_width(width), m_height(height)
+    {
+        m_jobTotal = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    }
+
+    void processTasks(int /* workerThreadId */)
+    {
+        for (;;)
+        {
+            m_lock.acquire();
+            int band = m_jobAcquired < m_jobTotal ? m_jobAcquired++ : -1;
+            m_lock.release();
+            if (band < 0)
+                return;
+
+            int rowBegin = band * BAND_HEIGHT;
+            m_dst.copyRows(m_pic, m_internalCsp, m_width, rowBegin, X265_MIN(rowBegin + (int)BAND_HEIGHT, m_height));
+        }
+    }
+
+protected:
+
+    CopyRowsGroup& operator=(const CopyRowsGroup&);
+};
+}
+
 /* Copy pixels from an x265_picture into internal PicYuv instance.
  * Shift pixels as necessary, mask off bits above X265_DEPTH for safety. */
-void PicYuv::copyFromPicture(const x265_picture& pic, const x265_param& param, int padx, int pady)
+void PicYuv::copyFromPicture(const x265_picture& pic, const x265_param& param, int padx, int pady, ThreadPool* pool)
 {
     /* m_picWidth is the width that is being encoded, padx indicates how many
      * of those pixels are padding to reach multiple of MinCU(4) size.
@@ -232,7 +437,9 @@ void PicYuv::copyFromPicture(const x265_picture& pic, const x265_param& param, i
      * warnings from valgrind about using uninitialized pixels */
     padx++;
     pady++;
-    m_picCsp = pic.colorSpace;
+    /* converted pictures take the internal color space, except 4:0:0 input
+     * whose chroma is not coded */
+    m_picCsp = pic.colorSpace == X265_CSP_I400 ? X265_CSP_I400 : param.internalCsp;
 
     X265_CHECK(pic.bitDepth >= 8, "pic.bitDepth check failure");
 
@@ -243,108 +450,20 @@ void PicYuv::copyFromPicture(const x265_picture& pic, const x265_param& param, i
 
     if (m_param->bCopyPicToFrame)
     {
-        if (pic.bitDepth == 8)
-        {
-#if (X265_DEPTH > 8)
-        {
-            pixel *yPixel = m_picOrg[0];
-
-            uint8_t *yChar = (uint8_t*)pic.planes[0];
-            int shift = (X265_DEPTH - 8);
-
-            primitives.planecopy_cp(yChar, pic.stride[0] / sizeof(*yChar), yPixel, m_stride, width, height, shift);
-
-            if (param.internalCsp != X265_CSP_I400)
-            {
-                pixel *uPixel = m_picOrg[1];
-                pixel *vPixel = m_picOrg[2];
-
-                uint8_t *uChar = (uint8_t*)pic.planes[1];
-                uint8_t *vChar = (uint8_t*)pic.planes[2];
-
-                primitives.planecopy_cp(uChar, pic.stride[1] / sizeof(*uChar), uPixel, m_strideC, width >> m_hChromaShift, height >> m_vChromaShift, shift);
-                primitives.planecopy_cp(vChar, pic.stride[2] / sizeof(*vChar), vPixel, m_strideC, width >> m_hChromaShift, height >> m_vChromaShift, shift);
-            }
-        }
-#else /* Case for (X265_DEPTH == 8) */
-            // TODO: Does we need this path? may merge into above in future
-        {
-            pixel *yPixel = m_picOrg[0];
-            uint8_t *yChar = (uint8_t*)pic.planes[0];
-
-            for (int r = 0; r < height; r++)
-            {
-                memcpy(yPixel, yChar, width * sizeof(pixel));
-
-                yPixel += m_stride;
-                yChar += pic.stride[0] / sizeof(*yChar);
-            }
-
-            if (param.internalCsp != X265_CSP_I400)
-            {
-                pixel *uPixel = m_picOrg[1];
-                pixel *vPixel = m_picOrg[2];
-
-                uint8_t *uChar = (uint8_t*)pic.planes[1];
-                uint8_t *vChar = (uint8_t*)pic.planes[2];
-
-                for (int r = 0; r < height >> m_vChromaShift; r++)
-                {
-                    memcpy(uPixel, uChar, (width >> m_hChromaShift) * sizeof(pixel));
-                    memcpy(vPixel, vChar, (width >> m_hChromaShift) * sizeof(pixel));
-
-                    uPixel += m_strideC;
-                    vPixel += m_strideC;
-                    uChar += pic.stride[1] / sizeof(*uChar);
-                    vChar += pic.stride[2] / sizeof(*vChar);
-                }
-            }
-        }
-#endif /* (X265_DEPTH > 8) */
-        }
-        else /* pic.bitDepth > 8 */
+        CopyRowsGroup group(*this, pic, param.internalCsp, width, height);
+        if (pool && group.m_jobTotal > 1)
         {
-            /* defensive programming, mask off bits that are supposed to be zero */
-            uint16_t mask = (1 << X265_DEPTH) - 1;
-            int shift = abs(pic.bitDepth - X265_DEPTH);
-            pixel *yPixel = m_picOrg[0];
-
-            uint16_t *yShort = (uint16_t*)pic.planes[0];
-
-            if (pic.bitDepth > X265_DEPTH)
-            {
-                /* shift right and mask pixels to final size */
-                primitives.planecopy_sp(yShort, pic.stride[0] / sizeof(*yShort), yPixel, m_stride, width, height, shift, mask);
-            }
-            else /* Case for (pic.bitDepth <= X265_DEPTH) */
-            {
-                /* shift left and mask pixels to final size */
-                primitives.planecopy_sp_shl(yShort, pic.stride[0] / sizeof(*yShort), yPixel, m_stride, width, height, shift, mask);
-            }
-
-            if (param.internalCsp != X265_CSP_I400)
-            {
-                pixel *uPixel = m_picOrg[1];
-                pixel *vPixel = m_picOrg[2];
-
-                uint16_t *uShort = (uint16_t*)pic.planes[1];
-                uint16_t *vShort = (uint16_t*)pic.planes[2];
-
-                if (pic.bitDepth > X265_DEPTH)
-                {
-                    primitives.planecopy_sp(uShort, pic.stride[1] / sizeof(*uShort), uPixel, m_strideC, width >> m_hChromaShift, height >> m_vChromaShift, shift, mask);
-                    primitives.planecopy_sp(vShort, pic.stride[2] / sizeof(*vShort), vPixel, m_strideC, width >> m_hChromaShift, height >> m_vChromaShift, shift, mask);
-                }
-                else /* Case for (pic.bitDepth <= X265_DEPTH) */
-                {
-                    primitives.planecopy_sp_shl(uShort, pic.stride[1] / sizeof(*uShort), uPixel, m_strideC, width >> m_hChromaShift, height >> m_vChromaShift, shift, mask);
-                    primitives.planecopy_sp_shl(vShort, pic.stride[2] / sizeof(*vShort), vPixel, m_strideC, width >> m_hChromaShift, height >> m_vChromaShift, shift, mask);
-                }
-            }
+            group.tryBondPeers(*pool, group.m_jobTotal - 1);
+            group.processTasks(-1);
+            group.waitForExit();
         }
+        else
+            group.processTasks(-1);
     }
     else
     {
+        /* zero-copy input, the planes have the layout of our own buffers
+         * (checked by the encoder) and are padded in place below */
         m_picOrg[0] = (pixel*)pic.planes[0];
         m_picOrg[1] = (pixel*)pic.planes[1];
         m_picOrg[2] = (pixel*)pic.planes[2];
@@ -33,6 +33,7 @@ namespace X265_NS {
 // private namespace
 
 class ShortYuv;
+class ThreadPool;
 struct SPS;
 
 class PicYuv : public x265_picyuv
@@ -82,7 +83,20 @@ public:
     void  destroy();
     int   getLumaBufLen(uint32_t picWidth, uint32_t picHeight, uint32_t picCsp);
 
-    void  copyFromPicture(const x265_picture&, const x265_param& param, int padx, int pady);
+    /* layout of the buffers allocated by create(), in bytes: stride, offset
+     * of the plane start and size of each plane buffer */
+    void  getBufferLayout(int stride[3], int offset[3], int size[3]) const;
+
+    /* true if input pictures of the given color space and bit depth can be
+     * converted to the internal color space */
+    static bool isValidInput(int csp, int bitDepth, int internalCsp);
+
+    /* converts the picture in row bands, on idle workers of the pool if any */
+    void  copyFromPicture(const x265_picture&, const x265_param& param, int padx, int pady, ThreadPool* pool);
+
+    /* converts luma rows [rowBegin, rowEnd) of the picture and the chroma rows
+     * they cover, rowBegin must be even */
+    void  copyRows(const x265_picture&, int internalCsp, int width, int rowBegin, int rowEnd);
 
     intptr_t getChromaAddrOffset(uint32_t ctuAddr, uint32_t absPartIdx) const { return m_cuOffsetC[ctuAddr] + m_buOffsetC[absPartIdx]; }
 
@@ -888,6 +888,121 @@ static void planecopy_sp_shl_c(const uint16_t* src, intptr_t srcStride, pixel* d
     }
 }
 
+static void planecopy_nv_cp_c(const uint8_t* src, intptr_t srcStride, pixel* dstU, pixel* dstV, intptr_t dstStride, int width, int height, int shift)
+{
+    for (int r = 0; r < height; r++)
+    {
+        for (int c = 0; c < width; c++)
+        {
+            dstU[c] = ((pixel)src[2 * c]) << shift;
+            dstV[c] = ((pixel)src[2 * c + 1]) << shift;
+        }
+
+        dstU += dstStride;
+        dstV += dstStride;
+        src += srcStride;
+    }
+}
+
+static void planecopy_nv_sp_c(const uint16_t* src, intptr_t srcStride, pixel* dstU, pixel* dstV, intptr_t dstStride, int width, int height, int shift, uint16_t mask)
+{
+    for (int r = 0; r < height; r++)
+    {
+        for (int c = 0; c < width; c++)
+        {
+            dstU[c] = (pixel)((src[2 * c] >> shift) & mask);
+            dstV[c] = (pixel)((src[2 * c + 1] >> shift) & mask);
+        }
+
+        dstU += dstStride;
+        dstV += dstStride;
+        src += srcStride;
+    }
+}
+
+/* packed 4:2:2 with 8 bit samples, Y is the byte offset of the first luma
+ * sample of a pair and C of its u sample */
+template<int Y, int C>
+void planecopy_packed422_c(const uint8_t* src, intptr_t srcStride, pixel* dstY, intptr_t dstStride, pixel* dstU, pixel* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const int shift = X265_DEPTH - 8;
+
+    for (int r = 0; r < height; r++)
+    {
+        for (int c = 0; c < width >> 1; c++)
+        {
+            const uint8_t* pair = src + 4 * c;
+            dstY[2 * c]     = ((pixel)pair[Y]) << shift;
+            dstY[2 * c + 1] = ((pixel)pair[Y + 2]) << shift;
+            dstU[c] = ((pixel)pair[C]) << shift;
+            dstV[c] = ((pixel)pair[C + 2]) << shift;
+        }
+
+        dstY += dstStride;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+        src += srcStride;
+    }
+}
+
+static inline pixel v210Sample(uint32_t word, int pos)
+{
+    uint32_t v = (word >> (10 * pos)) & 0x3ff;
+#if X265_DEPTH >= 10
+    return (pixel)(v << (X265_DEPTH - 10));
+#else
+    return (pixel)(v >> (10 - X265_DEPTH));
+#endif
+}
+
+/* v210: 4:2:2 10 bit, each little-endian 32 bit word packs three samples and
+ * four words hold six pixels, in the order u0 y0 v0 y1 u2 y2 v2 y3 u4 y4 v4 y5.
+ * Rows are padded to whole blocks of six pixels */
+static void planecopy_v210_c(const uint8_t* src, intptr_t srcStride, pixel* dstY, intptr_t dstStride, pixel* dstU, pixel* dstV, intptr_t dstStrideC, int width, int height)
+{
+    for (int r = 0; r < height; r++)
+    {
+        for (int c = 0; c < width; c += 6)
+        {
+            const uint8_t* block = src + (c / 6) * 16;
+            uint32_t w[4];
+            for (int i = 0; i < 4; i++)
+                w[i] = block[4 * i] | (block[4 * i + 1] << 8) | (block[4 * i + 2] << 16) | ((uint32_t)block[4 * i + 3] << 24);
+
+            pixel y[6] = { v210Sample(w[0], 1), v210Sample(w[1], 0), v210Sample(w[1], 2), v210Sample(w[2], 1), v210Sample(w[3], 0), v210Sample(w[3], 2) };
+            pixel u[3] = { v210Sample(w[0], 0), v210Sample(w[1], 1), v210Sample(w[2], 2) };
+            pixel v[3] = { v210Sample(w[0], 2), v210Sample(w[2], 0), v210Sample(w[3], 1) };
+
+            int count = X265_MIN(6, width - c);
+            for (int i = 0; i < count; i++)
+                dstY[c + i] = y[i];
+            for (int i = 0; i < count >> 1; i++)
+            {
+                dstU[(c >> 1) + i] = u[i];
+                dstV[(c >> 1) + i] = v[i];
+            }
+        }
+
+        dstY += dstStride;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+        src += srcStride;
+    }
+}
+
+/* 4:2:2 to 4:2:0 chroma, averages each pair of rows */
+static void chroma_downsample_c(const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height)
+{
+    for (int r = 0; r < height; r++)
+    {
+        for (int c = 0; c < width; c++)
+            dst[c] = (pixel)((src[c] + src[c + srcStride] + 1) >> 1);
+
+        dst += dstStride;
+        src += 2 * srcStride;
+    }
+}
+
 /* Estimate the total amount of influence on future quality that could be had if we
  * were to improve the reference samples used to inter predict any given CU. */
 static void estimateCUPropagateCost(int* dst, const uint16_t* propagateIn, const int32_t* intraCosts, const uint16_t* interCosts,
@@ -1277,6 +1392,12 @@ void setupPixelPrimitives_c(EncoderPrimitives &p)
     p.planecopy_cp = planecopy_cp_c;
     p.planecopy_sp = planecopy_sp_c;
     p.planecopy_sp_shl = planecopy_sp_shl_c;
+    p.planecopy_nv_cp = planecopy_nv_cp_c;
+    p.planecopy_nv_sp = planecopy_nv_sp_c;
+    p.planecopy_yuyv = planecopy_packed422_c<0, 1>;
+    p.planecopy_uyvy = planecopy_packed422_c<1, 0>;
+    p.planecopy_v210 = planecopy_v210_c;
+    p.chroma_downsample = chroma_downsample_c;
 #if HIGH_BIT_DEPTH
     p.planeClipAndMax = planeClipAndMax_c;
 #endif
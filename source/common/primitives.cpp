@@ -245,35 +245,44 @@ void x265_report_simd(x265_param* param)
     }
 }
 
-void x265_setup_primitives(x265_param *param)
+void setupPrimitives(EncoderPrimitives &p, int cpuMask)
 {
-    if (!primitives.pu[0].sad)
-    {
-        setupCPrimitives(primitives);
+    setupCPrimitives(p);
 
-        /* We do not want the encoder to use the un-optimized intra all-angles
-         * C references. It is better to call the individual angle functions
-         * instead. We must check for NULL before using this primitive */
-        for (int i = 0; i < NUM_TR_SIZE; i++)
-            primitives.cu[i].intra_pred_allangs = NULL;
+    /* We do not want the encoder to use the un-optimized intra all-angles
+     * C references. It is better to call the individual angle functions
+     * instead. We must check for NULL before using this primitive */
+    for (int i = 0; i < NUM_TR_SIZE; i++)
+        p.cu[i].intra_pred_allangs = NULL;
 
 #if ENABLE_ASSEMBLY
 #if X265_ARCH_X86
-        setupInstrinsicPrimitives(primitives, param->cpuid);
+    setupInstrinsicPrimitives(p, cpuMask);
 #endif
-        setupAssemblyPrimitives(primitives, param->cpuid);
+    setupAssemblyPrimitives(p, cpuMask);
 #endif
 #if HAVE_ALTIVEC
-        if (param->cpuid & X265_CPU_ALTIVEC)
-        {
-            setupPixelPrimitives_altivec(primitives);       // pixel_altivec.cpp, overwrite the initialization for altivec optimizated functions
-            setupDCTPrimitives_altivec(primitives);         // dct_altivec.cpp, overwrite the initialization for altivec optimizated functions
-            setupFilterPrimitives_altivec(primitives);      // ipfilter.cpp, overwrite the initialization for altivec optimizated functions
-            setupIntraPrimitives_altivec(primitives);       // intrapred_altivec.cpp, overwrite the initialization for altivec optimizated functions
-        }
+    if (cpuMask & X265_CPU_ALTIVEC)
+    {
+        setupPixelPrimitives_altivec(p);       // pixel_altivec.cpp, overwrite the initialization for altivec optimizated functions
+        setupDCTPrimitives_altivec(p);         // dct_altivec.cpp, overwrite the initialization for altivec optimizated functions
+        setupFilterPrimitives_altivec(p);      // ipfilter.cpp, overwrite the initialization for altivec optimizated functions
+        setupIntraPrimitives_altivec(p);       // intrapred_altivec.cpp, overwrite the initialization for altivec optimizated functions
+    }
 #endif
 
-        setupAliasPrimitives(primitives);
+    setupAliasPrimitives(p);
+    (void)cpuMask;
+}
+
+void x265_setup_primitives(x265_param *param)
+{
+    if (!primitives.pu[0].sad)
+    {
+        setupPrimitives(primitives, param->cpuid);
+
+        if (param->bPrimitiveTune || param->primitiveTuneFile)
+            tunePrimitives(primitives, param);
 
         if (param->bLowPassDct)
         {
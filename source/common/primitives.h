@@ -204,6 +204,10 @@ typedef void (*saoCuStatsE3_t)(const int16_t *diff, const pixel *rec, intptr_t s
 typedef void (*sign_t)(int8_t *dst, const pixel *src1, const pixel *src2, const int endX);
 typedef void (*planecopy_cp_t) (const uint8_t* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height, int shift);
 typedef void (*planecopy_sp_t) (const uint16_t* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height, int shift, uint16_t mask);
+typedef void (*planecopy_nv_cp_t) (const uint8_t* src, intptr_t srcStride, pixel* dstU, pixel* dstV, intptr_t dstStride, int width, int height, int shift);
+typedef void (*planecopy_nv_sp_t) (const uint16_t* src, intptr_t srcStride, pixel* dstU, pixel* dstV, intptr_t dstStride, int width, int height, int shift, uint16_t mask);
+typedef void (*planecopy_packed_t) (const uint8_t* src, intptr_t srcStride, pixel* dstY, intptr_t dstStride, pixel* dstU, pixel* dstV, intptr_t dstStrideC, int width, int height);
+typedef void (*chroma_downsample_t) (const pixel* src, intptr_t srcStride, pixel* dst, intptr_t dstStride, int width, int height);
 typedef pixel (*planeClipAndMax_t)(pixel *src, intptr_t stride, int width, int height, uint64_t *outsum, const pixel minPix, const pixel maxPix);
 
 typedef void (*cutree_propagate_cost) (int* dst, const uint16_t* propagateIn, const int32_t* intraCosts, const uint16_t* interCosts, const int32_t* invQscales, const double* fpsFactor, int len);
@@ -350,6 +354,12 @@ struct EncoderPrimitives
     planecopy_cp_t        planecopy_cp;
     planecopy_sp_t        planecopy_sp;
     planecopy_sp_t        planecopy_sp_shl;
+    planecopy_nv_cp_t     planecopy_nv_cp;    // semi-planar chroma, width in chroma samples
+    planecopy_nv_sp_t     planecopy_nv_sp;
+    planecopy_packed_t    planecopy_yuyv;     // packed 4:2:2, width in luma samples
+    planecopy_packed_t    planecopy_uyvy;
+    planecopy_packed_t    planecopy_v210;
+    chroma_downsample_t   chroma_downsample;  // vertical 2:1, height in output rows
     planeClipAndMax_t     planeClipAndMax;
 
     weightp_sp_t          weight_sp;
@@ -457,12 +467,29 @@ void setupCPrimitives(EncoderPrimitives &p);
 void setupInstrinsicPrimitives(EncoderPrimitives &p, int cpuMask);
 void setupAssemblyPrimitives(EncoderPrimitives &p, int cpuMask);
 void setupAliasPrimitives(EncoderPrimitives &p);
+
+/* Fill p with the best primitives for the CPU capabilities in cpuMask, as
+ * x265_setup_primitives() does for the encoder table */
+void setupPrimitives(EncoderPrimitives &p, int cpuMask);
+
+/* Replace primitives of p, set up for param->cpuid, by the implementations
+ * of lower CPU capabilities which measure faster on this host, see
+ * primitivetune.cpp */
+void tunePrimitives(EncoderPrimitives &p, x265_param* param);
 #if HAVE_ALTIVEC
 void setupPixelPrimitives_altivec(EncoderPrimitives &p);
 void setupDCTPrimitives_altivec(EncoderPrimitives &p);
 void setupFilterPrimitives_altivec(EncoderPrimitives &p);
 void setupIntraPrimitives_altivec(EncoderPrimitives &p);
 #endif
+#if X265_ARCH_ARM64
+void setupPixelPrimitives_neon(EncoderPrimitives &p);
+void setupFilterPrimitives_neon(EncoderPrimitives &p);
+void setupDCTPrimitives_neon(EncoderPrimitives &p);
+void setupIntraPrimitives_neon(EncoderPrimitives &p);
+void setupLoopFilterPrimitives_neon(EncoderPrimitives &p);
+void setupPixelPrimitives_sve(EncoderPrimitives &p);
+#endif
 }
 
 #if !EXPORT_C_API
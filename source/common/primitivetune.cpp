@@ -0,0 +1,713 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include "constants.h"
+#include "cpu.h"
+
+#if X265_ARCH_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/* Startup tuning of the primitive table (--primitive-tune). The primitive
+ * tables of the CPU capability levels below the detected one are the
+ * candidates; each tuned primitive whose candidates differ has them timed on
+ * synthetic blocks, and the fastest is installed. The default implementation
+ * is only replaced by one at least TUNE_MARGIN percent faster, so measurement
+ * noise does not churn the table. The choices are cached in a text file,
+ * keyed by the build, the bit depth, the CPU capabilities and the host type,
+ * since hosts with the same capabilities may favour different candidates:
+ *
+ *   x265-primitive-tune <version> <bit depth> <cpuid hex> <vendor> <family> <model> <stepping>
+ *   <primitive name> <cpu capabilities of the chosen candidate, hex>
+ *   ...
+ */
+
+using namespace X265_NS;
+
+namespace {
+
+/* Cycle counter, and calls per timed sample to stay well above its resolution */
+#if X265_ARCH_X86
+inline uint64_t tuneTimer() { return __rdtsc(); }
+enum { TUNE_CALLS = 4 };
+#elif X265_ARCH_ARM64 && defined(__GNUC__) && defined(__aarch64__)
+inline uint64_t tuneTimer()
+{
+    uint64_t cnt;
+    asm volatile("mrs %0, cntvct_el0" : "=r" (cnt));
+    return cnt;
+}
+enum { TUNE_CALLS = 16 };
+#else
+inline uint64_t tuneTimer() { return (uint64_t)x265_mdate(); }
+enum { TUNE_CALLS = 256 };
+#endif
+
+enum { TUNE_RUNS = 64 };     // timed samples per candidate
+enum { TUNE_MARGIN = 5 };    // percent a candidate must gain over the default
+enum { MAX_CANDIDATES = 32 };
+enum { MAX_TUNE_SLOTS = 2048 };
+enum { MAX_TUNE_TIMES = 8192 };
+
+/* Synthetic blocks, sized for 64x64 blocks with interpolation margins. Blocks
+ * start on aligned rows for the ALIGNED primitive variants, the taps left of
+ * a block read the end of the previous row */
+enum { TUNE_STRIDE = 128 };
+enum { TUNE_ROWS = 64 + 16 };
+enum { TUNE_PAD = 8 * TUNE_STRIDE };
+enum { TUNE_SIZE = TUNE_ROWS * TUNE_STRIDE + 2 * TUNE_PAD };
+
+struct TuneBuffers
+{
+    ALIGN_VAR_64(pixel,   pix[3][TUNE_SIZE]);
+    ALIGN_VAR_64(pixel,   dst[TUNE_SIZE]);
+    ALIGN_VAR_64(int16_t, inter[2][TUNE_SIZE]);   // interpolation intermediates
+    ALIGN_VAR_64(int16_t, resi[TUNE_SIZE]);       // residual
+    ALIGN_VAR_64(int16_t, coef[TUNE_SIZE]);
+    ALIGN_VAR_64(int16_t, sdst[TUNE_SIZE]);
+    ALIGN_VAR_64(int32_t, quantCoef[MAX_TR_SIZE * MAX_TR_SIZE]);
+    ALIGN_VAR_64(int32_t, deltaU[MAX_TR_SIZE * MAX_TR_SIZE]);
+    ALIGN_VAR_64(int32_t, idst[MAX_TR_SIZE * MAX_TR_SIZE]);
+    ALIGN_VAR_64(uint16_t, propagateIn[MAX_TR_SIZE * MAX_TR_SIZE]);
+    ALIGN_VAR_64(uint16_t, interCosts[MAX_TR_SIZE * MAX_TR_SIZE]);
+    ALIGN_VAR_64(int32_t, intraCosts[MAX_TR_SIZE * MAX_TR_SIZE]);
+    ALIGN_VAR_64(int32_t, invQscales[MAX_TR_SIZE * MAX_TR_SIZE]);
+    int8_t  upBuff[2][MAX_CU_SIZE + 2];
+    int32_t stats[32], count[32], sads[4];
+
+    void init()
+    {
+        uint32_t seed = 0x2545f491;
+        const int pixMax = (1 << X265_DEPTH) - 1;
+
+        for (int i = 0; i < TUNE_SIZE; i++)
+        {
+            for (int j = 0; j < 3; j++)
+            {
+                seed = seed * 1664525 + 1013904223;
+                pix[j][i] = (pixel)((seed >> 8) & pixMax);
+            }
+            dst[i] = 0;
+            inter[0][i] = (int16_t)((pix[0][i] << (IF_INTERNAL_PREC - X265_DEPTH)) - IF_INTERNAL_OFFS);
+            inter[1][i] = (int16_t)((pix[1][i] << (IF_INTERNAL_PREC - X265_DEPTH)) - IF_INTERNAL_OFFS);
+            resi[i] = (int16_t)(pix[0][i] - pix[1][i]);
+            coef[i] = (int16_t)(((seed >> 4) & 4095) - 2048);
+            sdst[i] = 0;
+        }
+
+        for (int i = 0; i < MAX_TR_SIZE * MAX_TR_SIZE; i++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            quantCoef[i] = 16384;
+            deltaU[i] = 0;
+            idst[i] = 0;
+            propagateIn[i] = (uint16_t)(seed & 0x3fff);
+            interCosts[i] = (uint16_t)((seed >> 14) & 0x3fff);
+            intraCosts[i] = (int32_t)((seed >> 12) & 0x7fff);
+            invQscales[i] = 256;
+        }
+    }
+
+    /* top left of a block, with room for the filter taps around it */
+    pixel*   p(int i)     { return pix[i] + TUNE_PAD; }
+    int16_t* s(int i)     { return inter[i] + TUNE_PAD; }
+};
+
+typedef void (*tunefunc_t)();
+typedef void (*tunebench_t)(tunefunc_t f, TuneBuffers& b, int arg);
+
+/* Benchmark calls, one per primitive signature */
+
+void benchPixelcmp(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((pixelcmp_t)f)(b.p(0), TUNE_STRIDE, b.p(1) + 1, TUNE_STRIDE);
+}
+
+void benchSadX3(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((pixelcmp_x3_t)f)(b.p(0), b.p(1) + 1, b.p(1) - 1, b.p(2), TUNE_STRIDE, b.sads);
+}
+
+void benchSadX4(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((pixelcmp_x4_t)f)(b.p(0), b.p(1) + 1, b.p(1) - 1, b.p(2), b.p(2) + TUNE_STRIDE, TUNE_STRIDE, b.sads);
+}
+
+void benchSse(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((pixel_sse_t)f)(b.p(0), TUNE_STRIDE, b.p(1), TUNE_STRIDE);
+}
+
+void benchVar(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((var_t)f)(b.p(0), TUNE_STRIDE);
+}
+
+void benchFilterPP(tunefunc_t f, TuneBuffers& b, int coeffIdx)
+{
+    ((filter_pp_t)f)(b.p(0), TUNE_STRIDE, b.dst, TUNE_STRIDE, coeffIdx);
+}
+
+void benchFilterHPS(tunefunc_t f, TuneBuffers& b, int coeffIdx)
+{
+    ((filter_hps_t)f)(b.p(0), TUNE_STRIDE, b.sdst, TUNE_STRIDE, coeffIdx, 0);
+}
+
+void benchFilterPS(tunefunc_t f, TuneBuffers& b, int coeffIdx)
+{
+    ((filter_ps_t)f)(b.p(0), TUNE_STRIDE, b.sdst, TUNE_STRIDE, coeffIdx);
+}
+
+void benchFilterSP(tunefunc_t f, TuneBuffers& b, int coeffIdx)
+{
+    ((filter_sp_t)f)(b.s(0), TUNE_STRIDE, b.dst, TUNE_STRIDE, coeffIdx);
+}
+
+void benchFilterSS(tunefunc_t f, TuneBuffers& b, int coeffIdx)
+{
+    ((filter_ss_t)f)(b.s(0), TUNE_STRIDE, b.sdst, TUNE_STRIDE, coeffIdx);
+}
+
+void benchPixelavg(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((pixelavg_pp_t)f)(b.dst, TUNE_STRIDE, b.p(0), TUNE_STRIDE, b.p(1), TUNE_STRIDE, 32);
+}
+
+void benchAddAvg(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((addAvg_t)f)(b.s(0), b.s(1), b.dst, TUNE_STRIDE, TUNE_STRIDE, TUNE_STRIDE);
+}
+
+void benchCopyPP(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((copy_pp_t)f)(b.dst, TUNE_STRIDE, b.p(0), TUNE_STRIDE);
+}
+
+void benchP2S(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((filter_p2s_t)f)(b.p(0), TUNE_STRIDE, b.sdst, TUNE_STRIDE);
+}
+
+void benchDct(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((dct_t)f)(b.resi, b.sdst, TUNE_STRIDE);
+}
+
+void benchIdct(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((idct_t)f)(b.coef, b.sdst, TUNE_STRIDE);
+}
+
+void benchCalcResidual(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((calcresidual_t)f)(b.p(0), b.p(1), b.sdst, TUNE_STRIDE);
+}
+
+void benchSubPS(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((pixel_sub_ps_t)f)(b.sdst, TUNE_STRIDE, b.p(0), b.p(1), TUNE_STRIDE, TUNE_STRIDE);
+}
+
+void benchAddPS(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((pixel_add_ps_t)f)(b.dst, TUNE_STRIDE, b.p(0), b.resi, TUNE_STRIDE, TUNE_STRIDE);
+}
+
+void benchQuant(tunefunc_t f, TuneBuffers& b, int numCoeff)
+{
+    ((quant_t)f)(b.coef, b.quantCoef, b.deltaU, b.sdst, 23, 23785, numCoeff);
+}
+
+void benchNquant(tunefunc_t f, TuneBuffers& b, int numCoeff)
+{
+    ((nquant_t)f)(b.coef, b.quantCoef, b.sdst, 23, 23785, numCoeff);
+}
+
+void benchDequant(tunefunc_t f, TuneBuffers& b, int numCoeff)
+{
+    ((dequant_normal_t)f)(b.coef, b.sdst, numCoeff, 70, 1);
+}
+
+void benchSaoStatsE0(tunefunc_t f, TuneBuffers& b, int)
+{
+    ((saoCuStatsE0_t)f)(b.resi, b.p(0), TUNE_STRIDE, 60, 61, b.stats, b.count);
+}
+
+void benchSaoStatsE1(tunefunc_t f, TuneBuffers& b, int)
+{
+    memset(b.upBuff, 0, sizeof(b.upBuff));
+    ((saoCuStatsE1_t)f)(b.resi, b.p(0), TUNE_STRIDE, b.upBuff[0] + 1, 60, 61, b.stats, b.count);
+}
+
+void benchSaoStatsE2(tunefunc_t f, TuneBuffers& b, int)
+{
+    memset(b.upBuff, 0, sizeof(b.upBuff));
+    ((saoCuStatsE2_t)f)(b.resi, b.p(0), TUNE_STRIDE, b.upBuff[0] + 1, b.upBuff[1] + 1, 60, 61, b.stats, b.count);
+}
+
+void benchSaoStatsE3(tunefunc_t f, TuneBuffers& b, int)
+{
+    memset(b.upBuff, 0, sizeof(b.upBuff));
+    ((saoCuStatsE3_t)f)(b.resi, b.p(0), TUNE_STRIDE, b.upBuff[0] + 1, 60, 61, b.stats, b.count);
+}
+
+void benchPropagateCost(tunefunc_t f, TuneBuffers& b, int len)
+{
+    double fpsFactor = 1.0;
+    ((cutree_propagate_cost)f)(b.idst, b.propagateIn, b.intraCosts, b.interCosts, b.invQscales, &fpsFactor, len);
+}
+
+/* Average cycles of TUNE_CALLS calls, with the sample filter of TestBench's
+ * REPORT_SPEEDUP: samples more than four times the running average are
+ * discarded as preempted or interrupted */
+uint32_t measure(tunebench_t bench, tunefunc_t f, TuneBuffers& b, int arg)
+{
+    uint64_t cycles = 0;
+    uint64_t runs = 0;
+
+    bench(f, b, arg);
+    for (int ti = 0; ti < TUNE_RUNS; ti++)
+    {
+        uint64_t t0 = tuneTimer();
+        for (int i = 0; i < TUNE_CALLS; i++)
+            bench(f, b, arg);
+        uint64_t t1 = tuneTimer() - t0;
+        if (t1 * runs <= cycles * 4 && ti > 0)
+        {
+            cycles += t1;
+            runs++;
+        }
+    }
+
+    x265_emms();
+    return runs ? (uint32_t)X265_MIN(cycles / runs, (uint64_t)UINT32_MAX) : UINT32_MAX;
+}
+
+struct TuneSlot
+{
+    char        name[40];
+    size_t      offset;        // of the function pointer in EncoderPrimitives
+    tunebench_t bench;
+    int         arg;
+    int         choice;        // candidate table, -1 when not tuned
+};
+
+struct TuneTime
+{
+    tunefunc_t  func;
+    tunebench_t bench;
+    int         arg;
+    uint32_t    cycles;
+};
+
+class PrimitiveTuner
+{
+public:
+
+    PrimitiveTuner(int cpuid) : m_cpuid(cpuid), m_numCandidates(0), m_numSlots(0), m_numTimes(0), m_buffers(NULL)
+    {
+        cpu_host_type(m_host);
+    }
+
+    ~PrimitiveTuner()
+    {
+        for (int i = 0; i < m_numCandidates; i++)
+            X265_FREE(m_candidate[i]);
+        X265_FREE(m_buffers);
+    }
+
+    bool init(const EncoderPrimitives& p);
+    bool load(const char* fileName);
+    void calibrate();
+    bool save(const char* fileName) const;
+    int  apply(EncoderPrimitives& p) const;
+
+    int  numTuned() const;
+
+protected:
+
+    int               m_cpuid;
+    cpu_host_t        m_host;
+    int               m_mask[MAX_CANDIDATES];
+    EncoderPrimitives* m_candidate[MAX_CANDIDATES]; // m_candidate[0] is the default table
+    int               m_numCandidates;
+    TuneSlot          m_slots[MAX_TUNE_SLOTS];
+    int               m_numSlots;
+    TuneTime          m_times[MAX_TUNE_TIMES];
+    int               m_numTimes;
+    TuneBuffers*      m_buffers;
+
+    static tunefunc_t get(const EncoderPrimitives& p, const TuneSlot& s)
+    {
+        return *(const tunefunc_t*)((const uint8_t*)&p + s.offset);
+    }
+
+    bool addCandidate(int mask);
+    void enumerateSlots(const EncoderPrimitives& p);
+    void addSlot(const EncoderPrimitives& p, const void* slot, tunebench_t bench, int arg, const char* fmt, ...);
+    uint32_t time(tunebench_t bench, tunefunc_t f, int arg);
+};
+
+bool PrimitiveTuner::addCandidate(int mask)
+{
+    for (int i = 0; i < m_numCandidates; i++)
+        if (m_mask[i] == mask)
+            return true;
+    if (m_numCandidates == MAX_CANDIDATES)
+        return false;
+
+    EncoderPrimitives* t = X265_MALLOC(EncoderPrimitives, 1);
+    if (!t)
+        return false;
+    memset(t, 0, sizeof(*t));
+    setupPrimitives(*t, mask);
+    m_mask[m_numCandidates] = mask;
+    m_candidate[m_numCandidates++] = t;
+    return true;
+}
+
+bool PrimitiveTuner::init(const EncoderPrimitives& p)
+{
+    m_buffers = X265_MALLOC(TuneBuffers, 1);
+    if (!m_buffers)
+        return false;
+    m_buffers->init();
+
+    /* the detected capabilities first, then every capability level they
+     * include, down to the C primitives */
+    if (!addCandidate(m_cpuid))
+        return false;
+    int keep = 0;
+#if X265_ARCH_X86
+    keep = m_cpuid & X265_CPU_STACK_MOD4; // not a speed option
+#endif
+    for (int i = 0; cpu_names[i].flags; i++)
+    {
+        int flags = (int)cpu_names[i].flags;
+        if ((m_cpuid & flags) == flags && !addCandidate(flags | keep))
+            return false;
+    }
+    if (!addCandidate(0))
+        return false;
+
+    enumerateSlots(p);
+    return true;
+}
+
+void PrimitiveTuner::addSlot(const EncoderPrimitives& p, const void* slot, tunebench_t bench, int arg, const char* fmt, ...)
+{
+    if (m_numSlots == MAX_TUNE_SLOTS)
+        return;
+
+    TuneSlot& s = m_slots[m_numSlots];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(s.name, sizeof(s.name), fmt, ap);
+    va_end(ap);
+    s.offset = (size_t)((const uint8_t*)slot - (const uint8_t*)&p);
+    s.bench = bench;
+    s.arg = arg;
+    s.choice = -1;
+    m_numSlots++;
+}
+
+void PrimitiveTuner::enumerateSlots(const EncoderPrimitives& p)
+{
+    static const char* const cspNames[X265_CSP_COUNT] = { "i400", "i420", "i422", "i444" };
+    const char* const align[NUM_ALIGNMENT_TYPES] = { "", "a" };
+
+    for (int i = 0; i < NUM_PU_SIZES; i++)
+    {
+        int w, h;
+        sizesFromPartition(i, &w, &h);
+        const EncoderPrimitives::PU& pu = p.pu[i];
+
+        addSlot(p, &pu.sad, benchPixelcmp, 0, "sad_%dx%d", w, h);
+        addSlot(p, &pu.sad_x3, benchSadX3, 0, "sad_x3_%dx%d", w, h);
+        addSlot(p, &pu.sad_x4, benchSadX4, 0, "sad_x4_%dx%d", w, h);
+        addSlot(p, &pu.satd, benchPixelcmp, 0, "satd_%dx%d", w, h);
+        addSlot(p, &pu.luma_hpp, benchFilterPP, 1, "luma_hpp_%dx%d", w, h);
+        addSlot(p, &pu.luma_hps, benchFilterHPS, 1, "luma_hps_%dx%d", w, h);
+        addSlot(p, &pu.luma_vpp, benchFilterPP, 1, "luma_vpp_%dx%d", w, h);
+        addSlot(p, &pu.luma_vps, benchFilterPS, 1, "luma_vps_%dx%d", w, h);
+        addSlot(p, &pu.luma_vsp, benchFilterSP, 1, "luma_vsp_%dx%d", w, h);
+        addSlot(p, &pu.luma_vss, benchFilterSS, 1, "luma_vss_%dx%d", w, h);
+        addSlot(p, &pu.copy_pp, benchCopyPP, 0, "copy_pp_%dx%d", w, h);
+        for (int a = 0; a < NUM_ALIGNMENT_TYPES; a++)
+        {
+            addSlot(p, &pu.pixelavg_pp[a], benchPixelavg, 0, "pixelavg_pp%s_%dx%d", align[a], w, h);
+            addSlot(p, &pu.addAvg[a], benchAddAvg, 0, "addAvg%s_%dx%d", align[a], w, h);
+            addSlot(p, &pu.convert_p2s[a], benchP2S, 0, "p2s%s_%dx%d", align[a], w, h);
+        }
+    }
+
+    for (int i = 0; i < NUM_CU_SIZES; i++)
+    {
+        int size = 4 << i;
+        const EncoderPrimitives::CU& cu = p.cu[i];
+
+        addSlot(p, &cu.dct, benchDct, 0, "dct_%dx%d", size, size);
+        addSlot(p, &cu.idct, benchIdct, 0, "idct_%dx%d", size, size);
+        addSlot(p, &cu.sub_ps, benchSubPS, 0, "sub_ps_%dx%d", size, size);
+        addSlot(p, &cu.var, benchVar, 0, "var_%dx%d", size, size);
+        addSlot(p, &cu.sse_pp, benchSse, 0, "sse_pp_%dx%d", size, size);
+        addSlot(p, &cu.sa8d, benchPixelcmp, 0, "sa8d_%dx%d", size, size);
+        for (int a = 0; a < NUM_ALIGNMENT_TYPES; a++)
+        {
+            addSlot(p, &cu.calcresidual[a], benchCalcResidual, 0, "calcresidual%s_%dx%d", align[a], size, size);
+            addSlot(p, &cu.add_ps[a], benchAddPS, 0, "add_ps%s_%dx%d", align[a], size, size);
+        }
+    }
+
+    for (int c = X265_CSP_I420; c < X265_CSP_COUNT; c++)
+    {
+        const char* csp = cspNames[c];
+        int shiftW = c == X265_CSP_I444 ? 0 : 1;
+        int shiftH = c == X265_CSP_I420 ? 1 : 0;
+
+        for (int i = 0; i < NUM_PU_SIZES; i++)
+        {
+            int w, h;
+            sizesFromPartition(i, &w, &h);
+            w >>= shiftW;
+            h >>= shiftH;
+            const EncoderPrimitives::Chroma::PUChroma& pu = p.chroma[c].pu[i];
+
+            addSlot(p, &pu.satd, benchPixelcmp, 0, "%s_satd_%dx%d", csp, w, h);
+            addSlot(p, &pu.filter_hpp, benchFilterPP, 4, "%s_hpp_%dx%d", csp, w, h);
+            addSlot(p, &pu.filter_hps, benchFilterHPS, 4, "%s_hps_%dx%d", csp, w, h);
+            addSlot(p, &pu.filter_vpp, benchFilterPP, 4, "%s_vpp_%dx%d", csp, w, h);
+            addSlot(p, &pu.filter_vps, benchFilterPS, 4, "%s_vps_%dx%d", csp, w, h);
+            addSlot(p, &pu.filter_vsp, benchFilterSP, 4, "%s_vsp_%dx%d", csp, w, h);
+            addSlot(p, &pu.filter_vss, benchFilterSS, 4, "%s_vss_%dx%d", csp, w, h);
+            for (int a = 0; a < NUM_ALIGNMENT_TYPES; a++)
+                addSlot(p, &pu.addAvg[a], benchAddAvg, 0, "%s_addAvg%s_%dx%d", csp, align[a], w, h);
+        }
+
+        for (int i = 0; i < NUM_CU_SIZES; i++)
+        {
+            int w = (4 << i) >> shiftW;
+            int h = (4 << i) >> shiftH;
+            const EncoderPrimitives::Chroma::CUChroma& cu = p.chroma[c].cu[i];
+
+            addSlot(p, &cu.sa8d, benchPixelcmp, 0, "%s_sa8d_%dx%d", csp, w, h);
+            addSlot(p, &cu.sse_pp, benchSse, 0, "%s_sse_pp_%dx%d", csp, w, h);
+            addSlot(p, &cu.sub_ps, benchSubPS, 0, "%s_sub_ps_%dx%d", csp, w, h);
+            for (int a = 0; a < NUM_ALIGNMENT_TYPES; a++)
+                addSlot(p, &cu.add_ps[a], benchAddPS, 0, "%s_add_ps%s_%dx%d", csp, align[a], w, h);
+        }
+    }
+
+    /* block size arguments are set to typical values */
+    addSlot(p, &p.quant, benchQuant, 16 * 16, "quant");
+    addSlot(p, &p.nquant, benchNquant, 16 * 16, "nquant");
+    addSlot(p, &p.dequant_normal, benchDequant, 16 * 16, "dequant_normal");
+    addSlot(p, &p.saoCuStatsE0, benchSaoStatsE0, 0, "saoCuStatsE0");
+    addSlot(p, &p.saoCuStatsE1, benchSaoStatsE1, 0, "saoCuStatsE1");
+    addSlot(p, &p.saoCuStatsE2, benchSaoStatsE2, 0, "saoCuStatsE2");
+    addSlot(p, &p.saoCuStatsE3, benchSaoStatsE3, 0, "saoCuStatsE3");
+    addSlot(p, &p.propagateCost, benchPropagateCost, 80, "propagateCost");
+}
+
+/* aliased primitives are timed once */
+uint32_t PrimitiveTuner::time(tunebench_t bench, tunefunc_t f, int arg)
+{
+    for (int i = 0; i < m_numTimes; i++)
+        if (m_times[i].func == f && m_times[i].bench == bench && m_times[i].arg == arg)
+            return m_times[i].cycles;
+
+    uint32_t cycles = measure(bench, f, *m_buffers, arg);
+    if (m_numTimes < MAX_TUNE_TIMES)
+    {
+        TuneTime& t = m_times[m_numTimes++];
+        t.func = f;
+        t.bench = bench;
+        t.arg = arg;
+        t.cycles = cycles;
+    }
+    return cycles;
+}
+
+void PrimitiveTuner::calibrate()
+{
+    for (int i = 0; i < m_numSlots; i++)
+    {
+        TuneSlot& s = m_slots[i];
+        tunefunc_t def = get(*m_candidate[0], s);
+        s.choice = -1;
+        if (!def)
+            continue;
+
+        bool differ = false;
+        for (int c = 1; c < m_numCandidates; c++)
+        {
+            tunefunc_t f = get(*m_candidate[c], s);
+            differ |= f && f != def;
+        }
+        if (!differ)
+            continue;
+
+        uint32_t best = time(s.bench, def, s.arg);
+        uint32_t limit = (uint32_t)((uint64_t)best * (100 - TUNE_MARGIN) / 100);
+        s.choice = 0;
+        for (int c = 1; c < m_numCandidates; c++)
+        {
+            tunefunc_t f = get(*m_candidate[c], s);
+            if (!f || f == def)
+                continue;
+            uint32_t cycles = time(s.bench, f, s.arg);
+            if (cycles < limit && cycles < best)
+            {
+                best = cycles;
+                s.choice = c;
+            }
+        }
+    }
+}
+
+int PrimitiveTuner::numTuned() const
+{
+    int n = 0;
+    for (int i = 0; i < m_numSlots; i++)
+        n += m_slots[i].choice >= 0;
+    return n;
+}
+
+int PrimitiveTuner::apply(EncoderPrimitives& p) const
+{
+    int changed = 0;
+    for (int i = 0; i < m_numSlots; i++)
+    {
+        const TuneSlot& s = m_slots[i];
+        if (s.choice <= 0)
+            continue;
+        tunefunc_t f = get(*m_candidate[s.choice], s);
+        tunefunc_t* slot = (tunefunc_t*)((uint8_t*)&p + s.offset);
+        if (f && *slot != f)
+        {
+            *slot = f;
+            changed++;
+        }
+    }
+    return changed;
+}
+
+bool PrimitiveTuner::save(const char* fileName) const
+{
+    FILE* fp = x265_fopen(fileName, "w");
+    if (!fp)
+        return false;
+
+    fprintf(fp, "x265-primitive-tune %s %d %x %s %d %d %d\n", PFX(version_str), X265_DEPTH, m_cpuid,
+            m_host.vendor, m_host.family, m_host.model, m_host.stepping);
+    for (int i = 0; i < m_numSlots; i++)
+        if (m_slots[i].choice >= 0)
+            fprintf(fp, "%s %x\n", m_slots[i].name, m_mask[m_slots[i].choice]);
+
+    bool ok = !ferror(fp);
+    return !fclose(fp) && ok;
+}
+
+/* Returns false when the file does not exist or is for another host type or
+ * build, the primitives must then be measured */
+bool PrimitiveTuner::load(const char* fileName)
+{
+    FILE* fp = x265_fopen(fileName, "r");
+    if (!fp)
+        return false;
+
+    char version[64], name[64];
+    cpu_host_t host;
+    int depth = 0;
+    unsigned int cpuid = 0, mask = 0;
+    if (fscanf(fp, "x265-primitive-tune %63s %d %x %15s %d %d %d", version, &depth, &cpuid,
+               host.vendor, &host.family, &host.model, &host.stepping) != 7 ||
+        strcmp(version, PFX(version_str)) || depth != X265_DEPTH || (int)cpuid != m_cpuid ||
+        strcmp(host.vendor, m_host.vendor) || host.family != m_host.family ||
+        host.model != m_host.model || host.stepping != m_host.stepping)
+    {
+        fclose(fp);
+        return false;
+    }
+
+    int next = 0;
+    while (fscanf(fp, "%63s %x", name, &mask) == 2)
+    {
+        /* lines are in slot order, search from the previous match */
+        for (int n = 0; n < m_numSlots; n++, next++)
+        {
+            TuneSlot& s = m_slots[next % m_numSlots];
+            if (strcmp(s.name, name))
+                continue;
+            for (int c = 0; c < m_numCandidates; c++)
+                if (m_mask[c] == (int)mask)
+                    s.choice = c;
+            break;
+        }
+    }
+
+    fclose(fp);
+    return true;
+}
+
+} // end anonymous namespace
+
+namespace X265_NS {
+// private x265 namespace
+
+void tunePrimitives(EncoderPrimitives &p, x265_param* param)
+{
+    PrimitiveTuner* tuner = new PrimitiveTuner(param->cpuid);
+    if (!tuner->init(p))
+    {
+        x265_log(param, X265_LOG_WARNING, "primitive tuning: unable to allocate candidate tables\n");
+        delete tuner;
+        return;
+    }
+
+    const char* fileName = param->primitiveTuneFile;
+    int64_t start = x265_mdate();
+    bool loaded = fileName && tuner->load(fileName);
+    if (!loaded)
+    {
+        tuner->calibrate();
+        if (fileName && !tuner->save(fileName))
+            x265_log(param, X265_LOG_WARNING, "primitive tuning: unable to write %s\n", fileName);
+    }
+
+    int changed = tuner->apply(p);
+    if (loaded)
+        x265_log(param, X265_LOG_INFO, "primitive tuning: %d of %d primitives replaced, from %s\n",
+                 changed, tuner->numTuned(), fileName);
+    else
+        x265_log(param, X265_LOG_INFO, "primitive tuning: %d of %d primitives replaced, measured in %.1f ms\n",
+                 changed, tuner->numTuned(), (x265_mdate() - start) / 1000.0);
+
+    delete tuner;
+}
+
+}
@@ -55,6 +55,8 @@ int no_atomic_and(int* ptr, int mask);
 int no_atomic_inc(int* ptr);
 int no_atomic_dec(int* ptr);
 int no_atomic_add(int* ptr, int val);
+int64_t no_atomic_add64(int64_t* ptr, int64_t val);
+int no_atomic_cas(int* ptr, int oldval, int newval);
 }
 
 #define CLZ(id, x)            id = (unsigned long)__builtin_clz(x) ^ 31
@@ -64,6 +66,8 @@ int no_atomic_add(int* ptr, int val);
 #define ATOMIC_INC(ptr)       no_atomic_inc((int*)ptr)
 #define ATOMIC_DEC(ptr)       no_atomic_dec((int*)ptr)
 #define ATOMIC_ADD(ptr, val)  no_atomic_add((int*)ptr, val)
+#define ATOMIC_ADD64(ptr, val) no_atomic_add64((int64_t*)ptr, val)
+#define ATOMIC_CAS32(ptr, oldval, newval) no_atomic_cas((int*)ptr, oldval, newval)
 #define GIVE_UP_TIME()        usleep(0)
 
 #elif __GNUC__               /* GCCs builtin atomics */
@@ -78,6 +82,8 @@ int no_atomic_add(int* ptr, int val);
 #define ATOMIC_INC(ptr)       __sync_add_and_fetch((volatile int32_t*)ptr, 1)
 #define ATOMIC_DEC(ptr)       __sync_add_and_fetch((volatile int32_t*)ptr, -1)
 #define ATOMIC_ADD(ptr, val)  __sync_fetch_and_add((volatile int32_t*)ptr, val)
+#define ATOMIC_ADD64(ptr, val) __sync_fetch_and_add((volatile int64_t*)ptr, val)
+#define ATOMIC_CAS32(ptr, oldval, newval) __sync_val_compare_and_swap((volatile int32_t*)ptr, oldval, newval)
 #define GIVE_UP_TIME()        usleep(0)
 
 #elif defined(_MSC_VER)       /* Windows atomic intrinsics */
@@ -89,8 +95,10 @@ int no_atomic_add(int* ptr, int val);
 #define ATOMIC_INC(ptr)       InterlockedIncrement((volatile LONG*)ptr)
 #define ATOMIC_DEC(ptr)       InterlockedDecrement((volatile LONG*)ptr)
 #define ATOMIC_ADD(ptr, val)  InterlockedExchangeAdd((volatile LONG*)ptr, val)
+#define ATOMIC_ADD64(ptr, val) InterlockedExchangeAdd64((volatile LONG64*)ptr, val)
 #define ATOMIC_OR(ptr, mask)  _InterlockedOr((volatile LONG*)ptr, (LONG)mask)
 #define ATOMIC_AND(ptr, mask) _InterlockedAnd((volatile LONG*)ptr, (LONG)mask)
+#define ATOMIC_CAS32(ptr, oldval, newval) InterlockedCompareExchange((volatile LONG*)ptr, (LONG)newval, (LONG)oldval)
 #define GIVE_UP_TIME()        Sleep(0)
 
 #endif // ifdef __GNUC__
@@ -121,6 +129,11 @@ public:
         EnterCriticalSection(&this->handle);
     }
 
+    bool tryAcquire()
+    {
+        return !!TryEnterCriticalSection(&this->handle);
+    }
+
     void release()
     {
         LeaveCriticalSection(&this->handle);
@@ -268,6 +281,11 @@ public:
         pthread_mutex_lock(&this->handle);
     }
 
+    bool tryAcquire()
+    {
+        return !pthread_mutex_trylock(&this->handle);
+    }
+
     void release()
     {
         pthread_mutex_unlock(&this->handle);
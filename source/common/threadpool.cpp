@@ -43,8 +43,8 @@
 #elif defined(_MSC_VER)
 
 #define SLEEPBITMAP_CTZ(id, x)     _BitScanForward64(&id, x)
-#define SLEEPBITMAP_OR(ptr, mask)  InterlockedOr64((volatile LONG64*)ptr, (LONG)mask)
-#define SLEEPBITMAP_AND(ptr, mask) InterlockedAnd64((volatile LONG64*)ptr, (LONG)mask)
+#define SLEEPBITMAP_OR(ptr, mask)  InterlockedOr64((volatile LONG64*)ptr, (LONG64)mask)
+#define SLEEPBITMAP_AND(ptr, mask) InterlockedAnd64((volatile LONG64*)ptr, (LONG64)mask)
 
 #endif // ifdef __GNUC__
 
@@ -109,8 +109,88 @@ public:
 
     void threadMain();
     void awaken()           { m_wakeEvent.trigger(); }
+    void waitOrSteal();
 };
 
+/* Placeholder for the removed providers of shared pools, and the current
+ * provider of their workers before any encoder is attached */
+class IdleJobProvider : public JobProvider
+{
+public:
+    void findJob(int) {}
+};
+
+static IdleJobProvider s_idleProvider;
+
+/* Counts a scan of the provider table of a shared pool, see
+ * ThreadPool::removeProvider() */
+struct ProviderScan
+{
+    ThreadPool& m_pool;
+
+    ProviderScan(ThreadPool& pool) : m_pool(pool) { if (m_pool.m_bShared) ATOMIC_INC(&m_pool.m_activeScans); }
+    ~ProviderScan()                               { if (m_pool.m_bShared) ATOMIC_DEC(&m_pool.m_activeScans); }
+};
+
+/* true if a provider with keys (share, priority) should be serviced before one
+ * with keys (bestShare, bestPriority) */
+static inline bool isBefore(uint64_t share, uint64_t priority, uint64_t bestShare, uint64_t bestPriority)
+{
+    return share < bestShare || (share == bestShare && priority < bestPriority);
+}
+
+/* Performs a job of the provider, charging the time spent to its encoder's
+ * share of a shared pool */
+static inline void serviceJob(JobProvider& jp, int workerThreadId)
+{
+    if (jp.m_share)
+    {
+        PoolShare* share = jp.m_share;
+        int64_t start = x265_mdate();
+        jp.findJob(workerThreadId);
+        ATOMIC_ADD64(&share->m_serviceTime, x265_mdate() - start);
+    }
+    else
+        jp.findJob(workerThreadId);
+}
+
+void SleepBitmap::set(int id)
+{
+    int w = word(id);
+    SLEEPBITMAP_OR(&m_words[w], bit(id));
+    SLEEPBITMAP_OR(&m_summary, (sleepbitmap_t)1 << w);
+}
+
+void SleepBitmap::clear(int id)
+{
+    int w = word(id);
+    sleepbitmap_t b = bit(id);
+    if (!(SLEEPBITMAP_AND(&m_words[w], ~b) & ~b))
+        refreshSummary(w);
+}
+
+bool SleepBitmap::tryClear(int id)
+{
+    int w = word(id);
+    sleepbitmap_t b = bit(id);
+    sleepbitmap_t prev = SLEEPBITMAP_AND(&m_words[w], ~b);
+    if (!(prev & ~b))
+        refreshSummary(w);
+    return !!(prev & b);
+}
+
+void SleepBitmap::refreshSummary(int w)
+{
+    sleepbitmap_t wordBit = (sleepbitmap_t)1 << w;
+    SLEEPBITMAP_AND(&m_summary, ~wordBit);
+
+    /* a set() may have landed between our clear of the word and the clear of
+     * the summary bit; the atomics above are full barriers so re-checking the
+     * word here is sufficient to never lose a summary bit */
+    if (m_words[w])
+        SLEEPBITMAP_OR(&m_summary, wordBit);
+}
+
 void WorkerThread::threadMain()
 {
     THREAD_NAME("Worker", m_id);
@@ -123,13 +203,15 @@ void WorkerThread::threadMain()
 
     m_pool.setCurrentThreadAffinity();
 
-    sleepbitmap_t idBit = (sleepbitmap_t)1 << m_id;
-    m_curJobProvider = m_pool.m_jpTable[0];
+    m_curJobProvider = m_pool.m_bShared ? &s_idleProvider : m_pool.m_jpTable[0];
     m_bondMaster = NULL;
 
-    SLEEPBITMAP_OR(&m_curJobProvider->m_ownerBitmap, idBit);
-    SLEEPBITMAP_OR(&m_pool.m_sleepBitmap, idBit);
-    m_wakeEvent.wait();
+    m_curJobProvider->m_ownerBitmap.set(m_id);
+    m_pool.m_sleepBitmap.set(m_id);
+    if (m_pool.m_stealIdleMs)
+        waitOrSteal();
+    else
+        m_wakeEvent.wait();
 
     while (m_pool.m_isActive)
     {
@@ -143,28 +225,35 @@ void WorkerThread::threadMain()
         do
         {
             /* do pending work for current job provider */
-            m_curJobProvider->findJob(m_id);
+            serviceJob(*m_curJobProvider, m_id);
 
             /* if the current job provider still wants help, only switch to a
-             * higher priority provider (lower slice type). Else take the first
+             * higher priority provider (see JobProvider::priority(), preceded
+             * by JobProvider::shareKey() in shared pools). Else take the first
              * available job provider with the highest priority */
-            int curPriority = (m_curJobProvider->m_helpWanted) ? m_curJobProvider->m_sliceType :
-                                                                 INVALID_SLICE_PRIORITY + 1;
-            int nextProvider = -1;
+            ProviderScan scan(m_pool);
+            uint64_t curShare = NO_PROVIDER_PRIORITY, curPriority = NO_PROVIDER_PRIORITY;
+            if (m_curJobProvider->m_helpWanted)
+            {
+                curShare = m_curJobProvider->shareKey();
+                curPriority = m_curJobProvider->priority();
+            }
+            JobProvider* nextProvider = NULL;
             for (int i = 0; i < m_pool.m_numProviders; i++)
             {
-                if (m_pool.m_jpTable[i]->m_helpWanted &&
-                    m_pool.m_jpTable[i]->m_sliceType < curPriority)
+                JobProvider* jp = m_pool.m_jpTable[i];
+                if (jp->m_helpWanted && isBefore(jp->shareKey(), jp->priority(), curShare, curPriority))
                 {
-                    nextProvider = i;
-                    curPriority = m_pool.m_jpTable[i]->m_sliceType;
+                    nextProvider = jp;
+                    curShare = jp->shareKey();
+                    curPriority = jp->priority();
                 }
             }
-            if (nextProvider != -1 && m_curJobProvider != m_pool.m_jpTable[nextProvider])
+            if (nextProvider && m_curJobProvider != nextProvider)
             {
-                SLEEPBITMAP_AND(&m_curJobProvider->m_ownerBitmap, ~idBit);
-                m_curJobProvider = m_pool.m_jpTable[nextProvider];
-                SLEEPBITMAP_OR(&m_curJobProvider->m_ownerBitmap, idBit);
+                m_curJobProvider->m_ownerBitmap.clear(m_id);
+                m_curJobProvider = nextProvider;
+                m_curJobProvider->m_ownerBitmap.set(m_id);
             }
         }
         while (m_curJobProvider->m_helpWanted);
@@ -172,16 +261,52 @@ void WorkerThread::threadMain()
         /* While the worker sleeps, a job-provider or bond-group may acquire this
          * worker's sleep bitmap bit. Once acquired, that thread may modify 
          * m_bondMaster or m_curJobProvider, then waken the thread */
-        SLEEPBITMAP_OR(&m_pool.m_sleepBitmap, idBit);
-        m_wakeEvent.wait();
+        m_pool.m_sleepBitmap.set(m_id);
+        if (m_pool.m_stealIdleMs)
+            waitOrSteal();
+        else
+            m_wakeEvent.wait();
     }
 
-    SLEEPBITMAP_OR(&m_pool.m_sleepBitmap, idBit);
+    m_pool.m_sleepBitmap.set(m_id);
+}
+
+/* Each time this worker has been idle for the steal threshold, it takes
+ * itself out of the sleep bitmap (so its own pool can no longer acquire it)
+ * and helps the job providers of other pools. Returns once awakened, or with
+ * its bit cleared when its own pool has work again */
+void WorkerThread::waitOrSteal()
+{
+    while (m_wakeEvent.timedWait(m_pool.m_stealIdleMs))
+    {
+        if (!m_pool.m_isActive)
+            continue;
+
+        /* if our bit is already gone, a waker has acquired us and will trigger
+         * our wake event */
+        if (!m_pool.m_sleepBitmap.tryClear(m_id))
+        {
+            m_wakeEvent.wait();
+            return;
+        }
+
+        ThreadPool::StealResult result;
+        while ((result = m_pool.tryHelpRemotePool()) == ThreadPool::STEAL_JOB_DONE)
+        {}
+
+        /* a provider of our own pool wanted help while we were out of the
+         * sleep bitmap, so nobody could wake us for it. Go back to our pool
+         * with our bit still clear */
+        if (result == ThreadPool::STEAL_OWN_WORK)
+            return;
+
+        m_pool.m_sleepBitmap.set(m_id);
+    }
 }
 
 void JobProvider::tryWakeOne()
 {
-    int id = m_pool->tryAcquireSleepingThread(m_ownerBitmap, ALL_POOL_THREADS);
+    int id = m_pool->tryAcquireSleepingThread(&m_ownerBitmap, true);
     if (id < 0)
     {
         m_helpWanted = true;
@@ -191,51 +316,61 @@ void JobProvider::tryWakeOne()
     WorkerThread& worker = m_pool->m_workers[id];
     if (worker.m_curJobProvider != this) /* poaching */
     {
-        sleepbitmap_t bit = (sleepbitmap_t)1 << id;
-        SLEEPBITMAP_AND(&worker.m_curJobProvider->m_ownerBitmap, ~bit);
+        worker.m_curJobProvider->m_ownerBitmap.clear(id);
         worker.m_curJobProvider = this;
-        SLEEPBITMAP_OR(&worker.m_curJobProvider->m_ownerBitmap, bit);
+        worker.m_curJobProvider->m_ownerBitmap.set(id);
     }
     worker.awaken();
 }
 
-int ThreadPool::tryAcquireSleepingThread(sleepbitmap_t firstTryBitmap, sleepbitmap_t secondTryBitmap)
+/* Walk the words of the sleep bitmap which may hold sleeping threads
+ * (optionally restricted to the threads in mask) and try to claim one */
+static int acquireFromBitmap(SleepBitmap& sleepBitmap, const SleepBitmap* mask)
 {
     unsigned long id;
 
-    sleepbitmap_t masked = m_sleepBitmap & firstTryBitmap;
-    while (masked)
-    {
-        SLEEPBITMAP_CTZ(id, masked);
-
-        sleepbitmap_t bit = (sleepbitmap_t)1 << id;
-        if (SLEEPBITMAP_AND(&m_sleepBitmap, ~bit) & bit)
-            return (int)id;
+    sleepbitmap_t words = sleepBitmap.m_summary;
+    if (mask)
+        words &= mask->m_summary;
 
-        masked = m_sleepBitmap & firstTryBitmap;
-    }
-
-    masked = m_sleepBitmap & secondTryBitmap;
-    while (masked)
+    while (words)
     {
-        SLEEPBITMAP_CTZ(id, masked);
+        SLEEPBITMAP_CTZ(id, words);
+        int w = (int)id;
+        words &= ~((sleepbitmap_t)1 << w);
+
+        sleepbitmap_t wordMask = mask ? mask->m_words[w] : (sleepbitmap_t)-1;
+        sleepbitmap_t masked = sleepBitmap.m_words[w] & wordMask;
+        while (masked)
+        {
+            SLEEPBITMAP_CTZ(id, masked);
 
-        sleepbitmap_t bit = (sleepbitmap_t)1 << id;
-        if (SLEEPBITMAP_AND(&m_sleepBitmap, ~bit) & bit)
-            return (int)id;
+            int threadId = w * SLEEPBITMAP_BITS + (int)id;
+            if (sleepBitmap.tryClear(threadId))
+                return threadId;
 
-        masked = m_sleepBitmap & secondTryBitmap;
+            masked = sleepBitmap.m_words[w] & wordMask;
+        }
     }
 
     return -1;
 }
 
-int ThreadPool::tryBondPeers(int maxPeers, sleepbitmap_t peerBitmap, BondedTaskGroup& master)
+int ThreadPool::tryAcquireSleepingThread(const SleepBitmap* firstTryBitmap, bool bTryAll)
+{
+    int id = acquireFromBitmap(m_sleepBitmap, firstTryBitmap);
+    if (id < 0 && bTryAll && firstTryBitmap)
+        id = acquireFromBitmap(m_sleepBitmap, NULL);
+
+    return id;
+}
+
+int ThreadPool::tryBondPeers(int maxPeers, const SleepBitmap* peerBitmap, BondedTaskGroup& master)
 {
     int bondCount = 0;
     do
     {
-        int id = tryAcquireSleepingThread(peerBitmap, 0);
+        int id = tryAcquireSleepingThread(peerBitmap, false);
         if (id < 0)
             return bondCount;
 
@@ -247,7 +382,252 @@ int ThreadPool::tryBondPeers(int maxPeers, sleepbitmap_t peerBitmap, BondedTaskG
 
     return bondCount;
 }
-ThreadPool* ThreadPool::allocThreadPools(x265_param* p, int& numPools, bool isThreadsReserved)
+/* Returns the highest priority job provider of this pool which wants help */
+JobProvider* ThreadPool::findHelpWanted()
+{
+    JobProvider* best = NULL;
+    uint64_t bestShare = NO_PROVIDER_PRIORITY, bestPriority = NO_PROVIDER_PRIORITY;
+    for (int i = 0; i < m_numProviders; i++)
+    {
+        JobProvider* jp = m_jpTable[i];
+        if (jp->m_helpWanted && isBefore(jp->shareKey(), jp->priority(), bestShare, bestPriority))
+        {
+            best = jp;
+            bestShare = jp->shareKey();
+            bestPriority = jp->priority();
+        }
+    }
+    return best;
+}
+
+/* Called by an idle worker of this pool which has removed itself from the
+ * sleep bitmap. Performs one job for the nearest pool whose workers are all
+ * busy but which still has job providers wanting help. Returns whether a job
+ * was done, nothing was found, or our own pool has work again */
+ThreadPool::StealResult ThreadPool::tryHelpRemotePool()
+{
+    if (!m_isActive)
+        return STEAL_NONE;
+    {
+        ProviderScan scan(*this);
+        if (findHelpWanted())
+            return STEAL_OWN_WORK;
+    }
+
+    for (int i = 0; i < m_numStealPools; i++)
+    {
+        ThreadPool& remote = m_pools[m_stealOrder[i]];
+
+        /* the remote pool has idle workers of its own */
+        if (!remote.m_isActive || remote.m_sleepBitmap.m_summary)
+            continue;
+
+        /* the scan lasts until the job is done, a removed provider of a
+         * shared pool is only released once no guest may still service it */
+        ProviderScan scan(remote);
+        JobProvider* jp = remote.findHelpWanted();
+        if (!jp)
+            continue;
+
+        int guest = acquireFromBitmap(remote.m_guestBitmap, NULL);
+        if (guest < 0)
+            continue;
+
+        serviceJob(*jp, remote.m_numWorkers + guest);
+        remote.m_guestBitmap.set(guest);
+
+        ATOMIC_INC(&m_remoteJobCount);
+        ATOMIC_INC(&remote.m_guestJobCount);
+        return STEAL_JOB_DONE;
+    }
+
+    return STEAL_NONE;
+}
+
+/* NUMA distance between the node sets of two pools, in ACPI SLIT units */
+static int poolDistance(uint64_t nodeMaskA, uint64_t nodeMaskB)
+{
+#if HAVE_LIBNUMA
+    if (numa_available() >= 0)
+    {
+        int best = 0;
+        for (int i = 0; i < 64; i++)
+        {
+            if (!((nodeMaskA >> i) & 1))
+                continue;
+            for (int j = 0; j < 64; j++)
+            {
+                if (!((nodeMaskB >> j) & 1))
+                    continue;
+                int dist = numa_distance(i, j);
+                if (dist > 0 && (!best || dist < best))
+                    best = dist;
+            }
+        }
+        if (best)
+            return best;
+    }
+#endif
+    return (nodeMaskA & nodeMaskB) ? 10 : 20;
+}
+
+void ThreadPool::initPoolStealing(ThreadPool* pools, int numPools, int idleMs)
+{
+    for (int i = 0; i < numPools; i++)
+    {
+        ThreadPool& pool = pools[i];
+        pool.m_pools = pools;
+        pool.m_stealIdleMs = idleMs;
+        pool.m_stealOrder = X265_MALLOC(int, numPools);
+        if (!pool.m_stealOrder)
+        {
+            pool.m_stealIdleMs = 0;
+            continue;
+        }
+
+        /* insertion sort of the other pools by NUMA distance */
+        int remoteWorkers = 0;
+        pool.m_numStealPools = 0;
+        for (int j = 0; j < numPools; j++)
+        {
+            if (j == i)
+                continue;
+            remoteWorkers += pools[j].m_numWorkers;
+
+            int dist = poolDistance(pool.m_nodeMask, pools[j].m_nodeMask);
+            int k = pool.m_numStealPools++;
+            while (k && poolDistance(pool.m_nodeMask, pools[pool.m_stealOrder[k - 1]].m_nodeMask) > dist)
+            {
+                pool.m_stealOrder[k] = pool.m_stealOrder[k - 1];
+                k--;
+            }
+            pool.m_stealOrder[k] = j;
+        }
+
+        pool.m_numGuests = X265_MIN(remoteWorkers, (int)MAX_POOL_GUESTS);
+        for (int g = 0; g < pool.m_numGuests; g++)
+            pool.m_guestBitmap.set(g);
+    }
+}
+
+void WorkStealingTaskGroup::runJobs(ThreadPool* pool, int maxPeers, bool bSteal)
+{
+    m_bSteal = bSteal;
+    m_jobAcquired = 0;
+    m_numQueues = m_queuesJoined = 0;
+    m_steals = m_stolenJobs = m_lockWaits = 0;
+
+    int peers = pool && maxPeers > 0 ? tryBondPeers(*pool, maxPeers) : 0;
+
+    if (bSteal)
+    {
+        /* one queue for each participant which was bonded. Peers which are
+         * already in acquireJob() wait until the queues are published */
+        int numQueues = X265_MIN(X265_MIN(peers + 1, m_jobTotal), (int)MAX_JOB_QUEUES);
+        numQueues = X265_MAX(numQueues, 1);
+        for (int i = 0; i < numQueues; i++)
+        {
+            m_jobQueue[i].lock = 0;
+            m_jobQueue[i].head = (int)((int64_t)m_jobTotal * i / numQueues);
+            m_jobQueue[i].tail = (int)((int64_t)m_jobTotal * (i + 1) / numQueues);
+        }
+        ATOMIC_ADD(&m_numQueues, numQueues);
+    }
+
+    processTasks(-1);
+    waitForExit();
+}
+
+void WorkStealingTaskGroup::lockQueue(JobQueue& queue)
+{
+    if (!ATOMIC_CAS32(&queue.lock, 0, 1))
+        return;
+
+    ATOMIC_INC(&m_lockWaits);
+    for (int spins = 0; queue.lock || ATOMIC_CAS32(&queue.lock, 0, 1); spins++)
+    {
+        if (spins >= 64)
+            GIVE_UP_TIME();
+    }
+}
+
+int WorkStealingTaskGroup::acquireJob(int& slot)
+{
+    if (!m_bSteal)
+    {
+        if (!m_lock.tryAcquire())
+        {
+            ATOMIC_INC(&m_lockWaits);
+            m_lock.acquire();
+        }
+        int job = m_jobAcquired < m_jobTotal ? m_jobAcquired++ : -1;
+        m_lock.release();
+        return job;
+    }
+
+    if (slot < 0)
+    {
+        while (!m_numQueues)
+            GIVE_UP_TIME();
+        slot = ATOMIC_INC(&m_queuesJoined) - 1;
+    }
+
+    int numQueues = m_numQueues;
+    bool bHasQueue = slot < numQueues;
+    if (bHasQueue)
+    {
+        JobQueue& own = m_jobQueue[slot];
+        lockQueue(own);
+        if (own.head < own.tail)
+        {
+            int job = own.head++;
+            unlockQueue(own);
+            return job;
+        }
+        unlockQueue(own);
+    }
+
+    /* our queue is empty; steal from the back of our siblings' queues. Late
+     * participants without a queue of their own take one job at a time */
+    for (int i = 1; i <= numQueues; i++)
+    {
+        int victimId = (slot + i) % numQueues;
+        if (victimId == slot)
+            continue;
+
+        JobQueue& victim = m_jobQueue[victimId];
+        if (victim.head >= victim.tail)
+            continue;
+
+        lockQueue(victim);
+        int avail = victim.tail - victim.head;
+        if (avail <= 0)
+        {
+            unlockQueue(victim);
+            continue;
+        }
+        int count = bHasQueue ? (avail + 1) >> 1 : 1;
+        victim.tail -= count;
+        int first = victim.tail;
+        unlockQueue(victim);
+
+        ATOMIC_INC(&m_steals);
+        ATOMIC_ADD(&m_stolenJobs, count);
+        if (count > 1)
+        {
+            JobQueue& own = m_jobQueue[slot];
+            lockQueue(own);
+            own.head = first + 1;
+            own.tail = first + count;
+            unlockQueue(own);
+        }
+        return first;
+    }
+
+    return -1;
+}
+
+ThreadPool* ThreadPool::allocThreadPools(x265_param* p, int& numPools, bool isThreadsReserved, bool bShared)
 {
     enum { MAX_NODE_NUM = 127 };
     int cpusPerNode[MAX_NODE_NUM + 1];
@@ -409,7 +789,7 @@ ThreadPool* ThreadPool::allocThreadPools(x265_param* p, int& numPools, bool isTh
     if (!numPools)
         return NULL;
 
-    if (numPools > p->frameNumThreads)
+    if (numPools > p->frameNumThreads && !bShared)
     {
         x265_log(p, X265_LOG_DEBUG, "Reducing number of thread pools for frame thread count\n");
         numPools = X265_MAX(p->frameNumThreads / 2, 1);
@@ -420,6 +800,8 @@ ThreadPool* ThreadPool::allocThreadPools(x265_param* p, int& numPools, bool isTh
     if (pools)
     {
         int maxProviders = (p->frameNumThreads + numPools - 1) / numPools + !isThreadsReserved; /* +1 is Lookahead, always assigned to threadpool 0 */
+        if (bShared)
+            maxProviders = MAX_SHARED_PROVIDERS;
         int node = 0;
         for (int i = 0; i < numPools; i++)
         {
@@ -460,6 +842,11 @@ ThreadPool* ThreadPool::allocThreadPools(x265_param* p, int& numPools, bool isTh
                 x265_log(p, X265_LOG_INFO, "Thread pool created using %d threads\n", numThreads);
             threadsPerPool[node] -= origNumThreads;
         }
+        if (numPools > 1 && p->poolStealThreshold > 0 && !isThreadsReserved)
+        {
+            initPoolStealing(pools, numPools, p->poolStealThreshold);
+            x265_log(p, X265_LOG_INFO, "Idle workers may help other thread pools after %d ms\n", p->poolStealThreshold);
+        }
     }
     else
         numPools = 0;
@@ -497,11 +884,10 @@ bool ThreadPool::create(int numThreads, int maxProviders, uint64_t nodeMask)
         else
             x265_log(NULL, X265_LOG_ERROR, "unable to get NUMA node mask for %lx\n", nodeMask);
     }
-#else
-    (void)nodeMask;
 #endif
 
     m_numWorkers = numThreads;
+    m_nodeMask = nodeMask;
 
     m_workers = X265_MALLOC(WorkerThread, numThreads);
     /* placement new initialization */
@@ -511,6 +897,7 @@ bool ThreadPool::create(int numThreads, int maxProviders, uint64_t nodeMask)
 
     m_jpTable = X265_MALLOC(JobProvider*, maxProviders);
     m_numProviders = 0;
+    m_maxProviders = maxProviders;
 
     return m_workers && m_jpTable;
 }
@@ -536,7 +923,7 @@ void ThreadPool::stopWorkers()
         m_isActive = false;
         for (int i = 0; i < m_numWorkers; i++)
         {
-            while (!(m_sleepBitmap & ((sleepbitmap_t)1 << i)))
+            while (!m_sleepBitmap.test(i))
                 GIVE_UP_TIME();
             m_workers[i].awaken();
             m_workers[i].stop();
@@ -544,6 +931,58 @@ void ThreadPool::stopWorkers()
     }
 }
 
+void ThreadPool::addProvider(JobProvider& jp)
+{
+    X265_CHECK(m_bShared, "providers are only added to running shared pools\n");
+
+    jp.m_pool = this;
+    for (int i = 0; i < m_numProviders; i++)
+    {
+        if (m_jpTable[i] == &s_idleProvider)
+        {
+            m_jpTable[i] = &jp;
+            return;
+        }
+    }
+
+    X265_CHECK(m_numProviders < m_maxProviders, "shared thread pool provider table overflow\n");
+    m_jpTable[m_numProviders] = &jp;
+    ATOMIC_INC(&m_numProviders); /* the slot is written before it is scanned */
+}
+
+void ThreadPool::removeProvider(JobProvider& jp)
+{
+    for (int i = 0; i < m_numProviders; i++)
+    {
+        if (m_jpTable[i] == &jp)
+            m_jpTable[i] = &s_idleProvider;
+    }
+    jp.m_helpWanted = false;
+
+    /* the scans in progress may have picked the provider before it left the
+     * table, later ones cannot */
+    while (m_activeScans)
+        GIVE_UP_TIME();
+
+    /* move the workers still bound to the provider to the idle provider. A
+     * sleeping worker is acquired and awakened like tryWakeOne() does, an
+     * awake one finds no more work and soon either switches or sleeps */
+    for (int i = 0; i < m_numWorkers; i++)
+    {
+        WorkerThread& worker = m_workers[i];
+        while (worker.m_curJobProvider == &jp)
+        {
+            if (m_sleepBitmap.tryClear(i))
+            {
+                worker.m_curJobProvider = &s_idleProvider;
+                worker.awaken();
+            }
+            else
+                GIVE_UP_TIME();
+        }
+    }
+}
+
 ThreadPool::~ThreadPool()
 {
     if (m_workers)
@@ -554,6 +993,7 @@ ThreadPool::~ThreadPool()
 
     X265_FREE(m_workers);
     X265_FREE(m_jpTable);
+    X265_FREE(m_stealOrder);
 
 #if HAVE_LIBNUMA
     if(m_numaMask)
@@ -676,4 +1116,111 @@ void ThreadPool::getFrameThreadsCount(x265_param* p, int cpuCount)
         p->frameNumThreads = 1;
 }
 
+SharedThreadPool* SharedThreadPool::create(x265_param* p)
+{
+    /* the pools are sized by --pools and --pool-steal alone, lookahead
+     * threads are never reserved and frame threads belong to each encoder */
+    x265_param param = *p;
+    param.lookaheadThreads = 0;
+    if (!param.frameNumThreads)
+        param.frameNumThreads = 1;
+
+    if (param.numaPools && !strcmp(param.numaPools, "none"))
+        return NULL;
+
+    int numPools = 0;
+    ThreadPool* pools = ThreadPool::allocThreadPools(&param, numPools, false, true);
+    if (!pools)
+        return NULL;
+
+    SharedThreadPool* shared = new SharedThreadPool;
+    shared->m_pools = pools;
+    shared->m_numPools = numPools;
+    for (int i = 0; i < numPools; i++)
+    {
+        pools[i].m_bShared = true;
+        shared->m_numWorkers += pools[i].m_numWorkers;
+    }
+    for (int i = 0; i < numPools; i++)
+    {
+        if (!pools[i].start())
+        {
+            shared->destroy();
+            return NULL;
+        }
+    }
+
+    return shared;
+}
+
+bool SharedThreadPool::destroy()
+{
+    if (m_numShares)
+        return false;
+
+    for (int i = 0; i < m_numPools; i++)
+        m_pools[i].stopWorkers();
+    delete [] m_pools;
+    delete this;
+    return true;
+}
+
+PoolShare* SharedThreadPool::attach(int weight)
+{
+    ScopedLock s(m_lock);
+
+    if (m_numShares == MAX_POOL_SHARES)
+        return NULL;
+
+    PoolShare* share = new PoolShare;
+    share->m_weight = X265_MAX(weight, 1);
+    share->m_firstPool = m_nextPool;
+    m_nextPool = (m_nextPool + 1) % m_numPools;
+
+    /* a new encoder starts level with the least serviced one rather than being
+     * owed all the service time of the encoders which came before it */
+    int64_t minTime = 0;
+    for (int i = 0; i < m_numShares; i++)
+    {
+        int64_t time = m_shares[i]->m_serviceTime / m_shares[i]->m_weight;
+        if (!i || time < minTime)
+            minTime = time;
+    }
+    share->m_serviceTime = minTime * share->m_weight;
+
+    m_shares[m_numShares++] = share;
+    return share;
+}
+
+void SharedThreadPool::detach(PoolShare* share)
+{
+    ScopedLock s(m_lock);
+
+    for (int i = 0; i < m_numShares; i++)
+    {
+        if (m_shares[i] == share)
+        {
+            m_shares[i] = m_shares[--m_numShares];
+            delete share;
+            return;
+        }
+    }
+}
+
+void SharedThreadPool::addProvider(ThreadPool& pool, JobProvider& jp, PoolShare* share)
+{
+    ScopedLock s(m_lock);
+
+    jp.m_share = share;
+    pool.addProvider(jp);
+}
+
+void SharedThreadPool::removeProvider(JobProvider& jp)
+{
+    ScopedLock s(m_lock);
+
+    jp.m_pool->removeProvider(jp);
+    jp.m_share = NULL;
+}
+
 } // end namespace X265_NS
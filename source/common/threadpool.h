@@ -27,12 +27,15 @@
 #include "common.h"
 #include "threading.h"
 
+struct x265_threadpool {};
+
 namespace X265_NS {
 // x265 private namespace
 
 class ThreadPool;
 class WorkerThread;
 class BondedTaskGroup;
+struct PoolShare;
 
 #if X86_64
 typedef uint64_t sleepbitmap_t;
@@ -40,9 +43,60 @@ typedef uint64_t sleepbitmap_t;
 typedef uint32_t sleepbitmap_t;
 #endif
 
-static const sleepbitmap_t ALL_POOL_THREADS = (sleepbitmap_t)-1;
-enum { MAX_POOL_THREADS = sizeof(sleepbitmap_t) * 8 };
+enum { SLEEPBITMAP_BITS = sizeof(sleepbitmap_t) * 8 };
+enum { SLEEPBITMAP_WORDS = 8 };
+enum { MAX_POOL_THREADS = SLEEPBITMAP_BITS * SLEEPBITMAP_WORDS };
+enum { MAX_POOL_GUESTS = 8 };         // thread IDs reserved for cross-pool stealing
 enum { INVALID_SLICE_PRIORITY = 10 }; // a value larger than any X265_TYPE_* macro
+enum { MAX_POOL_SHARES = 32 };        // encoders attached to one shared pool set
+enum { MAX_SHARED_PROVIDERS = MAX_POOL_SHARES * (X265_MAX_FRAME_THREADS + 1) };
+enum { POOL_SHARE_QUANTUM = 10000 };  // worker microseconds, see PoolShare
+static const uint64_t NO_PROVIDER_PRIORITY = (uint64_t)-1;
+
+// Scheduling state of one encoder attached to a shared pool set (see
+// SharedThreadPool). Workers service the encoder with the least service time,
+// divided by its weight, first; in quanta of POOL_SHARE_QUANTUM so a worker
+// keeps to one encoder's providers until that encoder is a quantum ahead of
+// the others, rather than moving after every job
+struct PoolShare
+{
+    int64_t  m_serviceTime; // worker microseconds spent in our providers' findJob()
+    int      m_weight;
+    int      m_firstPool;   // pool of our first frame encoder
+
+    uint64_t key() const { return (uint64_t)m_serviceTime / ((uint64_t)m_weight * POOL_SHARE_QUANTUM); }
+};
+
+// Two level bitmap of worker thread IDs, allowing a single pool to span more
+// threads than fit in one machine word. Bit N of m_summary is a hint that
+// m_words[N] may be non-zero; it is set after any bit in the word is set and
+// lazily cleared by scanners which find the word empty, so readers may skip
+// words without touching their cache lines. All modifications are atomic.
+struct SleepBitmap
+{
+    sleepbitmap_t m_summary;
+    sleepbitmap_t m_words[SLEEPBITMAP_WORDS];
+
+    static int  word(int id)          { return id / SLEEPBITMAP_BITS; }
+    static sleepbitmap_t bit(int id)  { return (sleepbitmap_t)1 << (id % SLEEPBITMAP_BITS); }
+
+    void clearAll()                   { memset(this, 0, sizeof(*this)); }
+    bool test(int id) const           { return !!(m_words[word(id)] & bit(id)); }
+
+    // atomically set the bit for thread id
+    void set(int id);
+
+    // atomically clear the bit for thread id
+    void clear(int id);
+
+    // atomically clear the bit for thread id, returns true if this call
+    // transitioned the bit from set to clear
+    bool tryClear(int id);
+
+    // clear the summary hint of an empty word, re-asserting it if a
+    // concurrent set() raced with us
+    void refreshSummary(int w);
+};
 
 // Frame level job providers. FrameEncoder and Lookahead derive from
 // this class and implement findJob()
@@ -51,20 +105,43 @@ class JobProvider
 public:
 
     ThreadPool*   m_pool;
-    sleepbitmap_t m_ownerBitmap;
+    PoolShare*    m_share;          // NULL unless the pool is shared by several encoders
+    SleepBitmap   m_ownerBitmap;
     int           m_jpId;
     int           m_sliceType;
+    int           m_encodeOrder;    // of the picture being encoded, frame encoders only
+    int           m_blockedCount;   // number of frame encoders blocked on our reconstructed rows
     bool          m_helpWanted;
     bool          m_isFrameEncoder; /* rather ugly hack, but nothing better presents itself */
 
     JobProvider()
         : m_pool(NULL)
-        , m_ownerBitmap(0)
+        , m_share(NULL)
         , m_jpId(-1)
         , m_sliceType(INVALID_SLICE_PRIORITY)
+        , m_encodeOrder(0)
+        , m_blockedCount(0)
         , m_helpWanted(false)
         , m_isFrameEncoder(false)
-    {}
+    {
+        m_ownerBitmap.clearAll();
+    }
+
+    /* Scheduling key of this provider, workers service the provider with the
+     * lowest key first. Providers which other frame encoders are blocked on
+     * (the critical path of frame parallelism) come first, then by reference
+     * depth (slice type, I/P before referenced B before non-referenced B)
+     * and finally by encode order, since the oldest picture in flight is the
+     * one every younger picture ultimately waits on */
+    uint64_t priority() const
+    {
+        uint64_t notBlocked = m_blockedCount > 0 ? 0 : 1;
+        return (notBlocked << 40) | ((uint64_t)m_sliceType << 32) | (uint32_t)m_encodeOrder;
+    }
+
+    /* Scheduling key between the encoders of a shared pool, compared before
+     * priority(). Always 0 in private pools */
+    uint64_t shareKey() const { return m_share ? m_share->key() : 0; }
 
     virtual ~JobProvider() {}
 
@@ -80,10 +157,32 @@ class ThreadPool
 {
 public:
 
-    sleepbitmap_t m_sleepBitmap;
+    SleepBitmap   m_sleepBitmap;
     int           m_numProviders;
     int           m_numWorkers;
     void*         m_numaMask; // node mask in linux, cpu mask in windows
+    uint64_t      m_nodeMask;
+
+    /* cross-pool work stealing (--pool-steal). Idle workers of this pool may
+     * help the job providers of the pools in m_stealOrder (nearest NUMA
+     * distance first) once they have been idle for m_stealIdleMs. Workers of
+     * other pools which help our providers borrow one of our m_numGuests
+     * guest thread IDs, which follow our worker IDs */
+    ThreadPool*   m_pools;
+    int*          m_stealOrder;
+    int           m_numStealPools;
+    int           m_stealIdleMs;
+    int           m_numGuests;
+    SleepBitmap   m_guestBitmap;
+    int           m_remoteJobCount; // jobs our workers performed for other pools
+    int           m_guestJobCount;  // jobs other pools' workers performed for us
+
+    /* pools of a SharedThreadPool have providers added and removed while
+     * their workers run. Scans of m_jpTable are counted in m_activeScans so a
+     * removal can wait until no thread still holds the removed provider */
+    bool          m_bShared;
+    int           m_maxProviders;
+    int           m_activeScans;
 #if defined(_WIN32_WINNT) && _WIN32_WINNT >= _WIN32_WINNT_WIN7 
     GROUP_AFFINITY m_groupAffinity;
 #endif
@@ -98,16 +197,64 @@ public:
     bool create(int numThreads, int maxProviders, uint64_t nodeMask);
     bool start();
     void stopWorkers();
+
+    /* shared pools only, calls are serialized by SharedThreadPool::m_lock */
+    void addProvider(JobProvider& jp);
+    void removeProvider(JobProvider& jp);
     void setCurrentThreadAffinity();
     void setThreadNodeAffinity(void *numaMask);
-    int  tryAcquireSleepingThread(sleepbitmap_t firstTryBitmap, sleepbitmap_t secondTryBitmap);
-    int  tryBondPeers(int maxPeers, sleepbitmap_t peerBitmap, BondedTaskGroup& master);
-    static ThreadPool* allocThreadPools(x265_param* p, int& numPools, bool isThreadsReserved);
+
+    /* Acquire a sleeping worker, preferring those in firstTryBitmap (NULL
+     * means all pool threads). If none are available and bTryAll is true,
+     * any sleeping worker may be acquired. Returns -1 on failure */
+    int  tryAcquireSleepingThread(const SleepBitmap* firstTryBitmap, bool bTryAll);
+    int  tryBondPeers(int maxPeers, const SleepBitmap* peerBitmap, BondedTaskGroup& master);
+
+    /* number of distinct thread IDs which may be passed to findJob() or
+     * processTasks(); per-thread data must be allocated for this many IDs */
+    int  numThreadIds() const { return m_numWorkers + m_numGuests; }
+
+    JobProvider* findHelpWanted();
+    enum StealResult { STEAL_NONE, STEAL_JOB_DONE, STEAL_OWN_WORK };
+    StealResult tryHelpRemotePool();
+    static void initPoolStealing(ThreadPool* pools, int numPools, int idleMs);
+    static ThreadPool* allocThreadPools(x265_param* p, int& numPools, bool isThreadsReserved, bool bShared);
     static int  getCpuCount();
     static int  getNumaNodeCount();
     static void getFrameThreadsCount(x265_param* p,int cpuCount);
 };
 
+/* A set of thread pools created by x265_threadpool_create() and shared by the
+ * encoders which have it as param->threadPool, so that several encoders of one
+ * process (an ABR ladder, a transcoding server) do not each start a worker
+ * per core. Each attached encoder owns a PoolShare, its frame encoders and
+ * lookahead are added to the pools' provider tables by Encoder::create() and
+ * removed by Encoder::stopJobs(). The set must outlive its encoders */
+class SharedThreadPool : public x265_threadpool
+{
+public:
+
+    ThreadPool*   m_pools;
+    int           m_numPools;
+    int           m_numWorkers;     // of all the pools
+    int           m_nextPool;
+    PoolShare*    m_shares[MAX_POOL_SHARES];
+    int           m_numShares;
+    Lock          m_lock;
+
+    SharedThreadPool() : m_pools(NULL), m_numPools(0), m_numWorkers(0), m_nextPool(0), m_numShares(0) {}
+
+    static SharedThreadPool* create(x265_param* p);
+    bool destroy();
+
+    /* returns NULL if MAX_POOL_SHARES encoders are already attached */
+    PoolShare* attach(int weight);
+    void detach(PoolShare* share);
+
+    void addProvider(ThreadPool& pool, JobProvider& jp, PoolShare* share);
+    void removeProvider(JobProvider& jp);
+};
+
 /* Any worker thread may enlist the help of idle worker threads from the same
  * job provider. They must derive from this class and implement the
  * processTasks() method.  To use, an instance must be instantiated by a worker
@@ -139,7 +286,7 @@ public:
      * maxPeers worker threads will call your processTasks() method. */
     int tryBondPeers(JobProvider& jp, int maxPeers)
     {
-        int count = jp.m_pool->tryBondPeers(maxPeers, jp.m_ownerBitmap, *this);
+        int count = jp.m_pool->tryBondPeers(maxPeers, &jp.m_ownerBitmap, *this);
         m_bondedPeerCount += count;
         return count;
     }
@@ -149,7 +296,7 @@ public:
      * processTasks() method. */
     int tryBondPeers(ThreadPool& pool, int maxPeers)
     {
-        int count = pool.tryBondPeers(maxPeers, ALL_POOL_THREADS, *this);
+        int count = pool.tryBondPeers(maxPeers, NULL, *this);
         m_bondedPeerCount += count;
         return count;
     }
@@ -169,6 +316,60 @@ public:
     virtual void processTasks(int workerThreadId) = 0;
 };
 
+/* A bonded task group which hands out job indices [0, m_jobTotal) through
+ * per-participant queues instead of a single shared counter. Once the peers
+ * are bonded, runJobs() seeds one queue per participant with a contiguous
+ * chunk of jobs (for locality). A participant pops jobs from the front of its
+ * own queue and, once that is empty, steals half of the remaining jobs from
+ * the back of a sibling's queue; so peers only contend with each other when
+ * the load is unbalanced. Without bSteal, runJobs() hands the jobs out from
+ * the shared m_jobAcquired counter under m_lock instead, for comparison.
+ * Derived classes call acquireJob() from processTasks() until it returns -1 */
+class WorkStealingTaskGroup : public BondedTaskGroup
+{
+public:
+
+    enum { MAX_JOB_QUEUES = 32 };
+
+    /* the critical sections are a few instructions long, so the queues are
+     * guarded by a spin lock rather than a Lock, and are plain data which
+     * only runJobs() initializes, for the participants which were bonded */
+    struct JobQueue
+    {
+        volatile int32_t lock;
+        int      head;       // next job to be popped by the owner
+        int      tail;       // one past the last job; thieves steal from here
+        char     pad[52];    // keep queues on separate cache lines
+    };
+
+    JobQueue      m_jobQueue[MAX_JOB_QUEUES];
+    volatile int  m_numQueues;    // 0 until runJobs() has seeded the queues
+    int           m_queuesJoined;
+    bool          m_bSteal;
+
+    /* counters since the last runJobs() call */
+    int           m_steals;       // steals from a sibling's queue
+    int           m_stolenJobs;   // jobs taken by those steals
+    int           m_lockWaits;    // job acquisitions which found their lock held
+
+    WorkStealingTaskGroup() { m_numQueues = m_queuesJoined = m_steals = m_stolenJobs = m_lockWaits = 0; m_bSteal = true; }
+
+    /* Performs jobs [0, m_jobTotal) on the calling thread and on up to
+     * maxPeers idle workers of pool (which may be NULL), and returns once
+     * every participant has exited processTasks() */
+    void runJobs(ThreadPool* pool, int maxPeers, bool bSteal);
+
+    /* Returns the next job index for the calling participant or -1 when no
+     * jobs remain. slot must be initialized to -1 by the caller and passed
+     * unmodified on subsequent calls; it identifies the caller's own queue */
+    int  acquireJob(int& slot);
+
+protected:
+
+    void lockQueue(JobQueue& queue);
+    void unlockQueue(JobQueue& queue) { ATOMIC_AND(&queue.lock, 0); }
+};
+
 } // end namespace X265_NS
 
 #endif // ifndef X265_THREADPOOL_H
@@ -0,0 +1,424 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include <immintrin.h> // AVX-512 F, BW, VL
+
+/* AVX-512 versions of the high bit depth primitives which have no AVX-512
+ * assembly: sa8d, the satd and 4:2:2 sse_pp block sizes the assembly skips, and
+ * the SAO edge statistics. Hadamard transforms run on 32bit lanes, so 12bit
+ * input cannot overflow, and partial rows are handled with load masks
+ * rather than separate narrow kernels. Only selected when the cpu does not
+ * drop its clock for 512bit instructions, see X265_CPU_SLOW_AVX512 */
+
+#if HIGH_BIT_DEPTH
+
+using namespace X265_NS;
+
+namespace {
+
+/* mask of the first n of 16 lanes */
+inline __mmask16 laneMask(int n)
+{
+    return (__mmask16)(n >= 16 ? 0xffff : (1 << n) - 1);
+}
+
+/* residual of up to 16 pixels widened to 32bit lanes, masked lanes are zero */
+inline __m512i loadDiff(const pixel* pix1, const pixel* pix2, __mmask16 mask)
+{
+    __m256i a = _mm256_maskz_loadu_epi16(mask, pix1);
+    __m256i b = _mm256_maskz_loadu_epi16(mask, pix2);
+    return _mm512_cvtepi16_epi32(_mm256_sub_epi16(a, b));
+}
+
+/* one butterfly stage between lane pairs selected by the shuffled copy t,
+ * lanes in m keep the difference. The sign of a coefficient is irrelevant
+ * since only absolute values are summed */
+inline __m512i butterfly(__m512i x, __m512i t, __mmask16 m)
+{
+    return _mm512_mask_sub_epi32(_mm512_add_epi32(x, t), m, t, x);
+}
+
+/* 4 point Hadamard within each group of 4 lanes */
+inline __m512i hadamard4Lanes(__m512i x)
+{
+    x = butterfly(x, _mm512_shuffle_epi32(x, _MM_PERM_CDAB), 0xaaaa);
+    return butterfly(x, _mm512_shuffle_epi32(x, _MM_PERM_BADC), 0xcccc);
+}
+
+/* 8 point Hadamard within each group of 8 lanes */
+inline __m512i hadamard8Lanes(__m512i x)
+{
+    x = hadamard4Lanes(x);
+    return butterfly(x, _mm512_shuffle_i64x2(x, x, _MM_SHUFFLE(2, 3, 0, 1)), 0xf0f0);
+}
+
+/* sum of absolute 4x4 Hadamard coefficients for up to four 4x4 blocks side by side */
+inline __m512i satd4Rows(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2, __mmask16 mask)
+{
+    __m512i r0 = loadDiff(pix1, pix2, mask);
+    __m512i r1 = loadDiff(pix1 + stride_pix1, pix2 + stride_pix2, mask);
+    __m512i r2 = loadDiff(pix1 + 2 * stride_pix1, pix2 + 2 * stride_pix2, mask);
+    __m512i r3 = loadDiff(pix1 + 3 * stride_pix1, pix2 + 3 * stride_pix2, mask);
+
+    __m512i t0 = _mm512_add_epi32(r0, r1);
+    __m512i t1 = _mm512_sub_epi32(r0, r1);
+    __m512i t2 = _mm512_add_epi32(r2, r3);
+    __m512i t3 = _mm512_sub_epi32(r2, r3);
+
+    r0 = hadamard4Lanes(_mm512_add_epi32(t0, t2));
+    r1 = hadamard4Lanes(_mm512_add_epi32(t1, t3));
+    r2 = hadamard4Lanes(_mm512_sub_epi32(t0, t2));
+    r3 = hadamard4Lanes(_mm512_sub_epi32(t1, t3));
+
+    return _mm512_add_epi32(_mm512_add_epi32(_mm512_abs_epi32(r0), _mm512_abs_epi32(r1)),
+                            _mm512_add_epi32(_mm512_abs_epi32(r2), _mm512_abs_epi32(r3)));
+}
+
+/* all coefficients of a Hadamard transform share the parity of the input
+ * sum, so every 4x4 total is even and halving the grand total gives the same
+ * result as satd4<> and satd8<>, which halve per block */
+template<int w, int h>
+int satd_avx512(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    __m512i sum = _mm512_setzero_si512();
+
+    for (int row = 0; row < h; row += 4)
+        for (int col = 0; col < w; col += 16)
+            sum = _mm512_add_epi32(sum, satd4Rows(pix1 + row * stride_pix1 + col, stride_pix1,
+                                                  pix2 + row * stride_pix2 + col, stride_pix2, laneMask(w - col)));
+
+    return _mm512_reduce_add_epi32(sum) >> 1;
+}
+
+/* sum of absolute 8x8 Hadamard coefficients for one or two 8x8 blocks side by side,
+ * the unrounded _sa8d_8x8() of each block is left in its half of the lanes */
+inline __m512i sa8d8Rows(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2, __mmask16 mask)
+{
+    __m512i r[8];
+
+    for (int i = 0; i < 8; i++)
+        r[i] = loadDiff(pix1 + i * i_pix1, pix2 + i * i_pix2, mask);
+
+    for (int step = 1; step < 8; step <<= 1)
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            if (i & step)
+                continue;
+            __m512i a = r[i], b = r[i + step];
+            r[i] = _mm512_add_epi32(a, b);
+            r[i + step] = _mm512_sub_epi32(a, b);
+        }
+    }
+
+    __m512i sum = _mm512_setzero_si512();
+    for (int i = 0; i < 8; i++)
+        sum = _mm512_add_epi32(sum, _mm512_abs_epi32(hadamard8Lanes(r[i])));
+
+    return sum;
+}
+
+template<int w, int h>
+int sa8d8_avx512(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    int cost = 0;
+
+    for (int y = 0; y < h; y += 8)
+    {
+        for (int x = 0; x < w; x += 16)
+        {
+            __m512i sum = sa8d8Rows(pix1 + i_pix1 * y + x, i_pix1, pix2 + i_pix2 * y + x, i_pix2, laneMask(w - x));
+            cost += (_mm512_mask_reduce_add_epi32(0x00ff, sum) + 2) >> 2;
+            if (x + 8 < w)
+                cost += (_mm512_mask_reduce_add_epi32(0xff00, sum) + 2) >> 2;
+        }
+    }
+
+    return cost;
+}
+
+template<int w, int h>
+int sa8d16_avx512(const pixel* pix1, intptr_t i_pix1, const pixel* pix2, intptr_t i_pix2)
+{
+    int cost = 0;
+
+    for (int y = 0; y < h; y += 16)
+    {
+        for (int x = 0; x < w; x += 16)
+        {
+            const pixel* p1 = pix1 + i_pix1 * y + x;
+            const pixel* p2 = pix2 + i_pix2 * y + x;
+            __m512i sum = _mm512_add_epi32(sa8d8Rows(p1, i_pix1, p2, i_pix2, 0xffff),
+                                           sa8d8Rows(p1 + 8 * i_pix1, i_pix1, p2 + 8 * i_pix2, i_pix2, 0xffff));
+            cost += (_mm512_reduce_add_epi32(sum) + 2) >> 2;
+        }
+    }
+
+    return cost;
+}
+
+/* a squared 12bit residual pair fits a 32bit madd lane, and 64 rows of them
+ * still fit the lane as an unsigned value */
+template<int w, int h>
+sse_t sse_pp_avx512(const pixel* pix1, intptr_t stride_pix1, const pixel* pix2, intptr_t stride_pix2)
+{
+    const __mmask32 mask = (__mmask32)(w >= 32 ? 0xffffffff : (1u << w) - 1);
+    __m512i sum = _mm512_setzero_si512();
+
+    for (int y = 0; y < h; y++)
+    {
+        for (int x = 0; x < w; x += 32)
+        {
+            __m512i a = _mm512_maskz_loadu_epi16(mask, pix1 + x);
+            __m512i b = _mm512_maskz_loadu_epi16(mask, pix2 + x);
+            __m512i d = _mm512_sub_epi16(a, b);
+            sum = _mm512_add_epi32(sum, _mm512_madd_epi16(d, d));
+        }
+
+        pix1 += stride_pix1;
+        pix2 += stride_pix2;
+    }
+
+    __m512i lo = _mm512_cvtepu32_epi64(_mm512_castsi512_si256(sum));
+    __m512i hi = _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(sum, 1));
+    return (sse_t)_mm512_reduce_add_epi64(_mm512_add_epi64(lo, hi));
+}
+
+/* SAO edge statistics. Each row is classified 32 pixels at a time; the lanes
+ * of each edge class are selected by a mask register which drives both the
+ * masked sum of the residuals and the masked count */
+
+enum { NUM_EDGETYPE = 5 };
+
+/* same mapping as SAO::s_eoTable */
+const int s_eoTable[NUM_EDGETYPE] = { 1, 2, 0, 3, 4 };
+
+inline int8_t signOf(int x)
+{
+    return (x >> 31) | ((int)((((uint32_t)-x)) >> 31));
+}
+
+/* sign(a - b) in 16bit lanes */
+inline __m512i signOf16(__m512i a, __m512i b)
+{
+    __m512i gt = _mm512_maskz_set1_epi16(_mm512_cmpgt_epu16_mask(a, b), 1);
+    return _mm512_mask_set1_epi16(gt, _mm512_cmplt_epu16_mask(a, b), -1);
+}
+
+inline __m512i loadUpBuff(const int8_t* upBuff, __mmask32 mask)
+{
+    return _mm512_cvtepi8_epi16(_mm256_maskz_loadu_epi8(mask, upBuff));
+}
+
+inline void storeUpBuff(int8_t* upBuff, __m512i sign, __mmask32 mask)
+{
+    _mm256_mask_storeu_epi8(upBuff, mask, _mm512_cvtepi16_epi8(_mm512_sub_epi16(_mm512_setzero_si512(), sign)));
+}
+
+struct EdgeStats
+{
+    __m512i stats[NUM_EDGETYPE];
+    __m512i count[NUM_EDGETYPE]; // 16bit lanes, a lane sees at most one pixel per row
+
+    EdgeStats()
+    {
+        for (int i = 0; i < NUM_EDGETYPE; i++)
+        {
+            stats[i] = _mm512_setzero_si512();
+            count[i] = _mm512_setzero_si512();
+        }
+    }
+
+    /* edgeType holds signs summed without the +2 bias, in [-2, 2] */
+    void add(__m512i edgeType, const int16_t* diff, __mmask32 valid)
+    {
+        const __m512i ones = _mm512_set1_epi16(1);
+        __m512i d = _mm512_maskz_loadu_epi16(valid, diff);
+
+        for (int i = 0; i < NUM_EDGETYPE; i++)
+        {
+            __mmask32 m = _mm512_mask_cmpeq_epi16_mask(valid, edgeType, _mm512_set1_epi16((int16_t)(i - 2)));
+            stats[i] = _mm512_add_epi32(stats[i], _mm512_madd_epi16(_mm512_maskz_mov_epi16(m, d), ones));
+            count[i] = _mm512_mask_add_epi16(count[i], m, count[i], ones);
+        }
+    }
+
+    void flush(int32_t* outStats, int32_t* outCount) const
+    {
+        const __m512i ones = _mm512_set1_epi16(1);
+
+        for (int i = 0; i < NUM_EDGETYPE; i++)
+        {
+            outStats[s_eoTable[i]] += _mm512_reduce_add_epi32(stats[i]);
+            outCount[s_eoTable[i]] += _mm512_reduce_add_epi32(_mm512_madd_epi16(count[i], ones));
+        }
+    }
+};
+
+inline __mmask32 colMask(int n)
+{
+    return (__mmask32)(n >= 32 ? 0xffffffff : (1u << n) - 1);
+}
+
+void saoCuStatsE0_avx512(const int16_t *diff, const pixel *rec, intptr_t stride, int endX, int endY, int32_t *stats, int32_t *count)
+{
+    X265_CHECK(endX <= MAX_CU_SIZE, "endX too big\n");
+
+    EdgeStats acc;
+
+    for (int y = 0; y < endY; y++)
+    {
+        for (int x = 0; x < endX; x += 32)
+        {
+            __mmask32 m = colMask(endX - x);
+            __m512i cur = _mm512_maskz_loadu_epi16(m, rec + x);
+            __m512i left = _mm512_maskz_loadu_epi16(m, rec + x - 1);
+            __m512i right = _mm512_maskz_loadu_epi16(m, rec + x + 1);
+            acc.add(_mm512_add_epi16(signOf16(cur, right), signOf16(cur, left)), diff + x, m);
+        }
+
+        diff += MAX_CU_SIZE;
+        rec += stride;
+    }
+
+    acc.flush(stats, count);
+}
+
+void saoCuStatsE1_avx512(const int16_t *diff, const pixel *rec, intptr_t stride, int8_t *upBuff1, int endX, int endY, int32_t *stats, int32_t *count)
+{
+    X265_CHECK(endX <= MAX_CU_SIZE, "endX check failure\n");
+    X265_CHECK(endY <= MAX_CU_SIZE, "endY check failure\n");
+
+    EdgeStats acc;
+
+    for (int y = 0; y < endY; y++)
+    {
+        for (int x = 0; x < endX; x += 32)
+        {
+            __mmask32 m = colMask(endX - x);
+            __m512i signDown = signOf16(_mm512_maskz_loadu_epi16(m, rec + x), _mm512_maskz_loadu_epi16(m, rec + x + stride));
+            acc.add(_mm512_add_epi16(signDown, loadUpBuff(upBuff1 + x, m)), diff + x, m);
+            storeUpBuff(upBuff1 + x, signDown, m);
+        }
+
+        diff += MAX_CU_SIZE;
+        rec += stride;
+    }
+
+    acc.flush(stats, count);
+}
+
+void saoCuStatsE2_avx512(const int16_t *diff, const pixel *rec, intptr_t stride, int8_t *upBuff1, int8_t *upBufft, int endX, int endY, int32_t *stats, int32_t *count)
+{
+    X265_CHECK(endX < MAX_CU_SIZE, "endX check failure\n");
+    X265_CHECK(endY < MAX_CU_SIZE, "endY check failure\n");
+
+    EdgeStats acc;
+
+    for (int y = 0; y < endY; y++)
+    {
+        upBufft[0] = (int8_t)signOf(rec[stride] - rec[-1]);
+        for (int x = 0; x < endX; x += 32)
+        {
+            __mmask32 m = colMask(endX - x);
+            __m512i signDown = signOf16(_mm512_maskz_loadu_epi16(m, rec + x), _mm512_maskz_loadu_epi16(m, rec + x + stride + 1));
+            acc.add(_mm512_add_epi16(signDown, loadUpBuff(upBuff1 + x, m)), diff + x, m);
+            storeUpBuff(upBufft + x + 1, signDown, m);
+        }
+
+        std::swap(upBuff1, upBufft);
+
+        rec += stride;
+        diff += MAX_CU_SIZE;
+    }
+
+    acc.flush(stats, count);
+}
+
+void saoCuStatsE3_avx512(const int16_t *diff, const pixel *rec, intptr_t stride, int8_t *upBuff1, int endX, int endY, int32_t *stats, int32_t *count)
+{
+    X265_CHECK(endX < MAX_CU_SIZE, "endX check failure\n");
+    X265_CHECK(endY < MAX_CU_SIZE, "endY check failure\n");
+
+    EdgeStats acc;
+
+    for (int y = 0; y < endY; y++)
+    {
+        /* the store of each block lands one entry to the left, below the
+         * entries the next block still has to read */
+        for (int x = 0; x < endX; x += 32)
+        {
+            __mmask32 m = colMask(endX - x);
+            __m512i signDown = signOf16(_mm512_maskz_loadu_epi16(m, rec + x), _mm512_maskz_loadu_epi16(m, rec + x + stride - 1));
+            acc.add(_mm512_add_epi16(signDown, loadUpBuff(upBuff1 + x, m)), diff + x, m);
+            storeUpBuff(upBuff1 + x - 1, signDown, m);
+        }
+
+        upBuff1[endX - 1] = (int8_t)signOf(rec[endX - 1 + stride] - rec[endX]);
+
+        rec += stride;
+        diff += MAX_CU_SIZE;
+    }
+
+    acc.flush(stats, count);
+}
+
+} // end anonymous namespace
+
+namespace X265_NS {
+// private x265 namespace
+
+void setupIntrinsicPixel16_avx512(EncoderPrimitives &p)
+{
+    p.pu[LUMA_16x4].satd  = satd_avx512<16, 4>;
+    p.pu[LUMA_16x12].satd = satd_avx512<16, 12>;
+    p.pu[LUMA_24x32].satd = satd_avx512<24, 32>;
+    p.chroma[X265_CSP_I420].pu[CHROMA_420_16x4].satd  = satd_avx512<16, 4>;
+    p.chroma[X265_CSP_I420].pu[CHROMA_420_16x12].satd = satd_avx512<16, 12>;
+    p.chroma[X265_CSP_I420].pu[CHROMA_420_24x32].satd = satd_avx512<24, 32>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_16x24].satd = satd_avx512<16, 24>;
+    p.chroma[X265_CSP_I422].pu[CHROMA_422_24x64].satd = satd_avx512<24, 64>;
+
+    p.cu[BLOCK_8x8].sa8d   = sa8d8_avx512<8, 8>;
+    p.cu[BLOCK_16x16].sa8d = sa8d16_avx512<16, 16>;
+    p.cu[BLOCK_32x32].sa8d = sa8d16_avx512<32, 32>;
+    p.cu[BLOCK_64x64].sa8d = sa8d16_avx512<64, 64>;
+    p.chroma[X265_CSP_I420].cu[BLOCK_16x16].sa8d = sa8d8_avx512<8, 8>;
+    p.chroma[X265_CSP_I420].cu[BLOCK_32x32].sa8d = sa8d16_avx512<16, 16>;
+    p.chroma[X265_CSP_I420].cu[BLOCK_64x64].sa8d = sa8d16_avx512<32, 32>;
+    p.chroma[X265_CSP_I422].cu[BLOCK_16x16].sa8d = sa8d8_avx512<8, 16>;
+    p.chroma[X265_CSP_I422].cu[BLOCK_32x32].sa8d = sa8d16_avx512<16, 32>;
+    p.chroma[X265_CSP_I422].cu[BLOCK_64x64].sa8d = sa8d16_avx512<32, 64>;
+
+    /* luma sse_pp is aliased to sse_ss at high bit depth, and 4:2:0 sse_pp to luma */
+    p.chroma[X265_CSP_I422].cu[BLOCK_422_8x16].sse_pp  = sse_pp_avx512<8, 16>;
+    p.chroma[X265_CSP_I422].cu[BLOCK_422_16x32].sse_pp = sse_pp_avx512<16, 32>;
+
+    p.saoCuStatsE0 = saoCuStatsE0_avx512;
+    p.saoCuStatsE1 = saoCuStatsE1_avx512;
+    p.saoCuStatsE2 = saoCuStatsE2_avx512;
+    p.saoCuStatsE3 = saoCuStatsE3_avx512;
+}
+}
+
+#endif // if HIGH_BIT_DEPTH
@@ -0,0 +1,171 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "primitives.h"
+#include <xmmintrin.h> // SSE
+#include <pmmintrin.h> // SSE3
+#include <tmmintrin.h> // SSSE3
+
+/* Input conversion of semi-planar and packed 4:2:2 pictures, see
+ * PicYuv::copyFromPicture(). Columns past the last whole vector are
+ * converted by the scalar tail of each row. The compiler vectorizes
+ * chroma_downsample_c() as well as intrinsics would */
+
+using namespace X265_NS;
+
+/* even bytes then odd bytes */
+#define SHUF_DEINTERLEAVE_8  _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15)
+/* even words then odd words */
+#define SHUF_DEINTERLEAVE_16 _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15)
+/* y0..y7 u0..u3 v0..v3 from y0 u0 y1 v0 .. or from u0 y0 v0 y1 .. */
+#define SHUF_YUYV            _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 5, 9, 13, 3, 7, 11, 15)
+#define SHUF_UYVY            _mm_setr_epi8(1, 3, 5, 7, 9, 11, 13, 15, 0, 4, 8, 12, 2, 6, 10, 14)
+
+static void planecopy_nv_cp(const uint8_t* src, intptr_t srcStride, pixel* dstU, pixel* dstV, intptr_t dstStride, int width, int height, int shift)
+{
+    const __m128i shuf = SHUF_DEINTERLEAVE_8;
+
+    for (int r = 0; r < height; r++)
+    {
+        int c = 0;
+#if HIGH_BIT_DEPTH
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vshift = _mm_cvtsi32_si128(shift);
+        for (; c + 8 <= width; c += 8)
+        {
+            __m128i uv = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * c)), shuf);
+            _mm_storeu_si128((__m128i*)(dstU + c), _mm_sll_epi16(_mm_unpacklo_epi8(uv, zero), vshift));
+            _mm_storeu_si128((__m128i*)(dstV + c), _mm_sll_epi16(_mm_unpackhi_epi8(uv, zero), vshift));
+        }
+#else
+        for (; c + 16 <= width; c += 16)
+        {
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * c)), shuf);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * c + 16)), shuf);
+            _mm_storeu_si128((__m128i*)(dstU + c), _mm_unpacklo_epi64(a, b));
+            _mm_storeu_si128((__m128i*)(dstV + c), _mm_unpackhi_epi64(a, b));
+        }
+#endif
+        for (; c < width; c++)
+        {
+            dstU[c] = ((pixel)src[2 * c]) << shift;
+            dstV[c] = ((pixel)src[2 * c + 1]) << shift;
+        }
+
+        dstU += dstStride;
+        dstV += dstStride;
+        src += srcStride;
+    }
+}
+
+static void planecopy_nv_sp(const uint16_t* src, intptr_t srcStride, pixel* dstU, pixel* dstV, intptr_t dstStride, int width, int height, int shift, uint16_t mask)
+{
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+    const __m128i vmask = _mm_set1_epi16(mask);
+
+    for (int r = 0; r < height; r++)
+    {
+        int c = 0;
+        for (; c + 8 <= width; c += 8)
+        {
+            __m128i a = _mm_and_si128(_mm_srl_epi16(_mm_loadu_si128((const __m128i*)(src + 2 * c)), vshift), vmask);
+            __m128i b = _mm_and_si128(_mm_srl_epi16(_mm_loadu_si128((const __m128i*)(src + 2 * c + 8)), vshift), vmask);
+#if HIGH_BIT_DEPTH
+            const __m128i shuf = SHUF_DEINTERLEAVE_16;
+            a = _mm_shuffle_epi8(a, shuf);
+            b = _mm_shuffle_epi8(b, shuf);
+            _mm_storeu_si128((__m128i*)(dstU + c), _mm_unpacklo_epi64(a, b));
+            _mm_storeu_si128((__m128i*)(dstV + c), _mm_unpackhi_epi64(a, b));
+#else
+            __m128i uv = _mm_shuffle_epi8(_mm_packus_epi16(a, b), SHUF_DEINTERLEAVE_8);
+            _mm_storel_epi64((__m128i*)(dstU + c), uv);
+            _mm_storel_epi64((__m128i*)(dstV + c), _mm_srli_si128(uv, 8));
+#endif
+        }
+        for (; c < width; c++)
+        {
+            dstU[c] = (pixel)((src[2 * c] >> shift) & mask);
+            dstV[c] = (pixel)((src[2 * c + 1] >> shift) & mask);
+        }
+
+        dstU += dstStride;
+        dstV += dstStride;
+        src += srcStride;
+    }
+}
+
+/* Y and C are the byte offsets of the first luma and of the u sample of a
+ * pair, as in planecopy_packed422_c() */
+template<int Y, int C>
+static void planecopy_packed422(const uint8_t* src, intptr_t srcStride, pixel* dstY, intptr_t dstStride, pixel* dstU, pixel* dstV, intptr_t dstStrideC, int width, int height)
+{
+    const __m128i shuf = Y ? SHUF_UYVY : SHUF_YUYV;
+    const int shift = X265_DEPTH - 8;
+
+    for (int r = 0; r < height; r++)
+    {
+        int c = 0;
+        for (; c + 16 <= width; c += 16)
+        {
+            /* a and b hold eight luma and four u and v samples each */
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * c)), shuf);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + 2 * c + 16)), shuf);
+#if HIGH_BIT_DEPTH
+            const __m128i zero = _mm_setzero_si128();
+            __m128i ca = _mm_slli_epi16(_mm_unpackhi_epi8(a, zero), shift);
+            __m128i cb = _mm_slli_epi16(_mm_unpackhi_epi8(b, zero), shift);
+            _mm_storeu_si128((__m128i*)(dstY + c), _mm_slli_epi16(_mm_unpacklo_epi8(a, zero), shift));
+            _mm_storeu_si128((__m128i*)(dstY + c + 8), _mm_slli_epi16(_mm_unpacklo_epi8(b, zero), shift));
+            _mm_storeu_si128((__m128i*)(dstU + (c >> 1)), _mm_unpacklo_epi64(ca, cb));
+            _mm_storeu_si128((__m128i*)(dstV + (c >> 1)), _mm_unpackhi_epi64(ca, cb));
+#else
+            __m128i uv = _mm_unpacklo_epi32(_mm_srli_si128(a, 8), _mm_srli_si128(b, 8));
+            _mm_storeu_si128((__m128i*)(dstY + c), _mm_unpacklo_epi64(a, b));
+            _mm_storel_epi64((__m128i*)(dstU + (c >> 1)), uv);
+            _mm_storel_epi64((__m128i*)(dstV + (c >> 1)), _mm_srli_si128(uv, 8));
+#endif
+        }
+        for (; c < width; c += 2)
+        {
+            const uint8_t* pair = src + 2 * c;
+            dstY[c]     = ((pixel)pair[Y]) << shift;
+            dstY[c + 1] = ((pixel)pair[Y + 2]) << shift;
+            dstU[c >> 1] = ((pixel)pair[C]) << shift;
+            dstV[c >> 1] = ((pixel)pair[C + 2]) << shift;
+        }
+
+        dstY += dstStride;
+        dstU += dstStrideC;
+        dstV += dstStrideC;
+        src += srcStride;
+    }
+}
+
+namespace X265_NS {
+void setupIntrinsicPlanecopy_ssse3(EncoderPrimitives &p)
+{
+    p.planecopy_nv_cp = planecopy_nv_cp;
+    p.planecopy_nv_sp = planecopy_nv_sp;
+    p.planecopy_yuyv = planecopy_packed422<0, 1>;
+    p.planecopy_uyvy = planecopy_packed422<1, 0>;
+}
+}
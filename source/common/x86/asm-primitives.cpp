@@ -906,6 +906,10 @@ void interp_8tap_hv_pp_cpu(const pixel* src, intptr_t srcStride, pixel* dst, int
 
 #if HIGH_BIT_DEPTH
 
+#ifdef HAVE_AVX512_INTRINSICS
+void setupIntrinsicPixel16_avx512(EncoderPrimitives&);
+#endif
+
 void setupAssemblyPrimitives(EncoderPrimitives &p, int cpuMask) // Main10
 {
 #if X86_64
@@ -3167,6 +3171,10 @@ void setupAssemblyPrimitives(EncoderPrimitives &p, int cpuMask) // Main10
         p.chroma[X265_CSP_I422].cu[BLOCK_422_32x64].sse_pp = (pixel_sse_t)PFX(pixel_ssd_32x64_avx512);
         p.planecopy_sp_shl = PFX(upShift_16_avx512);
 
+#ifdef HAVE_AVX512_INTRINSICS
+        if (!(cpuMask & X265_CPU_SLOW_AVX512))
+            setupIntrinsicPixel16_avx512(p);
+#endif
     }
 #endif
 }
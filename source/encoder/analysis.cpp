@@ -2776,6 +2776,11 @@ void Analysis::checkMerge2Nx2N_rd0_4(Mode& skip, Mode& merge, const CUGeom& cuGe
             if (candMvField[i][0].mv.y >= (m_param->searchRange + 1) * 4 ||
                 candMvField[i][1].mv.y >= (m_param->searchRange + 1) * 4)
                 continue;
+
+            if (m_param->bEnableColumnSync &&
+                (candMvField[i][0].mv.x >= (m_param->searchRange + 1) * 4 ||
+                 candMvField[i][1].mv.x >= (m_param->searchRange + 1) * 4))
+                continue;
         }
 
         if (m_param->bIntraRefresh && m_slice->m_sliceType == P_SLICE &&
@@ -2906,6 +2911,11 @@ void Analysis::checkMerge2Nx2N_rd5_6(Mode& skip, Mode& merge, const CUGeom& cuGe
             if (candMvField[i][0].mv.y >= (m_param->searchRange + 1) * 4 ||
                 candMvField[i][1].mv.y >= (m_param->searchRange + 1) * 4)
                 continue;
+
+            if (m_param->bEnableColumnSync &&
+                (candMvField[i][0].mv.x >= (m_param->searchRange + 1) * 4 ||
+                 candMvField[i][1].mv.x >= (m_param->searchRange + 1) * 4))
+                continue;
         }
 
         /* the merge candidate list is packed with MV(0,0) ref 0 when it is not full */
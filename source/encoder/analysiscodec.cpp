@@ -0,0 +1,377 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "analysiscodec.h"
+
+using namespace X265_NS;
+
+namespace {
+// file private namespace
+
+enum { PLANE_RAW, PLANE_CONSTANT, PLANE_RANS };
+enum { STREAM_DELTA_MV = 1 };
+
+#define RANS_PROB_BITS  12
+#define RANS_PROB_SCALE (1 << RANS_PROB_BITS)
+#define RANS_L          (1u << 23)
+
+/* size of a stream header and of a plane header */
+#define STREAM_HEADER_SIZE 6
+#define PLANE_HEADER_SIZE  5
+
+inline void write16(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); }
+inline void write32(uint8_t* p, uint32_t v) { write16(p, v); write16(p + 2, v >> 16); }
+inline uint32_t read16(const uint8_t* p)    { return p[0] | (p[1] << 8); }
+inline uint32_t read32(const uint8_t* p)    { return read16(p) | (read16(p + 2) << 16); }
+
+/* scale the symbol counts of n bytes to RANS_PROB_SCALE, keeping every
+ * present symbol codable */
+void normalizeFreqs(uint32_t freq[256], uint32_t n)
+{
+    uint32_t sum = 0;
+    int maxSym = -1;
+    for (int s = 0; s < 256; s++)
+    {
+        if (!freq[s])
+            continue;
+        freq[s] = X265_MAX((uint32_t)((uint64_t)freq[s] * RANS_PROB_SCALE / n), 1u);
+        sum += freq[s];
+        if (maxSym < 0 || freq[s] > freq[maxSym])
+            maxSym = s;
+    }
+    if (sum < RANS_PROB_SCALE)
+        freq[maxSym] += RANS_PROB_SCALE - sum;
+    while (sum > RANS_PROB_SCALE)
+    {
+        /* rounding up the rare symbols overshot, take from the largest */
+        int s = 0;
+        for (int i = 1; i < 256; i++)
+            if (freq[i] > freq[s])
+                s = i;
+        freq[s]--;
+        sum--;
+    }
+}
+
+/* returns the coded size, or 0 if it does not fit in outSize bytes */
+uint32_t ransEncode(const uint8_t* in, uint32_t n, uint8_t* out, uint32_t outSize)
+{
+    uint32_t freq[256], cum[256];
+    memset(freq, 0, sizeof(freq));
+    for (uint32_t i = 0; i < n; i++)
+        freq[in[i]]++;
+    normalizeFreqs(freq, n);
+
+    uint32_t numSyms = 0;
+    for (int s = 0, c = 0; s < 256; s++)
+    {
+        cum[s] = c;
+        c += freq[s];
+        numSyms += !!freq[s];
+    }
+    uint32_t tableSize = 2 + 3 * numSyms;
+    if (outSize < tableSize + 4)
+        return 0;
+    write16(out, numSyms);
+    uint8_t* p = out + 2;
+    for (int s = 0; s < 256; s++)
+    {
+        if (freq[s])
+        {
+            p[0] = (uint8_t)s;
+            write16(p + 1, freq[s]);
+            p += 3;
+        }
+    }
+
+    /* the symbols are coded in reverse, the output grows down from the end
+     * of the buffer */
+    uint8_t* body = out + tableSize;
+    uint8_t* ptr = out + outSize;
+    uint32_t x = RANS_L;
+    for (uint32_t i = n; i > 0; i--)
+    {
+        uint32_t s = in[i - 1];
+        uint32_t f = freq[s];
+        uint32_t xMax = ((RANS_L >> RANS_PROB_BITS) << 8) * f;
+        while (x >= xMax)
+        {
+            if (ptr == body)
+                return 0;
+            *--ptr = (uint8_t)x;
+            x >>= 8;
+        }
+        x = ((x / f) << RANS_PROB_BITS) + (x % f) + cum[s];
+    }
+    if (ptr - body < 4)
+        return 0;
+    ptr -= 4;
+    write32(ptr, x);
+
+    uint32_t bodySize = (uint32_t)(out + outSize - ptr);
+    memmove(body, ptr, bodySize);
+    return tableSize + bodySize;
+}
+
+bool ransDecode(const uint8_t* in, uint32_t size, uint8_t* out, uint32_t n)
+{
+    if (size < 2)
+        return false;
+    uint32_t numSyms = read16(in);
+    if (!numSyms || numSyms > 256 || size < 2 + 3 * numSyms + 4)
+        return false;
+
+    uint32_t freq[256], cum[256];
+    uint8_t slotSym[RANS_PROB_SCALE];
+    memset(freq, 0, sizeof(freq));
+    const uint8_t* p = in + 2;
+    for (uint32_t i = 0; i < numSyms; i++, p += 3)
+        freq[p[0]] = read16(p + 1);
+    uint32_t c = 0;
+    for (int s = 0; s < 256; s++)
+    {
+        cum[s] = c;
+        if (c + freq[s] > RANS_PROB_SCALE)
+            return false;
+        memset(slotSym + c, s, freq[s]);
+        c += freq[s];
+    }
+    if (c != RANS_PROB_SCALE)
+        return false;
+
+    const uint8_t* end = in + size;
+    uint32_t x = read32(p);
+    p += 4;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        uint32_t slot = x & (RANS_PROB_SCALE - 1);
+        uint32_t s = slotSym[slot];
+        out[i] = (uint8_t)s;
+        x = freq[s] * (x >> RANS_PROB_BITS) + slot - cum[s];
+        while (x < RANS_L)
+        {
+            if (p == end)
+                return false;
+            x = (x << 8) | *p++;
+        }
+    }
+    return true;
+}
+
+}
+
+bool AnalysisStreamWriter::reserve(uint32_t size)
+{
+    if (size <= m_capacity)
+        return true;
+    uint32_t capacity = X265_MAX(size, 2 * m_capacity);
+    uint8_t* buf = X265_MALLOC(uint8_t, capacity);
+    if (!buf)
+        return false;
+    if (m_size)
+        memcpy(buf, m_buf, m_size);
+    X265_FREE(m_buf);
+    m_buf = buf;
+    m_capacity = capacity;
+    return true;
+}
+
+bool AnalysisStreamWriter::put(const void* data, uint32_t elemSize, uint32_t count, bool bDeltaMV)
+{
+    uint32_t raw = elemSize * count;
+    uint32_t ransSize = count + (count >> 1) + 1024;
+    if (!reserve(m_size + STREAM_HEADER_SIZE + elemSize * (PLANE_HEADER_SIZE + count)))
+        return false;
+    if (m_tmpSize < 2 * raw + ransSize)
+    {
+        X265_FREE(m_tmp);
+        m_tmpSize = 2 * raw + ransSize;
+        m_tmp = X265_MALLOC(uint8_t, m_tmpSize);
+        if (!m_tmp)
+        {
+            m_tmpSize = 0;
+            return false;
+        }
+    }
+
+    uint8_t* out = m_buf + m_size;
+    write32(out, raw);
+    out[4] = (uint8_t)elemSize;
+    out[5] = bDeltaMV ? STREAM_DELTA_MV : 0;
+    out += STREAM_HEADER_SIZE;
+
+    /* MV residuals against the previous MV of the stream, per int16 lane */
+    const uint8_t* src = (const uint8_t*)data;
+    if (bDeltaMV)
+    {
+        X265_CHECK(!(elemSize & 1), "delta coding requires int16 lanes\n");
+        int16_t* delta = (int16_t*)m_tmp;
+        memcpy(delta, data, raw);
+        for (uint32_t i = raw / 2 - 1; i >= elemSize / 2 && i < raw / 2; i--)
+            delta[i] = (int16_t)(delta[i] - delta[i - elemSize / 2]);
+        src = m_tmp;
+    }
+
+    uint8_t* plane = m_tmp + raw;
+    uint8_t* rans = plane + raw;
+    for (uint32_t b = 0; b < elemSize; b++)
+    {
+        for (uint32_t i = 0; i < count; i++)
+            plane[i] = src[i * elemSize + b];
+
+        bool bConstant = true;
+        for (uint32_t i = 1; i < count && bConstant; i++)
+            bConstant = plane[i] == plane[0];
+
+        uint32_t coded = 0;
+        if (count && bConstant)
+        {
+            out[0] = PLANE_CONSTANT;
+            out[PLANE_HEADER_SIZE] = plane[0];
+            coded = 1;
+        }
+        else if (count && (coded = ransEncode(plane, count, rans, ransSize)) > 0 && coded < count)
+        {
+            out[0] = PLANE_RANS;
+            memcpy(out + PLANE_HEADER_SIZE, rans, coded);
+        }
+        else
+        {
+            out[0] = PLANE_RAW;
+            memcpy(out + PLANE_HEADER_SIZE, plane, count);
+            coded = count;
+        }
+        write32(out + 1, coded);
+        out += PLANE_HEADER_SIZE + coded;
+    }
+
+    m_size = (uint32_t)(out - m_buf);
+    m_blockRawBytes += raw;
+    return true;
+}
+
+bool AnalysisStreamWriter::writeBlock(FILE* file)
+{
+    uint8_t header[2 * sizeof(uint32_t)];
+    write32(header, m_blockRawBytes);
+    write32(header + 4, m_size);
+    if (fwrite(header, sizeof(header), 1, file) != 1 || fwrite(m_buf, 1, m_size, file) != m_size)
+        return false;
+    m_rawBytes += m_blockRawBytes;
+    m_codedBytes += blockSize();
+    return true;
+}
+
+bool AnalysisStreamReader::readBlock(FILE* file)
+{
+    uint8_t header[2 * sizeof(uint32_t)];
+    m_pos = m_size = 0;
+    if (fread(header, sizeof(header), 1, file) != 1)
+        return false;
+    uint32_t size = read32(header + 4);
+    if (!size)
+        return false;
+    if (size > m_capacity)
+    {
+        X265_FREE(m_buf);
+        m_buf = X265_MALLOC(uint8_t, size);
+        m_capacity = m_buf ? size : 0;
+    }
+    if (!m_buf || fread(m_buf, 1, size, file) != size)
+        return false;
+    m_size = size;
+    m_codedBytes += sizeof(header) + size;
+    return true;
+}
+
+bool AnalysisStreamReader::get(void* dst, uint32_t elemSize, uint32_t count)
+{
+    int64_t startTime = x265_mdate();
+    uint32_t raw = elemSize * count;
+    const uint8_t* in = m_buf + m_pos;
+    const uint8_t* end = m_buf + m_size;
+    if (end - in < STREAM_HEADER_SIZE || read32(in) != raw || in[4] != elemSize)
+        return false;
+    bool bDeltaMV = !!(in[5] & STREAM_DELTA_MV);
+    in += STREAM_HEADER_SIZE;
+
+    if (m_tmpSize < count)
+    {
+        X265_FREE(m_tmp);
+        m_tmp = X265_MALLOC(uint8_t, count);
+        m_tmpSize = m_tmp ? count : 0;
+        if (!m_tmp)
+            return false;
+    }
+    uint8_t* out = (uint8_t*)dst;
+    for (uint32_t b = 0; b < elemSize; b++)
+    {
+        if (end - in < PLANE_HEADER_SIZE)
+            return false;
+        uint32_t method = in[0];
+        uint32_t coded = read32(in + 1);
+        in += PLANE_HEADER_SIZE;
+        if ((uint64_t)(end - in) < coded)
+            return false;
+
+        uint8_t* plane = elemSize == 1 ? out : m_tmp;
+        if (method == PLANE_CONSTANT && coded == 1)
+            memset(plane, in[0], count);
+        else if (method == PLANE_RAW && coded == count)
+            memcpy(plane, in, count);
+        else if (method != PLANE_RANS || !ransDecode(in, coded, plane, count))
+            return false;
+        in += coded;
+
+        if (elemSize > 1)
+        {
+            for (uint32_t i = 0; i < count; i++)
+                out[i * elemSize + b] = plane[i];
+        }
+    }
+
+    if (bDeltaMV)
+    {
+        if (elemSize & 1)
+            return false;
+        int16_t lanes[8];
+        uint32_t numLanes = elemSize / 2;
+        if (numLanes > 8)
+            return false;
+        memset(lanes, 0, sizeof(lanes));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            for (uint32_t l = 0; l < numLanes; l++)
+            {
+                int16_t v;
+                memcpy(&v, out + i * elemSize + 2 * l, 2);
+                lanes[l] = (int16_t)(lanes[l] + v);
+                memcpy(out + i * elemSize + 2 * l, &lanes[l], 2);
+            }
+        }
+    }
+
+    m_pos = (uint32_t)(in - m_buf);
+    m_rawBytes += raw;
+    m_decodeTime += x265_mdate() - startTime;
+    return true;
+}
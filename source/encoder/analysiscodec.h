@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_ANALYSISCODEC_H
+#define X265_ANALYSISCODEC_H
+
+#include "common.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* Compressed analysis file streams, see --analysis-compress.
+ *
+ * A compressed analysis file starts with ANALYSIS_STREAM_MAGIC. Each frame
+ * record keeps its uncompressed header and weights, followed by one block
+ * holding the frame's analysis arrays. A block only depends on its own data
+ * so blocks of different frames can be decoded independently.
+ *
+ * Every array is coded as a stream: multi-byte elements are optionally
+ * delta coded as int16 lanes against the previous element (MVs), then split
+ * into byte planes, and each plane is coded with an order-0 static rANS
+ * coder, or stored as a single value or as raw bytes when that is smaller */
+
+#define ANALYSIS_STREAM_MAGIC "x265anlz"
+
+class AnalysisStreamWriter
+{
+public:
+
+    AnalysisStreamWriter() : m_rawBytes(0), m_codedBytes(0), m_buf(NULL), m_size(0), m_capacity(0), m_blockRawBytes(0), m_tmp(NULL), m_tmpSize(0) {}
+    ~AnalysisStreamWriter() { X265_FREE(m_buf); X265_FREE(m_tmp); }
+
+    /* starts a new block */
+    void     reset() { m_size = m_blockRawBytes = 0; }
+
+    /* append a stream of count elements of elemSize bytes to the block */
+    bool     put(const void* data, uint32_t elemSize, uint32_t count, bool bDeltaMV);
+
+    /* size of the block, with its header, and block write */
+    uint32_t blockSize() const { return 2 * sizeof(uint32_t) + m_size; }
+    bool     writeBlock(FILE* file);
+
+    uint64_t m_rawBytes;         // totals over all the streams
+    uint64_t m_codedBytes;
+
+protected:
+
+    uint8_t* m_buf;
+    uint32_t m_size;
+    uint32_t m_capacity;
+    uint32_t m_blockRawBytes;
+    uint8_t* m_tmp;              // byte plane and rANS scratch buffers
+    uint32_t m_tmpSize;
+
+    bool     reserve(uint32_t size);
+};
+
+class AnalysisStreamReader
+{
+public:
+
+    AnalysisStreamReader() : m_rawBytes(0), m_codedBytes(0), m_decodeTime(0), m_buf(NULL), m_capacity(0), m_pos(0), m_size(0), m_tmp(NULL), m_tmpSize(0) {}
+    ~AnalysisStreamReader() { X265_FREE(m_buf); X265_FREE(m_tmp); }
+
+    /* reads a block from the file, the following get() calls decode its
+     * streams in order */
+    bool     readBlock(FILE* file);
+    bool     isActive() const { return m_size > 0; }
+    void     reset()          { m_pos = m_size = 0; }
+
+    /* decodes the next stream, its size must be count elements of elemSize */
+    bool     get(void* dst, uint32_t elemSize, uint32_t count);
+
+    uint64_t m_rawBytes;         // totals over all the blocks
+    uint64_t m_codedBytes;
+    int64_t  m_decodeTime;
+
+protected:
+
+    uint8_t* m_buf;
+    uint32_t m_capacity;
+    uint32_t m_pos;
+    uint32_t m_size;
+    uint8_t* m_tmp;
+    uint32_t m_tmpSize;
+};
+}
+
+#endif // ifndef X265_ANALYSISCODEC_H
@@ -0,0 +1,212 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "analysisfile.h"
+
+using namespace X265_NS;
+
+static inline uint64_t alignSize(uint64_t size)
+{
+    return (size + ANALYSIS_FILE_ALIGN - 1) & ~(uint64_t)(ANALYSIS_FILE_ALIGN - 1);
+}
+
+AnalysisFile::AnalysisFile()
+{
+    m_file = NULL;
+    m_offset = 0;
+    memset(&m_header, 0, sizeof(m_header));
+    m_index = NULL;
+    m_indexSize = 0;
+    m_data = NULL;
+    m_size = 0;
+    m_pocMap = NULL;
+    m_pocMapSize = 0;
+}
+
+bool AnalysisFile::create(const char* fileName, const x265_analysis_validate& params)
+{
+    m_file = x265_fopen(fileName, "wb");
+    if (!m_file)
+        return false;
+
+    memcpy(m_header.magic, ANALYSIS_FILE_MAGIC, sizeof(m_header.magic));
+    m_header.version = ANALYSIS_FILE_VERSION;
+    m_header.headerSize = sizeof(AnalysisFileHeader);
+    m_header.recordHeaderSize = sizeof(AnalysisFrameRecord);
+    m_header.params = params;
+
+    /* the header is rewritten by finish() once the index location is known */
+    return writePadded(&m_header, sizeof(m_header));
+}
+
+bool AnalysisFile::writePadded(const void* data, uint64_t size)
+{
+    static const uint8_t zeros[ANALYSIS_FILE_ALIGN] = { 0 };
+    uint64_t padding = alignSize(size) - size;
+
+    if (fwrite(data, 1, (size_t)size, m_file) != size || fwrite(zeros, 1, (size_t)padding, m_file) != padding)
+        return false;
+    m_offset += size + padding;
+    return true;
+}
+
+bool AnalysisFile::writeFrame(AnalysisFrameRecord& record, const void* const sections[AS_COUNT])
+{
+    if (m_header.numFrames == m_indexSize)
+    {
+        uint32_t size = X265_MAX(2 * m_indexSize, 64);
+        AnalysisIndexEntry* index = X265_MALLOC(AnalysisIndexEntry, size);
+        if (!index)
+            return false;
+        if (m_index)
+            memcpy(index, m_index, m_indexSize * sizeof(AnalysisIndexEntry));
+        X265_FREE(m_index);
+        m_index = index;
+        m_indexSize = size;
+    }
+    AnalysisIndexEntry& entry = m_index[m_header.numFrames++];
+    entry.poc = record.poc;
+    entry.sliceType = record.sliceType;
+    entry.offset = m_offset;
+
+    uint64_t offset = alignSize(sizeof(AnalysisFrameRecord));
+    for (int i = 0; i < AS_COUNT; i++)
+    {
+        if (!sections[i] || !record.sectionSize[i])
+        {
+            record.sectionOffset[i] = 0;
+            record.sectionSize[i] = 0;
+            continue;
+        }
+        record.sectionOffset[i] = offset;
+        offset += alignSize(record.sectionSize[i]);
+    }
+    record.recordSize = (uint32_t)offset;
+
+    if (!writePadded(&record, sizeof(record)))
+        return false;
+    for (int i = 0; i < AS_COUNT; i++)
+    {
+        if (record.sectionOffset[i] && !writePadded(sections[i], record.sectionSize[i]))
+            return false;
+    }
+    return true;
+}
+
+bool AnalysisFile::finish()
+{
+    bool bOk = !!m_file;
+
+    if (bOk)
+    {
+        m_header.indexOffset = m_offset;
+        bOk = (!m_header.numFrames || writePadded(m_index, m_header.numFrames * sizeof(AnalysisIndexEntry))) &&
+              !fseeko(m_file, 0, SEEK_SET) &&
+              fwrite(&m_header, sizeof(m_header), 1, m_file) == 1;
+    }
+    if (m_file && fclose(m_file))
+        bOk = false;
+    m_file = NULL;
+    X265_FREE(m_index);
+    m_index = NULL;
+    m_indexSize = 0;
+    return bOk;
+}
+
+bool AnalysisFile::open(const char* fileName)
+{
+    m_data = (uint8_t*)x265_map_file(fileName, &m_size);
+    if (!m_data)
+        return false;
+
+    /* validate the header and the index before handing out any pointer */
+    const AnalysisFileHeader* hdr = header();
+    if (m_size < sizeof(AnalysisFileHeader) || memcmp(hdr->magic, ANALYSIS_FILE_MAGIC, sizeof(hdr->magic)) ||
+        hdr->version != ANALYSIS_FILE_VERSION || hdr->headerSize != sizeof(AnalysisFileHeader) ||
+        hdr->recordHeaderSize != sizeof(AnalysisFrameRecord) || hdr->indexOffset > m_size ||
+        (m_size - hdr->indexOffset) / sizeof(AnalysisIndexEntry) < hdr->numFrames)
+    {
+        close();
+        return false;
+    }
+
+    const AnalysisIndexEntry* index = (const AnalysisIndexEntry*)(m_data + hdr->indexOffset);
+    uint32_t maxPoc = 0;
+    for (uint32_t i = 0; i < hdr->numFrames; i++)
+    {
+        const AnalysisFrameRecord* record = (const AnalysisFrameRecord*)(m_data + index[i].offset);
+        bool bValid = !(index[i].offset & (ANALYSIS_FILE_ALIGN - 1)) && index[i].offset <= hdr->indexOffset &&
+                      hdr->indexOffset - index[i].offset >= sizeof(AnalysisFrameRecord) &&
+                      record->recordSize <= hdr->indexOffset - index[i].offset && record->poc == index[i].poc;
+        for (int s = 0; bValid && s < AS_COUNT; s++)
+            bValid = record->sectionOffset[s] <= record->recordSize && record->sectionSize[s] <= record->recordSize - record->sectionOffset[s];
+        if (!bValid)
+        {
+            close();
+            return false;
+        }
+        maxPoc = X265_MAX(maxPoc, index[i].poc);
+    }
+
+    if (hdr->numFrames)
+    {
+        m_pocMapSize = maxPoc + 1;
+        m_pocMap = X265_MALLOC(uint32_t, m_pocMapSize);
+        if (!m_pocMap)
+        {
+            close();
+            return false;
+        }
+        memset(m_pocMap, 0xff, m_pocMapSize * sizeof(uint32_t));
+        for (uint32_t i = 0; i < hdr->numFrames; i++)
+            m_pocMap[index[i].poc] = i;
+    }
+    return true;
+}
+
+const AnalysisFrameRecord* AnalysisFile::findFrame(uint32_t poc) const
+{
+    if (poc >= m_pocMapSize || m_pocMap[poc] == (uint32_t)-1)
+        return NULL;
+
+    const AnalysisIndexEntry* index = (const AnalysisIndexEntry*)(m_data + header()->indexOffset);
+    return (const AnalysisFrameRecord*)(m_data + index[m_pocMap[poc]].offset);
+}
+
+void* AnalysisFile::section(const AnalysisFrameRecord* record, int id, uint64_t size) const
+{
+    if (!record->sectionOffset[id] || record->sectionSize[id] != size)
+        return NULL;
+    return (uint8_t*)record + record->sectionOffset[id];
+}
+
+void AnalysisFile::close()
+{
+    if (m_file)
+        finish();
+    x265_unmap_file(m_data, m_size);
+    m_data = NULL;
+    m_size = 0;
+    X265_FREE(m_pocMap);
+    m_pocMap = NULL;
+    m_pocMapSize = 0;
+}
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_ANALYSISFILE_H
+#define X265_ANALYSISFILE_H
+
+#include "common.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* Indexed analysis file, see --analysis-mmap.
+ *
+ * The file starts with an AnalysisFileHeader, followed by one record per
+ * frame in encode order and by the frame index. Each record is an
+ * AnalysisFrameRecord followed by its sections, which hold the analysis
+ * arrays already expanded to one entry per 4x4 partition, exactly as they
+ * are consumed by the analysis load encoder. Records and sections are
+ * aligned to ANALYSIS_FILE_ALIGN bytes, so once the file is memory mapped
+ * the x265_analysis_data arrays can point directly into the mapping and
+ * several encoders loading the same file share its page cache */
+
+#define ANALYSIS_FILE_MAGIC   "x265anix"
+#define ANALYSIS_FILE_VERSION 1
+#define ANALYSIS_FILE_ALIGN   64
+
+enum AnalysisSection
+{
+    AS_WEIGHTS,       // WeightParam[numPlanes * numDir]
+    AS_DEPTH,         // uint8_t per partition
+    AS_MODES,         // uint8_t per partition, predMode
+    AS_PART_SIZE,     // uint8_t per partition
+    AS_MERGE_FLAG,    // uint8_t per partition
+    AS_INTER_DIR,     // uint8_t per partition
+    AS_MVP_IDX,       // uint8_t per partition, two sections (one per list)
+    AS_REF_IDX = AS_MVP_IDX + 2, // int8_t per partition, two sections
+    AS_MV = AS_REF_IDX + 2,      // MV per partition, two sections
+    AS_REF = AS_MV + 2,          // int32_t[X265_MAX_PRED_MODE_PER_CTU * numDir] per CTU
+    AS_LUMA_MODES,    // uint8_t per partition
+    AS_CHROMA_MODES,  // uint8_t per partition
+    AS_COUNT
+};
+
+struct AnalysisFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordHeaderSize;
+    uint32_t numFrames;
+    uint64_t indexOffset;
+    x265_analysis_validate params;
+};
+
+struct AnalysisFrameRecord
+{
+    int64_t  satdCost;
+    uint32_t poc;
+    uint32_t sliceType;
+    uint32_t numCUsInFrame;
+    uint32_t numPartitions;
+    int32_t  bScenecut;
+    uint32_t recordSize;
+    uint64_t sectionOffset[AS_COUNT]; // from the start of the record, 0 if absent
+    uint64_t sectionSize[AS_COUNT];
+};
+
+struct AnalysisIndexEntry
+{
+    uint32_t poc;
+    uint32_t sliceType;
+    uint64_t offset;
+};
+
+class AnalysisFile
+{
+public:
+
+    AnalysisFile();
+    ~AnalysisFile() { close(); }
+
+    /* writer, frames are appended and the index is written by finish() */
+    bool create(const char* fileName, const x265_analysis_validate& params);
+    bool writeFrame(AnalysisFrameRecord& record, const void* const sections[AS_COUNT]);
+    bool finish();
+
+    /* reader, maps the whole file copy-on-write */
+    bool open(const char* fileName);
+    const AnalysisFileHeader* header() const { return (const AnalysisFileHeader*)m_data; }
+    const AnalysisFrameRecord* findFrame(uint32_t poc) const;
+
+    /* returns the section data, or NULL if the section is absent or its size
+     * is not the expected one */
+    void* section(const AnalysisFrameRecord* record, int id, uint64_t size) const;
+
+    /* true if ptr points within the mapping, i.e. must not be freed */
+    bool  contains(const void* ptr) const { return m_data && (const uint8_t*)ptr >= m_data && (const uint8_t*)ptr < m_data + m_size; }
+
+    void  close();
+
+protected:
+
+    /* writer state */
+    FILE*               m_file;
+    uint64_t            m_offset;
+    AnalysisFileHeader  m_header;
+    AnalysisIndexEntry* m_index;
+    uint32_t            m_indexSize;
+
+    /* reader state */
+    uint8_t*            m_data;
+    uint64_t            m_size;
+    uint32_t*           m_pocMap;    // poc -> index entry, or -1
+    uint32_t            m_pocMapSize;
+
+    bool writePadded(const void* data, uint64_t size);
+};
+}
+
+#endif // ifndef X265_ANALYSISFILE_H
@@ -23,9 +23,11 @@
 
 #include "common.h"
 #include "bitstream.h"
+#include "threadpool.h"
 #include "param.h"
 
 #include "encoder.h"
+#include "asyncencoder.h"
 #include "entropy.h"
 #include "level.h"
 #include "nal.h"
@@ -146,6 +148,8 @@ x265_encoder *x265_encoder_open(x265_param *p)
     return encoder;
 
 fail:
+    if (encoder)
+        encoder->detachThreadPool();
     delete encoder;
     PARAM_NS::x265_param_free(param);
     PARAM_NS::x265_param_free(latestParam);
@@ -254,11 +258,9 @@ int x265_encoder_reconfig(x265_encoder* enc, x265_param* param_in)
     return ret;
 }
 
-int x265_encoder_encode(x265_encoder *enc, x265_nal **pp_nal, uint32_t *pi_nal, x265_picture *pic_in, x265_picture *pic_out)
+/* synchronous encode call, also used by the thread of asynchronous encoders */
+static int encodePicture(x265_encoder *enc, x265_nal **pp_nal, uint32_t *pi_nal, x265_picture *pic_in, x265_picture *pic_out)
 {
-    if (!enc)
-        return -1;
-
     Encoder *encoder = static_cast<Encoder*>(enc);
     int numEncoded;
 
@@ -298,6 +300,67 @@ int x265_encoder_encode(x265_encoder *enc, x265_nal **pp_nal, uint32_t *pi_nal,
     return numEncoded;
 }
 
+int x265_encoder_encode(x265_encoder *enc, x265_nal **pp_nal, uint32_t *pi_nal, x265_picture *pic_in, x265_picture *pic_out)
+{
+    if (!enc)
+        return -1;
+
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    if (encoder->m_async)
+    {
+        x265_log(encoder->m_param, X265_LOG_ERROR, "asynchronous encoders take their pictures from x265_encoder_submit()\n");
+        return -1;
+    }
+
+    return encodePicture(enc, pp_nal, pi_nal, pic_in, pic_out);
+}
+
+int x265_encoder_async_start(x265_encoder *enc, int queueSize, x265_async_callback callback, void* opaque)
+{
+    if (!enc || !callback || queueSize < 1)
+        return -1;
+
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    if (encoder->m_async || encoder->m_pocLast >= 0)
+        return -1;
+
+    AsyncEncoder* async = new AsyncEncoder(enc, encodePicture, !!encoder->m_param->bCopyPicToFrame);
+    if (!async->start(queueSize, callback, opaque))
+    {
+        x265_log(encoder->m_param, X265_LOG_ERROR, "unable to start the asynchronous encoder thread\n");
+        delete async;
+        return -1;
+    }
+    encoder->m_async = async;
+    return 0;
+}
+
+int x265_encoder_submit(x265_encoder *enc, x265_picture *pic_in)
+{
+    if (!enc)
+        return -1;
+
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    if (!encoder->m_async)
+        return -1;
+
+    return encoder->m_async->submit(pic_in);
+}
+
+int x265_encoder_slice_output(x265_encoder *enc, x265_nal_callback callback, void* opaque)
+{
+    if (!enc)
+        return -1;
+
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    if (encoder->m_pocLast >= 0)
+        return -1;
+
+    encoder->m_sliceOutput = callback;
+    encoder->m_sliceOutputOpaque = opaque;
+    return 0;
+}
+
 void x265_encoder_get_stats(x265_encoder *enc, x265_stats *outputStats, uint32_t statsSizeBytes)
 {
     if (enc && outputStats)
@@ -347,6 +410,12 @@ void x265_encoder_close(x265_encoder *enc)
     {
         Encoder *encoder = static_cast<Encoder*>(enc);
 
+        if (encoder->m_async)
+        {
+            encoder->m_async->stop();
+            delete encoder->m_async;
+            encoder->m_async = NULL;
+        }
         encoder->stopJobs();
         encoder->printSummary();
         encoder->destroy();
@@ -403,6 +472,38 @@ int x265_set_analysis_data(x265_encoder *enc, x265_analysis_data *analysis_data,
     return -1;
 }
 
+x265_threadpool* x265_threadpool_create(x265_param *p)
+{
+    if (!p)
+        return NULL;
+
+    return SharedThreadPool::create(p);
+}
+
+int x265_threadpool_free(x265_threadpool *pool)
+{
+    if (!pool)
+        return 0;
+
+    SharedThreadPool* shared = static_cast<SharedThreadPool*>(pool);
+    if (!shared->destroy())
+    {
+        x265_log(NULL, X265_LOG_ERROR, "thread pool not released, encoders are still using it\n");
+        return -1;
+    }
+    return 0;
+}
+
+int x265_encoder_input_layout(x265_encoder *enc, int stride[3], int offset[3], int size[3])
+{
+    if (!enc || !stride || !offset || !size)
+        return -1;
+
+    Encoder *encoder = static_cast<Encoder*>(enc);
+    encoder->inputLayout(stride, offset, size);
+    return 0;
+}
+
 void x265_cleanup(void)
 {
     BitCost::destroy();
@@ -486,8 +587,14 @@ static const x265_api libapi =
 #if ENABLE_LIBVMAF
     &x265_calculate_vmafscore,
     &x265_calculate_vmaf_framelevelscore,
-    &x265_vmaf_encoder_log
+    &x265_vmaf_encoder_log,
 #endif
+    &x265_threadpool_create,
+    &x265_threadpool_free,
+    &x265_encoder_input_layout,
+    &x265_encoder_async_start,
+    &x265_encoder_submit,
+    &x265_encoder_slice_output,
 
 };
 
@@ -781,7 +888,7 @@ FILE* x265_csvlog_open(const x265_param* param)
 
                     /* detailed performance statistics */
                     fprintf(csvfp, ", DecideWait (ms), Row0Wait (ms), Wall time (ms), Ref Wait Wall (ms), Total CTU time (ms),"
-                        "Stall Time (ms), Total frame time (ms), Avg WPP, Row Blocks");
+                        "Stall Time (ms), Total frame time (ms), Avg WPP, Row Blocks, Lookahead In, Lookahead Out");
 #if ENABLE_LIBVMAF
                     fprintf(csvfp, ", VMAF Frame Score");
 #endif
@@ -905,6 +1012,7 @@ void x265_csvlog_frame(const x265_param* param, const x265_picture* pic)
                                                                                      frameStats->totalFrameTime);
 
         fprintf(param->csvfpt, " %.3lf, %d", frameStats->avgWPP, frameStats->countRowBlocks);
+        fprintf(param->csvfpt, ", %d, %d", frameStats->lookaheadInputDepth, frameStats->lookaheadOutputDepth);
 #if ENABLE_LIBVMAF
         fprintf(param->csvfpt, ", %lf", frameStats->vmafFrameScore);
 #endif
@@ -1096,6 +1204,12 @@ void x265_dither_image(x265_picture* picIn, int picWidth, int picHeight, int16_t
         return;
     }
 
+    if (picIn->colorSpace < 0 || picIn->colorSpace >= X265_CSP_COUNT)
+    {
+        fprintf(stderr, "extras [error]: dither support enabled only for planar color spaces\n");
+        return;
+    }
+
     /* This portion of code is from readFrame in x264. */
     for (int i = 0; i < x265_cli_csps[picIn->colorSpace].planes; i++)
     {
@@ -0,0 +1,160 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "asyncencoder.h"
+
+using namespace X265_NS;
+
+static void releasePlanes(x265_picture& pic)
+{
+    if (pic.planesRelease)
+        pic.planesRelease(pic.planesOpaque, pic.planes);
+}
+
+AsyncEncoder::AsyncEncoder(x265_encoder* encoder, EncodeCall encode, bool bCopyPlanes)
+{
+    m_encoder = encoder;
+    m_encode = encode;
+    m_callback = NULL;
+    m_opaque = NULL;
+    m_bCopyPlanes = bCopyPlanes;
+    m_queue = NULL;
+    m_queueSize = 0;
+    m_head = 0;
+    m_count = 0;
+    m_bFlush = false;
+    m_bRefused = false;
+    m_bClosed = false;
+    m_bStop = false;
+}
+
+bool AsyncEncoder::start(int queueSize, x265_async_callback callback, void* opaque)
+{
+    m_queue = X265_MALLOC(x265_picture, queueSize);
+    if (!m_queue)
+        return false;
+    m_queueSize = queueSize;
+    m_callback = callback;
+    m_opaque = opaque;
+    return Thread::start();
+}
+
+int AsyncEncoder::submit(const x265_picture* pic)
+{
+    int ret = 1;
+
+    m_lock.acquire();
+    if (m_bClosed)
+        ret = -1;
+    else if (!pic)
+        m_bFlush = m_bClosed = true;
+    else if (m_count == m_queueSize)
+    {
+        m_bRefused = true;
+        ret = 0;
+    }
+    else
+        m_queue[(m_head + m_count++) % m_queueSize] = *pic;
+    m_lock.release();
+
+    if (ret > 0)
+        m_wake.trigger();
+    return ret;
+}
+
+void AsyncEncoder::stop()
+{
+    m_lock.acquire();
+    m_bStop = m_bClosed = true;
+    m_lock.release();
+    m_wake.trigger();
+    Thread::stop();
+
+    /* the encoder never saw these pictures */
+    for (; m_count; m_count--, m_head = (m_head + 1) % m_queueSize)
+        releasePlanes(m_queue[m_head]);
+}
+
+void AsyncEncoder::threadMain()
+{
+    THREAD_NAME("Async", 0);
+
+    x265_picture picOut;
+
+    for (;;)
+    {
+        x265_picture picIn;
+        bool bPicture = false;
+        bool bFlush = false;
+        bool bReady = false;
+
+        m_lock.acquire();
+        if (m_bStop)
+        {
+            m_lock.release();
+            return;
+        }
+        if (m_count)
+        {
+            picIn = m_queue[m_head];
+            m_head = (m_head + 1) % m_queueSize;
+            m_count--;
+            bPicture = true;
+            bReady = m_bRefused;
+            m_bRefused = false;
+        }
+        else
+            bFlush = m_bFlush;
+        m_lock.release();
+
+        if (!bPicture && !bFlush)
+        {
+            m_wake.wait();
+            continue;
+        }
+
+        /* the queue has room again, let the application refill it while we
+         * encode */
+        if (bReady)
+            m_callback(m_opaque, X265_ASYNC_READY, NULL, 0, NULL);
+
+        x265_nal* nal = NULL;
+        uint32_t numNal = 0;
+        int ret = m_encode(m_encoder, &nal, &numNal, bPicture ? &picIn : NULL, &picOut);
+
+        /* zero-copy planes are released by the encoder once it is done with
+         * the frame, copied planes as soon as they are consumed */
+        if (bPicture && m_bCopyPlanes)
+            releasePlanes(picIn);
+
+        if (ret > 0)
+            m_callback(m_opaque, X265_ASYNC_OUTPUT, nal, numNal, &picOut);
+        else if (ret < 0 || bFlush)
+        {
+            m_lock.acquire();
+            m_bClosed = true;
+            m_lock.release();
+            m_callback(m_opaque, ret < 0 ? X265_ASYNC_ERROR : X265_ASYNC_FLUSHED, NULL, 0, NULL);
+            return;
+        }
+    }
+}
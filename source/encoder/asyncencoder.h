@@ -0,0 +1,84 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_ASYNCENCODER_H
+#define X265_ASYNCENCODER_H
+
+#include "common.h"
+#include "threading.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* Asynchronous encode, see x265_encoder_async_start().
+ *
+ * The application queues pictures without blocking and receives the NALs
+ * of the output pictures through a callback. A pump thread owned by the
+ * encoder feeds the queued pictures to the synchronous encode call, which
+ * blocks on the frame encoders while the pipeline is full, and runs the
+ * callbacks. Callbacks are serialized with the encode calls so they may use
+ * the other x265_encoder functions, except encode and close */
+
+typedef int (*EncodeCall)(x265_encoder*, x265_nal**, uint32_t*, x265_picture*, x265_picture*);
+
+class AsyncEncoder : public Thread
+{
+public:
+
+    AsyncEncoder(x265_encoder* encoder, EncodeCall encode, bool bCopyPlanes);
+    ~AsyncEncoder() { X265_FREE(m_queue); }
+
+    bool start(int queueSize, x265_async_callback callback, void* opaque);
+
+    /* queues a picture, or the flush of the encoder if pic is NULL. Returns 1
+     * if queued, 0 if the queue is full (X265_ASYNC_READY follows) and -1 once
+     * flushed or aborted */
+    int  submit(const x265_picture* pic);
+
+    /* stops the pump thread after its current encode call and releases the
+     * planes of the pictures left in the queue */
+    void stop();
+
+protected:
+
+    x265_encoder*       m_encoder;
+    EncodeCall          m_encode;
+    x265_async_callback m_callback;
+    void*               m_opaque;
+    bool                m_bCopyPlanes;  // planes are released once the encoder copied them
+
+    x265_picture*       m_queue;
+    int                 m_queueSize;
+    int                 m_head;
+    int                 m_count;
+    bool                m_bFlush;       // flush requested behind the queued pictures
+    bool                m_bRefused;     // a submit was refused since the last picture was taken
+    bool                m_bClosed;      // flushed or aborted, submits fail
+    bool                m_bStop;
+
+    Lock                m_lock;
+    Event               m_wake;
+
+    void threadMain();
+};
+}
+
+#endif // ifndef X265_ASYNCENCODER_H
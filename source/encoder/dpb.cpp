@@ -73,6 +73,7 @@ void DPB::recycleUnreferenced()
         if (!curFrame->m_encData->m_bHasReferences && !curFrame->m_countRefEncoders)
         {
             curFrame->m_bChromaExtended = false;
+            curFrame->releasePlanes();
 
             // Reset column counter
             X265_CHECK(curFrame->m_reconRowFlag != NULL, "curFrame->m_reconRowFlag check failure");
@@ -37,6 +37,8 @@
 #include "ratecontrol.h"
 #include "dpb.h"
 #include "nal.h"
+#include "analysisfile.h"
+#include "analysiscodec.h"
 
 #include "x265.h"
 
@@ -72,13 +74,22 @@ Encoder::Encoder()
     m_rateControl = NULL;
     m_dpb = NULL;
     m_exportedPic = NULL;
+    m_async = NULL;
+    m_sliceOutput = NULL;
+    m_sliceOutputOpaque = NULL;
     m_numDelayedPic = 0;
     m_outputCount = 0;
     m_param = NULL;
     m_latestParam = NULL;
     m_threadPool = NULL;
+    m_sharedPool = NULL;
+    m_poolShare = NULL;
     m_analysisFileIn = NULL;
     m_analysisFileOut = NULL;
+    m_analysisIndexIn = NULL;
+    m_analysisIndexOut = NULL;
+    m_analysisStreamsIn = NULL;
+    m_analysisStreamsOut = NULL;
     m_offsetEmergency = NULL;
     m_iFrameNum = 0;
     m_iPPSQpMinus26 = 0;
@@ -140,9 +151,25 @@ void Encoder::create()
         allowPools = false;
 
     m_numPools = 0;
-    if (allowPools)
-        m_threadPool = ThreadPool::allocThreadPools(p, m_numPools, 0);
-    else
+    if (allowPools && p->threadPool)
+    {
+        SharedThreadPool* shared = static_cast<SharedThreadPool*>(p->threadPool);
+        m_poolShare = shared->attach(p->poolWeight);
+        if (m_poolShare)
+        {
+            m_sharedPool = shared;
+            m_threadPool = shared->m_pools;
+            m_numPools = shared->m_numPools;
+            if (!p->frameNumThreads)
+                ThreadPool::getFrameThreadsCount(p, shared->m_numWorkers);
+        }
+        else
+            x265_log(p, X265_LOG_WARNING, "%d encoders already share the thread pool, allocating private pools\n", MAX_POOL_SHARES);
+    }
+
+    if (allowPools && !m_sharedPool)
+        m_threadPool = ThreadPool::allocThreadPools(p, m_numPools, 0, false);
+    else if (!allowPools)
     {
         if (!p->frameNumThreads)
         {
@@ -181,6 +208,12 @@ void Encoder::create()
     if (!len)
         strcpy(buf, "none");
 
+    if (p->bEnableColumnSync && (p->frameNumThreads <= 1 || p->maxSlices > 1 || p->searchMethod == X265_SEA))
+    {
+        x265_log(p, X265_LOG_WARNING, "--column-sync requires frame threads and is not compatible with --slices or --me sea, disabled\n");
+        p->bEnableColumnSync = 0;
+    }
+
     x265_log(p, X265_LOG_INFO, "frame threads / pool features       : %d / %s\n", p->frameNumThreads, buf);
 
     for (int i = 0; i < m_param->frameNumThreads; i++)
@@ -189,7 +222,18 @@ void Encoder::create()
         m_frameEncoder[i]->m_nalList.m_annexB = !!m_param->bAnnexB;
     }
 
-    if (m_numPools)
+    if (m_sharedPool)
+    {
+        /* the pools are running, frame encoders ids are our own providers
+         * count in their pool */
+        for (int i = 0; i < m_param->frameNumThreads; i++)
+        {
+            int pool = (m_poolShare->m_firstPool + i) % m_numPools;
+            m_frameEncoder[i]->m_jpId = numPoolProviders(&m_threadPool[pool]);
+            m_sharedPool->addProvider(m_threadPool[pool], *m_frameEncoder[i], m_poolShare);
+        }
+    }
+    else if (m_numPools)
     {
         for (int i = 0; i < m_param->frameNumThreads; i++)
         {
@@ -222,19 +266,24 @@ void Encoder::create()
         m_aborted = true;
     int pools = m_numPools;
     ThreadPool* lookAheadThreadPool = 0;
-    if (m_param->lookaheadThreads > 0)
+    if (m_param->lookaheadThreads > 0 && !m_sharedPool)
     {
-        lookAheadThreadPool = ThreadPool::allocThreadPools(p, pools, 1);
+        lookAheadThreadPool = ThreadPool::allocThreadPools(p, pools, 1, false);
     }
     else
         lookAheadThreadPool = m_threadPool;
     m_lookahead = new Lookahead(m_param, lookAheadThreadPool);
-    if (pools)
+    if (m_sharedPool)
+    {
+        m_lookahead->m_jpId = numPoolProviders(&lookAheadThreadPool[0]);
+        m_sharedPool->addProvider(lookAheadThreadPool[0], *m_lookahead, m_poolShare);
+    }
+    else if (pools)
     {
         m_lookahead->m_jpId = lookAheadThreadPool[0].m_numProviders++;
         lookAheadThreadPool[0].m_jpTable[m_lookahead->m_jpId] = m_lookahead;
     }
-    if (m_param->lookaheadThreads > 0)
+    if (m_param->lookaheadThreads > 0 && !m_sharedPool)
         for (int i = 0; i < pools; i++)
             lookAheadThreadPool[i].start();
     m_lookahead->m_numPools = pools;
@@ -351,25 +400,99 @@ void Encoder::create()
         char* temp = strcatFilename(m_param->analysisSave, ".temp");
         if (!temp)
             m_aborted = true;
+        else if (m_param->bAnalysisMmap)
+        {
+            x265_analysis_validate params;
+            params.maxNumReferences = m_param->maxNumReferences;
+            params.analysisReuseLevel = m_param->analysisReuseLevel;
+            params.scaleFactor = m_param->scaleFactor;
+            params.keyframeMax = m_param->keyframeMax;
+            params.keyframeMin = m_param->keyframeMin;
+            params.openGOP = m_param->bOpenGOP;
+            params.bframes = m_param->bframes;
+            params.bPyramid = m_param->bBPyramid;
+            params.maxCUSize = m_param->maxCUSize;
+            params.minCUSize = m_param->minCUSize;
+            params.radl = m_param->radl;
+            params.lookaheadDepth = m_param->lookaheadDepth;
+            params.gopLookahead = m_param->gopLookahead;
+            m_analysisIndexOut = new AnalysisFile;
+            if (!m_analysisIndexOut->create(temp, params))
+            {
+                delete m_analysisIndexOut;
+                m_analysisIndexOut = NULL;
+            }
+            X265_FREE(temp);
+        }
         else
         {
             m_analysisFileOut = x265_fopen(temp, "wb");
             X265_FREE(temp);
+            if (m_analysisFileOut && m_param->bAnalysisCompress)
+            {
+                m_analysisStreamsOut = new AnalysisStreamWriter;
+                if (fwrite(ANALYSIS_STREAM_MAGIC, sizeof(ANALYSIS_STREAM_MAGIC) - 1, 1, m_analysisFileOut) != 1)
+                {
+                    fclose(m_analysisFileOut);
+                    m_analysisFileOut = NULL;
+                }
+            }
         }
-        if (!m_analysisFileOut)
+        if (!m_analysisFileOut && !m_analysisIndexOut)
         {
             x265_log_file(NULL, X265_LOG_ERROR, "Analysis save: failed to open file %s.temp\n", m_param->analysisSave);
             m_aborted = true;
         }
     }
-    if (m_param->analysisLoad && m_param->bUseAnalysisFile)
+    if (m_param->analysisLoad && m_param->bUseAnalysisFile && m_param->bAnalysisMmap)
+    {
+        m_analysisIndexIn = new AnalysisFile;
+        if (!m_analysisIndexIn->open(m_param->analysisLoad))
+        {
+            x265_log_file(NULL, X265_LOG_ERROR, "Analysis load: %s is not a valid indexed analysis file\n", m_param->analysisLoad);
+            m_aborted = true;
+        }
+        else
+        {
+            /* same checks as validateAnalysisData(), except the reuse with a
+             * different CTU size which requires the legacy file format */
+            const x265_analysis_validate& params = m_analysisIndexIn->header()->params;
+            if (params.maxNumReferences != m_param->maxNumReferences || params.analysisReuseLevel != m_param->analysisReuseLevel ||
+                params.scaleFactor != m_param->scaleFactor || params.keyframeMax != m_param->keyframeMax ||
+                params.keyframeMin != m_param->keyframeMin || params.openGOP != m_param->bOpenGOP ||
+                params.bframes != m_param->bframes || params.bPyramid != m_param->bBPyramid ||
+                params.maxCUSize != (int)m_param->maxCUSize || params.minCUSize != (int)m_param->minCUSize ||
+                params.radl != m_param->radl || params.lookaheadDepth != m_param->lookaheadDepth ||
+                params.gopLookahead != m_param->gopLookahead)
+            {
+                x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data. Mismatch in params.\n");
+                m_aborted = true;
+            }
+        }
+    }
+    else if (m_param->analysisLoad && m_param->bUseAnalysisFile)
     {
         m_analysisFileIn = x265_fopen(m_param->analysisLoad, "rb");
+        char magic[sizeof(ANALYSIS_FILE_MAGIC) - 1];
         if (!m_analysisFileIn)
         {
             x265_log_file(NULL, X265_LOG_ERROR, "Analysis load: failed to open file %s\n", m_param->analysisLoad);
             m_aborted = true;
         }
+        else
+        {
+            /* files too short for a magic are left to the legacy reader */
+            bool bMagic = fread(magic, sizeof(magic), 1, m_analysisFileIn) == 1;
+            if (bMagic && !memcmp(magic, ANALYSIS_FILE_MAGIC, sizeof(magic)))
+            {
+                x265_log_file(NULL, X265_LOG_ERROR, "Analysis load: %s is an indexed analysis file, requires --analysis-mmap\n", m_param->analysisLoad);
+                m_aborted = true;
+            }
+            else if (bMagic && !memcmp(magic, ANALYSIS_STREAM_MAGIC, sizeof(magic)))
+                m_analysisStreamsIn = new AnalysisStreamReader;
+            else
+                fseeko(m_analysisFileIn, 0, SEEK_SET);
+        }
     }
 
     if (m_param->analysisMultiPassRefine || m_param->analysisMultiPassDistortion)
@@ -448,13 +571,52 @@ void Encoder::stopJobs()
         }
     }
 
-    if (m_threadPool)
+    if (m_sharedPool)
+        detachThreadPool();
+    else if (m_threadPool)
     {
         for (int i = 0; i < m_numPools; i++)
             m_threadPool[i].stopWorkers();
     }
 }
 
+void Encoder::detachThreadPool()
+{
+    if (!m_poolShare)
+        return;
+
+    for (int i = 0; i < m_param->frameNumThreads; i++)
+    {
+        if (m_frameEncoder[i] && m_frameEncoder[i]->m_share)
+            m_sharedPool->removeProvider(*m_frameEncoder[i]);
+    }
+    if (m_lookahead && m_lookahead->m_share)
+        m_sharedPool->removeProvider(*m_lookahead);
+
+    m_sharedPool->detach(m_poolShare);
+    m_poolShare = NULL;
+}
+
+int Encoder::numPoolProviders(const ThreadPool* pool) const
+{
+    int count = 0;
+    for (int i = 0; i < m_param->frameNumThreads; i++)
+    {
+        if (m_frameEncoder[i] && m_frameEncoder[i]->m_pool == pool)
+            count++;
+    }
+    if (m_lookahead && m_lookahead->m_pool == pool)
+        count++;
+    return count;
+}
+
+void Encoder::inputLayout(int stride[3], int offset[3], int size[3]) const
+{
+    PicYuv pic;
+    pic.create(m_param, false);
+    pic.getBufferLayout(stride, offset, size);
+}
+
 int Encoder::copySlicetypePocAndSceneCut(int *slicetype, int *poc, int *sceneCut)
 {
     Frame *FramePtr = m_dpb->m_picList.getCurFrame();
@@ -706,6 +868,26 @@ int Encoder::setAnalysisData(x265_analysis_data *analysis_data, int poc, uint32_
     return -1;
 }
 
+/* Addresses of the string arguments of param which destroy() releases. A
+ * param copied for another encoder must duplicate all of them */
+int Encoder::getParamStrings(x265_param* param, const char** strings[MAX_PARAM_STRINGS])
+{
+    int n = 0;
+    strings[n++] = &param->rc.lambdaFileName;
+    strings[n++] = &param->rc.statFileName;
+    strings[n++] = &param->analysisReuseFileName;
+    strings[n++] = &param->scalingLists;
+    strings[n++] = &param->csvfn;
+    strings[n++] = &param->numaPools;
+    strings[n++] = &param->masteringDisplayColorVolume;
+    strings[n++] = &param->toneMapFile;
+    strings[n++] = &param->analysisSave;
+    strings[n++] = &param->primitiveTuneFile;
+    strings[n++] = &param->analysisLoad;
+    X265_CHECK(n <= MAX_PARAM_STRINGS, "too many param strings\n");
+    return n;
+}
+
 void Encoder::destroy()
 {
 #if ENABLE_HDR10_PLUS
@@ -735,8 +917,9 @@ void Encoder::destroy()
     }
 
     // thread pools can be cleaned up now that all the JobProviders are
-    // known to be shutdown
-    delete [] m_threadPool;
+    // known to be shutdown, shared pools are released by their owner
+    if (!m_sharedPool)
+        delete [] m_threadPool;
 
     if (m_lookahead)
     {
@@ -762,11 +945,18 @@ void Encoder::destroy()
     }
     if (m_analysisFileIn)
         fclose(m_analysisFileIn);
+    delete m_analysisIndexIn;
+    delete m_analysisStreamsIn;
+    delete m_analysisStreamsOut;
 
-    if (m_analysisFileOut)
+    if (m_analysisFileOut || m_analysisIndexOut)
     {
         int bError = 1;
-        fclose(m_analysisFileOut);
+        if (m_analysisFileOut)
+            fclose(m_analysisFileOut);
+        else if (!m_analysisIndexOut->finish())
+            x265_log(NULL, X265_LOG_ERROR, "Error writing analysis data\n");
+        delete m_analysisIndexOut;
         const char* name = m_param->analysisSave ? m_param->analysisSave : m_param->analysisReuseFileName;
         if (!name)
             name = defaultAnalysisFileName;
@@ -787,16 +977,10 @@ void Encoder::destroy()
         if (m_param->csvfpt)
             fclose(m_param->csvfpt);
         /* release string arguments that were strdup'd */
-        free((char*)m_param->rc.lambdaFileName);
-        free((char*)m_param->rc.statFileName);
-        free((char*)m_param->analysisReuseFileName);
-        free((char*)m_param->scalingLists);
-        free((char*)m_param->csvfn);
-        free((char*)m_param->numaPools);
-        free((char*)m_param->masteringDisplayColorVolume);
-        free((char*)m_param->toneMapFile);
-        free((char*)m_param->analysisSave);
-        free((char*)m_param->analysisLoad);
+        const char** strings[MAX_PARAM_STRINGS];
+        int numStrings = getParamStrings(m_param, strings);
+        for (int i = 0; i < numStrings; i++)
+            free((char*)*strings[i]);
         PARAM_NS::x265_param_free(m_param);
     }
 }
@@ -858,6 +1042,14 @@ void Encoder::calcRefreshInterval(Frame* frameEnc)
     }
 }
 
+/* a rejected zero-copy picture is given back to the application, which
+ * otherwise would never see its planes released */
+static void releaseRejected(const x265_picture* pic, const x265_param* param)
+{
+    if (pic && !param->bCopyPicToFrame && pic->planesRelease)
+        pic->planesRelease(pic->planesOpaque, (void**)pic->planes);
+}
+
 /**
  * Feed one new input frame into the encoder, get one frame out. If pic_in is
  * NULL, a flush condition is implied and pic_in must be NULL for all subsequent
@@ -879,7 +1071,10 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
     }
 #endif
     if (m_aborted)
+    {
+        releaseRejected(pic_in, m_param);
         return -1;
+    }
 
     if (m_exportedPic)
     {
@@ -927,9 +1122,36 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
         {
             x265_log(m_param, X265_LOG_ERROR, "Input bit depth (%d) must be between 8 and 16\n",
                      pic_in->bitDepth);
+            releaseRejected(pic_in, m_param);
             return -1;
         }
 
+        if (m_param->bCopyPicToFrame && !PicYuv::isValidInput(pic_in->colorSpace, pic_in->bitDepth, m_param->internalCsp))
+        {
+            x265_log(m_param, X265_LOG_ERROR, "Input color space (%d) with bit depth %d cannot be converted to %s\n",
+                     pic_in->colorSpace, pic_in->bitDepth, x265_source_csp_names[m_param->internalCsp]);
+            releaseRejected(pic_in, m_param);
+            return -1;
+        }
+
+        if (!m_param->bCopyPicToFrame)
+        {
+            /* zero-copy input, the planes are encoded in place so they must
+             * have the layout, depth and alignment of the internal pictures */
+            int stride[3], offset[3], size[3];
+            inputLayout(stride, offset, size);
+            int numPlanes = m_param->internalCsp == X265_CSP_I400 ? 1 : 3;
+            bool bValid = pic_in->bitDepth == X265_DEPTH && pic_in->colorSpace == m_param->internalCsp;
+            for (int i = 0; i < numPlanes && bValid; i++)
+                bValid = pic_in->planes[i] && pic_in->stride[i] == stride[i] && !(((intptr_t)pic_in->planes[i] - offset[i]) & 63);
+            if (!bValid)
+            {
+                x265_log(m_param, X265_LOG_ERROR, "zero-copy input picture does not have the layout given by x265_encoder_input_layout()\n");
+                releaseRejected(pic_in, m_param);
+                return -1;
+            }
+        }
+
         Frame *inFrame;
         if (m_dpb->m_freeList.empty())
         {
@@ -959,6 +1181,7 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
                         x265_log(m_param, X265_LOG_ERROR, "memory allocation failure, aborting encode\n");
                         inFrame->destroy();
                         delete inFrame;
+                        releaseRejected(pic_in, m_param);
                         return -1;
                     }
                     else
@@ -981,6 +1204,7 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
                 x265_log(m_param, X265_LOG_ERROR, "memory allocation failure, aborting encode\n");
                 inFrame->destroy();
                 delete inFrame;
+                releaseRejected(pic_in, m_param);
                 return -1;
             }
         }
@@ -996,10 +1220,12 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
         }
 
         /* Copy input picture into a Frame and PicYuv, send to lookahead */
-        inFrame->m_fencPic->copyFromPicture(*pic_in, *m_param, m_sps.conformanceWindow.rightOffset, m_sps.conformanceWindow.bottomOffset);
+        inFrame->m_fencPic->copyFromPicture(*pic_in, *m_param, m_sps.conformanceWindow.rightOffset, m_sps.conformanceWindow.bottomOffset, m_threadPool);
 
         inFrame->m_poc       = ++m_pocLast;
         inFrame->m_userData  = pic_in->userData;
+        inFrame->m_planesRelease = m_param->bCopyPicToFrame ? NULL : pic_in->planesRelease;
+        inFrame->m_planesOpaque  = pic_in->planesOpaque;
         inFrame->m_pts       = pic_in->pts;
         inFrame->m_forceqp   = pic_in->forceqp;
         inFrame->m_param     = (m_reconfigure || m_reconfigureRc) ? m_latestParam : m_param;
@@ -1072,30 +1298,35 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
         {
             /* reads analysis data for the frame and allocates memory based on slicetype */
             static int paramBytes = 0;
-            if (!inFrame->m_poc)
-            {
-                x265_analysis_data analysisData = pic_in->analysisData;
-                paramBytes = validateAnalysisData(&analysisData, 0);
-                if (paramBytes == -1)
-                    m_aborted = true;
-            }
-            if (m_saveCTUSize)
+            if (m_analysisIndexIn)
+                readAnalysisIndex(&inFrame->m_analysisData, inFrame->m_poc);
+            else
             {
-                cuLocation cuLocInFrame;
-                cuLocInFrame.init(m_param);
-                /* Set skipWidth/skipHeight flags when the out of bound pixels in lowRes is greater than half of maxCUSize */
-                int extendedWidth = ((m_param->sourceWidth / 2 + m_param->maxCUSize - 1) >> m_param->maxLog2CUSize) * m_param->maxCUSize;
-                int extendedHeight = ((m_param->sourceHeight / 2 + m_param->maxCUSize - 1) >> m_param->maxLog2CUSize) * m_param->maxCUSize;
-                uint32_t outOfBoundaryLowres = extendedWidth - m_param->sourceWidth / 2;
-                if (outOfBoundaryLowres * 2 >= m_param->maxCUSize)
-                    cuLocInFrame.skipWidth = true;
-                uint32_t outOfBoundaryLowresH = extendedHeight - m_param->sourceHeight / 2;
-                if (outOfBoundaryLowresH * 2 >= m_param->maxCUSize)
-                    cuLocInFrame.skipHeight = true;
-                readAnalysisFile(&inFrame->m_analysisData, inFrame->m_poc, pic_in, paramBytes, cuLocInFrame);
+                if (!inFrame->m_poc)
+                {
+                    x265_analysis_data analysisData = pic_in->analysisData;
+                    paramBytes = validateAnalysisData(&analysisData, 0);
+                    if (paramBytes == -1)
+                        m_aborted = true;
+                }
+                if (m_saveCTUSize)
+                {
+                    cuLocation cuLocInFrame;
+                    cuLocInFrame.init(m_param);
+                    /* Set skipWidth/skipHeight flags when the out of bound pixels in lowRes is greater than half of maxCUSize */
+                    int extendedWidth = ((m_param->sourceWidth / 2 + m_param->maxCUSize - 1) >> m_param->maxLog2CUSize) * m_param->maxCUSize;
+                    int extendedHeight = ((m_param->sourceHeight / 2 + m_param->maxCUSize - 1) >> m_param->maxLog2CUSize) * m_param->maxCUSize;
+                    uint32_t outOfBoundaryLowres = extendedWidth - m_param->sourceWidth / 2;
+                    if (outOfBoundaryLowres * 2 >= m_param->maxCUSize)
+                        cuLocInFrame.skipWidth = true;
+                    uint32_t outOfBoundaryLowresH = extendedHeight - m_param->sourceHeight / 2;
+                    if (outOfBoundaryLowresH * 2 >= m_param->maxCUSize)
+                        cuLocInFrame.skipHeight = true;
+                    readAnalysisFile(&inFrame->m_analysisData, inFrame->m_poc, pic_in, paramBytes, cuLocInFrame);
+                }
+                else
+                    readAnalysisFile(&inFrame->m_analysisData, inFrame->m_poc, pic_in, paramBytes);
             }
-            else
-                readAnalysisFile(&inFrame->m_analysisData, inFrame->m_poc, pic_in, paramBytes);
             inFrame->m_poc = inFrame->m_analysisData.poc;
             sliceType = inFrame->m_analysisData.sliceType;
             inFrame->m_lowres.bScenecut = !!inFrame->m_analysisData.bScenecut;
@@ -1252,7 +1483,10 @@ int Encoder::encode(const x265_picture* pic_in, x265_picture* pic_out)
                             pic_out->analysisData.lookahead.vbvCost = outFrame->m_analysisData.lookahead.vbvCost;
                         }
                     }
-                    writeAnalysisFile(&pic_out->analysisData, *outFrame->m_encData);
+                    if (m_analysisIndexOut)
+                        writeAnalysisIndex(&pic_out->analysisData, *outFrame->m_encData);
+                    else
+                        writeAnalysisFile(&pic_out->analysisData, *outFrame->m_encData);
                     pic_out->analysisData.saveParam = pic_out->analysisData.saveParam;
                     if (m_param->bUseAnalysisFile)
                         freeAnalysis(&pic_out->analysisData);
@@ -1790,6 +2024,31 @@ void Encoder::printSummary()
 
         x265_log(m_param, X265_LOG_INFO, "consecutive B-frames: %s\n", buffer);
     }
+    if (m_param->logLevel >= X265_LOG_DEBUG)
+    {
+        const PicQueue& in = m_lookahead->m_inputQueue;
+        const PicQueue& out = m_lookahead->m_outputQueue;
+        x265_log(m_param, X265_LOG_DEBUG, "lookahead queues: peak depth in %d out %d, full waits %d (%.1f ms), output waits %d (%.1f ms)\n",
+                 in.m_maxDepth, out.m_maxDepth, in.m_numFullWaits + out.m_numFullWaits,
+                 (double)(in.m_fullWaitTime + out.m_fullWaitTime) / 1000,
+                 m_lookahead->m_numOutputWaits, (double)m_lookahead->m_outputWaitTime / 1000);
+        if (m_lookahead->m_countGroupJobs)
+            x265_log(m_param, X265_LOG_DEBUG, "lookahead task groups: %d jobs, %s, %d steals took %d jobs, %d lock waits\n",
+                     m_lookahead->m_countGroupJobs, m_param->bLookaheadSteal ? "work stealing" : "shared counter",
+                     m_lookahead->m_countSteals, m_lookahead->m_countStolenJobs, m_lookahead->m_countLockWaits);
+    }
+    if (m_analysisStreamsOut && m_analysisStreamsOut->m_codedBytes)
+    {
+        x265_log(m_param, X265_LOG_INFO, "analysis save: %.1f MB compressed to %.1f MB, ratio %.2f::1\n",
+                 (double)m_analysisStreamsOut->m_rawBytes / (1 << 20), (double)m_analysisStreamsOut->m_codedBytes / (1 << 20),
+                 (double)m_analysisStreamsOut->m_rawBytes / m_analysisStreamsOut->m_codedBytes);
+    }
+    if (m_analysisStreamsIn && m_analysisStreamsIn->m_codedBytes)
+    {
+        x265_log(m_param, X265_LOG_INFO, "analysis load: %.1f MB decompressed to %.1f MB in %.1f ms\n",
+                 (double)m_analysisStreamsIn->m_codedBytes / (1 << 20), (double)m_analysisStreamsIn->m_rawBytes / (1 << 20),
+                 (double)m_analysisStreamsIn->m_decodeTime / 1000);
+    }
     if (m_param->bLossless)
     {
         float frameSize = (float)(m_param->sourceWidth - m_sps.conformanceWindow.rightOffset) *
@@ -1831,6 +2090,13 @@ void Encoder::printSummary()
     else
         general_log(m_param, NULL, X265_LOG_INFO, "\nencoded 0 frames\n");
 
+    if (m_param->poolStealThreshold && m_numPools > 1 && !m_sharedPool)
+    {
+        for (int i = 0; i < m_numPools; i++)
+            x265_log(m_param, X265_LOG_INFO, "pool %d: %d jobs performed for other pools, %d jobs received from other pools\n",
+                     i, m_threadPool[i].m_remoteJobCount, m_threadPool[i].m_guestJobCount);
+    }
+
 #if DETAILED_CU_STATS
     /* Summarize stats from all frame encoders */
     CUStats cuStats;
@@ -2170,6 +2436,8 @@ void Encoder::finishFrameStats(Frame* curFrame, FrameEncoder *curEncoder, x265_f
             else
                 frameStats->avgWPP = 1;
             frameStats->countRowBlocks = curEncoder->m_countRowBlocks;
+            frameStats->lookaheadInputDepth = curFrame->m_lookaheadInputDepth;
+            frameStats->lookaheadOutputDepth = curFrame->m_lookaheadOutputDepth;
 
             frameStats->avgChromaDistortion = curFrame->m_encData->m_frameStats.avgChromaDistortion;
             frameStats->avgLumaDistortion = curFrame->m_encData->m_frameStats.avgLumaDistortion;
@@ -3202,16 +3470,20 @@ fail:
 }
 void Encoder::freeAnalysis(x265_analysis_data* analysis)
 {
+    /* buffers loaded from an --analysis-mmap file point into the mapped file */
+#define X265_FREE_ANALYSIS(ptr) \
+    do { if (!m_analysisIndexIn || !m_analysisIndexIn->contains(ptr)) X265_FREE(ptr); } while (0)
+
     if (m_param->bDisableLookahead && m_rateControl->m_isVbv)
     {
-        X265_FREE(analysis->lookahead.satdForVbv);
-        X265_FREE(analysis->lookahead.intraSatdForVbv);
-        X265_FREE(analysis->lookahead.vbvCost);
-        X265_FREE(analysis->lookahead.intraVbvCost);
+        X265_FREE_ANALYSIS(analysis->lookahead.satdForVbv);
+        X265_FREE_ANALYSIS(analysis->lookahead.intraSatdForVbv);
+        X265_FREE_ANALYSIS(analysis->lookahead.vbvCost);
+        X265_FREE_ANALYSIS(analysis->lookahead.intraVbvCost);
     }
     /* Early exit freeing weights alone if level is 1 (when there is no analysis inter/intra) */
     if (analysis->sliceType > X265_TYPE_I && analysis->wt && !(m_param->bMVType == AVC_INFO))
-        X265_FREE(analysis->wt);
+        X265_FREE_ANALYSIS(analysis->wt);
     if (m_param->analysisReuseLevel < 2)
         return;
 
@@ -3219,11 +3491,11 @@ void Encoder::freeAnalysis(x265_analysis_data* analysis)
     {
         if (analysis->intraData)
         {
-            X265_FREE(((analysis_intra_data*)analysis->intraData)->depth);
-            X265_FREE(((analysis_intra_data*)analysis->intraData)->modes);
-            X265_FREE(((analysis_intra_data*)analysis->intraData)->partSizes);
-            X265_FREE(((analysis_intra_data*)analysis->intraData)->chromaModes);
-            X265_FREE(analysis->intraData);
+            X265_FREE_ANALYSIS(((analysis_intra_data*)analysis->intraData)->depth);
+            X265_FREE_ANALYSIS(((analysis_intra_data*)analysis->intraData)->modes);
+            X265_FREE_ANALYSIS(((analysis_intra_data*)analysis->intraData)->partSizes);
+            X265_FREE_ANALYSIS(((analysis_intra_data*)analysis->intraData)->chromaModes);
+            X265_FREE_ANALYSIS(analysis->intraData);
             analysis->intraData = NULL;
         }
     }
@@ -3231,44 +3503,45 @@ void Encoder::freeAnalysis(x265_analysis_data* analysis)
     {
         if (analysis->intraData)
         {
-            X265_FREE(((analysis_intra_data*)analysis->intraData)->modes);
-            X265_FREE(((analysis_intra_data*)analysis->intraData)->chromaModes);
-            X265_FREE(analysis->intraData);
+            X265_FREE_ANALYSIS(((analysis_intra_data*)analysis->intraData)->modes);
+            X265_FREE_ANALYSIS(((analysis_intra_data*)analysis->intraData)->chromaModes);
+            X265_FREE_ANALYSIS(analysis->intraData);
             analysis->intraData = NULL;
         }
         if (analysis->interData)
         {
-            X265_FREE(((analysis_inter_data*)analysis->interData)->depth);
-            X265_FREE(((analysis_inter_data*)analysis->interData)->modes);
+            X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->depth);
+            X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->modes);
             if (m_param->analysisReuseLevel > 4)
             {
-                X265_FREE(((analysis_inter_data*)analysis->interData)->mergeFlag);
-                X265_FREE(((analysis_inter_data*)analysis->interData)->partSize);
+                X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->mergeFlag);
+                X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->partSize);
             }
             if (m_param->analysisReuseLevel >= 7)
             {
-                X265_FREE(((analysis_inter_data*)analysis->interData)->interDir);
-                X265_FREE(((analysis_inter_data*)analysis->interData)->sadCost);
+                X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->interDir);
+                X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->sadCost);
                 int numDir = analysis->sliceType == X265_TYPE_P ? 1 : 2;
                 for (int dir = 0; dir < numDir; dir++)
                 {
-                    X265_FREE(((analysis_inter_data*)analysis->interData)->mvpIdx[dir]);
-                    X265_FREE(((analysis_inter_data*)analysis->interData)->refIdx[dir]);
-                    X265_FREE(((analysis_inter_data*)analysis->interData)->mv[dir]);
+                    X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->mvpIdx[dir]);
+                    X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->refIdx[dir]);
+                    X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->mv[dir]);
                     if (analysis->modeFlag[dir] != NULL)
                     {
-                        X265_FREE(analysis->modeFlag[dir]);
+                        X265_FREE_ANALYSIS(analysis->modeFlag[dir]);
                         analysis->modeFlag[dir] = NULL;
                     }
                 }
             }
             else
-                X265_FREE(((analysis_inter_data*)analysis->interData)->ref);
+                X265_FREE_ANALYSIS(((analysis_inter_data*)analysis->interData)->ref);
 
-            X265_FREE(analysis->interData);
+            X265_FREE_ANALYSIS(analysis->interData);
             analysis->interData = NULL;
         }
     }
+#undef X265_FREE_ANALYSIS
 }
 
 void Encoder::allocAnalysis2Pass(x265_analysis_2Pass* analysis, int sliceType)
@@ -3343,7 +3616,8 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
         {\
         memcpy(val, src, (size * readSize));\
         }\
-        else if (fread(val, size, readSize, fileOffset) != readSize)\
+        else if (m_analysisStreamsIn && m_analysisStreamsIn->isActive() ? !m_analysisStreamsIn->get(val, (uint32_t)(size), (uint32_t)(readSize)) : \
+                 fread(val, size, readSize, fileOffset) != readSize)\
     {\
         x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");\
         freeAnalysis(analysis);\
@@ -3354,6 +3628,8 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
     static uint64_t consumedBytes = 0;
     static uint64_t totalConsumedBytes = 0;
     uint32_t depthBytes = 0;
+    if (m_analysisStreamsIn)
+        m_analysisStreamsIn->reset();
     if (m_param->bUseAnalysisFile)
         fseeko(m_analysisFileIn, totalConsumedBytes + paramBytes, SEEK_SET);
     const x265_analysis_data *picData = &(picIn->analysisData);
@@ -3433,6 +3709,15 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
         if (m_param->analysisReuseLevel < 2)
             return;
 
+        /* the arrays of a compressed record are coded in a single block */
+        if (m_analysisStreamsIn && !m_analysisStreamsIn->readBlock(m_analysisFileIn))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");
+            freeAnalysis(analysis);
+            m_aborted = true;
+            return;
+        }
+
         uint8_t *tempBuf = NULL, *depthBuf = NULL, *modeBuf = NULL, *partSizes = NULL;
 
         tempBuf = X265_MALLOC(uint8_t, depthBytes * 3);
@@ -3485,6 +3770,15 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
         if (m_param->analysisReuseLevel < 2)
             return;
 
+        /* the arrays of a compressed record are coded in a single block */
+        if (m_analysisStreamsIn && !m_analysisStreamsIn->readBlock(m_analysisFileIn))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");
+            freeAnalysis(analysis);
+            m_aborted = true;
+            return;
+        }
+
         uint8_t *tempBuf = NULL, *depthBuf = NULL, *modeBuf = NULL, *partSize = NULL, *mergeFlag = NULL;
         uint8_t *interDir = NULL, *chromaDir = NULL, *mvpIdx[2];
         MV* mv[2];
@@ -3617,7 +3911,8 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
     {\
         memcpy(val, src, (size * readSize));\
     }\
-    else if (fread(val, size, readSize, fileOffset) != readSize)\
+    else if (m_analysisStreamsIn && m_analysisStreamsIn->isActive() ? !m_analysisStreamsIn->get(val, (uint32_t)(size), (uint32_t)(readSize)) : \
+                 fread(val, size, readSize, fileOffset) != readSize)\
     {\
         x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");\
         freeAnalysis(analysis);\
@@ -3628,6 +3923,8 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
     static uint64_t consumedBytes = 0;
     static uint64_t totalConsumedBytes = 0;
     uint32_t depthBytes = 0;
+    if (m_analysisStreamsIn)
+        m_analysisStreamsIn->reset();
     if (m_param->bUseAnalysisFile)
         fseeko(m_analysisFileIn, totalConsumedBytes + paramBytes, SEEK_SET);
 
@@ -3751,6 +4048,15 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
         if (m_param->analysisReuseLevel < 2)
             return;
 
+        /* the arrays of a compressed record are coded in a single block */
+        if (m_analysisStreamsIn && !m_analysisStreamsIn->readBlock(m_analysisFileIn))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");
+            freeAnalysis(analysis);
+            m_aborted = true;
+            return;
+        }
+
         uint8_t *tempBuf = NULL, *depthBuf = NULL, *modeBuf = NULL, *partSizes = NULL;
 
         tempBuf = X265_MALLOC(uint8_t, depthBytes * 3);
@@ -3812,6 +4118,15 @@ void Encoder::readAnalysisFile(x265_analysis_data* analysis, int curPoc, const x
         if (m_param->analysisReuseLevel < 2)
             return;
 
+        /* the arrays of a compressed record are coded in a single block */
+        if (m_analysisStreamsIn && !m_analysisStreamsIn->readBlock(m_analysisFileIn))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");
+            freeAnalysis(analysis);
+            m_aborted = true;
+            return;
+        }
+
         uint8_t *tempBuf = NULL, *depthBuf = NULL, *modeBuf = NULL, *partSize = NULL, *mergeFlag = NULL;
         uint8_t *interDir = NULL, *chromaDir = NULL, *mvpIdx[2];
         MV* mv[2];
@@ -4054,6 +4369,8 @@ int Encoder::validateAnalysisData(x265_analysis_data* analysis, int writeFlag)
     X265_PARAM_VALIDATE(saveParam->radl, sizeof(int), 1, &m_param->radl);
     X265_PARAM_VALIDATE(saveParam->lookaheadDepth, sizeof(int), 1, &m_param->lookaheadDepth);
     X265_PARAM_VALIDATE(saveParam->gopLookahead, sizeof(int), 1, &m_param->gopLookahead);
+    if (!writeFlag && m_analysisStreamsIn)
+        return (count * sizeof(int)) + sizeof(ANALYSIS_STREAM_MAGIC) - 1;
     return (count * sizeof(int));
 #undef X265_PARAM_VALIDATE
 }
@@ -4318,6 +4635,7 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
         numPlanes = m_param->internalCsp == X265_CSP_I400 ? 1 : 3;
         analysis->frameRecordSize += sizeof(WeightParam) * numPlanes * numDir;
     }
+    uint32_t headerBytes = analysis->frameRecordSize;
 
     if (m_param->analysisReuseLevel > 1)
     {
@@ -4434,6 +4752,56 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
     if (!m_param->bUseAnalysisFile)
         return;
 
+    if (m_analysisStreamsOut && m_param->analysisReuseLevel > 1)
+    {
+        /* code the arrays in the order of the uncompressed writes below, the
+         * record holds the coded block instead */
+#define X265_PUT_STREAM(val, size, count, bDeltaMV)\
+    if (!m_analysisStreamsOut->put(val, size, count, bDeltaMV))\
+    {\
+        x265_log(NULL, X265_LOG_ERROR, "Error writing analysis data\n");\
+        freeAnalysis(analysis);\
+        m_aborted = true;\
+        return;\
+    }\
+
+        m_analysisStreamsOut->reset();
+        if (analysis->sliceType == X265_TYPE_IDR || analysis->sliceType == X265_TYPE_I)
+        {
+            X265_PUT_STREAM(((analysis_intra_data*)analysis->intraData)->depth, sizeof(uint8_t), depthBytes, false);
+            X265_PUT_STREAM(((analysis_intra_data*)analysis->intraData)->chromaModes, sizeof(uint8_t), depthBytes, false);
+            X265_PUT_STREAM(((analysis_intra_data*)analysis->intraData)->partSizes, sizeof(char), depthBytes, false);
+            X265_PUT_STREAM(((analysis_intra_data*)analysis->intraData)->modes, sizeof(uint8_t), analysis->numCUsInFrame * analysis->numPartitions, false);
+        }
+        else
+        {
+            X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->depth, sizeof(uint8_t), depthBytes, false);
+            X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->modes, sizeof(uint8_t), depthBytes, false);
+            if (m_param->analysisReuseLevel > 4)
+            {
+                X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->partSize, sizeof(uint8_t), depthBytes, false);
+                X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->mergeFlag, sizeof(uint8_t), depthBytes, false);
+                if (m_param->analysisReuseLevel == 10)
+                {
+                    X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->interDir, sizeof(uint8_t), depthBytes, false);
+                    if (bIntraInInter) X265_PUT_STREAM(((analysis_intra_data*)analysis->intraData)->chromaModes, sizeof(uint8_t), depthBytes, false);
+                    for (uint32_t dir = 0; dir < numDir; dir++)
+                    {
+                        X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->mvpIdx[dir], sizeof(uint8_t), depthBytes, false);
+                        X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->refIdx[dir], sizeof(int8_t), depthBytes, false);
+                        X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->mv[dir], sizeof(MV), depthBytes, true);
+                    }
+                    if (bIntraInInter)
+                        X265_PUT_STREAM(((analysis_intra_data*)analysis->intraData)->modes, sizeof(uint8_t), analysis->numCUsInFrame * analysis->numPartitions, false);
+                }
+            }
+            if (m_param->analysisReuseLevel != 10)
+                X265_PUT_STREAM(((analysis_inter_data*)analysis->interData)->ref, sizeof(int32_t), analysis->numCUsInFrame * X265_MAX_PRED_MODE_PER_CTU * numDir, false);
+        }
+        analysis->frameRecordSize = headerBytes + m_analysisStreamsOut->blockSize();
+#undef X265_PUT_STREAM
+    }
+
     X265_FWRITE(&analysis->frameRecordSize, sizeof(uint32_t), 1, m_analysisFileOut);
     X265_FWRITE(&depthBytes, sizeof(uint32_t), 1, m_analysisFileOut);
     X265_FWRITE(&analysis->poc, sizeof(int), 1, m_analysisFileOut);
@@ -4448,6 +4816,17 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
     if (m_param->analysisReuseLevel < 2)
         return;
 
+    if (m_analysisStreamsOut)
+    {
+        if (!m_analysisStreamsOut->writeBlock(m_analysisFileOut))
+        {
+            x265_log(NULL, X265_LOG_ERROR, "Error writing analysis data\n");
+            freeAnalysis(analysis);
+            m_aborted = true;
+        }
+        return;
+    }
+
     if (analysis->sliceType == X265_TYPE_IDR || analysis->sliceType == X265_TYPE_I)
     {
         X265_FWRITE(((analysis_intra_data*)analysis->intraData)->depth, sizeof(uint8_t), depthBytes, m_analysisFileOut);
@@ -4484,6 +4863,272 @@ void Encoder::writeAnalysisFile(x265_analysis_data* analysis, FrameData &curEncD
 #undef X265_FWRITE
 }
 
+void Encoder::readAnalysisIndex(x265_analysis_data* analysis, int curPoc)
+{
+    /* the analysis arrays point into the mapped file, only the structures
+     * and the buffers which are not saved in the file are allocated */
+#define X265_MAP_ANALYSIS(var, type, id, count) \
+    do { \
+        var = (type*)m_analysisIndexIn->section(record, id, sizeof(type) * (count)); \
+        if (!var) \
+            goto fail; \
+    } while (0)
+
+    const AnalysisFrameRecord* record = m_analysisIndexIn->findFrame(curPoc);
+    if (!record)
+    {
+        x265_log(NULL, X265_LOG_WARNING, "Error reading analysis data: Cannot find POC %d\n", curPoc);
+        return;
+    }
+
+    analysis->poc = record->poc;
+    analysis->sliceType = record->sliceType;
+    analysis->bScenecut = record->bScenecut;
+    analysis->satdCost = record->satdCost;
+    analysis->numCUsInFrame = record->numCUsInFrame;
+    analysis->numPartitions = record->numPartitions;
+    analysis->frameRecordSize = record->recordSize;
+    analysis->interData = analysis->intraData = NULL;
+
+    uint64_t numParts = (uint64_t)analysis->numPartitions * analysis->numCUsInFrame;
+    if (analysis->sliceType == X265_TYPE_IDR || analysis->sliceType == X265_TYPE_I)
+    {
+        if (m_param->analysisReuseLevel < 2)
+            return;
+
+        analysis_intra_data *intraData = NULL;
+        CHECKED_MALLOC_ZERO(intraData, analysis_intra_data, 1);
+        analysis->intraData = intraData;
+        X265_MAP_ANALYSIS(intraData->depth, uint8_t, AS_DEPTH, numParts);
+        X265_MAP_ANALYSIS(intraData->modes, uint8_t, AS_LUMA_MODES, numParts);
+        X265_MAP_ANALYSIS(intraData->partSizes, char, AS_PART_SIZE, numParts);
+        X265_MAP_ANALYSIS(intraData->chromaModes, uint8_t, AS_CHROMA_MODES, numParts);
+    }
+    else
+    {
+        int numDir = analysis->sliceType == X265_TYPE_P ? 1 : 2;
+        uint32_t numPlanes = m_param->internalCsp == X265_CSP_I400 ? 1 : 3;
+        X265_MAP_ANALYSIS(analysis->wt, WeightParam, AS_WEIGHTS, numPlanes * numDir);
+        if (m_param->analysisReuseLevel < 2)
+            return;
+
+        analysis_inter_data *interData = NULL;
+        CHECKED_MALLOC_ZERO(interData, analysis_inter_data, 1);
+        analysis->interData = interData;
+        X265_MAP_ANALYSIS(interData->depth, uint8_t, AS_DEPTH, numParts);
+        X265_MAP_ANALYSIS(interData->modes, uint8_t, AS_MODES, numParts);
+        if (m_param->analysisReuseLevel > 4)
+        {
+            X265_MAP_ANALYSIS(interData->partSize, uint8_t, AS_PART_SIZE, numParts);
+            X265_MAP_ANALYSIS(interData->mergeFlag, uint8_t, AS_MERGE_FLAG, numParts);
+        }
+        if (m_param->analysisReuseLevel >= 7)
+        {
+            bool bIntraInInter = analysis->sliceType == X265_TYPE_P || m_param->bIntraInBFrames;
+            analysis_intra_data *intraData = NULL;
+            if (bIntraInInter)
+            {
+                CHECKED_MALLOC_ZERO(intraData, analysis_intra_data, 1);
+                analysis->intraData = intraData;
+            }
+            CHECKED_MALLOC(interData->sadCost, int64_t, numParts);
+            for (int dir = 0; dir < numDir; dir++)
+                CHECKED_MALLOC_ZERO(analysis->modeFlag[dir], uint8_t, numParts);
+            if (m_param->analysisReuseLevel == 10)
+            {
+                X265_MAP_ANALYSIS(interData->interDir, uint8_t, AS_INTER_DIR, numParts);
+                for (int dir = 0; dir < numDir; dir++)
+                {
+                    X265_MAP_ANALYSIS(interData->mvpIdx[dir], uint8_t, AS_MVP_IDX + dir, numParts);
+                    X265_MAP_ANALYSIS(interData->refIdx[dir], int8_t, AS_REF_IDX + dir, numParts);
+                    X265_MAP_ANALYSIS(interData->mv[dir], MV, AS_MV + dir, numParts);
+                }
+                if (bIntraInInter)
+                {
+                    X265_MAP_ANALYSIS(intraData->modes, uint8_t, AS_LUMA_MODES, numParts);
+                    X265_MAP_ANALYSIS(intraData->chromaModes, uint8_t, AS_CHROMA_MODES, numParts);
+                }
+            }
+            else
+            {
+                /* not saved below level 10, allocated as allocAnalysis() does */
+                CHECKED_MALLOC(interData->interDir, uint8_t, numParts);
+                for (int dir = 0; dir < numDir; dir++)
+                {
+                    CHECKED_MALLOC(interData->mvpIdx[dir], uint8_t, numParts);
+                    CHECKED_MALLOC(interData->refIdx[dir], int8_t, numParts);
+                    CHECKED_MALLOC(interData->mv[dir], MV, numParts);
+                }
+                if (bIntraInInter)
+                {
+                    CHECKED_MALLOC(intraData->modes, uint8_t, numParts);
+                    CHECKED_MALLOC(intraData->chromaModes, uint8_t, numParts);
+                }
+            }
+        }
+        else
+            X265_MAP_ANALYSIS(interData->ref, int32_t, AS_REF, analysis->numCUsInFrame * X265_MAX_PRED_MODE_PER_CTU * numDir);
+    }
+    return;
+
+fail:
+    x265_log(NULL, X265_LOG_ERROR, "Error reading analysis data\n");
+    freeAnalysis(analysis);
+    m_aborted = true;
+#undef X265_MAP_ANALYSIS
+}
+
+void Encoder::writeAnalysisIndex(x265_analysis_data* analysis, FrameData &curEncData)
+{
+    /* The analysis arrays are filled with the CTU data expanded to one entry
+     * per partition, as readAnalysisFile() expands the compact legacy records,
+     * and are saved as they are */
+#define X265_ANALYSIS_SECTION(id, var, size) \
+    do { \
+        sections[id] = var; \
+        record.sectionSize[id] = size; \
+    } while (0)
+
+    AnalysisFrameRecord record;
+    const void* sections[AS_COUNT];
+    memset(&record, 0, sizeof(record));
+    memset(sections, 0, sizeof(sections));
+    record.satdCost = analysis->satdCost;
+    record.poc = analysis->poc;
+    record.sliceType = analysis->sliceType;
+    record.numCUsInFrame = analysis->numCUsInFrame;
+    record.numPartitions = analysis->numPartitions;
+    record.bScenecut = analysis->bScenecut;
+
+    bool bIntra = analysis->sliceType == X265_TYPE_IDR || analysis->sliceType == X265_TYPE_I;
+    uint32_t numDir = analysis->sliceType == X265_TYPE_P ? 1 : 2;
+    uint32_t numPlanes = m_param->internalCsp == X265_CSP_I400 ? 1 : 3;
+    uint32_t numParts = analysis->numPartitions * analysis->numCUsInFrame;
+    if (!bIntra)
+        X265_ANALYSIS_SECTION(AS_WEIGHTS, analysis->wt, sizeof(WeightParam) * numPlanes * numDir);
+
+    if (m_param->analysisReuseLevel > 1)
+    {
+        analysis_intra_data* intraData = (analysis_intra_data*)analysis->intraData;
+        analysis_inter_data* interData = (analysis_inter_data*)analysis->interData;
+        bool bIntraInInter = !bIntra && m_param->analysisReuseLevel == 10 && (analysis->sliceType == X265_TYPE_P || m_param->bIntraInBFrames);
+
+        /* entries of the PUs following the first one of each CU */
+        if (!bIntra && m_param->analysisReuseLevel > 4)
+        {
+            memset(interData->mergeFlag, 0, numParts);
+            if (m_param->analysisReuseLevel == 10)
+            {
+                memset(interData->interDir, 0, numParts);
+                for (uint32_t dir = 0; dir < numDir; dir++)
+                {
+                    memset(interData->mvpIdx[dir], 0, numParts);
+                    memset(interData->refIdx[dir], 0, numParts);
+                    for (uint32_t i = 0; i < numParts; i++)
+                        interData->mv[dir][i] = MV();
+                }
+            }
+        }
+
+        for (uint32_t cuAddr = 0; cuAddr < analysis->numCUsInFrame; cuAddr++)
+        {
+            CUData* ctu = curEncData.getPicCTU(cuAddr);
+            for (uint32_t absPartIdx = 0; absPartIdx < ctu->m_numPartitions;)
+            {
+                uint8_t depth = ctu->m_cuDepth[absPartIdx];
+                uint32_t bytes = ctu->m_numPartitions >> (depth * 2);
+                uint32_t count = cuAddr * ctu->m_numPartitions + absPartIdx;
+                if (bIntra)
+                {
+                    memset(&intraData->depth[count], depth, bytes);
+                    memset(&intraData->chromaModes[count], ctu->m_chromaIntraDir[absPartIdx], bytes);
+                    memset(&intraData->partSizes[count], ctu->m_partSize[absPartIdx], bytes);
+                }
+                else
+                {
+                    uint8_t predMode = ctu->m_predMode[absPartIdx];
+                    if (m_param->analysisReuseLevel != 10 && ctu->m_refIdx[1][absPartIdx] != -1)
+                        predMode = 4; // used as indiacator if the block is coded as bidir
+
+                    memset(&interData->depth[count], depth, bytes);
+                    memset(&interData->modes[count], predMode, bytes);
+                    if (m_param->analysisReuseLevel > 4)
+                    {
+                        uint8_t partSize = ctu->m_partSize[absPartIdx];
+                        memset(&interData->partSize[count], partSize, bytes);
+
+                        uint32_t numPU = (predMode == MODE_INTRA) ? 1 : nbPartsTable[(int)partSize];
+                        for (uint32_t puIdx = 0; puIdx < numPU; puIdx++)
+                        {
+                            uint32_t puabsPartIdx = ctu->getPUOffset(puIdx, absPartIdx) + absPartIdx;
+                            interData->mergeFlag[count + puIdx] = ctu->m_mergeFlag[puabsPartIdx];
+                            if (m_param->analysisReuseLevel == 10)
+                            {
+                                interData->interDir[count + puIdx] = ctu->m_interDir[puabsPartIdx];
+                                for (uint32_t dir = 0; dir < numDir; dir++)
+                                {
+                                    interData->mvpIdx[dir][count + puIdx] = ctu->m_mvpIdx[dir][puabsPartIdx];
+                                    interData->refIdx[dir][count + puIdx] = ctu->m_refIdx[dir][puabsPartIdx];
+                                    interData->mv[dir][count + puIdx] = ctu->m_mv[dir][puabsPartIdx];
+                                }
+                            }
+                        }
+                        if (bIntraInInter)
+                            memset(&intraData->chromaModes[count], ctu->m_chromaIntraDir[absPartIdx], bytes);
+                    }
+                }
+                absPartIdx += bytes;
+            }
+            if (bIntra || bIntraInInter)
+                memcpy(&intraData->modes[cuAddr * ctu->m_numPartitions], ctu->m_lumaIntraDir, sizeof(uint8_t) * ctu->m_numPartitions);
+        }
+
+        if (bIntra)
+        {
+            X265_ANALYSIS_SECTION(AS_DEPTH, intraData->depth, numParts);
+            X265_ANALYSIS_SECTION(AS_PART_SIZE, intraData->partSizes, numParts);
+            X265_ANALYSIS_SECTION(AS_LUMA_MODES, intraData->modes, numParts);
+            X265_ANALYSIS_SECTION(AS_CHROMA_MODES, intraData->chromaModes, numParts);
+        }
+        else
+        {
+            X265_ANALYSIS_SECTION(AS_DEPTH, interData->depth, numParts);
+            X265_ANALYSIS_SECTION(AS_MODES, interData->modes, numParts);
+            if (m_param->analysisReuseLevel > 4)
+            {
+                X265_ANALYSIS_SECTION(AS_PART_SIZE, interData->partSize, numParts);
+                X265_ANALYSIS_SECTION(AS_MERGE_FLAG, interData->mergeFlag, numParts);
+            }
+            if (m_param->analysisReuseLevel == 10)
+            {
+                X265_ANALYSIS_SECTION(AS_INTER_DIR, interData->interDir, numParts);
+                for (uint32_t dir = 0; dir < numDir; dir++)
+                {
+                    X265_ANALYSIS_SECTION(AS_MVP_IDX + dir, interData->mvpIdx[dir], numParts);
+                    X265_ANALYSIS_SECTION(AS_REF_IDX + dir, interData->refIdx[dir], numParts);
+                    X265_ANALYSIS_SECTION(AS_MV + dir, interData->mv[dir], numParts * sizeof(MV));
+                }
+                if (bIntraInInter)
+                {
+                    X265_ANALYSIS_SECTION(AS_LUMA_MODES, intraData->modes, numParts);
+                    X265_ANALYSIS_SECTION(AS_CHROMA_MODES, intraData->chromaModes, numParts);
+                }
+            }
+            else
+                X265_ANALYSIS_SECTION(AS_REF, interData->ref, sizeof(int32_t) * analysis->numCUsInFrame * X265_MAX_PRED_MODE_PER_CTU * numDir);
+        }
+    }
+
+    if (!m_analysisIndexOut->writeFrame(record, sections))
+    {
+        x265_log(NULL, X265_LOG_ERROR, "Error writing analysis data\n");
+        m_aborted = true;
+    }
+    analysis->frameRecordSize = record.recordSize;
+    analysis->depthBytes = 0;
+#undef X265_ANALYSIS_SECTION
+}
+
 void Encoder::writeAnalysis2PassFile(x265_analysis_2Pass* analysis2Pass, FrameData &curEncData, int slicetype)
 {
 #define X265_FWRITE(val, size, writeSize, fileOffset)\
@@ -130,8 +130,14 @@ struct puOrientation
 class FrameEncoder;
 class DPB;
 class Lookahead;
+class AnalysisFile;
+class AnalysisStreamWriter;
+class AnalysisStreamReader;
 class RateControl;
 class ThreadPool;
+class SharedThreadPool;
+class AsyncEncoder;
+struct PoolShare;
 class FrameData;
 
 class Encoder : public x265_encoder
@@ -164,11 +170,18 @@ public:
     uint32_t           m_numDelayedPic;
 
     ThreadPool*        m_threadPool;
+    SharedThreadPool*  m_sharedPool;       // param->threadPool, m_threadPool are its pools
+    PoolShare*         m_poolShare;
     FrameEncoder*      m_frameEncoder[X265_MAX_FRAME_THREADS];
+    AsyncEncoder*      m_async;            // x265_encoder_async_start()
     DPB*               m_dpb;
     Frame*             m_exportedPic;
     FILE*              m_analysisFileIn;
     FILE*              m_analysisFileOut;
+    AnalysisFile*      m_analysisIndexIn;   // --analysis-mmap load, mapped file
+    AnalysisFile*      m_analysisIndexOut;  // --analysis-mmap save
+    AnalysisStreamReader* m_analysisStreamsIn;  // compressed analysis file load
+    AnalysisStreamWriter* m_analysisStreamsOut; // --analysis-compress save
     x265_param*        m_param;
     x265_param*        m_latestParam;     // Holds latest param during a reconfigure
     RateControl*       m_rateControl;
@@ -207,6 +220,12 @@ public:
 
     Lock               m_rpsInSpsLock;
     int                m_rpsInSpsCount;
+
+    /* x265_encoder_slice_output() */
+    x265_nal_callback  m_sliceOutput;
+    void*              m_sliceOutputOpaque;
+    Lock               m_sliceOutputLock;
+    ThreadSafeInteger  m_sliceOutputFrame;  // encode order of the access unit being published
     /* For HDR*/
     double                m_cB;
     double                m_cR;
@@ -243,6 +262,20 @@ public:
     void stopJobs();
     void destroy();
 
+    enum { MAX_PARAM_STRINGS = 16 };
+    static int getParamStrings(x265_param* param, const char** strings[MAX_PARAM_STRINGS]);
+
+    /* removes our job providers from a shared thread pool, once no more jobs
+     * can be started. Does nothing if our pools are private */
+    void detachThreadPool();
+
+    /* number of our job providers bound to the pool, frame encoders without
+     * WPP have ThreadLocalData past the pool's thread IDs for each of them */
+    int  numPoolProviders(const ThreadPool* pool) const;
+
+    /* plane layout of zero-copy input pictures, see x265_encoder_input_layout() */
+    void inputLayout(int stride[3], int offset[3], int size[3]) const;
+
     int encode(const x265_picture* pic, x265_picture *pic_out);
 
     int reconfigureParam(x265_param* encParam, x265_param* param);
@@ -290,6 +323,8 @@ public:
     int getPuShape(puOrientation* puOrient, int partSize, int numCTU);
 
     void writeAnalysisFile(x265_analysis_data* pic, FrameData &curEncData);
+    void readAnalysisIndex(x265_analysis_data* analysis, int poc);
+    void writeAnalysisIndex(x265_analysis_data* analysis, FrameData &curEncData);
     void readAnalysis2PassFile(x265_analysis_2Pass* analysis2Pass, int poc, int sliceType);
     void writeAnalysis2PassFile(x265_analysis_2Pass* analysis2Pass, FrameData &curEncData, int slicetype);
     void finishFrameStats(Frame* pic, FrameEncoder *curEncoder, x265_frame_stats* frameStats, int inPoc);
@@ -52,6 +52,11 @@ FrameEncoder::FrameEncoder()
     m_outStreams = NULL;
     m_backupStreams = NULL;
     m_substreamSizes = NULL;
+    m_sliceOutputDone = NULL;
+    m_sliceRowsFinished = NULL;
+    m_sliceOutputNext = 0;
+    m_sliceOutputNal = 0;
+    m_sliceOutputOrder = -1;
     m_nr = NULL;
     m_tld = NULL;
     m_rows = NULL;
@@ -61,6 +66,7 @@ FrameEncoder::FrameEncoder()
     m_cuGeoms = NULL;
     m_ctuGeomMap = NULL;
     m_localTldIdx = 0;
+    m_numTLD = 0;
     memset(&m_rce, 0, sizeof(RateControlEntry));
 }
 
@@ -70,10 +76,7 @@ void FrameEncoder::destroy()
     {
         if (!m_jpId)
         {
-            int numTLD = m_pool->m_numWorkers;
-            if (!m_param->bEnableWavefront)
-                numTLD += m_pool->m_numProviders;
-            for (int i = 0; i < numTLD; i++)
+            for (int i = 0; i < m_numTLD; i++)
                 m_tld[i].destroy();
             delete [] m_tld;
         }
@@ -89,6 +92,8 @@ void FrameEncoder::destroy()
     delete[] m_backupStreams;
     X265_FREE(m_sliceBaseRow);
     X265_FREE(m_sliceMaxBlockRow);
+    X265_FREE(m_sliceOutputDone);
+    X265_FREE((void*)m_sliceRowsFinished);
     X265_FREE(m_cuGeoms);
     X265_FREE(m_ctuGeomMap);
     X265_FREE(m_substreamSizes);
@@ -119,6 +124,10 @@ bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
 
     m_sliceBaseRow = X265_MALLOC(uint32_t, m_param->maxSlices + 1);
     ok &= !!m_sliceBaseRow;
+    m_sliceOutputDone = X265_MALLOC(uint8_t, m_param->maxSlices);
+    ok &= !!m_sliceOutputDone;
+    m_sliceRowsFinished = X265_MALLOC(int, m_param->maxSlices);
+    ok &= !!m_sliceRowsFinished;
     m_sliceGroupSize = (uint16_t)(m_numRows + m_param->maxSlices - 1) / m_param->maxSlices;
     uint32_t sliceGroupSizeAccu = (m_numRows << 8) / m_param->maxSlices;    
     uint32_t rowSum = sliceGroupSizeAccu;
@@ -160,6 +169,7 @@ bool FrameEncoder::init(Encoder *top, int numRows, int numCols)
     range += NTAPS_LUMA / 2;                 /* subpel filter half-length */
     range += 2 + (MotionEstimate::hpelIterationCount(m_param->subpelRefine) + 1) / 2; /* subpel refine steps */
     m_refLagRows = /*(m_param->maxSlices > 1 ? 1 : 0) +*/ 1 + ((range + m_param->maxCUSize - 1) / m_param->maxCUSize);
+    m_refLagCols = 1 + ((range + m_param->maxCUSize - 1) / m_param->maxCUSize);
 
     // NOTE: 2 times of numRows because both Encoder and Filter in same queue
     if (!WaveFront::init(m_numRows * 2))
@@ -264,6 +274,7 @@ bool FrameEncoder::startCompressFrame(Frame* curFrame)
     m_slicetypeWaitTime = x265_mdate() - m_prevOutputTime;
     m_frame = curFrame;
     m_sliceType = curFrame->m_lowres.sliceType;
+    m_encodeOrder = curFrame->m_encodeOrder;
     curFrame->m_encData->m_frameEncoderID = m_jpId;
     curFrame->m_encData->m_jobProvider = this;
     curFrame->m_encData->m_slice->m_mref = m_mref;
@@ -291,31 +302,32 @@ void FrameEncoder::threadMain()
          * each FE also needs a TLD instance */
         if (!m_jpId)
         {
-            int numTLD = m_pool->m_numWorkers;
+            int numTLD = m_pool->numThreadIds();
             if (!m_param->bEnableWavefront)
-                numTLD += m_pool->m_numProviders;
+                numTLD += m_top->numPoolProviders(m_pool);
 
             m_tld = new ThreadLocalData[numTLD];
+            m_numTLD = numTLD;
             for (int i = 0; i < numTLD; i++)
             {
                 m_tld[i].analysis.initSearch(*m_param, m_top->m_scalingList);
                 m_tld[i].analysis.create(m_tld);
             }
 
-            for (int i = 0; i < m_pool->m_numProviders; i++)
+            /* the pool may be shared with other encoders, so our peers are
+             * found among our encoder's frame encoders, not in the pool */
+            for (int i = 0; i < m_param->frameNumThreads; i++)
             {
-                if (m_pool->m_jpTable[i]->m_isFrameEncoder) /* ugh; over-allocation and other issues here */
-                {
-                    FrameEncoder *peer = dynamic_cast<FrameEncoder*>(m_pool->m_jpTable[i]);
+                FrameEncoder *peer = m_top->m_frameEncoder[i];
+                if (peer->m_pool == m_pool)
                     peer->m_tld = m_tld;
-                }
             }
         }
 
         if (m_param->bEnableWavefront)
             m_localTldIdx = -1; // cause exception if used
         else
-            m_localTldIdx = m_pool->m_numWorkers + m_jpId;
+            m_localTldIdx = m_pool->numThreadIds() + m_jpId;
     }
     else
     {
@@ -353,6 +365,126 @@ void FrameEncoder::WeightAnalysis::processTasks(int /* workerThreadId */)
 }
 
 
+/* Block until the given row of a reference picture is reconstructed. While we
+ * are blocked, the frame encoder producing that picture is boosted to the
+ * front of the thread pool's schedule (see JobProvider::priority()) */
+void FrameEncoder::waitForReconRow(Frame* refpic, int rowIdx)
+{
+    if (refpic->m_reconRowFlag[rowIdx].get())
+        return;
+
+    JobProvider* refEncoder = refpic->m_encData->m_jobProvider;
+    if (refEncoder)
+        ATOMIC_INC(&refEncoder->m_blockedCount);
+
+    while (refpic->m_reconRowFlag[rowIdx].get() == 0)
+        refpic->m_reconRowFlag[rowIdx].waitForChange(0);
+
+    if (refEncoder)
+        ATOMIC_DEC(&refEncoder->m_blockedCount);
+}
+
+/* With --column-sync, returns the number of leading CTUs of the given row
+ * whose motion reference pixels (m_refLagCols CTUs to the right, in row
+ * refLagRow()) are reconstructed in every reference picture. Horizontal
+ * motion vectors are clipped to the same range as vertical ones, see
+ * Search::setSearchRange(). limiter returns the reference picture which
+ * bounds the result, or NULL if all are complete */
+uint32_t FrameEncoder::refColsAvailable(uint32_t row, Frame*& limiter)
+{
+    Slice* slice = m_frame->m_encData->m_slice;
+    int numPredDir = slice->isInterP() ? 1 : slice->isInterB() ? 2 : 0;
+    const uint32_t rowIdx = refLagRow(row);
+    uint32_t avail = m_numCols;
+
+    limiter = NULL;
+    for (int l = 0; l < numPredDir; l++)
+    {
+        for (int ref = 0; ref < slice->m_numRefIdx[l]; ref++)
+        {
+            Frame* refpic = slice->m_refFrameList[l][ref];
+            uint32_t cols = (uint32_t)refpic->m_reconColCount[rowIdx].get();
+            if (cols >= m_numCols)
+                continue;
+
+            cols = cols > m_refLagCols ? cols - m_refLagCols : 0;
+            if (cols < avail)
+            {
+                avail = cols;
+                limiter = refpic;
+            }
+        }
+    }
+
+    return avail;
+}
+
+/* Block until at least numCols CTUs of a reference picture row are
+ * reconstructed, or until that row makes any progress if it is being waited
+ * on to service other rows. Like waitForReconRow(), the frame encoder of the
+ * reference picture is boosted while we are blocked */
+void FrameEncoder::waitForReconCols(Frame* refpic, int rowIdx, uint32_t numCols)
+{
+    int cols = refpic->m_reconColCount[rowIdx].get();
+    if ((uint32_t)cols >= numCols)
+        return;
+
+    JobProvider* refEncoder = refpic->m_encData->m_jobProvider;
+    if (refEncoder)
+        ATOMIC_INC(&refEncoder->m_blockedCount);
+
+    refpic->m_reconColCount[rowIdx].waitForChange(cols);
+
+    if (refEncoder)
+        ATOMIC_DEC(&refEncoder->m_blockedCount);
+}
+
+/* Re-queue WPP rows which worker threads parked because the reference
+ * pictures had not reconstructed enough columns (see processRowEncoder()).
+ * Returns the reference picture (and row, and column count) the first row
+ * still parked is waiting for, or NULL if no rows are parked */
+Frame* FrameEncoder::resumeRefBlockedRows(int& waitRow, uint32_t& waitCols)
+{
+    Frame* waitPic = NULL;
+
+    for (uint32_t row = 0; row < m_numRows; row++)
+    {
+        CTURow& curRow = m_rows[row];
+        if (!curRow.refBlocked)
+            continue;
+
+        Frame* limiter;
+        uint32_t avail = refColsAvailable(row, limiter);
+
+        ScopedLock self(curRow.lock);
+        if (avail <= curRow.completed)
+        {
+            if (!waitPic)
+            {
+                waitPic = limiter;
+                waitRow = (int)refLagRow(row);
+                waitCols = X265_MIN(curRow.completed + m_refLagCols + 1, m_numCols);
+            }
+            continue;
+        }
+
+        curRow.refBlocked = false;
+
+        /* if the row above is not far enough ahead, it will re-activate this
+         * row itself once it is (this can only happen after a VBV restart) */
+        bool bFirstRowInSlice = !row || m_rows[row - 1].sliceId != curRow.sliceId;
+        if (!curRow.active && !m_bAllRowsStop &&
+            (bFirstRowInSlice || m_rows[row - 1].completed >= X265_MIN(curRow.completed + 2, m_numCols)))
+        {
+            curRow.active = true;
+            enqueueRowEncoder(m_row_to_idx[row]);
+            tryWakeOne();
+        }
+    }
+
+    return waitPic;
+}
+
 uint32_t getBsLength( int32_t code )
 {
     uint32_t ucode = (code <= 0) ? -code << 1 : (code << 1) - 1;
@@ -381,6 +513,10 @@ void FrameEncoder::compressFrame()
     m_completionCount = 0;
     m_bAllRowsStop = false;
     m_vbvResetTriggerRow = -1;
+    m_sliceOutputNext = 0;
+    m_sliceOutputNal = 0;
+    memset(m_sliceOutputDone, 0, m_param->maxSlices);
+    memset((void*)m_sliceRowsFinished, 0, m_param->maxSlices * sizeof(int));
     m_rowSliceTotalBits[0] = 0;
     m_rowSliceTotalBits[1] = 0;
 
@@ -493,7 +629,7 @@ void FrameEncoder::compressFrame()
 
     int numTLD;
     if (m_pool)
-        numTLD = m_param->bEnableWavefront ? m_pool->m_numWorkers : m_pool->m_numWorkers + m_pool->m_numProviders;
+        numTLD = m_param->bEnableWavefront ? m_pool->numThreadIds() : m_pool->numThreadIds() + m_top->numPoolProviders(m_pool);
     else
         numTLD = 1;
 
@@ -771,6 +907,16 @@ void FrameEncoder::compressFrame()
     if (m_param->bDynamicRefine)
         computeAvgTrainingData();
 
+    /* the AUD, parameter sets and prefix SEI are complete, publish them now
+     * if the previous access unit is out */
+    if (m_top->m_sliceOutput)
+    {
+        ScopedLock outputLock(m_top->m_sliceOutputLock);
+        m_sliceOutputOrder = m_frame->m_encodeOrder;
+        if (m_top->m_sliceOutputFrame.get() == m_sliceOutputOrder)
+            publishNals(false);
+    }
+
     /* Analyze CTU rows, most of the hard work is done here.  Frame is
      * compressed in a wave-front pattern if WPP is enabled. Row based loop
      * filters runs behind the CTU compression and reconstruction */
@@ -822,14 +968,31 @@ void FrameEncoder::compressFrame()
                         // NOTE: we unnecessary wait row that beyond current slice boundary
                         const int rowIdx = X265_MIN(sliceEndRow, (row + m_refLagRows));
 
-                        while (refpic->m_reconRowFlag[rowIdx].get() == 0)
-                            refpic->m_reconRowFlag[rowIdx].waitForChange(0);
+                        bool bWeighted = (bUseWeightP || bUseWeightB) && m_mref[l][ref].isWeighted;
 
-                        if ((bUseWeightP || bUseWeightB) && m_mref[l][ref].isWeighted)
+                        /* with column sync, weighted references are still generated a row at a time */
+                        if (!m_param->bEnableColumnSync || bWeighted)
+                            waitForReconRow(refpic, rowIdx);
+
+                        if (bWeighted)
                             m_mref[l][ref].applyWeight(rowIdx, m_numRows, sliceEndRow, sliceId);
                     }
                 }
 
+                if (m_param->bEnableColumnSync)
+                {
+                    /* wait only for the references of the first CTU of the row,
+                     * while re-queueing rows which have caught up with them */
+                    Frame* limiter;
+                    while (!refColsAvailable(row, limiter))
+                    {
+                        int waitRow;
+                        uint32_t waitCols;
+                        resumeRefBlockedRows(waitRow, waitCols);
+                        waitForReconCols(limiter, refLagRow(row), X265_MIN(m_refLagCols + 1, m_numCols));
+                    }
+                }
+
                 enableRowEncoder(m_row_to_idx[row]); /* clear external dependency for this row */
                 if (!rowInSlice)
                 {
@@ -843,8 +1006,29 @@ void FrameEncoder::compressFrame()
         m_allRowsAvailableTime = x265_mdate();
         tryWakeOne(); /* ensure one thread is active or help-wanted flag is set prior to blocking */
         static const int block_ms = 250;
-        while (m_completionEvent.timedWait(block_ms))
-            tryWakeOne();
+        if (m_param->bEnableColumnSync)
+        {
+            /* m_completionEvent is also triggered by workers parking a row */
+            while (m_completionCount < 2 * (int)m_numRows)
+            {
+                int waitRow;
+                uint32_t waitCols;
+                Frame* waitPic = resumeRefBlockedRows(waitRow, waitCols);
+                if (waitPic)
+                    waitForReconCols(waitPic, waitRow, waitCols);
+                else if (m_completionEvent.timedWait(block_ms))
+                    tryWakeOne();
+            }
+
+            /* consume triggers which arrived after their rows were resumed */
+            while (!m_completionEvent.timedWait(0))
+            {}
+        }
+        else
+        {
+            while (m_completionEvent.timedWait(block_ms))
+                tryWakeOne();
+        }
     }
     else
     {
@@ -862,10 +1046,13 @@ void FrameEncoder::compressFrame()
                         Frame *refpic = slice->m_refFrameList[list][ref];
 
                         const int rowIdx = X265_MIN(m_numRows - 1, (i + m_refLagRows));
-                        while (refpic->m_reconRowFlag[rowIdx].get() == 0)
-                            refpic->m_reconRowFlag[rowIdx].waitForChange(0);
+                        bool bWeighted = (bUseWeightP || bUseWeightB) && m_mref[l][ref].isWeighted;
+
+                        /* with column sync, processRowEncoder() waits on each CTU's references */
+                        if (!m_param->bEnableColumnSync || bWeighted)
+                            waitForReconRow(refpic, rowIdx);
 
-                        if ((bUseWeightP || bUseWeightB) && m_mref[l][ref].isWeighted)
+                        if (bWeighted)
                             m_mref[list][ref].applyWeight(rowIdx, m_numRows, m_numRows, 0);
                     }
                 }
@@ -1031,64 +1218,16 @@ void FrameEncoder::compressFrame()
     if (m_param->bEnableSAO)
         encodeSlice(0);
 
-    m_entropyCoder.setBitstream(&m_bs);
-
-    if (m_param->maxSlices > 1)
+    /* with slice output and no SAO the workers have already written the
+     * slices, as soon as their last row was complete. m_nalList may be
+     * published by another frame's thread, so it is only written with the
+     * slice output lock held from here on */
     {
-        uint32_t nextSliceRow = 0;
-
-        for(uint32_t sliceId = 0; sliceId < m_param->maxSlices; sliceId++)
-        {
-            m_bs.resetBits();
-
-            const uint32_t sliceAddr = nextSliceRow * m_numCols;
-            //CUData* ctu = m_frame->m_encData->getPicCTU(sliceAddr);
-            //const int sliceQp = ctu->m_qp[0];
-            if (m_param->bOptRefListLengthPPS)
-            {
-                ScopedLock refIdxLock(m_top->m_sliceRefIdxLock);
-                m_top->analyseRefIdx(slice->m_numRefIdx);
-            }
-            m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, sliceAddr, m_sliceAddrBits, slice->m_sliceQp);
-
-            // Find rows of current slice
-            const uint32_t prevSliceRow = nextSliceRow;
-            while(nextSliceRow < m_numRows && m_rows[nextSliceRow].sliceId == sliceId)
-                nextSliceRow++;
-
-            // serialize each row, record final lengths in slice header
-            uint32_t maxStreamSize = m_nalList.serializeSubstreams(&m_substreamSizes[prevSliceRow], (nextSliceRow - prevSliceRow), &m_outStreams[prevSliceRow]);
-
-            // complete the slice header by writing WPP row-starts
-            m_entropyCoder.setBitstream(&m_bs);
-            if (slice->m_pps->bEntropyCodingSyncEnabled)
-                m_entropyCoder.codeSliceHeaderWPPEntryPoints(&m_substreamSizes[prevSliceRow], (nextSliceRow - prevSliceRow - 1), maxStreamSize);
-            
-            m_bs.writeByteAlignment();
-
-            m_nalList.serialize(slice->m_nalUnitType, m_bs);
-        }
+        ScopedLock outputLock(m_top->m_sliceOutputLock);
+        while (m_sliceOutputNext < m_param->maxSlices)
+            writeSlice(m_sliceOutputNext++);
     }
-    else
-    {
-        if (m_param->bOptRefListLengthPPS)
-        {
-            ScopedLock refIdxLock(m_top->m_sliceRefIdxLock);
-            m_top->analyseRefIdx(slice->m_numRefIdx);
-        }
-        m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, 0, 0, slice->m_sliceQp);
 
-        // serialize each row, record final lengths in slice header
-        uint32_t maxStreamSize = m_nalList.serializeSubstreams(m_substreamSizes, numSubstreams, m_outStreams);
-
-        // complete the slice header by writing WPP row-starts
-        m_entropyCoder.setBitstream(&m_bs);
-        if (slice->m_pps->bEntropyCodingSyncEnabled)
-            m_entropyCoder.codeSliceHeaderWPPEntryPoints(m_substreamSizes, (slice->m_sps->numCuInHeight - 1), maxStreamSize);
-        m_bs.writeByteAlignment();
-
-        m_nalList.serialize(slice->m_nalUnitType, m_bs);
-    }
     if (isSei && m_param->bSingleSeiNal)
         m_bs.resetBits();
 
@@ -1120,6 +1259,7 @@ void FrameEncoder::compressFrame()
         m_bs.resetBits();
         m_seiReconPictureDigest.setSize(payloadSize);
         m_seiReconPictureDigest.write(m_bs, *slice->m_sps);
+        ScopedLock outputLock(m_top->m_sliceOutputLock);
         m_seiReconPictureDigest.alignAndSerialize(m_bs, true, m_param->bSingleSeiNal, NAL_UNIT_SUFFIX_SEI, m_nalList);
     }
 
@@ -1153,12 +1293,34 @@ void FrameEncoder::compressFrame()
             filler--;
         }
         m_bs.writeByteAlignment();
+        ScopedLock outputLock(m_top->m_sliceOutputLock);
         m_nalList.serialize(NAL_UNIT_FILLER_DATA, m_bs);
         bytes += m_nalList.m_nal[m_nalList.m_numNal - 1].sizeBytes;
         bytes -= 3; //exclude start code prefix
         m_accessUnitBits = bytes << 3;
     }
 
+    if (m_top->m_sliceOutput)
+    {
+        /* access units are published in encode order */
+        int outputFrame;
+        while ((outputFrame = m_top->m_sliceOutputFrame.get()) != m_frame->m_encodeOrder)
+            m_top->m_sliceOutputFrame.waitForChange(outputFrame);
+
+        ScopedLock outputLock(m_top->m_sliceOutputLock);
+        publishNals(true);
+        m_sliceOutputOrder = -1;
+        m_top->m_sliceOutputFrame.incr();
+
+        /* slices of the next frame held back behind this one */
+        for (int i = 0; i < m_param->frameNumThreads; i++)
+        {
+            FrameEncoder* next = m_top->m_frameEncoder[i];
+            if (next->m_sliceOutputOrder == m_frame->m_encodeOrder + 1)
+                next->publishNals(false);
+        }
+    }
+
     m_endCompressTime = x265_mdate();
 
     /* Decrement referenced frame reference counts, allow them to be recycled */
@@ -1287,6 +1449,59 @@ void FrameEncoder::encodeSlice(uint32_t sliceAddr)
         m_entropyCoder.finishSlice();
 }
 
+void FrameEncoder::writeSlice(uint32_t sliceId)
+{
+    Slice* slice = m_frame->m_encData->m_slice;
+    const uint32_t sliceStartRow = m_sliceBaseRow[sliceId];
+
+    /* one substream per row with WPP, multiple slices require WPP */
+    const uint32_t firstStream = m_param->bEnableWavefront ? sliceStartRow : 0;
+    const uint32_t numStreams = m_param->bEnableWavefront ? m_sliceBaseRow[sliceId + 1] - sliceStartRow : 1;
+
+    m_bs.resetBits();
+    m_entropyCoder.setBitstream(&m_bs);
+
+    if (m_param->bOptRefListLengthPPS)
+    {
+        ScopedLock refIdxLock(m_top->m_sliceRefIdxLock);
+        m_top->analyseRefIdx(slice->m_numRefIdx);
+    }
+    m_entropyCoder.codeSliceHeader(*slice, *m_frame->m_encData, sliceStartRow * m_numCols, m_sliceAddrBits, slice->m_sliceQp);
+
+    // serialize each row, record final lengths in slice header
+    uint32_t maxStreamSize = m_nalList.serializeSubstreams(&m_substreamSizes[firstStream], numStreams, &m_outStreams[firstStream]);
+
+    // complete the slice header by writing WPP row-starts
+    m_entropyCoder.setBitstream(&m_bs);
+    if (slice->m_pps->bEntropyCodingSyncEnabled)
+        m_entropyCoder.codeSliceHeaderWPPEntryPoints(&m_substreamSizes[firstStream], numStreams - 1, maxStreamSize);
+    m_bs.writeByteAlignment();
+
+    m_nalList.serialize(slice->m_nalUnitType, m_bs);
+}
+
+void FrameEncoder::outputSlice(uint32_t sliceId)
+{
+    ScopedLock outputLock(m_top->m_sliceOutputLock);
+
+    m_sliceOutputDone[sliceId] = 1;
+    while (m_sliceOutputNext < m_param->maxSlices && m_sliceOutputDone[m_sliceOutputNext])
+        writeSlice(m_sliceOutputNext++);
+
+    if (m_top->m_sliceOutputFrame.get() == m_sliceOutputOrder)
+        publishNals(false);
+}
+
+/* called with m_top->m_sliceOutputLock held */
+void FrameEncoder::publishNals(bool bLast)
+{
+    uint32_t numNal = m_nalList.m_numNal - m_sliceOutputNal;
+    if (numNal || bLast)
+        m_top->m_sliceOutput(m_top->m_sliceOutputOpaque, numNal ? &m_nalList.m_nal[m_sliceOutputNal] : NULL, numNal,
+                             m_frame->m_poc, m_frame->m_pts, bLast);
+    m_sliceOutputNal = m_nalList.m_numNal;
+}
+
 void FrameEncoder::processRow(int row, int threadId)
 {
     int64_t startTime = x265_mdate();
@@ -1433,6 +1648,29 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
         ProfileScopeEvent(encodeCTU);
 
         const uint32_t col = curRow.completed;
+
+        if (m_param->bEnableColumnSync && col >= curRow.refReadyCols)
+        {
+            Frame* limiter;
+            if (!m_param->bEnableWavefront)
+            {
+                /* we are the frame encoder thread, we may block */
+                while ((curRow.refReadyCols = refColsAvailable(row, limiter)) <= col)
+                    waitForReconCols(limiter, refLagRow(row), X265_MIN(col + m_refLagCols + 1, numCols));
+            }
+            else if ((curRow.refReadyCols = refColsAvailable(row, limiter)) <= col)
+            {
+                /* park the row, compressFrame() re-queues it once the
+                 * reference pictures have caught up */
+                ScopedLock self(curRow.lock);
+                curRow.active = false;
+                curRow.busy = false;
+                curRow.refBlocked = true;
+                m_completionEvent.trigger();
+                return;
+            }
+        }
+
         const uint32_t cuAddr = lineStartCUAddr + col;
         CUData* ctu = curEncData.getPicCTU(cuAddr);
         const uint32_t bLastCuInSlice = (bLastRowInSlice & (col == numCols - 1)) ? 1 : 0;
@@ -1763,7 +2001,7 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
             /* activate next row */
             ScopedLock below(m_rows[row + 1].lock);
 
-            if (m_rows[row + 1].active == false &&
+            if (m_rows[row + 1].active == false && !m_rows[row + 1].refBlocked &&
                 m_rows[row + 1].completed + 2 <= curRow.completed)
             {
                 m_rows[row + 1].active = true;
@@ -1850,8 +2088,21 @@ void FrameEncoder::processRowEncoder(int intRow, ThreadLocalData& tld)
     /* flush row bitstream (if WPP and no SAO) or flush frame if no WPP and no SAO */
     /* end_of_sub_stream_one_bit / end_of_slice_segment_flag */
     if (!m_param->bEnableSAO && (m_param->bEnableWavefront || bLastRowInSlice))
+    {
         rowCoder.finishSlice();
 
+        /* without SAO the substreams of the slice are final once all of its
+         * rows are past finishSlice(). Under WPP an earlier row may still be
+         * finishing after the last one, so whichever row is last to get here
+         * writes the slice */
+        if (m_top->m_sliceOutput)
+        {
+            int rowsToFinish = m_param->bEnableWavefront ? (int)(endRowInSlicePlus1 - m_sliceBaseRow[sliceId]) : 1;
+            if (ATOMIC_INC(&m_sliceRowsFinished[sliceId]) == rowsToFinish)
+                outputSlice(sliceId);
+        }
+    }
+
 
     /* Processing left Deblock block with current threading */
     if ((m_param->bEnableLoopFilter | m_param->bEnableSAO) & (rowInSlice >= 2))
@@ -97,6 +97,12 @@ struct CTURow
     volatile uint32_t completed;
     volatile uint32_t avgQPComputed;
 
+    /* --column-sync: count of CTUs of this row known to have their motion
+     * reference pixels reconstructed, and whether the row was parked by a
+     * worker thread waiting for the reference pictures to catch up */
+    uint32_t          refReadyCols;
+    volatile bool     refBlocked;
+
     /* called at the start of each frame to initialize state */
     void init(Entropy& initContext, unsigned int sid)
     {
@@ -104,6 +110,8 @@ struct CTURow
         busy = false;
         completed = 0;
         avgQPComputed = 0;
+        refReadyCols = 0;
+        refBlocked = false;
         sliceId = sid;
         memset(&rowStats, 0, sizeof(rowStats));
         rowGoOnCoder.load(initContext);
@@ -133,6 +141,7 @@ public:
     Event                    m_done;
     Event                    m_completionEvent;
     int                      m_localTldIdx;
+    int                      m_numTLD;        // size of m_tld, if allocated by this frame encoder
     bool                     m_reconfigure; /* reconfigure in progress */
     volatile bool            m_threadActive;
     volatile bool            m_bAllRowsStop;
@@ -145,12 +154,18 @@ public:
     uint32_t                 m_filterRowDelay;
     uint32_t                 m_filterRowDelayCus;
     uint32_t                 m_refLagRows;
+    uint32_t                 m_refLagCols;
 
     CTURow*                  m_rows;
     uint16_t                 m_sliceAddrBits;
     uint32_t                 m_sliceGroupSize;
     uint32_t*                m_sliceBaseRow;    
     uint32_t*                m_sliceMaxBlockRow;
+    uint8_t*                 m_sliceOutputDone;   // slices whose rows are all entropy coded
+    volatile int*            m_sliceRowsFinished; // rows of each slice past finishSlice(), for slice output
+    uint32_t                 m_sliceOutputNext;   // next slice to be written in m_nalList
+    uint32_t                 m_sliceOutputNal;    // NALs of m_nalList given to the slice output callback
+    int                      m_sliceOutputOrder;  // encode order of the frame publishing its NALs, or -1
     int64_t                  m_rowSliceTotalBits[2];
     RateControlEntry         m_rce;
     SEIDecodedPictureHash    m_seiReconPictureDigest;
@@ -224,9 +239,27 @@ protected:
     /* analyze / compress frame, can be run in parallel within reference constraints */
     void compressFrame();
 
+    /* blocks until a reference picture row is reconstructed */
+    void waitForReconRow(Frame* refpic, int rowIdx);
+
+    /* --column-sync, CTU granular reference picture dependencies */
+    uint32_t refLagRow(uint32_t row) const { return X265_MIN(m_sliceBaseRow[m_rows[row].sliceId + 1] - 1, row + m_refLagRows); }
+    uint32_t refColsAvailable(uint32_t row, Frame*& limiter);
+    void     waitForReconCols(Frame* refpic, int rowIdx, uint32_t numCols);
+    Frame*   resumeRefBlockedRows(int& waitRow, uint32_t& waitCols);
+
     /* called by compressFrame to generate final per-row bitstreams */
     void encodeSlice(uint32_t sliceAddr);
 
+    /* write the slice header and row substreams of a slice NAL in m_nalList */
+    void writeSlice(uint32_t sliceId);
+
+    /* x265_encoder_slice_output(), called by the worker completing a slice.
+     * Slices are written in order and their NALs given to the callback once
+     * the frames before this one in encode order have been published */
+    void outputSlice(uint32_t sliceId);
+    void publishNals(bool bLast);
+
     void threadMain();
     int  collectCTUStatistics(const CUData& ctu, FrameStats* frameLog);
     void noiseReductionUpdate();
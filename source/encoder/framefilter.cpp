@@ -345,12 +345,13 @@ void FrameFilter::ParallelFilter::processSaoCTU(SAOParam *saoParam, int col)
 // NOTE: MUST BE delay a row when Deblock enabled, the Deblock will modify above pixels in Horizon pass
 void FrameFilter::ParallelFilter::processPostCu(int col) const
 {
-    // Update finished CU cursor
-    m_frameFilter->m_frame->m_reconColCount[m_row].set(col);
-
     // shortcut path for non-border area
     if ((col != 0) & (col != m_frameFilter->m_numCols - 1) & (m_row != 0) & (m_row != m_frameFilter->m_numRows - 1))
+    {
+        // Update finished CU cursor
+        m_frameFilter->m_frame->m_reconColCount[m_row].set(col + 1);
         return;
+    }
 
     PicYuv *reconPic = m_frameFilter->m_frame->m_reconPic;
     const uint32_t lineStartCUAddr = m_rowAddr + col;
@@ -433,6 +434,9 @@ void FrameFilter::ParallelFilter::processPostCu(int col) const
             }
         }
     }
+
+    // Update finished CU cursor, once borders are extended
+    m_frameFilter->m_frame->m_reconColCount[m_row].set(col + 1);
 }
 
 // NOTE: Single Threading only
@@ -555,7 +559,7 @@ void FrameFilter::ParallelFilter::processTasks(int /*workerThreadId*/)
 
             // Setting column sync counter
             if (!ctuPrev->m_bFirstRowInSlice)
-                m_frameFilter->m_frame->m_reconColCount[m_row - 1].set(numCols - 1);
+                m_frameFilter->m_frame->m_reconColCount[m_row - 1].set(numCols);
         }
         m_lastDeblocked.set(numCols);
     }
@@ -661,6 +665,7 @@ void FrameFilter::processPostRow(int row)
     if(m_param->searchMethod == X265_SEA)
         computeMEIntegral(row);
     // Notify other FrameEncoders that this row of reconstructed pixels is available
+    m_frame->m_reconColCount[row].set((int)numCols);
     m_frame->m_reconRowFlag[row].set(1);
 
     uint32_t cuAddr = lineStartCUAddr;
@@ -740,7 +740,9 @@ int MotionEstimate::motionEstimate(ReferencePlanes *ref,
                                    int              merange,
                                    MV &             outQMv,
                                    uint32_t         maxSlices,
-                                   pixel *          srcReferencePlane)
+                                   pixel *          srcReferencePlane,
+                                   const MV *       seedQMv,
+                                   int              seedMerange)
 {
     ALIGN_VAR_16(int, costs[16]);
     if (ctuAddr >= 0)
@@ -789,6 +791,25 @@ int MotionEstimate::motionEstimate(ReferencePlanes *ref,
         }
     }
 
+    // measure SAD cost at the full pel rounded seed MV, a search starting point
+    // independent of the MVP. If the search starts there, seedMerange (when
+    // not zero) limits the search range
+    if (seedQMv)
+    {
+        MV smv = seedQMv->clipped(qmvmin, qmvmax).roundToFPel();
+        if (smv != bmv && smv.checkRange(mvmin, mvmax))
+        {
+            int cost = sad(fenc, FENC_STRIDE, fref + smv.x + smv.y * stride, stride) + mvcost(smv << 2);
+            if (cost < bcost)
+            {
+                bcost = cost;
+                bmv = smv;
+                if (seedMerange)
+                    merange = X265_MIN(merange, seedMerange);
+            }
+        }
+    }
+
     X265_CHECK(!(ref->isLowres && numCandidates), "lowres motion candidates not allowed\n")
     // measure SAD cost at each QPEL motion vector candidate
     for (int i = 0; i < numCandidates; i++)
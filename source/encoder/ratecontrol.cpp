@@ -36,6 +36,7 @@
 #include "encoder.h"
 #include "slicetype.h"
 #include "ratecontrol.h"
+#include "statsfile.h"
 #include "sei.h"
 
 #define BR_SHIFT  6
@@ -208,6 +209,7 @@ RateControl::RateControl(x265_param& p)
     m_lastAbrResetPoc = -1;
     m_statFileOut = NULL;
     m_cutreeStatFileOut = m_cutreeStatFileIn = NULL;
+    m_statsFileIn = NULL;
     m_rce2Pass = NULL;
     m_encOrder = NULL;
     m_lastBsliceSatdCost = 0;
@@ -314,7 +316,7 @@ RateControl::RateControl(x265_param& p)
     /* qpstep - value set as encoder specific */
     m_lstep = pow(2, m_param->rc.qpStep / 6.0);
 
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < 3; i++)
         m_cuTreeStats.qpBuffer[i] = NULL;
 }
 
@@ -407,27 +409,59 @@ bool RateControl::init(const SPS& sps)
         if (m_param->rc.bStatRead)
         {
             m_expectedBitsSum = 0;
-            char *p, *statsIn, *statsBuf;
-            /* read 1st pass stats */
-            statsIn = statsBuf = x265_slurp_file(fileName);
-            if (!statsBuf)
-                return false;
-            if (m_param->rc.cuTree)
+            char *p, *opts, *statsIn = NULL, *statsBuf = NULL;
+            int ncu = m_param->rc.qgSize == 8 ? m_ncu * 4 : m_ncu;
+            if (StatsFile::probe(fileName))
+            {
+                /* binary stats are used in place, the records and cu-tree
+                 * data are read from the mapping when needed */
+                m_statsFileIn = new StatsFile;
+                if (!m_statsFileIn->open(fileName))
+                {
+                    x265_log_file(m_param, X265_LOG_ERROR, "stats file %s not valid\n", fileName);
+                    return false;
+                }
+                if (m_param->rc.cuTree && m_statsFileIn->header()->numCuTree != (uint32_t)ncu)
+                {
+                    x265_log(m_param, X265_LOG_ERROR, "CU-tree data in stats file not valid, expected %d entries per frame, found %u\n",
+                             ncu, m_statsFileIn->header()->numCuTree);
+                    return false;
+                }
+                opts = (char*)m_statsFileIn->options();
+            }
+            else
             {
-                char *tmpFile = strcatFilename(fileName, ".cutree");
-                if (!tmpFile)
+                /* read 1st pass stats */
+                statsIn = statsBuf = x265_slurp_file(fileName);
+                if (!statsBuf)
                     return false;
-                m_cutreeStatFileIn = x265_fopen(tmpFile, "rb");
-                X265_FREE(tmpFile);
-                if (!m_cutreeStatFileIn)
+                if (m_param->rc.cuTree)
+                {
+                    char *tmpFile = strcatFilename(fileName, ".cutree");
+                    if (!tmpFile)
+                        return false;
+                    m_cutreeStatFileIn = x265_fopen(tmpFile, "rb");
+                    X265_FREE(tmpFile);
+                    if (!m_cutreeStatFileIn)
+                    {
+                        x265_log_file(m_param, X265_LOG_ERROR, "can't open stats file %s.cutree\n", fileName);
+                        return false;
+                    }
+                }
+
+                opts = statsBuf;
+                statsIn = strchr(statsBuf, '\n');
+                if (!statsIn)
                 {
-                    x265_log_file(m_param, X265_LOG_ERROR, "can't open stats file %s.cutree\n", fileName);
+                    x265_log(m_param, X265_LOG_ERROR, "Malformed stats file\n");
                     return false;
                 }
+                *statsIn = '\0';
+                statsIn++;
             }
 
             /* check whether 1st pass options were compatible with current options */
-            if (strncmp(statsBuf, "#options:", 9))
+            if (strncmp(opts, "#options:", 9))
             {
                 x265_log(m_param, X265_LOG_ERROR,"options list in stats file not valid\n");
                 return false;
@@ -436,15 +470,6 @@ bool RateControl::init(const SPS& sps)
                 int i, j, m;
                 uint32_t k , l;
                 bool bErr = false;
-                char *opts = statsBuf;
-                statsIn = strchr(statsBuf, '\n');
-                if (!statsIn)
-                {
-                    x265_log(m_param, X265_LOG_ERROR, "Malformed stats file\n");
-                    return false;
-                }
-                *statsIn = '\0';
-                statsIn++;
                 if ((p = strstr(opts, " input-res=")) == 0 || sscanf(p, " input-res=%dx%d", &i, &j) != 2)
                 {
                     x265_log(m_param, X265_LOG_ERROR, "Resolution specified in stats file not valid\n");
@@ -517,10 +542,15 @@ bool RateControl::init(const SPS& sps)
                     m_param->lookaheadDepth = i;
             }
             /* find number of pics */
-            p = statsIn;
             int numEntries;
-            for (numEntries = -1; p; numEntries++)
-                p = strchr(p + 1, ';');
+            if (m_statsFileIn)
+                numEntries = (int)m_statsFileIn->numFrames();
+            else
+            {
+                p = statsIn;
+                for (numEntries = -1; p; numEntries++)
+                    p = strchr(p + 1, ';');
+            }
             if (!numEntries)
             {
                 x265_log(m_param, X265_LOG_ERROR, "empty stats file\n");
@@ -573,18 +603,65 @@ bool RateControl::init(const SPS& sps)
                 int e;
                 char *next;
                 double qpRc, qpAq, qNoVbv, qRceq;
-                next = strstr(p, ";");
-                if (next)
-                    *next++ = 0;
-                e = sscanf(p, " in:%d out:%d", &frameNumber, &encodeOrder);
+                const StatsFrameRecord* record = NULL;
+                if (m_statsFileIn)
+                {
+                    record = m_statsFileIn->frame(i);
+                    frameNumber = record->poc;
+                    encodeOrder = record->encodeOrder;
+                    e = 2;
+                    next = NULL;
+                }
+                else
+                {
+                    next = strstr(p, ";");
+                    if (next)
+                        *next++ = 0;
+                    e = sscanf(p, " in:%d out:%d", &frameNumber, &encodeOrder);
+                }
                 if (frameNumber < 0 || frameNumber >= m_numEntries)
                 {
                     x265_log(m_param, X265_LOG_ERROR, "bad frame number (%d) at stats line %d\n", frameNumber, i);
                     return false;
                 }
+                /* binary records are in encode order, cu-tree data is looked up by it */
+                if (encodeOrder < 0 || encodeOrder >= m_numEntries || (m_statsFileIn && encodeOrder != i))
+                {
+                    x265_log(m_param, X265_LOG_ERROR, "bad encode order (%d) at stats line %d\n", encodeOrder, i);
+                    return false;
+                }
                 rce = &m_rce2Pass[encodeOrder];
                 m_encOrder[frameNumber] = encodeOrder;
-                if (!m_param->bMultiPassOptRPS)
+                if (record)
+                {
+                    picType = record->type;
+                    qpRc = record->qpRc;
+                    qpAq = record->qpAq;
+                    qNoVbv = record->qpNoVbv;
+                    qRceq = record->qRceq;
+                    rce->coeffBits = record->coeffBits;
+                    rce->mvBits = record->mvBits;
+                    rce->miscBits = record->miscBits;
+                    rce->iCuCount = record->iCuCount;
+                    rce->pCuCount = record->pCuCount;
+                    rce->skipCuCount = record->skipCuCount;
+                    e += 11;
+                    if (m_param->bMultiPassOptRPS)
+                    {
+                        rce->rpsData.numberOfPictures = record->numberOfPictures;
+                        rce->rpsData.numberOfNegativePictures = record->numberOfNegativePictures;
+                        rce->rpsData.numberOfPositivePictures = record->numberOfPositivePictures;
+                        if (record->numberOfPictures < 0 || record->numberOfPictures > MAX_NUM_REF_PICS)
+                            e = -1;
+                        for (int j = 0; j < MAX_NUM_REF_PICS; j++)
+                        {
+                            rce->rpsData.deltaPOC[j] = record->deltaPOC[j];
+                            rce->rpsData.bUsed[j] = !!record->bUsed[j];
+                        }
+                        rce->rpsIdx = -1;
+                    }
+                }
+                else if (!m_param->bMultiPassOptRPS)
                 {
                     e += sscanf(p, " in:%*d out:%*d type:%c q:%lf q-aq:%lf q-noVbv:%lf q-Rceq:%lf tex:%d mv:%d misc:%d icu:%lf pcu:%lf scu:%lf",
                         &picType, &qpRc, &qpAq, &qNoVbv, &qRceq, &rce->coeffBits,
@@ -658,10 +735,33 @@ bool RateControl::init(const SPS& sps)
                 return false;
             }
             p = x265_param2string(m_param, sps.conformanceWindow.rightOffset, sps.conformanceWindow.bottomOffset);
-            if (p)
+            if (m_param->bStatsBinary)
+            {
+                /* the options string is stored as the text options line, so
+                 * both formats are validated the same way */
+                char *opts = p ? X265_MALLOC(char, strlen(p) + 11) : NULL;
+                bool bOk = opts != NULL;
+                if (opts)
+                {
+                    sprintf(opts, "#options: %s", p);
+                    bOk = StatsFile::writeHeader(m_statFileOut, opts, m_param->rc.cuTree ? (m_param->rc.qgSize == 8 ? m_ncu * 4 : m_ncu) : 0);
+                }
+                X265_FREE(opts);
+                if (!bOk)
+                {
+                    X265_FREE(p);
+                    x265_log_file(m_param, X265_LOG_ERROR, "can't write stats file %s.temp\n", fileName);
+                    return false;
+                }
+            }
+            else if (p)
                 fprintf(m_statFileOut, "#options: %s\n", p);
             X265_FREE(p);
-            if (m_param->rc.cuTree && !m_param->rc.bStatRead)
+            /* text stats keep the cu-tree data in a separate .cutree file. A
+             * multi-pass read of text stats leaves that file in place, but
+             * binary stats hold the cu-tree data themselves, so writing text
+             * stats from them must write the .cutree file as well */
+            if (m_param->rc.cuTree && !m_param->bStatsBinary && (!m_param->rc.bStatRead || m_statsFileIn))
             {
                 statFileTmpname = strcatFilename(fileName, ".cutree.temp");
                 if (!statFileTmpname)
@@ -689,6 +789,10 @@ bool RateControl::init(const SPS& sps)
                 if (m_param->bBPyramid && m_param->rc.bStatRead)
                     m_cuTreeStats.qpBuffer[1] = X265_MALLOC(uint16_t, m_ncu * sizeof(uint16_t));
             }
+            /* the lookahead reads text cu-tree stats into the first buffers
+             * while frames are written */
+            if (m_param->bStatsBinary && m_param->rc.bStatRead && m_param->rc.bStatWrite)
+                m_cuTreeStats.qpBuffer[2] = X265_MALLOC(uint16_t, (m_param->rc.qgSize == 8 ? m_ncu * 4 : m_ncu) * sizeof(uint16_t));
             m_cuTreeStats.qpBufPos = -1;
         }
     }
@@ -1556,7 +1660,17 @@ bool RateControl::cuTreeReadFor2Pass(Frame* frame)
         ncu = m_ncu * 4;
     else
         ncu = m_ncu;
-    if (m_rce2Pass[index].keptAsRef)
+    if (m_rce2Pass[index].keptAsRef && m_statsFileIn)
+    {
+        /* binary stats hold the cu-tree data of each frame with its record */
+        const uint16_t* qpBuffer = m_statsFileIn->cuTreeQp(m_statsFileIn->frame(index));
+        if (!qpBuffer)
+            goto fail;
+        primitives.fix8Unpack(frame->m_lowres.qpCuTreeOffset, (uint16_t*)qpBuffer, ncu);
+        for (int i = 0; i < ncu; i++)
+            frame->m_lowres.invQscaleFactor[i] = x265_exp2fix8(frame->m_lowres.qpCuTreeOffset[i]);
+    }
+    else if (m_rce2Pass[index].keptAsRef)
     {
         /* TODO: We don't need pre-lookahead to measure AQ offsets, but there is currently
          * no way to signal this */
@@ -2802,7 +2916,51 @@ int RateControl::writeRateControlFrameStats(Frame* curFrame, RateControlEntry* r
     char cType = rce->sliceType == I_SLICE ? (curFrame->m_lowres.sliceType == X265_TYPE_IDR ? 'I' : 'i')
         : rce->sliceType == P_SLICE ? 'P'
         : IS_REFERENCED(curFrame) ? 'B' : 'b';
-    
+
+    if (m_param->bStatsBinary)
+    {
+        StatsFrameRecord record;
+        memset(&record, 0, sizeof(record));
+        record.poc = rce->poc;
+        record.encodeOrder = rce->encodeOrder;
+        record.type = cType;
+        record.qpRc = curEncData.m_avgQpRc;
+        record.qpAq = curEncData.m_avgQpAq;
+        record.qpNoVbv = rce->qpNoVbv;
+        record.qRceq = rce->qRceq;
+        record.coeffBits = curEncData.m_frameStats.coeffBits;
+        record.mvBits = curEncData.m_frameStats.mvBits;
+        record.miscBits = curEncData.m_frameStats.miscBits;
+        record.iCuCount = curEncData.m_frameStats.percent8x8Intra * m_ncu;
+        record.pCuCount = curEncData.m_frameStats.percent8x8Inter * m_ncu;
+        record.skipCuCount = curEncData.m_frameStats.percent8x8Skip * m_ncu;
+        if (curEncData.m_param->bMultiPassOptRPS)
+        {
+            RPS* rpsWriter = &curEncData.m_slice->m_rps;
+            record.numberOfPictures = rpsWriter->numberOfPictures;
+            record.numberOfNegativePictures = rpsWriter->numberOfNegativePictures;
+            record.numberOfPositivePictures = rpsWriter->numberOfPositivePictures;
+            for (int i = 0; i < rpsWriter->numberOfPictures; i++)
+            {
+                record.deltaPOC[i] = rpsWriter->deltaPOC[i];
+                record.bUsed[i] = rpsWriter->bUsed[i];
+            }
+        }
+
+        /* unlike the .cutree file, multi-pass reads write the cu-tree data
+         * again, it must be present in every record */
+        uint16_t* qpBuffer = NULL;
+        if (m_param->rc.cuTree && IS_REFERENCED(curFrame))
+        {
+            qpBuffer = m_cuTreeStats.qpBuffer[m_param->rc.bStatRead ? 2 : 0];
+            primitives.fix8Pack(qpBuffer, curFrame->m_lowres.qpCuTreeOffset, ncu);
+            record.bCuTree = 1;
+        }
+        if (!StatsFile::writeFrame(m_statFileOut, record, qpBuffer, m_param->rc.cuTree ? ncu : 0))
+            goto writeFailure;
+        return 0;
+    }
+
     if (!curEncData.m_param->bMultiPassOptRPS)
     {
         if (fprintf(m_statFileOut,
@@ -2852,8 +3010,9 @@ int RateControl::writeRateControlFrameStats(Frame* curFrame, RateControlEntry* r
             deltaPOC, bUsed) < 0)
             goto writeFailure;
     }
-    /* Don't re-write the data in multi-pass mode. */
-    if (m_param->rc.cuTree && IS_REFERENCED(curFrame) && !m_param->rc.bStatRead)
+    /* Don't re-write the data in multi-pass mode, unless the input stats
+     * were binary and there is no .cutree file to keep */
+    if (m_cutreeStatFileOut && IS_REFERENCED(curFrame))
     {
         uint8_t sliceType = (uint8_t)rce->sliceType;
         primitives.fix8Pack(m_cuTreeStats.qpBuffer[0], curFrame->m_lowres.qpCuTreeOffset, ncu);
@@ -2897,6 +3056,10 @@ void RateControl::destroy()
     if (!fileName)
         fileName = s_defaultStatFileName;
 
+    /* unmap the input first, a multi-pass read replaces it below */
+    delete m_statsFileIn;
+    m_statsFileIn = NULL;
+
     if (m_statFileOut)
     {
         fclose(m_statFileOut);
@@ -2938,7 +3101,7 @@ void RateControl::destroy()
 
     X265_FREE(m_rce2Pass);
     X265_FREE(m_encOrder);
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < 3; i++)
         X265_FREE(m_cuTreeStats.qpBuffer[i]);
     
     X265_FREE(m_param->rc.zones);
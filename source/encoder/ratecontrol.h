@@ -35,6 +35,7 @@ namespace X265_NS {
 class Encoder;
 class Frame;
 class SEIBufferingPeriod;
+class StatsFile;
 struct SPS;
 #define BASE_FRAME_DURATION 0.04
 
@@ -220,6 +221,7 @@ public:
     FILE*   m_statFileOut;
     FILE*   m_cutreeStatFileOut;
     FILE*   m_cutreeStatFileIn;
+    StatsFile* m_statsFileIn;    /* binary stats file, replaces the text stats and .cutree inputs */
     double  m_lastAccumPNorm;
     double  m_expectedBitsSum;   /* sum of qscale2bits after rceq, ratefactor, and overflow, only includes finished frames */
     int64_t m_predictedBits;
@@ -227,7 +229,8 @@ public:
     RateControlEntry* m_rce2Pass;
     struct
     {
-        uint16_t *qpBuffer[2]; /* Global buffers for converting MB-tree quantizer data. */
+        uint16_t *qpBuffer[3]; /* Global buffers for converting MB-tree quantizer data, the
+                                * third one packs the binary stats output of a multi-pass read. */
         int qpBufPos;          /* In order to handle pyramid reordering, QP buffer acts as a stack.
                                 * This value is the current position (0 or 1). */
     } m_cuTreeStats;
@@ -1934,6 +1934,11 @@ uint32_t Search::mergeEstimation(CUData& cu, const CUGeom& cuGeom, const Predict
             if (candMvField[mergeCand][0].mv.y >= (m_param->searchRange + 1) * 4 ||
                 candMvField[mergeCand][1].mv.y >= (m_param->searchRange + 1) * 4)
                 continue;
+
+            if (m_param->bEnableColumnSync &&
+                (candMvField[mergeCand][0].mv.x >= (m_param->searchRange + 1) * 4 ||
+                 candMvField[mergeCand][1].mv.x >= (m_param->searchRange + 1) * 4))
+                continue;
         }
 
         cu.m_mv[0][pu.puAbsPartIdx] = candMvField[mergeCand][0].mv;
@@ -2009,6 +2014,9 @@ int Search::selectMVP(const CUData& cu, const PredictionUnit& pu, const MV amvp[
             if (mvCand.y >= (m_param->searchRange + 1) * 4)
                 continue;
 
+            if (m_param->bEnableColumnSync && mvCand.x >= (m_param->searchRange + 1) * 4)
+                continue;
+
             if ((m_param->maxSlices > 1) &
                 ((mvCand.y < m_sliceMinY)
               |  (mvCand.y > m_sliceMaxY)))
@@ -2096,11 +2104,11 @@ void Search::singleMotionEstimation(Search& master, Mode& interMode, const Predi
 
     const MV* amvp = interMode.amvpCand[list][ref];
     int mvpIdx = selectMVP(interMode.cu, pu, amvp, list, ref);
-    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx];
+    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx], lmv = 0;
 
     if (!m_param->analysisSave && !m_param->analysisLoad) /* Prevents load/save outputs from diverging if lowresMV is not available */
     {
-        MV lmv = getLowresMV(interMode.cu, pu, list, ref);
+        lmv = getLowresMV(interMode.cu, pu, list, ref);
         if (lmv.notZero())
             mvc[numMvc++] = lmv;
     }
@@ -2108,7 +2116,8 @@ void Search::singleMotionEstimation(Search& master, Mode& interMode, const Predi
     setSearchRange(interMode.cu, mvp, m_param->searchRange, mvmin, mvmax);
 
     int satdCost = m_me.motionEstimate(&m_slice->m_mref[list][ref], mvmin, mvmax, mvp, numMvc, mvc, m_param->searchRange, outmv, m_param->maxSlices, 
-      m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
+      m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0,
+      m_param->lowresMvSeed && lmv.notZero() ? &lmv : NULL, lowresSeedMerange());
 
     /* Get total cost of partition, but only include MV bit cost once */
     bits += m_me.bitcost(outmv);
@@ -2346,11 +2355,11 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
 
                     const MV* amvp = interMode.amvpCand[list][ref];
                     int mvpIdx = selectMVP(cu, pu, amvp, list, ref);
-                    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx];
+                    MV mvmin, mvmax, outmv, mvp = amvp[mvpIdx], lmv = 0;
 
                     if (!m_param->analysisSave && !m_param->analysisLoad) /* Prevents load/save outputs from diverging when lowresMV is not available */
                     {
-                        MV lmv = getLowresMV(cu, pu, list, ref);
+                        lmv = getLowresMV(cu, pu, list, ref);
                         if (lmv.notZero())
                             mvc[numMvc++] = lmv;
                     }
@@ -2363,7 +2372,8 @@ void Search::predInterSearch(Mode& interMode, const CUGeom& cuGeom, bool bChroma
                     }
                     setSearchRange(cu, mvp, m_param->searchRange, mvmin, mvmax);
                     int satdCost = m_me.motionEstimate(&slice->m_mref[list][ref], mvmin, mvmax, mvp, numMvc, mvc, m_param->searchRange, outmv, m_param->maxSlices, 
-                      m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0);
+                      m_param->bSourceReferenceEstimation ? m_slice->m_refFrameList[list][ref]->m_fencPic->getLumaAddr(0) : 0,
+                      m_param->lowresMvSeed && lmv.notZero() ? &lmv : NULL, lowresSeedMerange());
 
                     /* Get total cost of partition, but only include MV bit cost once */
                     bits += m_me.bitcost(outmv);
@@ -2673,6 +2683,14 @@ void Search::setSearchRange(const CUData& cu, const MV& mvp, int merange, MV& mv
     mvmin.y = X265_MIN(mvmin.y, (int16_t)m_refLagPixels);
     mvmax.y = X265_MIN(mvmax.y, (int16_t)m_refLagPixels);
 
+    /* with --column-sync, reference pictures are only guaranteed to be
+     * available 'refLagPixels' to the right as well */
+    if (m_param->bEnableColumnSync)
+    {
+        mvmin.x = X265_MIN(mvmin.x, (int16_t)m_refLagPixels);
+        mvmax.x = X265_MIN(mvmax.x, (int16_t)m_refLagPixels);
+    }
+
     /* conditional clipping for negative mv range */
     mvmax.y = X265_MAX(mvmax.y, mvmin.y);
 }
@@ -329,6 +329,10 @@ public:
 
     MV getLowresMV(const CUData& cu, const PredictionUnit& pu, int list, int ref);
 
+    /* search range of motion searches started at the lowres MV, --lowres-mv-seed 2.
+     * The scaled lowres MV is within a few pels of the full resolution MV */
+    int  lowresSeedMerange() const { return m_param->lowresMvSeed > 1 ? X265_MIN(m_param->searchRange, 16) : 0; }
+
     class PME : public BondedTaskGroup
     {
     public:
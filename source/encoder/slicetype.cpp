@@ -45,18 +45,18 @@ using namespace X265_NS;
 namespace {
 
 /* Compute variance to derive AC energy of each block */
-inline uint32_t acEnergyVar(Frame *curFrame, uint64_t sum_ssd, int shift, int plane)
+inline uint32_t acEnergyVar(uint64_t sum_ssd, int shift, int plane, uint64_t wpSum[3], uint64_t wpSsd[3])
 {
     uint32_t sum = (uint32_t)sum_ssd;
     uint32_t ssd = (uint32_t)(sum_ssd >> 32);
 
-    curFrame->m_lowres.wp_sum[plane] += sum;
-    curFrame->m_lowres.wp_ssd[plane] += ssd;
+    wpSum[plane] += sum;
+    wpSsd[plane] += ssd;
     return ssd - ((uint64_t)sum * sum >> shift);
 }
 
 /* Find the energy of each block in Y/Cb/Cr plane */
-inline uint32_t acEnergyPlane(Frame *curFrame, pixel* src, intptr_t srcStride, int plane, int colorFormat, uint32_t qgSize)
+inline uint32_t acEnergyPlane(pixel* src, intptr_t srcStride, int plane, int colorFormat, uint32_t qgSize, uint64_t wpSum[3], uint64_t wpSsd[3])
 {
     if ((colorFormat != X265_CSP_I444) && plane)
     {
@@ -64,28 +64,46 @@ inline uint32_t acEnergyPlane(Frame *curFrame, pixel* src, intptr_t srcStride, i
         {
             ALIGN_VAR_4(pixel, pix[4 * 4]);
             primitives.cu[BLOCK_4x4].copy_pp(pix, 4, src, srcStride);
-            return acEnergyVar(curFrame, primitives.cu[BLOCK_4x4].var(pix, 4), 4, plane);
+            return acEnergyVar(primitives.cu[BLOCK_4x4].var(pix, 4), 4, plane, wpSum, wpSsd);
         }
         else
         {
             ALIGN_VAR_8(pixel, pix[8 * 8]);
             primitives.cu[BLOCK_8x8].copy_pp(pix, 8, src, srcStride);
-            return acEnergyVar(curFrame, primitives.cu[BLOCK_8x8].var(pix, 8), 6, plane);
+            return acEnergyVar(primitives.cu[BLOCK_8x8].var(pix, 8), 6, plane, wpSum, wpSsd);
         }
     }
     else
     {
         if (qgSize == 8)
-            return acEnergyVar(curFrame, primitives.cu[BLOCK_8x8].var(src, srcStride), 6, plane);
+            return acEnergyVar(primitives.cu[BLOCK_8x8].var(src, srcStride), 6, plane, wpSum, wpSsd);
         else
-            return acEnergyVar(curFrame, primitives.cu[BLOCK_16x16].var(src, srcStride), 8, plane);
+            return acEnergyVar(primitives.cu[BLOCK_16x16].var(src, srcStride), 8, plane, wpSum, wpSsd);
+    }
+}
+
+/* true if calcAdaptiveQuantFrame() will need the AC energy of the AQ blocks */
+inline bool needsBlockEnergy(Frame *curFrame, x265_param* param)
+{
+    bool bAQ = !(param->rc.aqMode == X265_AQ_NONE || param->rc.aqStrength == 0) &&
+               !(param->rc.bStatRead && param->rc.cuTree && IS_REFERENCED(curFrame));
+    return bAQ || param->bEnableWeightedPred || param->bEnableWeightedBiPred || param->bDynamicRefine;
+}
+
+/* add the weighted prediction statistics of one pass over the block energies */
+inline void addEnergyStats(Lowres& lowres)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        lowres.wp_sum[i] += lowres.energySum[i];
+        lowres.wp_ssd[i] += lowres.energySsd[i];
     }
 }
 
 } // end anonymous namespace
 
 /* Find the total AC energy of each block in all planes */
-uint32_t LookaheadTLD::acEnergyCu(Frame* curFrame, uint32_t blockX, uint32_t blockY, int csp, uint32_t qgSize)
+uint32_t LookaheadTLD::acEnergyCu(Frame* curFrame, uint32_t blockX, uint32_t blockY, int csp, uint32_t qgSize, uint64_t wpSum[3], uint64_t wpSsd[3])
 {
     intptr_t stride = curFrame->m_fencPic->m_stride;
     intptr_t cStride = curFrame->m_fencPic->m_strideC;
@@ -96,15 +114,34 @@ uint32_t LookaheadTLD::acEnergyCu(Frame* curFrame, uint32_t blockX, uint32_t blo
 
     uint32_t var;
 
-    var  = acEnergyPlane(curFrame, curFrame->m_fencPic->m_picOrg[0] + blockOffsetLuma, stride, 0, csp, qgSize);
+    var  = acEnergyPlane(curFrame->m_fencPic->m_picOrg[0] + blockOffsetLuma, stride, 0, csp, qgSize, wpSum, wpSsd);
     if (csp != X265_CSP_I400 && curFrame->m_fencPic->m_picCsp != X265_CSP_I400)
     {
-        var += acEnergyPlane(curFrame, curFrame->m_fencPic->m_picOrg[1] + blockOffsetChroma, cStride, 1, csp, qgSize);
-        var += acEnergyPlane(curFrame, curFrame->m_fencPic->m_picOrg[2] + blockOffsetChroma, cStride, 2, csp, qgSize);
+        var += acEnergyPlane(curFrame->m_fencPic->m_picOrg[1] + blockOffsetChroma, cStride, 1, csp, qgSize, wpSum, wpSsd);
+        var += acEnergyPlane(curFrame->m_fencPic->m_picOrg[2] + blockOffsetChroma, cStride, 2, csp, qgSize, wpSum, wpSsd);
     }
     x265_emms();
     return var;
 }
+
+/* Find the AC energy of the AQ blocks of block rows [startRow, endRow), in
+ * raster order into m_lowres.blockEnergy. Rows may be processed in parallel
+ * bands, each band accumulating its own weighted prediction statistics */
+void LookaheadTLD::acEnergyRows(Frame* curFrame, x265_param* param, int startRow, int endRow, uint64_t wpSum[3], uint64_t wpSsd[3])
+{
+    int maxCol = curFrame->m_fencPic->m_picWidth;
+    int maxRow = curFrame->m_fencPic->m_picHeight;
+    int loopIncr = param->rc.qgSize == 8 ? 8 : 16;
+    int blocksInRow = (maxCol + loopIncr - 1) / loopIncr;
+    endRow = X265_MIN(endRow, (maxRow + loopIncr - 1) / loopIncr);
+
+    for (int row = startRow; row < endRow; row++)
+    {
+        uint32_t* energy = curFrame->m_lowres.blockEnergy + row * blocksInRow;
+        for (int blockX = 0; blockX < maxCol; blockX += loopIncr)
+            *energy++ = acEnergyCu(curFrame, blockX, row * loopIncr, param->internalCsp, param->rc.qgSize, wpSum, wpSsd);
+    }
+}
 /* Find the sum of pixels of each block for luma plane */
 uint32_t LookaheadTLD::lumaSumCu(Frame* curFrame, uint32_t blockX, uint32_t blockY, uint32_t qgSize)
 {
@@ -121,7 +158,7 @@ uint32_t LookaheadTLD::lumaSumCu(Frame* curFrame, uint32_t blockX, uint32_t bloc
     return (uint32_t)sum_ssd;
 }
 
-void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
+void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param, bool bEnergyReady)
 {
     /* Actual adaptive quantization */
     int maxCol = curFrame->m_fencPic->m_picWidth;
@@ -150,6 +187,17 @@ void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
         curFrame->m_lowres.wp_sum[y] = 0;
     }
 
+    /* the block energies may have been found by the pre-lookahead row bands */
+    uint32_t* blockEnergy = curFrame->m_lowres.blockEnergy;
+    int blockRows = (maxRow + loopIncr - 1) / loopIncr;
+    int energyCount = blockRows * ((maxCol + loopIncr - 1) / loopIncr);
+    if (!bEnergyReady && needsBlockEnergy(curFrame, param))
+    {
+        memset(curFrame->m_lowres.energySum, 0, sizeof(curFrame->m_lowres.energySum));
+        memset(curFrame->m_lowres.energySsd, 0, sizeof(curFrame->m_lowres.energySsd));
+        acEnergyRows(curFrame, param, 0, blockRows, curFrame->m_lowres.energySum, curFrame->m_lowres.energySsd);
+    }
+
     /* Calculate Qp offset for each 16x16 or 8x8 block in the frame */
     int blockXY = 0;
     int blockX = 0, blockY = 0;
@@ -180,11 +228,7 @@ void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
 
         /* Need variance data for weighted prediction and dynamic refinement*/
         if (param->bEnableWeightedPred || param->bEnableWeightedBiPred)
-        {            
-            for (blockY = 0; blockY < maxRow; blockY += loopIncr)
-                for (blockX = 0; blockX < maxCol; blockX += loopIncr)                
-                    acEnergyCu(curFrame, blockX, blockY, param->internalCsp, param->rc.qgSize);                
-        }
+            addEnergyStats(curFrame->m_lowres);
     }
     else
     {
@@ -201,7 +245,7 @@ void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
                 rowVariance = 0;
                 for (blockX = 0; blockX < maxCol; blockX += loopIncr)
                 {
-                    uint32_t energy = acEnergyCu(curFrame, blockX, blockY, param->internalCsp, param->rc.qgSize);
+                    uint32_t energy = blockEnergy[blockXY];
                     rowVariance += energy;
                     qp_adj = pow(energy * bit_depth_correction + 1, 0.1);
                     curFrame->m_lowres.qpCuTreeOffset[blockXY] = qp_adj;
@@ -238,7 +282,7 @@ void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
                 }
                 else
                 {
-                    uint32_t energy = acEnergyCu(curFrame, blockX, blockY, param->internalCsp,param->rc.qgSize);
+                    uint32_t energy = blockEnergy[blockXY];
                     qp_adj = strength * (X265_LOG2(X265_MAX(energy, 1)) - (modeOneConst + 2 * (X265_DEPTH - 8)));                    
                 }
 
@@ -273,6 +317,7 @@ void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
                 blockXY++;
             }
         }
+        addEnergyStats(curFrame->m_lowres);
     }
 
     if (param->rc.qgSize == 8)
@@ -310,13 +355,8 @@ void LookaheadTLD::calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param)
 
     if (param->bDynamicRefine)
     {
-        blockXY = 0;
-        for (blockY = 0; blockY < maxRow; blockY += loopIncr)
-            for (blockX = 0; blockX < maxCol; blockX += loopIncr)
-            {
-                curFrame->m_lowres.blockVariance[blockXY] = acEnergyCu(curFrame, blockX, blockY, param->internalCsp, param->rc.qgSize);
-                blockXY++;
-            }
+        memcpy(curFrame->m_lowres.blockVariance, blockEnergy, energyCount * sizeof(uint32_t));
+        addEnergyStats(curFrame->m_lowres);
     }
 }
 
@@ -599,7 +639,15 @@ Lookahead::Lookahead(x265_param *param, ThreadPool* pool)
     m_outputSignalRequired = false;
     m_isActive = true;
     m_inputCount = 0;
+    m_numOutputWaits = 0;
+    m_outputWaitTime = 0;
+    m_countGroupJobs = 0;
+    m_countSteals = 0;
+    m_countStolenJobs = 0;
+    m_countLockWaits = 0;
     m_extendGopBoundary = false;
+    m_preCount = 0;
+    m_preRunning = 0;
     m_8x8Height = ((m_param->sourceHeight / 2) + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
     m_8x8Width = ((m_param->sourceWidth / 2) + X265_LOWRES_CU_SIZE - 1) >> X265_LOWRES_CU_BITS;
     m_cuCount = m_8x8Width * m_8x8Height;
@@ -656,6 +704,19 @@ Lookahead::Lookahead(x265_param *param, ThreadPool* pool)
         m_numRowsPerSlice = m_8x8Height;
         m_numCoopSlices = 1;
     }
+
+    if (m_param->preLookaheadDepth && !m_pool)
+    {
+        x265_log(param, X265_LOG_WARNING, "No pools found; disabling pre-lookahead-depth\n");
+        m_param->preLookaheadDepth = 0;
+    }
+
+    /* split pre-lookahead pictures in about as many row bands as there are
+     * worker threads, with at least 4 lowres CU rows per band */
+    m_preDepth = m_param->preLookaheadDepth;
+    m_preBandRows = m_8x8Height;
+    if (m_preDepth)
+        m_preBandRows = X265_MAX((m_8x8Height + m_pool->m_numWorkers - 1) / m_pool->m_numWorkers, 4);
     if (param->gopLookahead && (param->gopLookahead > (param->lookaheadDepth - param->bframes - 2)))
     {
         param->gopLookahead = X265_MAX(0, param->lookaheadDepth - param->bframes - 2);
@@ -676,7 +737,7 @@ void Lookahead::getWorkerStats(int64_t& batchElapsedTime, uint64_t& batchCount,
 {
     batchElapsedTime = coopSliceElapsedTime = 0;
     coopSliceCount = batchCount = 0;
-    int tldCount = m_pool ? m_pool->m_numWorkers : 1;
+    int tldCount = m_pool ? m_pool->numThreadIds() : 1;
     for (int i = 0; i < tldCount; i++)
     {
         batchElapsedTime += m_tld[i].batchElapsedTime;
@@ -687,9 +748,17 @@ void Lookahead::getWorkerStats(int64_t& batchElapsedTime, uint64_t& batchCount,
 }
 #endif
 
+void Lookahead::addGroupStats(const WorkStealingTaskGroup& group)
+{
+    ATOMIC_ADD(&m_countGroupJobs, group.m_jobTotal);
+    ATOMIC_ADD(&m_countSteals, group.m_steals);
+    ATOMIC_ADD(&m_countStolenJobs, group.m_stolenJobs);
+    ATOMIC_ADD(&m_countLockWaits, group.m_lockWaits);
+}
+
 bool Lookahead::create()
 {
-    int numTLD = 1 + (m_pool ? m_pool->m_numWorkers : 0);
+    int numTLD = 1 + (m_pool ? m_pool->numThreadIds() : 0);
     m_tld = new LookaheadTLD[numTLD];
     for (int i = 0; i < numTLD; i++)
         m_tld[i].init(m_8x8Width, m_8x8Height, m_8x8Blocks);
@@ -710,6 +779,24 @@ void Lookahead::stopJobs()
         if (wait)
             m_outputSignal.wait();
     }
+    if (m_preDepth)
+    {
+        /* no new row bands are started once m_isActive is false, wait for
+         * the ones in progress */
+        m_preLock.acquire();
+        m_isActive = false;
+        m_preLock.release();
+        for (;;)
+        {
+            int prev = m_preProgress.get();
+            m_preLock.acquire();
+            int running = m_preRunning;
+            m_preLock.release();
+            if (!running)
+                break;
+            m_preProgress.waitForChange(prev);
+        }
+    }
     if (m_pool && m_param->lookaheadThreads > 0)
     {
         for (int i = 0; i < m_numPools; i++)
@@ -760,9 +847,7 @@ void Lookahead::addPicture(Frame& curFrame, int sliceType)
     {
         if (!m_filled)
             m_filled = true;
-        m_outputLock.acquire();
         m_outputQueue.pushBack(curFrame);
-        m_outputLock.release();
         m_inputCount++;
     }
     else
@@ -775,9 +860,11 @@ void Lookahead::addPicture(Frame& curFrame, int sliceType)
 
 void Lookahead::addPicture(Frame& curFrame)
 {
-    m_inputLock.acquire();
+    if (m_preDepth && !curFrame.m_lowresInit)
+        queuePreLookahead(curFrame);
+    else
+        curFrame.m_preQueued = false;
     m_inputQueue.pushBack(curFrame);
-    m_inputLock.release();
     m_inputCount++;
 }
 
@@ -793,10 +880,8 @@ void Lookahead::checkLookaheadQueue(int &frameCnt)
             m_filled = true; /* full capacity plus mini-gop lag */
     }
 
-    m_inputLock.acquire();
     if (m_pool && m_inputQueue.size() >= m_fullQueueSize)
         tryWakeOne();
-    m_inputLock.release();
 }
 
 /* Called by API thread */
@@ -813,7 +898,7 @@ void Lookahead::setLookaheadQueue()
     m_fullQueueSize = X265_MAX(1, m_param->lookaheadDepth);
 }
 
-void Lookahead::findJob(int /*workerThreadID*/)
+void Lookahead::findJob(int workerThreadID)
 {
     bool doDecide;
 
@@ -825,7 +910,13 @@ void Lookahead::findJob(int /*workerThreadID*/)
     m_inputLock.release();
 
     if (!doDecide)
+    {
+        /* worker threads process pre-lookahead row bands while there are no
+         * slice type decisions to be made */
+        if (m_preDepth && workerThreadID >= 0 && processPreLookaheadBand(workerThreadID, NULL))
+            m_helpWanted = true;
         return;
+    }
 
     ProfileLookaheadTime(m_slicetypeDecideElapsedTime, m_countSlicetypeDecide);
     ProfileScopeEvent(slicetypeDecideEV);
@@ -847,12 +938,11 @@ Frame* Lookahead::getDecidedPicture()
 {
     if (m_filled)
     {
-        m_outputLock.acquire();
         Frame *out = m_outputQueue.popFront();
-        m_outputLock.release();
-
         if (out)
         {
+            out->m_lookaheadInputDepth = m_inputQueue.size();
+            out->m_lookaheadOutputDepth = m_outputQueue.size();
             m_inputCount--;
             return out;
         }
@@ -867,11 +957,20 @@ Frame* Lookahead::getDecidedPicture()
         m_inputLock.release();
 
         if (wait)
+        {
+            int64_t startTime = x265_mdate();
             m_outputSignal.wait();
+            m_outputWaitTime += x265_mdate() - startTime;
+            m_numOutputWaits++;
+        }
 
         out = m_outputQueue.popFront();
         if (out)
+        {
+            out->m_lookaheadInputDepth = m_inputQueue.size();
+            out->m_lookaheadOutputDepth = m_outputQueue.size();
             m_inputCount--;
+        }
         return out;
     }
     else
@@ -997,28 +1096,184 @@ void Lookahead::getEstimatedPictureCost(Frame *curFrame)
 void PreLookaheadGroup::processTasks(int workerThreadID)
 {
     if (workerThreadID < 0)
-        workerThreadID = m_lookahead.m_pool ? m_lookahead.m_pool->m_numWorkers : 0;
+        workerThreadID = m_lookahead.m_pool ? m_lookahead.m_pool->numThreadIds() : 0;
     LookaheadTLD& tld = m_lookahead.m_tld[workerThreadID];
 
-    m_lock.acquire();
-    while (m_jobAcquired < m_jobTotal)
+    int slot = -1;
+    int job;
+    while ((job = acquireJob(slot)) >= 0)
     {
-        Frame* preFrame = m_preframes[m_jobAcquired++];
+        Frame* preFrame = m_preframes[job];
         ProfileLookaheadTime(m_lookahead.m_preLookaheadElapsedTime, m_lookahead.m_countPreLookahead);
         ProfileScopeEvent(prelookahead);
-        m_lock.release();
         preFrame->m_lowres.init(preFrame->m_fencPic, preFrame->m_poc);
         if (m_lookahead.m_bAdaptiveQuant)
             tld.calcAdaptiveQuantFrame(preFrame, m_lookahead.m_param);
         tld.lowresIntraEstimate(preFrame->m_lowres, m_lookahead.m_param->rc.qgSize);
         preFrame->m_lowresInit = true;
+    }
+}
+
+/* The pre-lookahead pipeline performs the pre-analysis of input pictures as
+ * soon as they are received, rather than when they enter the slicetypeDecide()
+ * window. Each picture is split in row bands; a band downscales its lowres
+ * lines and finds the AC energy of its AQ blocks. The thread completing the
+ * last band of a picture extends the lowres borders and derives the AQ
+ * offsets and lowres intra costs. Worker threads with nothing else to do
+ * for the lookahead process the bands of the first m_preDepth queued
+ * pictures, and slicetypeDecide() helps finish the pictures it needs */
+
+int Lookahead::numPreBands(Frame& curFrame) const
+{
+    return (curFrame.m_lowres.maxBlocksInCol + m_preBandRows - 1) / m_preBandRows;
+}
+
+/* Called by API thread */
+void Lookahead::queuePreLookahead(Frame& curFrame)
+{
+    int wake = 0;
+
+    m_preLock.acquire();
+    curFrame.m_preQueued = m_preCount < PRE_QUEUE_SIZE;
+    if (curFrame.m_preQueued)
+    {
+        curFrame.m_preNextBand = 0;
+        curFrame.m_preBandsDone = 0;
+        memset(curFrame.m_lowres.energySum, 0, sizeof(curFrame.m_lowres.energySum));
+        memset(curFrame.m_lowres.energySsd, 0, sizeof(curFrame.m_lowres.energySsd));
+        m_preFrames[m_preCount++] = &curFrame;
+        if (m_preCount <= m_preDepth)
+            wake = numPreBands(curFrame);
+    }
+    m_preLock.release();
+
+    while (wake--)
+        tryWakeOne();
+}
+
+/* Process one row band of the first queued picture (or of onlyFrame) which
+ * has bands left, returns false if there were none */
+bool Lookahead::processPreLookaheadBand(int workerThreadID, Frame* onlyFrame)
+{
+    Frame* preFrame = NULL;
+    int band = 0;
+
+    m_preLock.acquire();
+    if (onlyFrame)
+    {
+        if (onlyFrame->m_preNextBand < numPreBands(*onlyFrame))
+            preFrame = onlyFrame;
+    }
+    else if (m_isActive)
+    {
+        int window = X265_MIN(m_preCount, m_preDepth);
+        for (int i = 0; i < window && !preFrame; i++)
+        {
+            if (m_preFrames[i]->m_preNextBand < numPreBands(*m_preFrames[i]))
+                preFrame = m_preFrames[i];
+        }
+    }
+    if (preFrame)
+    {
+        band = preFrame->m_preNextBand++;
+        m_preRunning++;
+    }
+    m_preLock.release();
+
+    if (!preFrame)
+        return false;
+
+    if (workerThreadID < 0)
+        workerThreadID = m_pool ? m_pool->numThreadIds() : 0;
+    LookaheadTLD& tld = m_tld[workerThreadID];
+    Lowres& lowres = preFrame->m_lowres;
+    int numBands = numPreBands(*preFrame);
+    uint64_t wpSum[3] = { 0, 0, 0 };
+    uint64_t wpSsd[3] = { 0, 0, 0 };
+
+    {
+        ProfileLookaheadTime(m_preLookaheadElapsedTime, m_countPreLookahead);
+        ProfileScopeEvent(prelookahead);
+
+        int startRow = band * m_preBandRows;
+        int endRow = X265_MIN(startRow + m_preBandRows, (int)lowres.maxBlocksInCol);
+        lowres.downscale(preFrame->m_fencPic, startRow * X265_LOWRES_CU_SIZE, endRow * X265_LOWRES_CU_SIZE);
+
+        if (m_bAdaptiveQuant && needsBlockEnergy(preFrame, m_param))
+        {
+            /* one or two AQ block rows per lowres CU row, the last band takes
+             * any remaining block rows */
+            int rowScale = m_param->rc.qgSize == 8 ? 2 : 1;
+            int endBlockRow = band == numBands - 1 ? INT_MAX : endRow * rowScale;
+            tld.acEnergyRows(preFrame, m_param, startRow * rowScale, endBlockRow, wpSum, wpSsd);
+        }
+    }
+
+    m_preLock.acquire();
+    for (int i = 0; i < 3; i++)
+    {
+        lowres.energySum[i] += wpSum[i];
+        lowres.energySsd[i] += wpSsd[i];
+    }
+    bool bLastBand = ++preFrame->m_preBandsDone == numBands;
+    m_preLock.release();
+
+    if (bLastBand)
+    {
+        lowres.initState(preFrame->m_fencPic, preFrame->m_poc);
+        lowres.extendBorders(preFrame->m_fencPic);
+        if (m_bAdaptiveQuant)
+            tld.calcAdaptiveQuantFrame(preFrame, m_param, true);
+        tld.lowresIntraEstimate(lowres, m_param->rc.qgSize);
+    }
+
+    int wake = 0;
+    m_preLock.acquire();
+    if (bLastBand)
+    {
+        preFrame->m_lowresInit = true;
 
-        m_lock.acquire();
+        int i = 0;
+        while (m_preFrames[i] != preFrame)
+            i++;
+        for (m_preCount--; i < m_preCount; i++)
+            m_preFrames[i] = m_preFrames[i + 1];
+
+        /* another queued picture may now be processed by worker threads */
+        if (m_isActive && m_preCount >= m_preDepth)
+            wake = numPreBands(*m_preFrames[m_preDepth - 1]) - 1;
+    }
+    m_preRunning--;
+    m_preLock.release();
+
+    m_preProgress.incr();
+    while (wake-- > 0)
+        tryWakeOne();
+
+    return true;
+}
+
+/* Called by slicetypeDecide(). Help with the remaining row bands of a queued
+ * picture, then wait for the bands still being processed by other threads */
+void Lookahead::finishPreLookahead(Frame& curFrame)
+{
+    while (processPreLookaheadBand(-1, &curFrame))
+    {}
+
+    for (;;)
+    {
+        int prev = m_preProgress.get();
+        m_preLock.acquire();
+        bool bDone = curFrame.m_lowresInit;
+        m_preLock.release();
+        if (bDone)
+            break;
+        m_preProgress.waitForChange(prev);
     }
-    m_lock.release();
 }
 
-/* called by API thread or worker thread with inputQueueLock acquired */
+/* called by API thread or worker thread with m_sliceTypeBusy set, making it
+ * the only consumer of the input queue and only producer of the output queue */
 void Lookahead::slicetypeDecide()
 {
     PreLookaheadGroup pre(*this);
@@ -1031,28 +1286,23 @@ void Lookahead::slicetypeDecide()
     maxSearch = X265_MAX(1, maxSearch);
 
     {
-        ScopedLock lock(m_inputLock);
-
-        Frame *curFrame = m_inputQueue.first();
         int j;
         for (j = 0; j < m_param->bframes + 2; j++)
         {
+            Frame *curFrame = m_inputQueue.at(j);
             if (!curFrame) break;
             list[j] = curFrame;
-            curFrame = curFrame->m_next;
         }
 
-        curFrame = m_inputQueue.first();
         frames[0] = m_lastNonB;
         for (j = 0; j < maxSearch; j++)
         {
+            Frame *curFrame = m_inputQueue.at(j);
             if (!curFrame) break;
             frames[j + 1] = &curFrame->m_lowres;
 
-            if (!curFrame->m_lowresInit)
+            if (!curFrame->m_preQueued && !curFrame->m_lowresInit)
                 pre.m_preframes[pre.m_jobTotal++] = curFrame;
-
-            curFrame = curFrame->m_next;
         }
 
         maxSearch = j;
@@ -1061,10 +1311,19 @@ void Lookahead::slicetypeDecide()
     /* perform pre-analysis on frames which need it, using a bonded task group */
     if (pre.m_jobTotal)
     {
-        if (m_pool)
-            pre.tryBondPeers(*m_pool, pre.m_jobTotal);
-        pre.processTasks(-1);
-        pre.waitForExit();
+        pre.runJobs(m_pool, pre.m_jobTotal, !!m_param->bLookaheadSteal);
+        addGroupStats(pre);
+    }
+
+    /* wait for the pictures given to the pre-lookahead pipeline */
+    if (m_preDepth)
+    {
+        for (int j = 0; j < maxSearch; j++)
+        {
+            Frame *curFrame = m_inputQueue.at(j);
+            if (curFrame->m_preQueued)
+                finishPreLookahead(*curFrame);
+        }
     }
 
     if (m_lastNonB && !m_param->rc.bStatRead &&
@@ -1225,7 +1484,6 @@ void Lookahead::slicetypeDecide()
         }
     }
 
-    m_inputLock.acquire();
     /* dequeue all frames from inputQueue that are about to be enqueued
      * in the output queue. The order is important because Frame can
      * only be in one list at a time */
@@ -1237,9 +1495,34 @@ void Lookahead::slicetypeDecide()
         pts[i] = curFrame->m_pts;
         maxSearch--;
     }
-    m_inputLock.release();
 
-    m_outputLock.acquire();
+    /* the keyframe analysis must complete before the mini-GOP is published,
+     * since the output queue has no lock to keep the API thread from taking
+     * frames whose cuTree offsets are still being computed */
+    bool isKeyFrameAnalyse = (m_param->rc.cuTree || (m_param->rc.vbvBufferSize && m_param->lookaheadDepth)) && !m_param->rc.bStatRead;
+    if (isKeyFrameAnalyse && IS_X265_TYPE_I(m_lastNonB->sliceType))
+    {
+        frames[0] = m_lastNonB;
+        int j;
+        for (j = 0; j < maxSearch; j++)
+            frames[j + 1] = &m_inputQueue.at(j)->m_lowres;
+
+        frames[j + 1] = NULL;
+        slicetypeAnalyse(frames, true);
+        bool bIsVbv = m_param->rc.vbvBufferSize > 0 && m_param->rc.vbvMaxBitrate > 0;
+        if (m_param->analysisLoad && m_param->scaleFactor && bIsVbv)
+        {
+            int numFrames;
+            for (numFrames = 0; numFrames < maxSearch; numFrames++)
+            {
+                Lowres *fenc = frames[numFrames + 1];
+                if (!fenc)
+                    break;
+            }
+            vbvLookahead(frames, numFrames, true);
+        }
+    }
+
     /* add non-B to output queue */
     int idx = 0;
     list[bframes]->m_reorderedPts = pts[idx++];
@@ -1267,37 +1550,6 @@ void Lookahead::slicetypeDecide()
             m_outputQueue.pushBack(*list[i]);
         }
     }
-
-    bool isKeyFrameAnalyse = (m_param->rc.cuTree || (m_param->rc.vbvBufferSize && m_param->lookaheadDepth)) && !m_param->rc.bStatRead;
-    if (isKeyFrameAnalyse && IS_X265_TYPE_I(m_lastNonB->sliceType))
-    {
-        m_inputLock.acquire();
-        Frame *curFrame = m_inputQueue.first();
-        frames[0] = m_lastNonB;
-        int j;
-        for (j = 0; j < maxSearch; j++)
-        {
-            frames[j + 1] = &curFrame->m_lowres;
-            curFrame = curFrame->m_next;
-        }
-        m_inputLock.release();
-
-        frames[j + 1] = NULL;
-        slicetypeAnalyse(frames, true);
-        bool bIsVbv = m_param->rc.vbvBufferSize > 0 && m_param->rc.vbvMaxBitrate > 0;
-        if (m_param->analysisLoad && m_param->scaleFactor && bIsVbv)
-        {
-            int numFrames;
-            for (numFrames = 0; numFrames < maxSearch; numFrames++)
-            {
-                Lowres *fenc = frames[numFrames + 1];
-                if (!fenc)
-                    break;
-            }
-            vbvLookahead(frames, numFrames, true);
-        }
-    }
-    m_outputLock.release();
 }
 
 void Lookahead::vbvLookahead(Lowres **frames, int numFrames, int keyframe)
@@ -1539,11 +1791,16 @@ void Lookahead::slicetypeAnalyse(Lowres **frames, bool bKeyframe)
             if (numFrames > 1)
             {
                 char best_paths[X265_BFRAME_MAX + 1][X265_LOOKAHEAD_MAX + 1] = { "", "P" };
+                int64_t best_costs[X265_BFRAME_MAX + 1][2];
                 int best_path_index = numFrames % (X265_BFRAME_MAX + 1);
 
+                CostEstimateGroup estGroup(*this, frames);
+                best_costs[0][0] = best_costs[0][1] = 0;
+                best_costs[1][0] = best_costs[1][1] = estGroup.singleCost(0, 1, 1);
+
                 /* Perform the frame type analysis. */
                 for (int j = 2; j <= numFrames; j++)
-                    slicetypePath(frames, j, best_paths);
+                    slicetypePath(frames, j, best_paths, best_costs);
 
                 numBFrames = (int)strspn(best_paths[best_path_index], "B");
 
@@ -1795,11 +2052,17 @@ bool Lookahead::scenecutInternal(Lowres **frames, int p0, int p1, bool bRealScen
     return res;
 }
 
-void Lookahead::slicetypePath(Lowres **frames, int length, char(*best_paths)[X265_LOOKAHEAD_MAX + 1])
+/* Each candidate path of a given length is the best path of a shorter length
+ * followed by one new mini-GOP, so its cost is the (stored) cost of the best
+ * shorter path plus the cost of the new mini-GOP. best_costs[] holds for each
+ * length the cost of its best path, and that cost up to and including the
+ * P-frame of its last mini-GOP */
+void Lookahead::slicetypePath(Lowres **frames, int length, char(*best_paths)[X265_LOOKAHEAD_MAX + 1], int64_t(*best_costs)[2])
 {
     char paths[2][X265_LOOKAHEAD_MAX + 1];
     int num_paths = X265_MIN(m_param->bframes + 1, length);
     int64_t best_cost = 1LL << 62;
+    int64_t best_pcost = 0;
     int idx = 0;
 
     /* Iterate over all currently possible paths */
@@ -1812,61 +2075,99 @@ void Lookahead::slicetypePath(Lowres **frames, int length, char(*best_paths)[X26
         strcpy(paths[idx] + len + path, "P");
 
         /* Calculate the actual cost of the current path */
-        int64_t cost = slicetypePathCost(frames, paths[idx], best_cost);
+        int64_t pcost = 0;
+        int64_t cost = slicetypePathCost(frames, best_costs[len % (X265_BFRAME_MAX + 1)], len, length, best_cost, pcost);
         if (cost < best_cost)
         {
             best_cost = cost;
+            best_pcost = pcost;
             idx ^= 1;
         }
     }
 
     /* Store the best path. */
     memcpy(best_paths[length % (X265_BFRAME_MAX + 1)], paths[idx ^ 1], length);
+    best_costs[length % (X265_BFRAME_MAX + 1)][0] = best_cost;
+    best_costs[length % (X265_BFRAME_MAX + 1)][1] = best_pcost;
 }
 
-int64_t Lookahead::slicetypePathCost(Lowres **frames, char *path, int64_t threshold)
+/* Cost of the best path of length cur_p followed by a mini-GOP ending with a
+ * P-frame at next_p, terminating early once the cost exceeds the best path
+ * cost so far. The estimates made are those a full walk of the path would
+ * make, so the order of the motion searches (which affects their results)
+ * is preserved. A complete mini-GOP cost is kept by its P-frame for the
+ * following slicetypeDecide() calls */
+int64_t Lookahead::slicetypePathCost(Lowres **frames, const int64_t prefix[2], int cur_p, int next_p, int64_t threshold, int64_t& pcost)
 {
-    int64_t cost = 0;
-    int loc = 1;
-    int cur_p = 0;
-
     CostEstimateGroup estGroup(*this, frames);
+    Lowres* fenc = frames[next_p];
+    int dist = next_p - cur_p;
+    int64_t cost = prefix[0];
 
-    path--; /* Since the 1st path element is really the second frame */
-    while (path[loc])
+    if (cost >= threshold)
     {
-        int next_p = loc;
-        /* Find the location of the next P-frame. */
-        while (path[next_p] != 'P')
-            next_p++;
+        /* the walk of the prefix path stops within it, unless the P-frame of
+         * its last mini-GOP kept it within the threshold; its B-frames then
+         * exceed it and the walk stops after measuring this P-frame */
+        if (prefix[1] <= threshold)
+            estGroup.singleCost(cur_p, next_p, next_p);
+        return cost;
+    }
 
-        /* Add the cost of the P-frame found above */
-        cost += estGroup.singleCost(cur_p, next_p, next_p);
+    if (fenc->miniGopCost[dist] >= 0)
+    {
+        pcost = cost + fenc->costEst[dist][0];
+        return cost + fenc->miniGopCost[dist];
+    }
 
-        /* Early terminate if the cost we have found is larger than the best path cost so far */
-        if (cost > threshold)
-            break;
+    /* Add the cost of the P-frame */
+    int64_t gopCost = estGroup.singleCost(cur_p, next_p, next_p);
+    cost += gopCost;
+    pcost = cost;
 
-        if (m_param->bBPyramid && next_p - cur_p > 2)
-        {
-            int middle = cur_p + (next_p - cur_p) / 2;
-            cost += estGroup.singleCost(cur_p, next_p, middle);
+    /* Early terminate if the cost we have found is larger than the best path cost so far */
+    if (cost > threshold)
+        return cost;
 
-            for (int next_b = loc; next_b < middle && cost < threshold; next_b++)
-                cost += estGroup.singleCost(cur_p, middle, next_b);
+    int loc = cur_p + 1;
+    int next_b;
+    bool bComplete;
+    if (m_param->bBPyramid && dist > 2)
+    {
+        int middle = cur_p + dist / 2;
+        int64_t bcost = estGroup.singleCost(cur_p, next_p, middle);
+        cost += bcost;
+        gopCost += bcost;
 
-            for (int next_b = middle + 1; next_b < next_p && cost < threshold; next_b++)
-                cost += estGroup.singleCost(middle, next_p, next_b);
-        }
-        else
+        for (next_b = loc; next_b < middle && cost < threshold; next_b++)
         {
-            for (int next_b = loc; next_b < next_p && cost < threshold; next_b++)
-                cost += estGroup.singleCost(cur_p, next_p, next_b);
+            bcost = estGroup.singleCost(cur_p, middle, next_b);
+            cost += bcost;
+            gopCost += bcost;
         }
+        bComplete = next_b == middle;
 
-        loc = next_p + 1;
-        cur_p = next_p;
+        for (next_b = middle + 1; next_b < next_p && cost < threshold; next_b++)
+        {
+            bcost = estGroup.singleCost(middle, next_p, next_b);
+            cost += bcost;
+            gopCost += bcost;
+        }
+        bComplete &= next_b >= next_p;
     }
+    else
+    {
+        for (next_b = loc; next_b < next_p && cost < threshold; next_b++)
+        {
+            int64_t bcost = estGroup.singleCost(cur_p, next_p, next_b);
+            cost += bcost;
+            gopCost += bcost;
+        }
+        bComplete = next_b == next_p;
+    }
+
+    if (bComplete)
+        fenc->miniGopCost[dist] = gopCost;
 
     return cost;
 }
@@ -2252,7 +2553,7 @@ int64_t Lookahead::frameCostRecalculate(Lowres** frames, int p0, int p1, int b)
 
 int64_t CostEstimateGroup::singleCost(int p0, int p1, int b, bool intraPenalty)
 {
-    LookaheadTLD& tld = m_lookahead.m_tld[m_lookahead.m_pool ? m_lookahead.m_pool->m_numWorkers : 0];
+    LookaheadTLD& tld = m_lookahead.m_tld[m_lookahead.m_pool ? m_lookahead.m_pool->numThreadIds() : 0];
     return estimateFrameCost(tld, p0, p1, b, intraPenalty);
 }
 
@@ -2272,10 +2573,8 @@ void CostEstimateGroup::add(int p0, int p1, int b)
 
 void CostEstimateGroup::finishBatch()
 {
-    if (m_lookahead.m_pool)
-        tryBondPeers(*m_lookahead.m_pool, m_jobTotal);
-    processTasks(-1);
-    waitForExit();
+    runJobs(m_lookahead.m_pool, m_jobTotal, !!m_lookahead.m_param->bLookaheadSteal);
+    m_lookahead.addGroupStats(*this);
     m_jobTotal = m_jobAcquired = 0;
 }
 
@@ -2284,15 +2583,13 @@ void CostEstimateGroup::processTasks(int workerThreadID)
     ThreadPool* pool = m_lookahead.m_pool;
     int id = workerThreadID;
     if (workerThreadID < 0)
-        id = pool ? pool->m_numWorkers : 0;
+        id = pool ? pool->numThreadIds() : 0;
     LookaheadTLD& tld = m_lookahead.m_tld[id];
 
-    m_lock.acquire();
-    while (m_jobAcquired < m_jobTotal)
+    int slot = -1;
+    int i;
+    while ((i = acquireJob(slot)) >= 0)
     {
-        int i = m_jobAcquired++;
-        m_lock.release();
-
         if (m_batchMode)
         {
             ProfileLookaheadTime(tld.batchElapsedTime, tld.countBatches);
@@ -2322,10 +2619,7 @@ void CostEstimateGroup::processTasks(int workerThreadID)
                 lastRow = false;
             }
         }
-
-        m_lock.acquire();
     }
-    m_lock.release();
 }
 
 int64_t CostEstimateGroup::estimateFrameCost(LookaheadTLD& tld, int p0, int p1, int b, bool bIntraPenalty)
@@ -2356,6 +2650,13 @@ int64_t CostEstimateGroup::estimateFrameCost(LookaheadTLD& tld, int p0, int p1,
         fenc->costEst[b - p0][p1 - b] = 0;
         fenc->costEstAq[b - p0][p1 - b] = 0;
 
+        /* hierarchical motion search, coarsest level first */
+        if (bDoSearch[0] || bDoSearch[1])
+        {
+            for (int level = fenc->hmeLevels - 1; level >= 0; level--)
+                estimateHmeLevel(tld, p0, p1, b, bDoSearch, level);
+        }
+
         if (!m_batchMode && m_lookahead.m_numCoopSlices > 1 && ((p1 > b) || bDoSearch[0] || bDoSearch[1]))
         {
             /* Use cooperative mode if a thread pool is available and the cost estimate is
@@ -2371,14 +2672,10 @@ int64_t CostEstimateGroup::estimateFrameCost(LookaheadTLD& tld, int p0, int p1,
             m_coop.bDoSearch[0] = bDoSearch[0];
             m_coop.bDoSearch[1] = bDoSearch[1];
             m_jobTotal = m_lookahead.m_numCoopSlices;
-            m_jobAcquired = 0;
             m_lock.release();
 
-            tryBondPeers(*m_lookahead.m_pool, m_jobTotal);
-
-            processTasks(-1);
-
-            waitForExit();
+            runJobs(m_lookahead.m_pool, m_jobTotal, !!param->bLookaheadSteal);
+            m_lookahead.addGroupStats(*this);
 
             for (int i = 0; i < m_lookahead.m_numCoopSlices; i++)
             {
@@ -2417,6 +2714,78 @@ int64_t CostEstimateGroup::estimateFrameCost(LookaheadTLD& tld, int p0, int p1,
     return score;
 }
 
+/* Motion searches of one coarser level of the lowres pyramid, for the lists
+ * being searched. Each block is predicted from the MVs of its right and lower
+ * neighbors and of the covering block of the next coarser level */
+void CostEstimateGroup::estimateHmeLevel(LookaheadTLD& tld, int p0, int p1, int b, bool bDoSearch[2], int level)
+{
+    Lowres *fenc = m_frames[b];
+    ReferencePlanes& encPlanes = fenc->hmePlanes[level];
+
+    const int widthInCU = fenc->hmeBlocksInRow[level];
+    const int heightInCU = fenc->hmeBlocksInCol[level];
+    const int cuSize = X265_LOWRES_CU_SIZE;
+    int listDist[2] = { b - p0, p1 - b };
+
+    for (int i = 0; i < 2; i++)
+    {
+        if (!bDoSearch[i])
+            continue;
+
+        ReferencePlanes* fref = &m_frames[i ? p1 : p0]->hmePlanes[level];
+        MV* levelMvs = fenc->hmeMvs[level][i][listDist[i]];
+        MV* coarseMvs = level + 1 < fenc->hmeLevels ? fenc->hmeMvs[level + 1][i][listDist[i]] : NULL;
+
+        for (int cuY = heightInCU - 1; cuY >= 0; cuY--)
+        {
+            for (int cuX = widthInCU - 1; cuX >= 0; cuX--)
+            {
+                const int cuXY = cuX + cuY * widthInCU;
+                const intptr_t pelOffset = cuSize * cuX + cuSize * cuY * encPlanes.lumaStride;
+
+                MV mvmin, mvmax;
+                mvmin.x = (int16_t)(-cuX * cuSize - 8);
+                mvmin.y = (int16_t)(-cuY * cuSize - 8);
+                mvmax.x = (int16_t)((widthInCU - cuX - 1) * cuSize + 8);
+                mvmax.y = (int16_t)((heightInCU - cuY - 1) * cuSize + 8);
+
+                int numc = 0;
+                MV mvc[5], mvp = 0;
+                if (cuX < widthInCU - 1)
+                    mvc[numc++] = levelMvs[cuXY + 1];
+                if (cuY < heightInCU - 1)
+                {
+                    mvc[numc++] = levelMvs[cuXY + widthInCU];
+                    if (cuX > 0)
+                        mvc[numc++] = levelMvs[cuXY + widthInCU - 1];
+                    if (cuX < widthInCU - 1)
+                        mvc[numc++] = levelMvs[cuXY + widthInCU + 1];
+                }
+                if (coarseMvs)
+                {
+                    MV cmv = coarseMvs[(cuX >> 1) + (cuY >> 1) * fenc->hmeBlocksInRow[level + 1]] << 1;
+                    mvc[numc++] = cmv.clipped(mvmin.toQPel(), mvmax.toQPel());
+                }
+
+                tld.me.setSourcePU(encPlanes.lowresPlane[0], encPlanes.lumaStride, pelOffset, cuSize, cuSize, X265_HEX_SEARCH, 1);
+
+                /* lowres motion candidates are measured here, as in estimateCUCost() */
+                ALIGN_VAR_32(pixel, subpelbuf[X265_LOWRES_CU_SIZE * X265_LOWRES_CU_SIZE]);
+                int mvpcost = MotionEstimate::COST_MAX;
+                for (int idx = 0; idx < numc; idx++)
+                {
+                    intptr_t stride = X265_LOWRES_CU_SIZE;
+                    pixel *src = fref->lowresMC(pelOffset, mvc[idx], subpelbuf, stride);
+                    int cost = tld.me.bufSATD(src, stride);
+                    COPY2_IF_LT(mvpcost, cost, mvp, mvc[idx]);
+                }
+
+                tld.me.motionEstimate(fref, mvmin, mvmax, mvp, 0, NULL, s_merange, levelMvs[cuXY], m_lookahead.m_param->maxSlices);
+            }
+        }
+    }
+}
+
 void CostEstimateGroup::estimateCUCost(LookaheadTLD& tld, int cuX, int cuY, int p0, int p1, int b, bool bDoSearch[2], bool lastRow, int slice)
 {
     Lowres *fref0 = m_frames[p0];
@@ -2462,7 +2831,7 @@ void CostEstimateGroup::estimateCUCost(LookaheadTLD& tld, int cuX, int cuY, int
         }
 
         int numc = 0;
-        MV mvc[4], mvp;
+        MV mvc[5], mvp;
         MV* fencMV = &fenc->lowresMvs[i][listDist[i]][cuXY];
         ReferencePlanes* fref = i ? fref1 : wfref0;
 
@@ -2478,6 +2847,12 @@ void CostEstimateGroup::estimateCUCost(LookaheadTLD& tld, int cuX, int cuY, int
             if (cuX < widthInCU - 1)
                 MVC(fencMV[widthInCU + 1]);
         }
+        if (fenc->hmeLevels)
+        {
+            /* MV of the covering block of the quarter resolution level */
+            MV hmv = fenc->hmeMvs[0][i][listDist[i]][(cuX >> 1) + (cuY >> 1) * fenc->hmeBlocksInRow[0]] << 1;
+            MVC(hmv.clipped(mvmin.toQPel(), mvmax.toQPel()));
+        }
 #undef MVC
 
         if (!numc)
@@ -83,14 +83,15 @@ struct LookaheadTLD
 
     ~LookaheadTLD() { X265_FREE(wbuffer[0]); }
 
-    void calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param);
+    void calcAdaptiveQuantFrame(Frame *curFrame, x265_param* param, bool bEnergyReady = false);
+    void acEnergyRows(Frame* curFrame, x265_param* param, int startRow, int endRow, uint64_t wpSum[3], uint64_t wpSsd[3]);
     void lowresIntraEstimate(Lowres& fenc, uint32_t qgSize);
 
     void weightsAnalyse(Lowres& fenc, Lowres& ref);
 
 protected:
 
-    uint32_t acEnergyCu(Frame* curFrame, uint32_t blockX, uint32_t blockY, int csp, uint32_t qgSize);
+    uint32_t acEnergyCu(Frame* curFrame, uint32_t blockX, uint32_t blockY, int csp, uint32_t qgSize, uint64_t wpSum[3], uint64_t wpSsd[3]);
     uint32_t lumaSumCu(Frame* curFrame, uint32_t blockX, uint32_t blockY, uint32_t qgSize);
     uint32_t weightCostLuma(Lowres& fenc, Lowres& ref, WeightParam& wp);
     bool     allocWeightedRef(Lowres& fenc);
@@ -100,11 +101,16 @@ class Lookahead : public JobProvider
 {
 public:
 
-    PicList       m_inputQueue;      // input pictures in order received
-    PicList       m_outputQueue;     // pictures to be encoded, in encode order
-    Lock          m_inputLock;
-    Lock          m_outputLock;
+    PicQueue      m_inputQueue;      // input pictures in order received
+    PicQueue      m_outputQueue;     // pictures to be encoded, in encode order
+    Lock          m_inputLock;       // protects slicetypeDecide() state, not the queues
     Event         m_outputSignal;
+    int           m_numOutputWaits;  // count of blocking waits for slicetypeDecide()
+    int64_t       m_outputWaitTime;  // total time API thread was blocked on slicetypeDecide()
+    int           m_countGroupJobs;  // jobs handed out by the batch, slice and pre-lookahead task groups
+    int           m_countSteals;     // steals between their work-stealing queues (--lookahead-steal)
+    int           m_countStolenJobs; // jobs taken by those steals
+    int           m_countLockWaits;  // job acquisitions which found their lock held
     LookaheadTLD* m_tld;
     x265_param*   m_param;
     Lowres*       m_lastNonB;
@@ -133,6 +139,18 @@ public:
     bool          m_isSceneTransition;
     int           m_numPools;
     bool          m_extendGopBoundary;
+
+    /* pre-lookahead pipeline, see --pre-lookahead-depth. m_preLock protects
+     * this state and the m_pre* members of the queued pictures */
+    enum { PRE_QUEUE_SIZE = X265_LOOKAHEAD_MAX + X265_BFRAME_MAX + 4 };
+    Lock              m_preLock;
+    ThreadSafeInteger m_preProgress;  // incremented as each row band completes
+    Frame*            m_preFrames[PRE_QUEUE_SIZE]; // queued pictures, in input order
+    int               m_preCount;
+    int               m_preDepth;     // count of leading queued pictures open to worker threads
+    int               m_preRunning;   // count of row bands being processed
+    int               m_preBandRows;  // lowres CU rows per row band
+
     Lookahead(x265_param *param, ThreadPool *pool);
 #if DETAILED_CU_STATS
     int64_t       m_slicetypeDecideElapsedTime;
@@ -146,6 +164,9 @@ public:
     void    destroy();
     void    stopJobs();
 
+    /* may be called concurrently by frame encoder threads via getEstimatedPictureCost() */
+    void    addGroupStats(const WorkStealingTaskGroup& group);
+
     void    addPicture(Frame&, int sliceType);
     void    addPicture(Frame& curFrame);
     void    checkLookaheadQueue(int &frameCnt);
@@ -159,13 +180,19 @@ protected:
 
     void    findJob(int workerThreadID);
     void    slicetypeDecide();
+
+    /* pre-lookahead pipeline */
+    void    queuePreLookahead(Frame& curFrame);
+    bool    processPreLookaheadBand(int workerThreadID, Frame* onlyFrame);
+    void    finishPreLookahead(Frame& curFrame);
+    int     numPreBands(Frame& curFrame) const;
     void    slicetypeAnalyse(Lowres **frames, bool bKeyframe);
 
     /* called by slicetypeAnalyse() to make slice decisions */
     bool    scenecut(Lowres **frames, int p0, int p1, bool bRealScenecut, int numFrames);
     bool    scenecutInternal(Lowres **frames, int p0, int p1, bool bRealScenecut);
-    void    slicetypePath(Lowres **frames, int length, char(*best_paths)[X265_LOOKAHEAD_MAX + 1]);
-    int64_t slicetypePathCost(Lowres **frames, char *path, int64_t threshold);
+    void    slicetypePath(Lowres **frames, int length, char(*best_paths)[X265_LOOKAHEAD_MAX + 1], int64_t(*best_costs)[2]);
+    int64_t slicetypePathCost(Lowres **frames, const int64_t prefix[2], int cur_p, int next_p, int64_t threshold, int64_t& pcost);
     int64_t vbvFrameCost(Lowres **frames, int p0, int p1, int b);
     void    vbvLookahead(Lowres **frames, int numFrames, int keyframes);
     void    aqMotion(Lowres **frames, bool bintra);
@@ -180,7 +207,7 @@ protected:
     int64_t frameCostRecalculate(Lowres **frames, int p0, int p1, int b);
 };
 
-class PreLookaheadGroup : public BondedTaskGroup
+class PreLookaheadGroup : public WorkStealingTaskGroup
 {
 public:
 
@@ -196,7 +223,7 @@ protected:
     PreLookaheadGroup& operator=(const PreLookaheadGroup&);
 };
 
-class CostEstimateGroup : public BondedTaskGroup
+class CostEstimateGroup : public WorkStealingTaskGroup
 {
 public:
 
@@ -241,6 +268,7 @@ protected:
 
     int64_t estimateFrameCost(LookaheadTLD& tld, int p0, int p1, int b, bool intraPenalty);
     void    estimateCUCost(LookaheadTLD& tld, int cux, int cuy, int p0, int p1, int b, bool bDoSearch[2], bool lastRow, int slice);
+    void    estimateHmeLevel(LookaheadTLD& tld, int p0, int p1, int b, bool bDoSearch[2], int level);
 
     CostEstimateGroup& operator=(const CostEstimateGroup&);
 };
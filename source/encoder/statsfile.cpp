@@ -0,0 +1,121 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#include "common.h"
+#include "statsfile.h"
+
+using namespace X265_NS;
+
+static inline uint64_t alignSize(uint64_t size)
+{
+    return (size + STATS_FILE_ALIGN - 1) & ~(uint64_t)(STATS_FILE_ALIGN - 1);
+}
+
+static inline uint32_t recordSize(uint32_t numCuTree)
+{
+    return (uint32_t)alignSize(sizeof(StatsFrameRecord) + (uint64_t)numCuTree * sizeof(uint16_t));
+}
+
+static bool writePadded(FILE* file, const void* data, uint64_t size)
+{
+    static const uint8_t zeros[STATS_FILE_ALIGN] = { 0 };
+    uint64_t padding = alignSize(size) - size;
+
+    return fwrite(data, 1, (size_t)size, file) == size && fwrite(zeros, 1, (size_t)padding, file) == padding;
+}
+
+bool StatsFile::probe(const char* fileName)
+{
+    FILE* file = x265_fopen(fileName, "rb");
+    if (!file)
+        return false;
+
+    char magic[8];
+    bool bMatch = fread(magic, 1, sizeof(magic), file) == sizeof(magic) && !memcmp(magic, STATS_FILE_MAGIC, sizeof(magic));
+    fclose(file);
+    return bMatch;
+}
+
+bool StatsFile::writeHeader(FILE* file, const char* options, uint32_t numCuTree)
+{
+    StatsFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, STATS_FILE_MAGIC, sizeof(header.magic));
+    header.version = STATS_FILE_VERSION;
+    header.headerSize = sizeof(StatsFileHeader);
+    header.recordSize = recordSize(numCuTree);
+    header.numCuTree = numCuTree;
+    header.optionsSize = (uint32_t)strlen(options) + 1;
+    header.dataOffset = (uint32_t)alignSize(sizeof(StatsFileHeader) + header.optionsSize);
+
+    return fwrite(&header, sizeof(header), 1, file) == 1 && writePadded(file, options, header.optionsSize);
+}
+
+bool StatsFile::writeFrame(FILE* file, const StatsFrameRecord& record, const uint16_t* cuTreeQp, uint32_t numCuTree)
+{
+    static const uint16_t zeros[64] = { 0 };
+
+    if (fwrite(&record, sizeof(record), 1, file) != 1)
+        return false;
+    if (cuTreeQp)
+        return writePadded(file, cuTreeQp, numCuTree * sizeof(uint16_t));
+
+    /* frames without cu-tree data keep the fixed record size */
+    uint64_t size = recordSize(numCuTree) - sizeof(record);
+    for (uint64_t written = 0; written < size; written += sizeof(zeros))
+    {
+        size_t count = (size_t)X265_MIN(sizeof(zeros), size - written);
+        if (fwrite(zeros, 1, count, file) != count)
+            return false;
+    }
+    return true;
+}
+
+bool StatsFile::open(const char* fileName)
+{
+    m_data = (uint8_t*)x265_map_file(fileName, &m_size);
+    if (!m_data)
+        return false;
+
+    /* validate the header before handing out any pointer */
+    const StatsFileHeader* hdr = header();
+    if (m_size < sizeof(StatsFileHeader) || memcmp(hdr->magic, STATS_FILE_MAGIC, sizeof(hdr->magic)) ||
+        hdr->version != STATS_FILE_VERSION || hdr->headerSize != sizeof(StatsFileHeader) ||
+        hdr->recordSize != recordSize(hdr->numCuTree) || !hdr->optionsSize ||
+        hdr->dataOffset != alignSize(sizeof(StatsFileHeader) + (uint64_t)hdr->optionsSize) ||
+        hdr->dataOffset > m_size || options()[hdr->optionsSize - 1])
+    {
+        close();
+        return false;
+    }
+
+    m_numFrames = (uint32_t)((m_size - hdr->dataOffset) / hdr->recordSize);
+    return true;
+}
+
+void StatsFile::close()
+{
+    if (m_data)
+        x265_unmap_file(m_data, m_size);
+    m_data = NULL;
+    m_size = 0;
+    m_numFrames = 0;
+}
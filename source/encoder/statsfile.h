@@ -0,0 +1,120 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+#ifndef X265_STATSFILE_H
+#define X265_STATSFILE_H
+
+#include "common.h"
+
+namespace X265_NS {
+// private x265 namespace
+
+/* Binary multi-pass stats file, see --stats-binary.
+ *
+ * The file starts with a StatsFileHeader followed by the NUL terminated
+ * options string of the pass that wrote it, then by one fixed size record
+ * per frame in encode order. Each record is a StatsFrameRecord followed by
+ * the packed cu-tree qp offsets of the frame, present when the frame was
+ * kept as reference, so no separate .cutree file is needed. Records are
+ * read in place from the memory mapped file, the cu-tree offsets only when
+ * the lookahead asks for them */
+
+#define STATS_FILE_MAGIC   "x265stat"
+#define STATS_FILE_VERSION 1
+#define STATS_FILE_ALIGN   8
+
+struct StatsFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;     // StatsFrameRecord and cu-tree data, aligned
+    uint32_t numCuTree;      // qp offsets per frame, 0 without cu-tree
+    uint32_t optionsSize;    // options string, with its NUL
+    uint32_t dataOffset;     // first record, from the start of the file
+};
+
+struct StatsFrameRecord
+{
+    double   qpRc;
+    double   qpAq;
+    double   qpNoVbv;
+    double   qRceq;
+    double   iCuCount;
+    double   pCuCount;
+    double   skipCuCount;
+    int32_t  poc;
+    int32_t  encodeOrder;
+    int32_t  coeffBits;
+    int32_t  mvBits;
+    int32_t  miscBits;
+    int32_t  numberOfPictures;
+    int32_t  numberOfNegativePictures;
+    int32_t  numberOfPositivePictures;
+    int32_t  deltaPOC[MAX_NUM_REF_PICS];
+    uint8_t  bUsed[MAX_NUM_REF_PICS];
+    char     type;           // I, i, P, B or b, as in the text stats file
+    uint8_t  bCuTree;        // cu-tree qp offsets follow the record
+    uint8_t  reserved[6];
+};
+
+class StatsFile
+{
+public:
+
+    StatsFile() : m_data(NULL), m_size(0), m_numFrames(0) {}
+    ~StatsFile() { close(); }
+
+    /* true if the file exists and starts with STATS_FILE_MAGIC */
+    static bool probe(const char* fileName);
+
+    /* writer, the caller owns the file so it can be renamed once complete */
+    static bool writeHeader(FILE* file, const char* options, uint32_t numCuTree);
+    static bool writeFrame(FILE* file, const StatsFrameRecord& record, const uint16_t* cuTreeQp, uint32_t numCuTree);
+
+    /* reader, maps the whole file. A truncated last record is ignored */
+    bool open(const char* fileName);
+    const StatsFileHeader* header() const { return (const StatsFileHeader*)m_data; }
+    const char* options() const           { return (const char*)(m_data + sizeof(StatsFileHeader)); }
+    uint32_t numFrames() const            { return m_numFrames; }
+
+    const StatsFrameRecord* frame(uint32_t i) const
+    {
+        return (const StatsFrameRecord*)(m_data + header()->dataOffset + (uint64_t)i * header()->recordSize);
+    }
+
+    /* packed cu-tree qp offsets of the frame, or NULL if absent */
+    const uint16_t* cuTreeQp(const StatsFrameRecord* record) const
+    {
+        return record->bCuTree && header()->numCuTree ? (const uint16_t*)(record + 1) : NULL;
+    }
+
+    void close();
+
+protected:
+
+    uint8_t* m_data;
+    uint64_t m_size;
+    uint32_t m_numFrames;
+};
+}
+
+#endif // ifndef X265_STATSFILE_H
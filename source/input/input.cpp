@@ -25,8 +25,66 @@
 #include "yuv.h"
 #include "y4m.h"
 
+#if !_WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
 using namespace X265_NS;
 
+bool InputMapping::open(const char* filename)
+{
+    m_data = (char*)x265_map_file(filename, &m_size);
+    m_released = m_prefetched = 0;
+#if !_WIN32
+    if (m_data)
+        madvise(m_data, (size_t)m_size, MADV_SEQUENTIAL);
+#endif
+    return !!m_data;
+}
+
+void InputMapping::close()
+{
+    x265_unmap_file(m_data, m_size);
+    m_data = NULL;
+    m_size = 0;
+}
+
+void InputMapping::advance(uint64_t pos, uint64_t frameSize, int readAhead)
+{
+#if _WIN32
+    /* the mapping faults the pages in on demand */
+    (void)pos;
+    (void)frameSize;
+    (void)readAhead;
+#else
+    static const uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+
+    /* pages shared with the current frame are kept */
+    uint64_t released = pos & ~(pageSize - 1);
+    if (released > m_released)
+    {
+        madvise(m_data + m_released, (size_t)(released - m_released), MADV_DONTNEED);
+        m_released = released;
+    }
+
+    /* start the reads of the frames entering the read ahead window. The
+     * advice must start on a page boundary, m_prefetched usually is not */
+    uint64_t start = X265_MAX(m_prefetched, released) & ~(pageSize - 1);
+    uint64_t end = X265_MIN(m_size, pos + frameSize * (readAhead + 1));
+    if (end > m_prefetched)
+    {
+        if (madvise(m_data + start, (size_t)(end - start), MADV_WILLNEED))
+        {
+            x265_log(NULL, X265_LOG_WARNING, "input: read ahead of the mapped file failed (%s), disabled\n", strerror(errno));
+            end = m_size;
+        }
+        m_prefetched = end;
+    }
+#endif
+}
+
 InputFile* InputFile::open(InputFileInfo& info, bool bForceY4m)
 {
     const char * s = strrchr(info.filename, '.');
@@ -53,9 +53,45 @@ struct InputFileInfo
 
     /* user supplied */
     int skipFrames;
+    int readAhead;      // frames queued ahead of the encoder
+    bool bMmap;         // map regular files in memory instead of reading them
     const char *filename;
 };
 
+/* --input-mmap, the input file is mapped in memory and the pictures point
+ * into the mapping so frames are neither read into a queue nor copied. The
+ * kernel is asked to read the next frames ahead of the encoder, which keeps
+ * several reads in flight, and to drop the frames which have been encoded */
+class InputMapping
+{
+public:
+
+    InputMapping() : m_data(NULL), m_size(0), m_released(0), m_prefetched(0) {}
+
+    ~InputMapping() { close(); }
+
+    bool open(const char* filename);
+
+    void close();
+
+    bool isOpen() const              { return !!m_data; }
+
+    uint64_t size() const            { return m_size; }
+
+    char* data() const               { return m_data; }
+
+    /* the frame at pos is being read, the data before it is no longer used
+     * and readAhead frames of frameSize bytes follow it */
+    void advance(uint64_t pos, uint64_t frameSize, int readAhead);
+
+protected:
+
+    char*    m_data;
+    uint64_t m_size;
+    uint64_t m_released;    // start of the data still in use, page aligned
+    uint64_t m_prefetched;  // end of the data the kernel was asked to read
+};
+
 class InputFile
 {
 protected:
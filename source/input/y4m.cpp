@@ -42,8 +42,10 @@ using namespace std;
 static const char header[] = {'F','R','A','M','E'};
 Y4MInput::Y4MInput(InputFileInfo& info)
 {
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        buf[i] = NULL;
+    readAhead = X265_MAX(info.readAhead, 1);
+    queueSize = readAhead + 1; // and the picture given to the encoder
+    buf = NULL;
+    mapPos = 0;
 
     threadActive = false;
     colorSpace = info.csp;
@@ -76,14 +78,22 @@ Y4MInput::Y4MInput(InputFileInfo& info)
         }
 
         threadActive = true;
-        for (int q = 0; q < QUEUE_SIZE; q++)
+        if (info.bMmap)
         {
-            buf[q] = X265_MALLOC(char, framesize);
-            if (!buf[q])
+            if (ifs == stdin || !map.open(info.filename))
+                x265_log(NULL, X265_LOG_WARNING, "y4m: unable to map input file, reading it instead\n");
+        }
+        if (!map.isOpen())
+        {
+            bool ok = !!(buf = X265_MALLOC(char*, queueSize));
+            if (ok)
+                memset(buf, 0, queueSize * sizeof(char*));
+            for (int q = 0; ok && q < queueSize; q++)
+                ok = !!(buf[q] = X265_MALLOC(char, framesize));
+            if (!ok)
             {
                 x265_log(NULL, X265_LOG_ERROR, "y4m: buffer allocation failure, aborting");
                 threadActive = false;
-                break;
             }
         }
     }
@@ -127,13 +137,16 @@ Y4MInput::Y4MInput(InputFileInfo& info)
                 if (fread(buf[0], estFrameSize - framesize, 1, ifs) + fread(buf[0], framesize, 1, ifs) != 2)
                     break;
     }
+    if (map.isOpen())
+        mapPos = (uint64_t)ftello(ifs);
 }
 Y4MInput::~Y4MInput()
 {
     if (ifs && ifs != stdin)
         fclose(ifs);
-    for (int i = 0; i < QUEUE_SIZE; i++)
+    for (int i = 0; buf && i < queueSize; i++)
         X265_FREE(buf[i]);
+    X265_FREE(buf);
 }
 
 void Y4MInput::release()
@@ -311,7 +324,7 @@ bool Y4MInput::parseHeader()
 void Y4MInput::startReader()
 {
 #if ENABLE_THREADING
-    if (threadActive)
+    if (threadActive && !map.isOpen())
         start();
 #endif
 }
@@ -349,14 +362,14 @@ bool Y4MInput::populateFrameQueue()
     /* wait for room in the ring buffer */
     int written = writeCount.get();
     int read = readCount.get();
-    while (written - read > QUEUE_SIZE - 2)
+    while (written - read > queueSize - 2)
     {
         read = readCount.waitForChange(read);
         if (!threadActive)
             return false;
     }
     ProfileScopeEvent(frameRead);
-    if (fread(buf[written % QUEUE_SIZE], framesize, 1, ifs) == 1)
+    if (fread(buf[written % queueSize], framesize, 1, ifs) == 1)
     {
         writeCount.incr();
         return true;
@@ -367,6 +380,27 @@ bool Y4MInput::populateFrameQueue()
 
 bool Y4MInput::readPicture(x265_picture& pic)
 {
+    if (map.isOpen())
+    {
+        const char* data = map.data();
+        if (mapPos + sizeof(header) > map.size() || memcmp(data + mapPos, header, sizeof(header)))
+        {
+            if (mapPos < map.size())
+                x265_log(NULL, X265_LOG_ERROR, "y4m: frame header missing\n");
+            return false;
+        }
+        /* skip the FRAME line */
+        uint64_t pos = mapPos + sizeof(header);
+        while (pos < map.size() && data[pos] != '\n')
+            pos++;
+        if (++pos + framesize > map.size())
+            return false;
+        map.advance(pos, framesize + sizeof(header) + 1, readAhead);
+        setPicture(pic, map.data() + pos);
+        mapPos = pos + framesize;
+        return true;
+    }
+
     int read = readCount.get();
     int written = writeCount.get();
 
@@ -384,17 +418,7 @@ bool Y4MInput::readPicture(x265_picture& pic)
 
     if (read < written)
     {
-        int pixelbytes = depth > 8 ? 2 : 1;
-        pic.bitDepth = depth;
-        pic.framesize = framesize;
-        pic.height = height;
-        pic.colorSpace = colorSpace;
-        pic.stride[0] = width * pixelbytes;
-        pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
-        pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
-        pic.planes[0] = buf[read % QUEUE_SIZE];
-        pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
-        pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+        setPicture(pic, buf[read % queueSize]);
         readCount.incr();
         return true;
     }
@@ -402,3 +426,18 @@ bool Y4MInput::readPicture(x265_picture& pic)
         return false;
 }
 
+void Y4MInput::setPicture(x265_picture& pic, char* frame)
+{
+    int pixelbytes = depth > 8 ? 2 : 1;
+    pic.bitDepth = depth;
+    pic.framesize = framesize;
+    pic.height = height;
+    pic.colorSpace = colorSpace;
+    pic.stride[0] = width * pixelbytes;
+    pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
+    pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
+    pic.planes[0] = frame;
+    pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
+    pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+}
+
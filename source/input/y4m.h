@@ -28,8 +28,6 @@
 #include "threading.h"
 #include <fstream>
 
-#define QUEUE_SIZE 5
-
 namespace X265_NS {
 // x265 private namespace
 
@@ -60,20 +58,28 @@ protected:
     ThreadSafeInteger readCount;
 
     ThreadSafeInteger writeCount;
-    char* buf[QUEUE_SIZE];
+    int queueSize;
+    char** buf;
     FILE *ifs;
+
+    InputMapping map;
+    uint64_t mapPos;
+    int readAhead;
+
     bool parseHeader();
     void threadMain();
 
     bool populateFrameQueue();
 
+    void setPicture(x265_picture& pic, char* frame);
+
 public:
 
     Y4MInput(InputFileInfo& info);
 
     virtual ~Y4MInput();
     void release();
-    bool isEof() const            { return ifs && feof(ifs); }
+    bool isEof() const            { return map.isOpen() ? mapPos >= map.size() : ifs && feof(ifs); }
     bool isFail()                 { return !(ifs && !ferror(ifs) && threadActive); }
     void startReader();
     bool readPicture(x265_picture&);
@@ -42,8 +42,10 @@ using namespace std;
 
 YUVInput::YUVInput(InputFileInfo& info)
 {
-    for (int i = 0; i < QUEUE_SIZE; i++)
-        buf[i] = NULL;
+    readAhead = X265_MAX(info.readAhead, 1);
+    queueSize = readAhead + 1; // and the picture given to the encoder
+    buf = NULL;
+    mapPos = 0;
 
     depth = info.depth;
     width = info.width;
@@ -85,10 +87,20 @@ YUVInput::YUVInput(InputFileInfo& info)
         return;
     }
 
-    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+    if (info.bMmap)
     {
-        buf[i] = X265_MALLOC(char, framesize);
-        if (buf[i] == NULL)
+        if (ifs == stdin || !map.open(info.filename))
+            x265_log(NULL, X265_LOG_WARNING, "yuv: unable to map input file, reading it instead\n");
+    }
+
+    if (!map.isOpen())
+    {
+        bool ok = !!(buf = X265_MALLOC(char*, queueSize));
+        if (ok)
+            memset(buf, 0, queueSize * sizeof(char*));
+        for (int i = 0; ok && i < queueSize; i++)
+            ok = !!(buf[i] = X265_MALLOC(char, framesize));
+        if (!ok)
         {
             x265_log(NULL, X265_LOG_ERROR, "yuv: buffer allocation failure, aborting\n");
             threadActive = false;
@@ -119,13 +131,16 @@ YUVInput::YUVInput(InputFileInfo& info)
                 if (fread(buf[0], framesize, 1, ifs) != 1)
                     break;
     }
+    if (map.isOpen())
+        mapPos = (uint64_t)ftello(ifs);
 }
 YUVInput::~YUVInput()
 {
     if (ifs && ifs != stdin)
         fclose(ifs);
-    for (int i = 0; i < QUEUE_SIZE; i++)
+    for (int i = 0; buf && i < queueSize; i++)
         X265_FREE(buf[i]);
+    X265_FREE(buf);
 }
 
 void YUVInput::release()
@@ -139,7 +154,7 @@ void YUVInput::release()
 void YUVInput::startReader()
 {
 #if ENABLE_THREADING
-    if (threadActive)
+    if (threadActive && !map.isOpen())
         start();
 #endif
 }
@@ -163,7 +178,7 @@ bool YUVInput::populateFrameQueue()
     /* wait for room in the ring buffer */
     int written = writeCount.get();
     int read = readCount.get();
-    while (written - read > QUEUE_SIZE - 2)
+    while (written - read > queueSize - 2)
     {
         read = readCount.waitForChange(read);
         if (!threadActive)
@@ -171,7 +186,7 @@ bool YUVInput::populateFrameQueue()
             return false;
     }
     ProfileScopeEvent(frameRead);
-    if (fread(buf[written % QUEUE_SIZE], framesize, 1, ifs) == 1)
+    if (fread(buf[written % queueSize], framesize, 1, ifs) == 1)
     {
         writeCount.incr();
         return true;
@@ -182,6 +197,16 @@ bool YUVInput::populateFrameQueue()
 
 bool YUVInput::readPicture(x265_picture& pic)
 {
+    if (map.isOpen())
+    {
+        if (mapPos + framesize > map.size())
+            return false;
+        map.advance(mapPos, framesize, readAhead);
+        setPicture(pic, map.data() + mapPos);
+        mapPos += framesize;
+        return true;
+    }
+
     int read = readCount.get();
     int written = writeCount.get();
 
@@ -199,20 +224,25 @@ bool YUVInput::readPicture(x265_picture& pic)
 
     if (read < written)
     {
-        uint32_t pixelbytes = depth > 8 ? 2 : 1;
-        pic.colorSpace = colorSpace;
-        pic.bitDepth = depth;
-        pic.framesize = framesize;
-        pic.height = height;
-        pic.stride[0] = width * pixelbytes;
-        pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
-        pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
-        pic.planes[0] = buf[read % QUEUE_SIZE];
-        pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
-        pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+        setPicture(pic, buf[read % queueSize]);
         readCount.incr();
         return true;
     }
     else
         return false;
 }
+
+void YUVInput::setPicture(x265_picture& pic, char* frame)
+{
+    uint32_t pixelbytes = depth > 8 ? 2 : 1;
+    pic.colorSpace = colorSpace;
+    pic.bitDepth = depth;
+    pic.framesize = framesize;
+    pic.height = height;
+    pic.stride[0] = width * pixelbytes;
+    pic.stride[1] = pic.stride[0] >> x265_cli_csps[colorSpace].width[1];
+    pic.stride[2] = pic.stride[0] >> x265_cli_csps[colorSpace].width[2];
+    pic.planes[0] = frame;
+    pic.planes[1] = (char*)pic.planes[0] + pic.stride[0] * height;
+    pic.planes[2] = (char*)pic.planes[1] + pic.stride[1] * (height >> x265_cli_csps[colorSpace].height[1]);
+}
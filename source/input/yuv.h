@@ -28,8 +28,6 @@
 #include "threading.h"
 #include <fstream>
 
-#define QUEUE_SIZE 5
-
 namespace X265_NS {
 // private x265 namespace
 
@@ -52,20 +50,28 @@ protected:
     ThreadSafeInteger readCount;
 
     ThreadSafeInteger writeCount;
-    char* buf[QUEUE_SIZE];
+    int queueSize;
+    char** buf;
     FILE *ifs;
+
+    InputMapping map;
+    uint64_t mapPos;
+    int readAhead;
+
     int guessFrameCount();
     void threadMain();
 
     bool populateFrameQueue();
 
+    void setPicture(x265_picture& pic, char* frame);
+
 public:
 
     YUVInput(InputFileInfo& info);
 
     virtual ~YUVInput();
     void release();
-    bool isEof() const                            { return ifs && feof(ifs); }
+    bool isEof() const                            { return map.isOpen() ? mapPos + framesize > map.size() : ifs && feof(ifs); }
     bool isFail()                                 { return !(ifs && !ferror(ifs) && threadActive); }
     void startReader();
 
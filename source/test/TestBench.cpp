@@ -174,6 +174,8 @@ int main(int argc, char *argv[])
         { "ARMv6", X265_CPU_ARMV6 },
         { "NEON", X265_CPU_NEON },
         { "FastNeonMRC", X265_CPU_FAST_NEON_MRC },
+        { "SVE", X265_CPU_SVE },
+        { "SVE2", X265_CPU_SVE2 },
         { "", 0 },
     };
 
@@ -0,0 +1,717 @@
+/*****************************************************************************
+ * Copyright (C) 2013-2017 MulticoreWare, Inc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02111, USA.
+ *
+ * This program is also available under a commercial proprietary license.
+ * For more information, contact us at license @ x265.com.
+ *****************************************************************************/
+
+/* Whole-encoder benchmark. Encodes synthetic, deterministic content through
+ * the libx265 API for every combination of the requested presets,
+ * resolutions and thread counts, and writes the throughput of each run as
+ * JSON, for comparing builds and catching performance regressions. The
+ * per-stage worker times are only available when x265 is built with
+ * DETAILED_CU_STATS, they are null otherwise. */
+
+#include "common.h"
+#include "cpu.h"
+#include "threadpool.h"
+#include "x265.h"
+
+#if DETAILED_CU_STATS
+#include "encoder.h"
+#include "frameencoder.h"
+#include "slicetype.h"
+#endif
+
+#if _WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+#ifndef DETAILED_CU_STATS
+#define DETAILED_CU_STATS 0
+#endif
+
+using namespace X265_NS;
+
+namespace {
+
+enum { MAX_LIST = 16 };
+enum { MAX_RUNS = 32 };
+
+struct BenchOptions
+{
+    const char* presets[MAX_LIST];
+    int         numPresets;
+    int         width[MAX_LIST];
+    int         height[MAX_LIST];
+    int         numSizes;
+    int         threads[MAX_LIST];
+    int         numThreads;
+    int         frames;
+    int         runs;
+    const char* output;
+};
+
+struct StageTimes
+{
+    double motionEstimation;  // seconds of worker time, summed over all workers
+    double intraAnalysis;
+    double interRDO;
+    double intraRDO;
+    double loopFilter;
+    double weightAnalysis;
+    double lookahead;
+    double other;
+    double total;
+    double workerUtilization; // average number of busy workers
+    int    workers;
+};
+
+struct RunResult
+{
+    double   fps;
+    double   elapsed;         // wall seconds from the first picture to the end of the flush
+    double   cpuUtilization;  // process CPU seconds per wall second over the same interval
+    double   bitrate;         // kbps
+    uint64_t hash;            // FNV-1a of the bitstream, identical across runs of a config
+    long     peakRSS;         // kB, -1 when unknown
+    int      frameThreads;
+    bool     bHaveStages;
+    StageTimes stages;
+};
+
+/* Synthetic content: a value noise texture panned across the frame gives
+ * global motion, a square cut from the same texture moving on its own path
+ * gives local motion and occlusions. Integer only, so every platform encodes
+ * the same pictures */
+class SyntheticSource
+{
+public:
+
+    enum { PAN = 64 };
+
+    int     m_width;
+    int     m_height;
+    int     m_texStride;
+    pixel*  m_tex;
+    pixel*  m_plane[3];
+
+    SyntheticSource() : m_tex(NULL) { m_plane[0] = m_plane[1] = m_plane[2] = NULL; }
+
+    ~SyntheticSource()
+    {
+        X265_FREE(m_tex);
+        for (int i = 0; i < 3; i++)
+            X265_FREE(m_plane[i]);
+    }
+
+    bool init(int width, int height)
+    {
+        m_width = width;
+        m_height = height;
+        m_texStride = width + 2 * PAN;
+        int texHeight = height + 2 * PAN;
+
+        m_tex = X265_MALLOC(pixel, m_texStride * texHeight);
+        m_plane[0] = X265_MALLOC(pixel, width * height);
+        m_plane[1] = X265_MALLOC(pixel, (width / 2) * (height / 2));
+        m_plane[2] = X265_MALLOC(pixel, (width / 2) * (height / 2));
+        if (!m_tex || !m_plane[0] || !m_plane[1] || !m_plane[2])
+            return false;
+
+        /* random values on a 32x32 grid, bilinearly interpolated, plus fine
+         * grain noise */
+        const int cell = 32;
+        int gridW = m_texStride / cell + 2;
+        int gridH = texHeight / cell + 2;
+        uint8_t* grid = X265_MALLOC(uint8_t, gridW * gridH);
+        if (!grid)
+            return false;
+        uint32_t seed = 0x2650fe1d;
+        for (int i = 0; i < gridW * gridH; i++)
+            grid[i] = (uint8_t)(32 + random(seed) % 192);
+
+        for (int y = 0; y < texHeight; y++)
+        {
+            int gy = y / cell, fy = y % cell;
+            for (int x = 0; x < m_texStride; x++)
+            {
+                int gx = x / cell, fx = x % cell;
+                const uint8_t* g = grid + gy * gridW + gx;
+                int top = g[0] * (cell - fx) + g[1] * fx;
+                int bot = g[gridW] * (cell - fx) + g[gridW + 1] * fx;
+                int v = (top * (cell - fy) + bot * fy) / (cell * cell);
+                v += (int)(random(seed) % 17) - 8;
+                m_tex[y * m_texStride + x] = (pixel)(x265_clip3(0, 255, v) << (X265_DEPTH - 8));
+            }
+        }
+
+        X265_FREE(grid);
+        return true;
+    }
+
+    void generate(int frame, x265_picture& pic)
+    {
+        /* background */
+        int ox = PAN + triangle(frame * 3, PAN);
+        int oy = PAN + triangle(frame * 2, PAN);
+        for (int y = 0; y < m_height; y++)
+            memcpy(m_plane[0] + y * m_width, m_tex + (y + oy) * m_texStride + ox, m_width * sizeof(pixel));
+
+        /* moving square, its texture pans against the background */
+        int size = X265_MIN(m_width, m_height) / 4;
+        int rangeX = (m_width - size) / 2, rangeY = (m_height - size) / 2;
+        int bx = rangeX + triangle(frame * 5, rangeX);
+        int by = rangeY + triangle(frame * 4, rangeY);
+        int tx = PAN - triangle(frame * 2, PAN);
+        int ty = PAN - triangle(frame, PAN);
+        for (int y = 0; y < size; y++)
+            memcpy(m_plane[0] + (by + y) * m_width + bx, m_tex + (ty + y) * m_texStride + tx, size * sizeof(pixel));
+
+        /* chroma follows luma, so it moves with it */
+        int cw = m_width / 2, ch = m_height / 2;
+        int mid = 1 << (X265_DEPTH - 1);
+        for (int y = 0; y < ch; y++)
+        {
+            const pixel* l = m_plane[0] + 2 * y * m_width;
+            for (int x = 0; x < cw; x++)
+            {
+                m_plane[1][y * cw + x] = (pixel)(mid + (l[2 * x] - mid) / 4);
+                m_plane[2][y * cw + x] = (pixel)(mid - (l[m_width + 2 * x + 1] - mid) / 3);
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            pic.planes[i] = m_plane[i];
+            pic.stride[i] = (i ? cw : m_width) * (int)sizeof(pixel);
+        }
+        pic.pts = frame;
+    }
+
+protected:
+
+    static uint32_t random(uint32_t& seed)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return seed >> 16;
+    }
+
+    /* triangle wave of period 4 * amp, ranging over [-amp, amp] */
+    static int triangle(int v, int amp)
+    {
+        if (!amp)
+            return 0;
+        int p = v % (4 * amp);
+        return p < 2 * amp ? p - amp : 3 * amp - p;
+    }
+};
+
+double cpuSeconds()
+{
+#if _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+    return (double)(k.QuadPart + u.QuadPart) / 10000000;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#endif
+}
+
+/* Linux can reset the peak resident set size of a process, so each run
+ * reports its own peak. Elsewhere the peak is the high water mark of all runs
+ * so far, or unknown */
+void resetPeakRSS()
+{
+#if __linux__
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (f)
+    {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+long peakRSS()
+{
+#if __linux__
+    FILE* f = fopen("/proc/self/status", "r");
+    if (f)
+    {
+        char line[256];
+        long kb = -1;
+        while (fgets(line, sizeof(line), f))
+        {
+            if (!strncmp(line, "VmHWM:", 6))
+            {
+                kb = atol(line + 6);
+                break;
+            }
+        }
+        fclose(f);
+        return kb;
+    }
+    return -1;
+#elif _WIN32
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage))
+        return -1;
+#if __APPLE__
+    return (long)(usage.ru_maxrss / 1024);
+#else
+    return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+void hashBitstream(uint64_t& hash, const x265_nal* nal, uint32_t nalCount)
+{
+    for (uint32_t i = 0; i < nalCount; i++)
+    {
+        for (uint32_t j = 0; j < nal[i].sizeBytes; j++)
+        {
+            hash ^= nal[i].payload[j];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+}
+
+#if DETAILED_CU_STATS
+/* The same summary as Encoder::printSummary(), read once the encoder has been
+ * flushed. CUStats::accumulate() clears its argument, so copies of the frame
+ * encoder stats are summed and the originals are left for printSummary() */
+void fetchStageTimes(x265_encoder* enc, double elapsed, StageTimes& st)
+{
+    Encoder* encoder = static_cast<Encoder*>(enc);
+    x265_param& param = *encoder->m_param;
+
+    CUStats cuStats;
+    for (int i = 0; i < param.frameNumThreads; i++)
+    {
+        CUStats frameStats = encoder->m_frameEncoder[i]->m_cuStats;
+        cuStats.accumulate(frameStats, param);
+    }
+
+    int64_t batchElapsedTime, coopSliceElapsedTime;
+    uint64_t batchCount, coopSliceCount;
+    Lookahead* lookahead = encoder->m_lookahead;
+    lookahead->getWorkerStats(batchElapsedTime, batchCount, coopSliceElapsedTime, coopSliceCount);
+    int64_t lookaheadTime = lookahead->m_slicetypeDecideElapsedTime + lookahead->m_preLookaheadElapsedTime +
+                            batchElapsedTime + coopSliceElapsedTime;
+
+    int64_t interRDOTime = 0, intraRDOTime = 0;
+    for (uint32_t i = 0; i <= param.maxCUDepth; i++)
+    {
+        interRDOTime += cuStats.interRDOElapsedTime[i];
+        intraRDOTime += cuStats.intraRDOElapsedTime[i];
+    }
+    int64_t totalTime = cuStats.totalCTUTime + cuStats.loopFilterElapsedTime + cuStats.pmodeTime +
+                        cuStats.pmeTime + lookaheadTime + cuStats.weightAnalyzeTime;
+    int64_t unaccounted = (cuStats.totalCTUTime + cuStats.pmodeTime) -
+                          (cuStats.intraAnalysisElapsedTime + cuStats.motionEstimationElapsedTime + interRDOTime + intraRDOTime);
+
+    st.motionEstimation = (cuStats.motionEstimationElapsedTime + cuStats.pmeTime) / 1000000.0;
+    st.intraAnalysis = cuStats.intraAnalysisElapsedTime / 1000000.0;
+    st.interRDO = interRDOTime / 1000000.0;
+    st.intraRDO = intraRDOTime / 1000000.0;
+    st.loopFilter = cuStats.loopFilterElapsedTime / 1000000.0;
+    st.weightAnalysis = cuStats.weightAnalyzeTime / 1000000.0;
+    st.lookahead = lookaheadTime / 1000000.0;
+    st.other = unaccounted / 1000000.0;
+    st.total = totalTime / 1000000.0;
+
+    st.workers = 0;
+    for (int i = 0; i < encoder->m_numPools; i++)
+        st.workers += encoder->m_threadPool[i].m_numWorkers;
+    st.workerUtilization = elapsed > 0 ? st.total / elapsed : 0;
+}
+#endif
+
+bool runEncode(const char* preset, int width, int height, int threads, int frames, RunResult& result)
+{
+    memset(&result, 0, sizeof(result));
+    resetPeakRSS();
+
+    x265_param* param = x265_param_alloc();
+    if (!param)
+        return false;
+    if (x265_param_default_preset(param, preset, NULL) < 0)
+    {
+        fprintf(stderr, "encoderbench: unknown preset %s\n", preset);
+        x265_param_free(param);
+        return false;
+    }
+
+    char pools[16];
+    if (threads)
+        sprintf(pools, "%d", threads);
+    else
+        strcpy(pools, "none");
+
+    param->sourceWidth = width;
+    param->sourceHeight = height;
+    param->internalCsp = X265_CSP_I420;
+    param->fpsNum = 30;
+    param->fpsDenom = 1;
+    param->totalFrames = frames;
+    param->logLevel = X265_LOG_ERROR;
+    param->bEnablePsnr = 0;
+    param->bEnableSsim = 0;
+    x265_param_parse(param, "pools", pools);
+
+    x265_encoder* encoder = x265_encoder_open(param);
+    if (!encoder)
+    {
+        fprintf(stderr, "encoderbench: unable to open encoder for %s %dx%d, %d threads\n", preset, width, height, threads);
+        x265_param_free(param);
+        return false;
+    }
+    x265_encoder_parameters(encoder, param);
+    result.frameThreads = param->frameNumThreads;
+
+    x265_picture* pic = x265_picture_alloc();
+    x265_picture_init(param, pic);
+    SyntheticSource source;
+    bool bOk = source.init(width, height);
+
+    x265_nal* nal;
+    uint32_t nalCount;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    int64_t startTime = x265_mdate();
+    double startCpu = cpuSeconds();
+
+    for (int i = 0; bOk && i < frames; i++)
+    {
+        source.generate(i, *pic);
+        if (x265_encoder_encode(encoder, &nal, &nalCount, pic, NULL) < 0)
+            bOk = false;
+        else
+            hashBitstream(hash, nal, nalCount);
+    }
+    while (bOk)
+    {
+        int ret = x265_encoder_encode(encoder, &nal, &nalCount, NULL, NULL);
+        if (ret < 0)
+            bOk = false;
+        else if (!ret)
+            break;
+        else
+            hashBitstream(hash, nal, nalCount);
+    }
+
+    double elapsed = (x265_mdate() - startTime) / 1000000.0;
+    double cpu = cpuSeconds() - startCpu;
+
+    if (bOk)
+    {
+        x265_stats stats;
+        x265_encoder_get_stats(encoder, &stats, sizeof(stats));
+
+        result.elapsed = elapsed;
+        result.fps = elapsed > 0 ? stats.encodedPictureCount / elapsed : 0;
+        result.cpuUtilization = elapsed > 0 ? cpu / elapsed : 0;
+        result.bitrate = stats.bitrate;
+        result.hash = hash;
+        result.peakRSS = peakRSS();
+#if DETAILED_CU_STATS
+        fetchStageTimes(encoder, elapsed, result.stages);
+        result.bHaveStages = true;
+#endif
+    }
+    else
+        fprintf(stderr, "encoderbench: encode failed for %s %dx%d, %d threads\n", preset, width, height, threads);
+
+    x265_encoder_close(encoder);
+    x265_picture_free(pic);
+    x265_param_free(param);
+    return bOk;
+}
+
+int parseList(const char* value, const char** items, char* storage, size_t storageSize)
+{
+    strncpy(storage, value, storageSize - 1);
+    storage[storageSize - 1] = 0;
+    int count = 0;
+    for (char* tok = strtok(storage, ","); tok && count < MAX_LIST; tok = strtok(NULL, ","))
+        items[count++] = tok;
+    return count;
+}
+
+void do_help()
+{
+    printf("x265 whole-encoder benchmark\n\n");
+    printf("usage: EncoderBench [--presets LIST] [--resolutions LIST] [--threads LIST]\n");
+    printf("                    [--frames N] [--runs N] [--output FILE] [--help]\n\n");
+    printf("       --presets      comma separated presets. Default ultrafast,medium\n");
+    printf("       --resolutions  comma separated WxH sizes. Default 640x360,1280x720\n");
+    printf("       --threads      comma separated thread pool sizes, 0 for no thread pool.\n");
+    printf("                      Default 1 and the number of CPUs\n");
+    printf("       --frames       frames encoded per run. Default 60\n");
+    printf("       --runs         runs per configuration, the median run is reported. Default 3\n");
+    printf("       --output       JSON report file. Default stdout\n\n");
+    printf("Every preset, resolution and thread count combination is encoded from the\n");
+    printf("same synthetic content. Per-stage times need a DETAILED_CU_STATS build.\n");
+    printf("Options may be truncated.\n");
+}
+
+void printJSON(FILE* f, const BenchOptions& opt, const RunResult* results, const int* numRuns, int cpuid)
+{
+    char cpus[512] = "";
+    for (int i = 0; cpu_names[i].flags; i++)
+    {
+        if ((cpuid & cpu_names[i].flags) == cpu_names[i].flags && strlen(cpus) + strlen(cpu_names[i].name) + 2 < sizeof(cpus))
+        {
+            if (*cpus)
+                strcat(cpus, " ");
+            strcat(cpus, cpu_names[i].name);
+        }
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"version\": \"%s\",\n", x265_version_str);
+    fprintf(f, "  \"build\": \"%s\",\n", x265_build_info_str);
+    fprintf(f, "  \"bit_depth\": %d,\n", X265_DEPTH);
+    fprintf(f, "  \"cpu\": \"%s\",\n", cpus);
+    fprintf(f, "  \"cpu_count\": %d,\n", ThreadPool::getCpuCount());
+    fprintf(f, "  \"detailed_cu_stats\": %s,\n", DETAILED_CU_STATS ? "true" : "false");
+    fprintf(f, "  \"frames\": %d,\n", opt.frames);
+    fprintf(f, "  \"runs\": %d,\n", opt.runs);
+    fprintf(f, "  \"results\": [");
+
+    int idx = 0;
+    for (int p = 0; p < opt.numPresets; p++)
+    {
+        for (int s = 0; s < opt.numSizes; s++)
+        {
+            double baseFps = 0;
+            for (int t = 0; t < opt.numThreads; t++, idx++)
+            {
+                const RunResult* runs = results + idx * MAX_RUNS;
+                int count = numRuns[idx];
+
+                fprintf(f, "%s\n    {\n", idx ? "," : "");
+                fprintf(f, "      \"preset\": \"%s\",\n", opt.presets[p]);
+                fprintf(f, "      \"width\": %d,\n", opt.width[s]);
+                fprintf(f, "      \"height\": %d,\n", opt.height[s]);
+                fprintf(f, "      \"threads\": %d,\n", opt.threads[t]);
+                if (!count)
+                {
+                    fprintf(f, "      \"error\": true\n    }");
+                    continue;
+                }
+
+                /* median run by fps */
+                int order[MAX_RUNS] = { 0 };
+                for (int i = 0; i < count; i++)
+                    order[i] = i;
+                for (int i = 1; i < count; i++)
+                    for (int j = i; j > 0 && runs[order[j]].fps < runs[order[j - 1]].fps; j--)
+                    {
+                        int tmp = order[j];
+                        order[j] = order[j - 1];
+                        order[j - 1] = tmp;
+                    }
+                const RunResult& r = runs[order[count / 2]];
+                if (!baseFps)
+                    baseFps = r.fps;
+
+                fprintf(f, "      \"frame_threads\": %d,\n", r.frameThreads);
+                fprintf(f, "      \"fps\": %.3f,\n", r.fps);
+                fprintf(f, "      \"fps_runs\": [");
+                for (int i = 0; i < count; i++)
+                    fprintf(f, "%s%.3f", i ? ", " : "", runs[i].fps);
+                fprintf(f, "],\n");
+                fprintf(f, "      \"scaling\": %.3f,\n", baseFps ? r.fps / baseFps : 0);
+                fprintf(f, "      \"elapsed_sec\": %.3f,\n", r.elapsed);
+                fprintf(f, "      \"bitrate_kbps\": %.2f,\n", r.bitrate);
+                fprintf(f, "      \"bitstream_hash\": \"%08x%08x\",\n", (uint32_t)(r.hash >> 32), (uint32_t)r.hash);
+                fprintf(f, "      \"cpu_utilization\": %.3f,\n", r.cpuUtilization);
+                if (r.peakRSS >= 0)
+                    fprintf(f, "      \"peak_rss_kb\": %ld,\n", r.peakRSS);
+                else
+                    fprintf(f, "      \"peak_rss_kb\": null,\n");
+                if (r.bHaveStages)
+                {
+                    const StageTimes& st = r.stages;
+                    fprintf(f, "      \"workers\": %d,\n", st.workers);
+                    fprintf(f, "      \"worker_utilization\": %.3f,\n", st.workerUtilization);
+                    fprintf(f, "      \"stages\": {\n");
+                    fprintf(f, "        \"motion_estimation\": %.4f,\n", st.motionEstimation);
+                    fprintf(f, "        \"intra_analysis\": %.4f,\n", st.intraAnalysis);
+                    fprintf(f, "        \"inter_rdo\": %.4f,\n", st.interRDO);
+                    fprintf(f, "        \"intra_rdo\": %.4f,\n", st.intraRDO);
+                    fprintf(f, "        \"loop_filter\": %.4f,\n", st.loopFilter);
+                    fprintf(f, "        \"weight_analysis\": %.4f,\n", st.weightAnalysis);
+                    fprintf(f, "        \"lookahead\": %.4f,\n", st.lookahead);
+                    fprintf(f, "        \"other\": %.4f,\n", st.other);
+                    fprintf(f, "        \"total\": %.4f\n", st.total);
+                    fprintf(f, "      }\n");
+                }
+                else
+                {
+                    fprintf(f, "      \"workers\": null,\n");
+                    fprintf(f, "      \"worker_utilization\": null,\n");
+                    fprintf(f, "      \"stages\": null\n");
+                }
+                fprintf(f, "    }");
+            }
+        }
+    }
+    fprintf(f, "\n  ]\n}\n");
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    static char presetStorage[256], sizeStorage[256], threadStorage[256];
+    const char* items[MAX_LIST];
+
+    BenchOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.numPresets = parseList("ultrafast,medium", opt.presets, presetStorage, sizeof(presetStorage));
+    opt.width[0] = 640; opt.height[0] = 360;
+    opt.width[1] = 1280; opt.height[1] = 720;
+    opt.numSizes = 2;
+    opt.threads[0] = 1;
+    opt.threads[1] = ThreadPool::getCpuCount();
+    opt.numThreads = opt.threads[1] > 1 ? 2 : 1;
+    opt.frames = 60;
+    opt.runs = 3;
+
+    if (!(argc & 1))
+    {
+        do_help();
+        return 0;
+    }
+    for (int i = 1; i < argc - 1; i += 2)
+    {
+        if (strncmp(argv[i], "--", 2))
+        {
+            printf("** invalid long argument: %s\n\n", argv[i]);
+            do_help();
+            return 1;
+        }
+        const char *name = argv[i] + 2;
+        const char *value = argv[i + 1];
+        if (!strncmp(name, "presets", strlen(name)))
+            opt.numPresets = parseList(value, opt.presets, presetStorage, sizeof(presetStorage));
+        else if (!strncmp(name, "resolutions", strlen(name)))
+        {
+            int count = parseList(value, items, sizeStorage, sizeof(sizeStorage));
+            for (int j = 0; j < count; j++)
+            {
+                if (sscanf(items[j], "%dx%d", &opt.width[j], &opt.height[j]) != 2 ||
+                    opt.width[j] < 64 || opt.height[j] < 64 || (opt.width[j] | opt.height[j]) & 1)
+                {
+                    printf("Invalid resolution: %s\n", items[j]);
+                    return 1;
+                }
+            }
+            opt.numSizes = count;
+        }
+        else if (!strncmp(name, "threads", strlen(name)))
+        {
+            int count = parseList(value, items, threadStorage, sizeof(threadStorage));
+            for (int j = 0; j < count; j++)
+                opt.threads[j] = atoi(items[j]);
+            opt.numThreads = count;
+        }
+        else if (!strncmp(name, "frames", strlen(name)))
+            opt.frames = atoi(value);
+        else if (!strncmp(name, "runs", strlen(name)))
+            opt.runs = atoi(value);
+        else if (!strncmp(name, "output", strlen(name)))
+            opt.output = value;
+        else
+        {
+            printf("** invalid long argument: %s\n\n", name);
+            do_help();
+            return 1;
+        }
+    }
+    if (!opt.numPresets || !opt.numSizes || !opt.numThreads || opt.frames < 1 || opt.runs < 1 || opt.runs > MAX_RUNS)
+    {
+        do_help();
+        return 1;
+    }
+
+    int numConfigs = opt.numPresets * opt.numSizes * opt.numThreads;
+    RunResult* results = X265_MALLOC(RunResult, numConfigs * MAX_RUNS);
+    int* numRuns = X265_MALLOC(int, numConfigs);
+    if (!results || !numRuns)
+        return 1;
+
+    int cpuid = 0;
+    int idx = 0;
+    for (int p = 0; p < opt.numPresets; p++)
+    {
+        for (int s = 0; s < opt.numSizes; s++)
+        {
+            for (int t = 0; t < opt.numThreads; t++, idx++)
+            {
+                numRuns[idx] = 0;
+                for (int r = 0; r < opt.runs; r++)
+                {
+                    fprintf(stderr, "encoderbench: %s %dx%d, %d threads, run %d of %d\n",
+                            opt.presets[p], opt.width[s], opt.height[s], opt.threads[t], r + 1, opt.runs);
+                    RunResult& res = results[idx * MAX_RUNS + numRuns[idx]];
+                    if (!runEncode(opt.presets[p], opt.width[s], opt.height[s], opt.threads[t], opt.frames, res))
+                        break;
+                    numRuns[idx]++;
+                }
+            }
+        }
+    }
+
+    x265_param* param = x265_param_alloc();
+    if (param)
+    {
+        x265_param_default(param);
+        cpuid = param->cpuid;
+        x265_param_free(param);
+    }
+
+    FILE* f = opt.output ? x265_fopen(opt.output, "w") : stdout;
+    if (!f)
+    {
+        fprintf(stderr, "encoderbench: unable to open %s\n", opt.output);
+        return 1;
+    }
+    printJSON(f, opt, results, numRuns, cpuid);
+    if (f != stdout)
+        fclose(f);
+
+    X265_FREE(results);
+    X265_FREE(numRuns);
+    x265_cleanup();
+    return 0;
+}
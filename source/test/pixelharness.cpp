@@ -1569,6 +1569,127 @@ bool PixelHarness::check_planecopy_cp(planecopy_cp_t ref, planecopy_cp_t opt)
     return true;
 }
 
+bool PixelHarness::check_planecopy_nv_cp(planecopy_nv_cp_t ref, planecopy_nv_cp_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[2][32 * 32]);
+    ALIGN_VAR_16(pixel, opt_dest[2][32 * 32]);
+
+    memset(ref_dest, 0xCD, sizeof(ref_dest));
+    memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+    int width = 1 + rand() % 32;
+    int height = 1 + rand() % 32;
+    intptr_t srcStride = 64;
+    intptr_t dstStride = 32;
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        checked(opt, uchar_test_buff[index] + j, srcStride, opt_dest[0], opt_dest[1], dstStride, width, height, X265_DEPTH - 8);
+        ref(uchar_test_buff[index] + j, srcStride, ref_dest[0], ref_dest[1], dstStride, width, height, X265_DEPTH - 8);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_planecopy_nv_sp(planecopy_nv_sp_t ref, planecopy_nv_sp_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[2][32 * 32]);
+    ALIGN_VAR_16(pixel, opt_dest[2][32 * 32]);
+
+    memset(ref_dest, 0xCD, sizeof(ref_dest));
+    memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+    int width = 1 + rand() % 32;
+    int height = 1 + rand() % 32;
+    intptr_t srcStride = 64;
+    intptr_t dstStride = 32;
+    int shift = 16 - X265_DEPTH;
+    uint16_t mask = (uint16_t)((1 << X265_DEPTH) - 1);
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        checked(opt, ushort_test_buff[index] + j, srcStride, opt_dest[0], opt_dest[1], dstStride, width, height, shift, mask);
+        ref(ushort_test_buff[index] + j, srcStride, ref_dest[0], ref_dest[1], dstStride, width, height, shift, mask);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_planecopy_packed(planecopy_packed_t ref, planecopy_packed_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[3][32 * 32]);
+    ALIGN_VAR_16(pixel, opt_dest[3][32 * 32]);
+
+    memset(ref_dest, 0xCD, sizeof(ref_dest));
+    memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+    /* even widths, v210 rows are padded to six pixels in 16 bytes */
+    int width = 2 * (1 + rand() % 15);
+    int height = 1 + rand() % 32;
+    intptr_t srcStride = 96;
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        checked(opt, uchar_test_buff[index] + j, srcStride, opt_dest[0], 32, opt_dest[1], opt_dest[2], 16, width, height);
+        ref(uchar_test_buff[index] + j, srcStride, ref_dest[0], 32, ref_dest[1], ref_dest[2], 16, width, height);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
+bool PixelHarness::check_chroma_downsample(chroma_downsample_t ref, chroma_downsample_t opt)
+{
+    ALIGN_VAR_16(pixel, ref_dest[32 * 32]);
+    ALIGN_VAR_16(pixel, opt_dest[32 * 32]);
+
+    memset(ref_dest, 0xCD, sizeof(ref_dest));
+    memset(opt_dest, 0xCD, sizeof(opt_dest));
+
+    int width = 1 + rand() % 32;
+    int height = 1 + rand() % 32;
+    intptr_t dstStride = 32;
+    int j = 0;
+
+    for (int i = 0; i < ITERS; i++)
+    {
+        int index = i % TEST_CASES;
+        checked(opt, pixel_test_buff[index] + j, STRIDE, opt_dest, dstStride, width, height);
+        ref(pixel_test_buff[index] + j, STRIDE, ref_dest, dstStride, width, height);
+
+        if (memcmp(ref_dest, opt_dest, sizeof(ref_dest)))
+            return false;
+
+        reportfail();
+        j += INCR;
+    }
+
+    return true;
+}
+
 bool PixelHarness::check_cutree_propagate_cost(cutree_propagate_cost ref, cutree_propagate_cost opt)
 {
     ALIGN_VAR_16(int, ref_dest[64 * 64]);
@@ -2926,6 +3047,60 @@ bool PixelHarness::testCorrectness(const EncoderPrimitives& ref, const EncoderPr
         }
     }
 
+    if (opt.planecopy_nv_cp)
+    {
+        if (!check_planecopy_nv_cp(ref.planecopy_nv_cp, opt.planecopy_nv_cp))
+        {
+            printf("planecopy_nv_cp failed\n");
+            return false;
+        }
+    }
+
+    if (opt.planecopy_nv_sp)
+    {
+        if (!check_planecopy_nv_sp(ref.planecopy_nv_sp, opt.planecopy_nv_sp))
+        {
+            printf("planecopy_nv_sp failed\n");
+            return false;
+        }
+    }
+
+    if (opt.planecopy_yuyv)
+    {
+        if (!check_planecopy_packed(ref.planecopy_yuyv, opt.planecopy_yuyv))
+        {
+            printf("planecopy_yuyv failed\n");
+            return false;
+        }
+    }
+
+    if (opt.planecopy_uyvy)
+    {
+        if (!check_planecopy_packed(ref.planecopy_uyvy, opt.planecopy_uyvy))
+        {
+            printf("planecopy_uyvy failed\n");
+            return false;
+        }
+    }
+
+    if (opt.planecopy_v210)
+    {
+        if (!check_planecopy_packed(ref.planecopy_v210, opt.planecopy_v210))
+        {
+            printf("planecopy_v210 failed\n");
+            return false;
+        }
+    }
+
+    if (opt.chroma_downsample)
+    {
+        if (!check_chroma_downsample(ref.chroma_downsample, opt.chroma_downsample))
+        {
+            printf("chroma_downsample failed\n");
+            return false;
+        }
+    }
+
     if (opt.propagateCost)
     {
         if (!check_cutree_propagate_cost(ref.propagateCost, opt.propagateCost))
@@ -3551,6 +3726,36 @@ void PixelHarness::measureSpeed(const EncoderPrimitives& ref, const EncoderPrimi
         REPORT_SPEEDUP(opt.planecopy_cp, ref.planecopy_cp, uchar_test_buff[0], 64, pbuf1, 64, 64, 64, 2);
     }
 
+    if (opt.planecopy_nv_cp)
+    {
+        HEADER0("planecopy_nv_cp");
+        REPORT_SPEEDUP(opt.planecopy_nv_cp, ref.planecopy_nv_cp, uchar_test_buff[0], 64, pbuf1, pbuf2, 64, 32, 64, X265_DEPTH - 8);
+    }
+
+    if (opt.planecopy_nv_sp)
+    {
+        HEADER0("planecopy_nv_sp");
+        REPORT_SPEEDUP(opt.planecopy_nv_sp, ref.planecopy_nv_sp, ushort_test_buff[0], 64, pbuf1, pbuf2, 64, 32, 64, 16 - X265_DEPTH, (uint16_t)((1 << X265_DEPTH) - 1));
+    }
+
+    if (opt.planecopy_yuyv)
+    {
+        HEADER0("planecopy_yuyv");
+        REPORT_SPEEDUP(opt.planecopy_yuyv, ref.planecopy_yuyv, uchar_test_buff[0], 64, pbuf1, 64, pbuf2, pbuf3, 64, 32, 64);
+    }
+
+    if (opt.planecopy_uyvy)
+    {
+        HEADER0("planecopy_uyvy");
+        REPORT_SPEEDUP(opt.planecopy_uyvy, ref.planecopy_uyvy, uchar_test_buff[0], 64, pbuf1, 64, pbuf2, pbuf3, 64, 32, 64);
+    }
+
+    if (opt.chroma_downsample)
+    {
+        HEADER0("chroma_downsample");
+        REPORT_SPEEDUP(opt.chroma_downsample, ref.chroma_downsample, pixel_test_buff[0], 64, pbuf1, 64, 64, 32);
+    }
+
     if (opt.propagateCost)
     {
         HEADER0("propagateCost");
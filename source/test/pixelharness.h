@@ -120,6 +120,10 @@ protected:
     bool check_saoCuStatsE3_t(saoCuStatsE3_t ref, saoCuStatsE3_t opt);
     bool check_planecopy_sp(planecopy_sp_t ref, planecopy_sp_t opt);
     bool check_planecopy_cp(planecopy_cp_t ref, planecopy_cp_t opt);
+    bool check_planecopy_nv_cp(planecopy_nv_cp_t ref, planecopy_nv_cp_t opt);
+    bool check_planecopy_nv_sp(planecopy_nv_sp_t ref, planecopy_nv_sp_t opt);
+    bool check_planecopy_packed(planecopy_packed_t ref, planecopy_packed_t opt);
+    bool check_chroma_downsample(chroma_downsample_t ref, chroma_downsample_t opt);
     bool check_cutree_propagate_cost(cutree_propagate_cost ref, cutree_propagate_cost opt);
     bool check_cutree_fix8_pack(cutree_fix8_pack ref, cutree_fix8_pack opt);
     bool check_cutree_fix8_unpack(cutree_fix8_unpack ref, cutree_fix8_unpack opt);
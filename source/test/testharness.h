@@ -86,6 +86,12 @@ static inline uint32_t __rdtsc(void)
 
     // TO-DO: replace clock() function with appropriate ARM cpu instructions
     a = clock();
+#elif X265_ARCH_ARM64
+    // the virtual counter runs at a fixed frequency below the cpu clock,
+    // which is adequate for the relative timings reported here
+    uint64_t cnt;
+    asm volatile("mrs %0, cntvct_el0" : "=r" (cnt));
+    a = (uint32_t)cnt;
 #endif
     return a;
 }
@@ -136,7 +142,7 @@ int PFX(stack_pagealign)(int (*func)(), int align);
 intptr_t PFX(checkasm_call)(intptr_t (*func)(), int *ok, ...);
 float PFX(checkasm_call_float)(float (*func)(), int *ok, ...);
 #elif X265_ARCH_ARM == 0
-#define PFX(stack_pagealign)(func, align) func()
+static inline int PFX(stack_pagealign)(int (*func)(), int) { return func(); }
 #endif
 
 #if X86_64
@@ -31,6 +31,7 @@
 #include "input/input.h"
 #include "output/output.h"
 #include "output/reconplay.h"
+#include "abrladder.h"
 
 #if HAVE_VLD
 /* Visual Leak Detector */
@@ -76,9 +77,12 @@ struct CLIOptions
     const x265_api* api;
     x265_param* param;
     x265_vmaf_data* vmafData;
+    AbrLadder* ladder;
     bool bProgress;
     bool bForceY4m;
     bool bDither;
+    bool bInputMmap;
+    int readAhead;              // input frames read ahead of the encoder
     uint32_t seek;              // number of frames to skip from the beginning
     uint32_t framesToBeEncoded; // number of frames to encode
     uint64_t totalbytes;
@@ -98,6 +102,7 @@ struct CLIOptions
         api = NULL;
         param = NULL;
         vmafData = NULL;
+        ladder = NULL;
         framesToBeEncoded = seek = 0;
         totalbytes = 0;
         bProgress = true;
@@ -105,6 +110,8 @@ struct CLIOptions
         startTime = x265_mdate();
         prevUpdateTime = 0;
         bDither = false;
+        bInputMmap = false;
+        readAhead = 4;
     }
 
     void destroy();
@@ -127,6 +134,8 @@ void CLIOptions::destroy()
     if (output)
         output->release();
     output = NULL;
+    delete ladder;
+    ladder = NULL;
 }
 
 void CLIOptions::printStatus(uint32_t frameNum)
@@ -166,6 +175,7 @@ bool CLIOptions::parse(int argc, char **argv)
     const char *inputfn = NULL;
     const char *reconfn = NULL;
     const char *outputfn = NULL;
+    const char *ladderfn = NULL;
     const char *preset = NULL;
     const char *tune = NULL;
     const char *profile = NULL;
@@ -294,10 +304,14 @@ bool CLIOptions::parse(int argc, char **argv)
             OPT("frames") this->framesToBeEncoded = (uint32_t)x265_atoi(optarg, bError);
             OPT("no-progress") this->bProgress = false;
             OPT("output") outputfn = optarg;
+            OPT("abr-ladder") ladderfn = optarg;
             OPT("input") inputfn = optarg;
             OPT("recon") reconfn = optarg;
             OPT("input-depth") inputBitDepth = (uint32_t)x265_atoi(optarg, bError);
             OPT("dither") this->bDither = true;
+            OPT("input-mmap") this->bInputMmap = true;
+            OPT("no-input-mmap") this->bInputMmap = false;
+            OPT("input-read-ahead") this->readAhead = x265_atoi(optarg, bError);
             OPT("recon-depth") reconFileBitDepth = (uint32_t)x265_atoi(optarg, bError);
             OPT("y4m") this->bForceY4m = true;
             OPT("profile") /* handled above */;
@@ -347,7 +361,7 @@ bool CLIOptions::parse(int argc, char **argv)
         showHelp(param);
     }
 
-    if (!inputfn || !outputfn)
+    if (!inputfn || (!outputfn && !ladderfn))
     {
         x265_log(param, X265_LOG_ERROR, "input or output file not specified, try --help for help\n");
         return true;
@@ -370,6 +384,8 @@ bool CLIOptions::parse(int argc, char **argv)
     info.sarWidth = param->vui.sarWidth;
     info.sarHeight = param->vui.sarHeight;
     info.skipFrames = seek;
+    info.readAhead = readAhead;
+    info.bMmap = bInputMmap;
     info.frameCount = 0;
     getParamAspectRatio(param, info.sarWidth, info.sarHeight);
 
@@ -432,6 +448,19 @@ bool CLIOptions::parse(int argc, char **argv)
 
     this->input->startReader();
 
+    if (ladderfn)
+    {
+        if (reconfn || reconPlayCmd)
+        {
+            x265_log(param, X265_LOG_ERROR, "recon outputs are not supported with abr-ladder\n");
+            return true;
+        }
+        if (outputfn)
+            x265_log(param, X265_LOG_WARNING, "output file <%s> ignored, abr-ladder rungs have their own outputs\n", outputfn);
+        this->ladder = new AbrLadder;
+        return this->ladder->parse(ladderfn, api, param, info);
+    }
+
     if (reconfn)
     {
         if (reconFileBitDepth == 0)
@@ -552,6 +581,84 @@ static int get_argv_utf8(int *argc_ptr, char ***argv_ptr)
 }
 #endif
 
+/* encodes all the rungs of an abr-ladder from the shared input, returns a
+ * CLI return code */
+static int encodeLadder(CLIOptions& cliopt, int argc, char **argv)
+{
+    AbrLadder* ladder = cliopt.ladder;
+    x265_param* param = cliopt.param;
+    int ret = ladder->open();
+    if (ret)
+    {
+        ladder->close(argc, argv, true);
+        return ret;
+    }
+
+    /* Control-C handler */
+    if (signal(SIGINT, sigint_handler) == SIG_ERR)
+        x265_log(param, X265_LOG_ERROR, "Unable to register CTRL+C handler: %s\n", strerror(errno));
+
+    x265_picture pic_orig;
+    x265_picture *pic_in = &pic_orig;
+    uint32_t inFrameCount = 0;
+    int16_t *errorBuf = NULL;
+
+    cliopt.api->picture_init(param, pic_in);
+
+    if (cliopt.bDither)
+    {
+        errorBuf = X265_MALLOC(int16_t, param->sourceWidth + 1);
+        if (errorBuf)
+            memset(errorBuf, 0, (param->sourceWidth + 1) * sizeof(int16_t));
+        else
+            cliopt.bDither = false;
+    }
+
+    while (pic_in && !b_ctrl_c)
+    {
+        pic_orig.poc = inFrameCount;
+        if (cliopt.framesToBeEncoded && inFrameCount >= cliopt.framesToBeEncoded)
+            pic_in = NULL;
+        else if (cliopt.input->readPicture(pic_orig))
+            inFrameCount++;
+        else
+            pic_in = NULL;
+
+        if (pic_in)
+        {
+            if (pic_in->bitDepth > param->internalBitDepth && cliopt.bDither)
+            {
+                x265_dither_image(pic_in, cliopt.input->getWidth(), cliopt.input->getHeight(), errorBuf, param->internalBitDepth);
+                pic_in->bitDepth = param->internalBitDepth;
+            }
+            /* Overwrite PTS */
+            pic_in->pts = pic_in->poc;
+        }
+
+        /* a NULL picture flushes every rung */
+        if (!ladder->encode(pic_in))
+        {
+            b_ctrl_c = 1;
+            ret = 4;
+            break;
+        }
+
+        cliopt.totalbytes = ladder->totalBytes();
+        cliopt.printStatus(ladder->rootFrameCount());
+    }
+
+    /* clear progress report */
+    if (cliopt.bProgress)
+        fprintf(stderr, "%*s\r", 80, " ");
+
+    ladder->close(argc, argv, !!b_ctrl_c);
+    if (b_ctrl_c)
+        general_log(param, NULL, X265_LOG_INFO, "aborted at input frame %d\n", cliopt.seek + inFrameCount);
+
+    X265_FREE(errorBuf);
+    return ret;
+}
+
 /* CLI return codes:
  *
  * 0 - encode successful
@@ -589,6 +696,23 @@ int main(int argc, char **argv)
 
     x265_param* param = cliopt.param;
     const x265_api* api = cliopt.api;
+
+    if (cliopt.ladder)
+    {
+        int ret = encodeLadder(cliopt, argc, argv);
+
+        api->cleanup(); /* Free library singletons */
+        cliopt.destroy();
+        api->param_free(param);
+
+        SetConsoleTitle(orgConsoleTitle);
+        SetThreadExecutionState(ES_CONTINUOUS);
+#if _WIN32
+        if (argv != orgArgv)
+            free(argv);
+#endif
+        return ret;
+    }
 #if ENABLE_LIBVMAF
     x265_vmaf_data* vmafdata = cliopt.vmafData;
 #endif
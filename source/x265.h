@@ -39,6 +39,10 @@ typedef struct x265_encoder x265_encoder;
  *      opaque handler for PicYuv */
 typedef struct x265_picyuv x265_picyuv;
 
+/* x265_threadpool:
+ *      opaque handler for a set of worker thread pools shared by encoders */
+typedef struct x265_threadpool x265_threadpool;
+
 /* Application developers planning to link against a shared library version of
  * libx265 from a Microsoft Visual Studio or similar development environment
  * will need to define X265_API_IMPORTS before including this header.
@@ -228,6 +232,8 @@ typedef struct x265_frame_stats
     x265_pu_stats    puStats;
     double           totalFrameTime;
     double           vmafFrameScore;
+    int              lookaheadInputDepth;
+    int              lookaheadOutputDepth;
 } x265_frame_stats;
 
 typedef struct x265_ctu_info_t
@@ -340,8 +346,10 @@ typedef struct x265_picture
     int     poc;
 
     /* Must be specified on input pictures: X265_CSP_I420 or other. It must
-     * match the internal color space of the encoder. x265_picture_init() will
-     * initialize this value to the internal color space */
+     * match the internal color space of the encoder, or be one of the
+     * semi-planar and packed color spaces converted at ingest (see
+     * X265_CSP_NV12). x265_picture_init() will initialize this value to the
+     * internal color space */
     int     colorSpace;
 
     /* Force the slice base QP for this picture within the encoder. Set to 0
@@ -387,6 +395,17 @@ typedef struct x265_picture
 
     // pts is reordered in the order of encoding.
     int64_t reorderedPts;
+
+    /* Zero-copy input, only used when param.bCopyPicToFrame is disabled, and
+     * by asynchronous encoders. The encoder then works directly on the planes
+     * of the input picture, which must follow the layout given by
+     * x265_encoder_input_layout(), and calls planesRelease(planesOpaque,
+     * planes) from any of its threads once it no longer accesses them, even
+     * if the picture is rejected. The planes must not be modified or freed
+     * before. May be NULL if the application tracks the lifetime of the
+     * planes */
+    void  (*planesRelease)(void* planesOpaque, void* planes[3]);
+    void*   planesOpaque;
 } x265_picture;
 
 typedef enum
@@ -434,11 +453,14 @@ typedef enum
                                              * new SLOW flags. */
 #define X265_CPU_SLOW_PSHUFB     (1 << 24)  /* such as on the Intel Atom */
 #define X265_CPU_SLOW_PALIGNR    (1 << 25)  /* such as on the AMD Bobcat */
+#define X265_CPU_SLOW_AVX512     (1 << 26)  /* 512bit instructions lower the core clock, such as on Skylake-X */
 
 /* ARM */
 #define X265_CPU_ARMV6           0x0000001
 #define X265_CPU_NEON            0x0000002  /* ARM NEON */
 #define X265_CPU_FAST_NEON_MRC   0x0000004  /* Transfer from NEON to ARM register is fast (Cortex-A9) */
+#define X265_CPU_SVE             0x0000008  /* AArch64 Scalable Vector Extension */
+#define X265_CPU_SVE2            0x0000010  /* AArch64 SVE2 */
 
 /* IBM Power8 */
 #define X265_CPU_ALTIVEC         0x0000001
@@ -492,8 +514,11 @@ typedef enum
 #define X265_CSP_I444           3  /* yuv 4:4:4 planar */
 #define X265_CSP_COUNT          4  /* Number of supported internal color spaces */
 
-/* These color spaces will eventually be supported as input pictures. The pictures will
- * be converted to the appropriate planar color spaces at ingest */
+/* Semi-planar and packed color spaces accepted on input pictures, they are
+ * converted to the internal color space of the encoder at ingest. Semi-planar
+ * pictures with more than 8 bits use 16 bit samples, P010 and P016 are NV12
+ * pictures of bitDepth 16. Packed yuv 4:2:2 pictures have a single plane and
+ * the 4:2:2 color spaces, planar I422 included, may be encoded as 4:2:0 */
 #define X265_CSP_NV12           4  /* yuv 4:2:0, with one y plane and one packed u+v */
 #define X265_CSP_NV16           5  /* yuv 4:2:2, with one y plane and one packed u+v */
 
@@ -501,7 +526,11 @@ typedef enum
 #define X265_CSP_BGR            6  /* packed bgr 24bits   */
 #define X265_CSP_BGRA           7  /* packed bgr 32bits   */
 #define X265_CSP_RGB            8  /* packed rgb 24bits   */
-#define X265_CSP_MAX            9  /* end of list */
+
+#define X265_CSP_YUYV           9  /* packed yuv 4:2:2 y0 u y1 v, bitDepth 8 */
+#define X265_CSP_UYVY           10 /* packed yuv 4:2:2 u y0 v y1, bitDepth 8 */
+#define X265_CSP_V210           11 /* packed yuv 4:2:2, bitDepth 10, 6 pixels per 16 bytes */
+#define X265_CSP_MAX            12 /* end of list */
 #define X265_EXTENDED_SAR       255 /* aspect ratio explicitly specified as width:height */
 /* Analysis options */
 #define X265_ANALYSIS_OFF  0
@@ -1605,7 +1634,10 @@ typedef struct x265_param
 
     /* Reuse MV information obtained through API */
     int       bMVType;
-    /* Allow the encoder to have a copy of the planes of x265_picture in Frame */
+    /* Allow the encoder to have a copy of the planes of x265_picture in Frame.
+     * When disabled, input pictures are encoded from the planes of the
+     * application (zero-copy input), see x265_picture.planesRelease and
+     * x265_encoder_input_layout(). Default enabled */
     int       bCopyPicToFrame;
 
     /*Number of frames for GOP boundary decision lookahead.If a scenecut frame is found
@@ -1638,6 +1670,96 @@ typedef struct x265_param
 
     /* Enable writing all SEI messgaes in one single NAL instead of mul*/
     int       bSingleSeiNal;
+
+    /* Idle time in milliseconds after which a worker thread of one thread pool
+     * may perform jobs (WPP rows, lookahead batches) for the frame encoders and
+     * lookahead bound to other thread pools, nearest NUMA node first. Only
+     * relevant when more than one thread pool is created. Default 0, disabled */
+    int       poolStealThreshold;
+
+    /* When frame parallelism is active, allow a CTU to be encoded as soon as
+     * the CTUs of its reference pictures within the motion search range are
+     * reconstructed, rather than waiting for whole CTU rows. Motion vectors
+     * pointing right are then limited to the search range, as those pointing
+     * down always are. Not compatible with multiple slices or --me sea.
+     * Default disabled */
+    int       bEnableColumnSync;
+
+    /* Number of input pictures whose lowres planes and adaptive quant offsets
+     * may be generated concurrently, split in row bands, by the lookahead
+     * worker threads as soon as the pictures are received, ahead of and
+     * independently from slice type decisions. 0 leaves this pre-analysis to
+     * slicetypeDecide(). Requires a thread pool. Default 0 */
+    int       preLookaheadDepth;
+
+    /* Number of coarser levels (quarter, then eighth resolution) of the lowres
+     * pyramid searched, coarsest first, ahead of the lookahead motion
+     * searches, each level seeding the searches of the next finer level. This
+     * extends the effective lookahead search range to large motion, and the
+     * lowres MVs are motion candidates of the full resolution searches. 0
+     * disables the hierarchical search. Default 0 */
+    int       hmeLevels;
+
+    /* Use the lookahead (lowres) MV, scaled to full resolution, as a starting
+     * point of the full resolution motion searches, in addition to being a
+     * motion candidate. 1 starts the search at the lowres MV when its SAD is
+     * lower than at the MVP, 2 also limits the search range to 16 when the
+     * search starts there. Default 0 */
+    int       lowresMvSeed;
+
+    /* Use the indexed analysis file format with analysis-save and
+     * analysis-load. Frame records are aligned and hold the analysis arrays
+     * expanded to 4x4 partitions, so the load encoder memory maps the file
+     * and points the x265_analysis_data buffers into the mapping instead of
+     * reading and expanding them. Not supported with scaleFactor nor with
+     * bDisableLookahead. Default disabled */
+    int       bAnalysisMmap;
+
+    /* Compress the analysis arrays written by analysis-save: MVs are delta
+     * coded and every array is entropy coded, in one block per frame. The
+     * analysis-load encoder detects compressed files by themselves. Not
+     * supported with bAnalysisMmap. Default disabled */
+    int       bAnalysisCompress;
+
+    /* Thread pools created by x265_threadpool_create(), shared with the other
+     * encoders of the process which use them, instead of pools owned by this
+     * encoder. The pools must be created by the same libx265 (x265_api) as the
+     * encoder and outlive it. numaPools, poolStealThreshold and
+     * lookaheadThreads are then properties of the pools and are ignored.
+     * Default NULL */
+    x265_threadpool* threadPool;
+
+    /* Weight of this encoder when it competes with the other encoders of a
+     * shared thread pool (see threadPool) for worker threads; workers are
+     * shared between busy encoders in proportion to their weights. Default 1 */
+    int       poolWeight;
+
+    /* Write the multi-pass stats file in the binary format: fixed size frame
+     * records with the cu-tree data inline, instead of the text stats file
+     * and its .cutree companion. Reading passes detect the format by
+     * themselves. Default disabled */
+    int       bStatsBinary;
+
+    /* Micro-benchmark, when the primitive table is first set up, the
+     * implementations of every tuned primitive available at and below the
+     * detected CPU capabilities (cpuid), and use the fastest on this host
+     * rather than the one of the highest capability. This takes a fraction of
+     * a second and does not change the encoder output. Default disabled */
+    int       bPrimitiveTune;
+
+    /* File caching the choices of bPrimitiveTune, which it implies. When the
+     * file was written for the same build, bit depth, CPU capabilities and
+     * CPU type (vendor, family, model and stepping) its choices are used
+     * without measuring, otherwise the primitives are measured and the file
+     * is (re)written. Default NULL */
+    const char* primitiveTuneFile;
+
+    /* Distribute the jobs of the lookahead batch, slice and pre-lookahead
+     * task groups over one queue per participating thread, from which idle
+     * threads steal half the remaining jobs of another, rather than handing
+     * every job out of one counter under a shared lock. Does not change the
+     * encoder output. Default enabled */
+    int       bLookaheadSteal;
 } x265_param;
 
 /* x265_param_alloc:
@@ -1853,6 +1975,77 @@ int x265_get_ref_frame_list(x265_encoder *encoder, x265_picyuv**, x265_picyuv**,
  *     returns negative on error, 0 access unit were output. */
 int x265_set_analysis_data(x265_encoder *encoder, x265_analysis_data *analysis_data, int poc, uint32_t cuBytes);
 
+/* x265_threadpool_create:
+ *      create a set of worker thread pools, sized by the numaPools and
+ *      poolStealThreshold fields of param, which any number of encoders of
+ *      this process may then share by setting param->threadPool before they
+ *      are opened. Returns NULL if no thread pool could be created */
+x265_threadpool* x265_threadpool_create(x265_param *);
+
+/* x265_threadpool_free:
+ *      stop the worker threads and release the pools. All the encoders using
+ *      them must have been closed; returns 0 on success, negative if an
+ *      encoder is still attached, in which case the pools are left intact */
+int x265_threadpool_free(x265_threadpool *);
+
+/* x265_encoder_input_layout:
+ *      get the layout of the planes of the input pictures accepted without a
+ *      copy when param.bCopyPicToFrame is disabled: the stride in bytes of
+ *      each plane, and the offset of its first pixel from the start of a
+ *      buffer of size bytes allocated with 64 byte alignment. The margins
+ *      around the pixels are written by the encoder (edge padding and border
+ *      extension). Planes absent from the color space have a zero size.
+ *      Returns 0 on success, negative on error */
+int x265_encoder_input_layout(x265_encoder *, int stride[3], int offset[3], int size[3]);
+
+/* events of asynchronous encoders */
+#define X265_ASYNC_OUTPUT   0  /* the NALs of one output picture, and the picture */
+#define X265_ASYNC_READY    1  /* the input queue has room again after a refused submit */
+#define X265_ASYNC_FLUSHED  2  /* the flush is complete, the stream has been output */
+#define X265_ASYNC_ERROR    3  /* the encoder aborted */
+
+/* Called by the encoder thread running an asynchronous encoder. nal, numNal
+ * and picOut are only set for X265_ASYNC_OUTPUT and are valid until the
+ * callback returns; they are the pp_nal, pi_nal and pic_out outputs of
+ * x265_encoder_encode() */
+typedef void (*x265_async_callback)(void* opaque, int event, x265_nal* nal, uint32_t numNal, x265_picture* picOut);
+
+/* x265_encoder_async_start:
+ *      make the encoder asynchronous: pictures are then given to
+ *      x265_encoder_submit(), which does not block, and the output is passed
+ *      to callback, with opaque, by a thread of the encoder which feeds the
+ *      queued pictures to the encoder. At most queueSize pictures wait in the
+ *      queue. The callback may call the other x265_encoder functions except
+ *      x265_encoder_encode() and x265_encoder_close(). Must be called before
+ *      any picture is encoded. Returns 0 on success, negative on error */
+int x265_encoder_async_start(x265_encoder *, int queueSize, x265_async_callback callback, void* opaque);
+
+/* x265_encoder_submit:
+ *      queue a picture for an asynchronous encoder, or its flush if pic_in is
+ *      NULL. The picture structure is copied but its planes, and the buffers
+ *      it points to, are owned by the encoder until pic_in->planesRelease is
+ *      called, whether the encoder copies input pictures or not. Returns 1 if
+ *      the picture was queued, 0 if the queue is full in which case the
+ *      X265_ASYNC_READY event follows, negative after a flush or an error */
+int x265_encoder_submit(x265_encoder *, x265_picture *pic_in);
+
+/* Called by the encoder threads with the NAL units of an access unit as soon
+ * as they are final: the parameter sets and prefix SEI, then each slice once
+ * all its CTU rows are coded, then with bLast set the suffix SEI and filler
+ * data, which may be none. Access units are published in encode order, poc
+ * and pts identify the picture. The NALs are valid until the callback
+ * returns, which should be quick since calls are serialized */
+typedef void (*x265_nal_callback)(void* opaque, x265_nal* nal, uint32_t numNal, int poc, int64_t pts, int bLast);
+
+/* x265_encoder_slice_output:
+ *      publish the NAL units of each access unit slice by slice through
+ *      callback, with opaque, for sub-frame latency. The complete access units
+ *      are still returned by x265_encoder_encode(). With SAO the slices are
+ *      only final once the whole picture is filtered, use --no-sao for output
+ *      before the picture is complete. Must be called before any picture is
+ *      encoded. Returns 0 on success, negative on error */
+int x265_encoder_slice_output(x265_encoder *, x265_nal_callback callback, void* opaque);
+
 /* x265_cleanup:
  *       release library static allocations, reset configured CTU size */
 void x265_cleanup(void);
@@ -1875,7 +2068,7 @@ void x265_csvlog_frame(const x265_param *, const x265_picture *);
 void x265_csvlog_encode(const x265_param*, const x265_stats *, int padx, int pady, int argc, char** argv);
 
 /* In-place downshift from a bit-depth greater than 8 to a bit-depth of 8, using
- * the residual bits to dither each row. */
+ * the residual bits to dither each row. Only planar color spaces are supported. */
 void x265_dither_image(x265_picture *, int picWidth, int picHeight, int16_t *errorBuf, int bitDepth);
 #if ENABLE_LIBVMAF
 /* x265_calculate_vmafScore:
@@ -1951,6 +2144,12 @@ typedef struct x265_api
     double        (*calculate_vmaf_framelevelscore)(x265_vmaf_framedata *);
     void          (*vmaf_encoder_log)(x265_encoder*, int, char**, x265_param *, x265_vmaf_data *);
 #endif
+    x265_threadpool* (*threadpool_create)(x265_param*);
+    int           (*threadpool_free)(x265_threadpool*);
+    int           (*encoder_input_layout)(x265_encoder*, int*, int*, int*);
+    int           (*encoder_async_start)(x265_encoder*, int, x265_async_callback, void*);
+    int           (*encoder_submit)(x265_encoder*, x265_picture*);
+    int           (*encoder_slice_output)(x265_encoder*, x265_nal_callback, void*);
     /* add new pointers to the end, or increment X265_MAJOR_VERSION */
 } x265_api;
 
@@ -42,8 +42,13 @@ static const struct option long_options[] =
     { "version",              no_argument, NULL, 'V' },
     { "asm",            required_argument, NULL, 0 },
     { "no-asm",               no_argument, NULL, 0 },
+    { "primitive-tune",       no_argument, NULL, 0 },
+    { "no-primitive-tune",    no_argument, NULL, 0 },
+    { "primitive-tune-file", required_argument, NULL, 0 },
     { "pools",          required_argument, NULL, 0 },
     { "numa-pools",     required_argument, NULL, 0 },
+    { "pool-steal",     required_argument, NULL, 0 },
+    { "pool-weight",    required_argument, NULL, 0 },
     { "preset",         required_argument, NULL, 'p' },
     { "tune",           required_argument, NULL, 't' },
     { "frame-threads",  required_argument, NULL, 'F' },
@@ -64,9 +69,13 @@ static const struct option long_options[] =
     { "no-cu-stats",          no_argument, NULL, 0 },
     { "cu-stats",             no_argument, NULL, 0 },
     { "y4m",                  no_argument, NULL, 0 },
+    { "input-mmap",           no_argument, NULL, 0 },
+    { "no-input-mmap",        no_argument, NULL, 0 },
+    { "input-read-ahead", required_argument, NULL, 0 },
     { "no-progress",          no_argument, NULL, 0 },
     { "output",         required_argument, NULL, 'o' },
     { "output-depth",   required_argument, NULL, 'D' },
+    { "abr-ladder",     required_argument, NULL, 0 },
     { "input",          required_argument, NULL, 0 },
     { "input-depth",    required_argument, NULL, 0 },
     { "input-res",      required_argument, NULL, 0 },
@@ -81,6 +90,8 @@ static const struct option long_options[] =
     { "recon-depth",    required_argument, NULL, 0 },
     { "no-wpp",               no_argument, NULL, 0 },
     { "wpp",                  no_argument, NULL, 0 },
+    { "no-column-sync",       no_argument, NULL, 0 },
+    { "column-sync",          no_argument, NULL, 0 },
     { "ctu",            required_argument, NULL, 's' },
     { "min-cu-size",    required_argument, NULL, 0 },
     { "max-tu-size",    required_argument, NULL, 0 },
@@ -90,6 +101,7 @@ static const struct option long_options[] =
     { "me",             required_argument, NULL, 0 },
     { "subme",          required_argument, NULL, 'm' },
     { "merange",        required_argument, NULL, 0 },
+    { "lowres-mv-seed", required_argument, NULL, 0 },
     { "max-merge",      required_argument, NULL, 0 },
     { "no-temporal-mvp",      no_argument, NULL, 0 },
     { "temporal-mvp",         no_argument, NULL, 0 },
@@ -130,6 +142,10 @@ static const struct option long_options[] =
     { "rc-lookahead",   required_argument, NULL, 0 },
     { "lookahead-slices", required_argument, NULL, 0 },
     { "lookahead-threads", required_argument, NULL, 0 },
+    { "pre-lookahead-depth", required_argument, NULL, 0 },
+    { "lookahead-steal",      no_argument, NULL, 0 },
+    { "no-lookahead-steal",   no_argument, NULL, 0 },
+    { "hme-levels",     required_argument, NULL, 0 },
     { "bframes",        required_argument, NULL, 'b' },
     { "bframe-bias",    required_argument, NULL, 0 },
     { "b-adapt",        required_argument, NULL, 0 },
@@ -247,6 +263,8 @@ static const struct option long_options[] =
     { "nr-inter",       required_argument, NULL, 0 },
     { "stats",          required_argument, NULL, 0 },
     { "pass",           required_argument, NULL, 0 },
+    { "stats-binary",         no_argument, NULL, 0 },
+    { "no-stats-binary",      no_argument, NULL, 0 },
     { "multi-pass-opt-analysis", no_argument, NULL, 0 },
     { "no-multi-pass-opt-analysis",    no_argument, NULL, 0 },
     { "multi-pass-opt-distortion",     no_argument, NULL, 0 },
@@ -260,6 +278,10 @@ static const struct option long_options[] =
     { "analysis-reuse-level", required_argument, NULL, 0 },
     { "analysis-save",  required_argument, NULL, 0 },
     { "analysis-load",  required_argument, NULL, 0 },
+    { "analysis-mmap",        no_argument, NULL, 0 },
+    { "no-analysis-mmap",     no_argument, NULL, 0 },
+    { "analysis-compress",    no_argument, NULL, 0 },
+    { "no-analysis-compress", no_argument, NULL, 0 },
     { "scale-factor",   required_argument, NULL, 0 },
     { "refine-intra",   required_argument, NULL, 0 },
     { "refine-inter",   required_argument, NULL, 0 },
@@ -333,6 +355,7 @@ static void showHelp(x265_param *param)
     H0("\nOutput Options:\n");
     H0("-o/--output <filename>           Bitstream output file name\n");
     H0("-D/--output-depth 8|10|12        Output bit depth (also internal bit depth). Default %d\n", param->internalBitDepth);
+    H1("   --abr-ladder <filename>       Encode the ladder of rungs described in the file, sharing the input and a single lookahead\n");
     H0("   --log-level <string>          Logging level: none error warning info debug full. Default %s\n", X265_NS::logLevelNames[param->logLevel + 1]);
     H0("   --no-progress                 Disable CLI progress reports\n");
     H0("   --csv <filename>              Comma separated log file, if csv-log-level > 0 frame level statistics, else one line per run\n");
@@ -348,6 +371,8 @@ static void showHelp(x265_param *param)
     H1("                                 1 - i420 (4:2:0 default)\n");
     H1("                                 2 - i422 (4:2:2)\n");
     H1("                                 3 - i444 (4:4:4)\n");
+    H1("   --[no-]input-mmap             Map the input file in memory instead of reading it. Default disabled\n");
+    H1("   --input-read-ahead <integer>  Input frames read ahead of the encoder. Default 4\n");
 #if ENABLE_HDR10_PLUS
     H0("   --dhdr10-info <filename>      JSON file containing the Creative Intent Metadata to be encoded as Dynamic Tone Mapping\n");
     H0("   --[no-]dhdr10-opt             Insert tone mapping SEI only for IDR frames and when the tone mapping information changes. Default disabled\n");
@@ -369,12 +394,17 @@ static void showHelp(x265_param *param)
     H0("\nThreading, performance:\n");
     H0("   --pools <integer,...>         Comma separated thread count per thread pool (pool per NUMA node)\n");
     H0("                                 '-' implies no threads on node, '+' implies one thread per core on node\n");
+    H0("   --pool-steal <integer>        Idle ms after which workers may help other thread pools. 0 disables. Default %d\n", param->poolStealThreshold);
+    H1("   --pool-weight <integer>       Share of the workers of thread pools shared by several encoders. Default %d\n", param->poolWeight);
     H0("-F/--frame-threads <integer>     Number of concurrently encoded frames. 0: auto-determined by core count\n");
     H0("   --[no-]wpp                    Enable Wavefront Parallel Processing. Default %s\n", OPT(param->bEnableWavefront));
+    H0("   --[no-]column-sync            Synchronize frame threads on reference CTUs rather than CTU rows. Default %s\n", OPT(param->bEnableColumnSync));
     H0("   --[no-]slices <integer>       Enable Multiple Slices feature. Default %d\n", param->maxSlices);
     H0("   --[no-]pmode                  Parallel mode analysis. Default %s\n", OPT(param->bDistributeModeAnalysis));
     H0("   --[no-]pme                    Parallel motion estimation. Default %s\n", OPT(param->bDistributeMotionEstimation));
     H0("   --[no-]asm <bool|int|string>  Override CPU detection. Default: auto\n");
+    H1("   --[no-]primitive-tune         Measure the SIMD primitives at startup and use the fastest. Default %s\n", OPT(param->bPrimitiveTune));
+    H1("   --primitive-tune-file <filename> Cache of the --primitive-tune measurements. Default none\n");
     H0("\nPresets:\n");
     H0("-p/--preset <string>             Trade off performance for compression efficiency. Default medium\n");
     H0("                                 ultrafast, superfast, veryfast, faster, fast, medium, slow, slower, veryslow, or placebo\n");
@@ -419,6 +449,7 @@ static void showHelp(x265_param *param)
     H0("   --me <string>                 Motion search method dia hex umh star full. Default %d\n", param->searchMethod);
     H0("-m/--subme <integer>             Amount of subpel refinement to perform (0:least .. 7:most). Default %d \n", param->subpelRefine);
     H0("   --merange <integer>           Motion search range. Default %d\n", param->searchRange);
+    H1("   --lowres-mv-seed <0..2>       Start motion searches at the lookahead MV: 1 - start point, 2 - also narrow the range. Default %d\n", param->lowresMvSeed);
     H0("   --[no-]rect                   Enable rectangular motion partitions Nx2N and 2NxN. Default %s\n", OPT(param->bEnableRectInter));
     H0("   --[no-]amp                    Enable asymmetric motion partitions, requires --rect. Default %s\n", OPT(param->bEnableAMP));
     H0("   --[no-]limit-modes            Limit rectangular and asymmetric motion predictions. Default %d\n", param->limitModes);
@@ -442,6 +473,9 @@ static void showHelp(x265_param *param)
     H0("   --rc-lookahead <integer>      Number of frames for frame-type lookahead (determines encoder latency) Default %d\n", param->lookaheadDepth);
     H1("   --lookahead-slices <0..16>    Number of slices to use per lookahead cost estimate. Default %d\n", param->lookaheadSlices);
     H0("   --lookahead-threads <integer> Number of threads to be dedicated to perform lookahead only. Default %d\n", param->lookaheadThreads);
+    H1("   --pre-lookahead-depth <integer> Pictures whose lowres and AQ analysis may run concurrently ahead of lookahead. Default %d\n", param->preLookaheadDepth);
+    H1("   --[no-]lookahead-steal        Per-thread job queues with work stealing for lookahead task groups. Default %s\n", OPT(param->bLookaheadSteal));
+    H1("   --hme-levels <0..2>           Coarser lowres levels searched to seed lookahead motion searches. Default %d\n", param->hmeLevels);
     H0("-b/--bframes <0..16>             Maximum number of consecutive b-frames. Default %d\n", param->bframes);
     H1("   --bframe-bias <integer>       Bias towards B frame decisions. Default %d\n", param->bFrameBias);
     H0("   --b-adapt <0..2>              0 - none, 1 - fast, 2 - full (trellis) adaptive B frame scheduling. Default %d\n", param->bFrameAdaptive);
@@ -475,11 +509,14 @@ static void showHelp(x265_param *param)
     H0("   --[no-]multi-pass-opt-analysis   Refine analysis in 2 pass based on analysis information from pass 1\n");
     H0("   --[no-]multi-pass-opt-distortion Use distortion of CTU from pass 1 to refine qp in 2 pass\n");
     H0("   --stats                       Filename for stats file in multipass pass rate control. Default x265_2pass.log\n");
+    H1("   --[no-]stats-binary           Write the stats file in the binary format, with the CU-tree data inline. Default %s\n", OPT(param->bStatsBinary));
     H0("   --[no-]analyze-src-pics       Motion estimation uses source frame planes. Default disable\n");
     H0("   --[no-]slow-firstpass         Enable a slow first pass in a multipass rate control mode. Default %s\n", OPT(param->rc.bEnableSlowFirstPass));
     H0("   --[no-]strict-cbr             Enable stricter conditions and tolerance for bitrate deviations in CBR mode. Default %s\n", OPT(param->rc.bStrictCbr));
     H0("   --analysis-save <filename>    Dump analysis info into the specified file. Default Disabled\n");
     H0("   --analysis-load <filename>    Load analysis buffers from the file specified. Default Disabled\n");
+    H1("   --[no-]analysis-mmap          Save and load an indexed analysis file, memory mapped by analysis-load. Default %s\n", OPT(param->bAnalysisMmap));
+    H1("   --[no-]analysis-compress      Compress the analysis data written by analysis-save. Default %s\n", OPT(param->bAnalysisCompress));
     H0("   --analysis-reuse-file <filename>    Specify file name used for either dumping or reading analysis data. Deault x265_analysis.dat\n");
     H0("   --analysis-reuse-level <1..10>      Level of analysis reuse indicates amount of info stored/reused in save/load mode, 1:least..10:most. Default %d\n", param->analysisReuseLevel);
     H0("   --refine-mv-type <string>     Reuse MV information received through API call. Supported option is avc. Default disabled - %d\n", param->bMVType);